@@ -2,6 +2,7 @@
 #define ASSEMBLER_H
 
 #include <stdint.h>
+#include "object.h"
 
 #define OP_LODD  0x0
 #define OP_STOD  0x1
@@ -28,54 +29,224 @@
 #define OP_INSP  0xFC0
 #define OP_DESP  0xFE0
 
-#define MAX_LABELS 256
 #define MAX_INSTRUCTIONS 4096
 #define MAX_LINE_LENGTH 256
-#define MAX_LABEL_LENGTH 64
-#define SOURCE_LINE_MAP_SIZE 4096
+#define MAX_MACRO_PARAMS 8
+#define MAX_MACRO_DEPTH 16
+#define MAX_MACRO_LINES 1000000    /* macro body lines expanded per assembly */
 
+/* What kind of line it was (line_t.flags); assembler_update reassembles it all */
+#define LINE_ORG    0x1     /* .org: its padding depends on every line above */
+#define LINE_EQU    0x2     /* .equ */
+#define LINE_MACRO  0x4     /* .macro, .endm or a line of a macro body */
+
+/*
+ * Symbols live in a growable array indexed by an open-addressing hash
+ * table (linear probing, at most half full, doubled as it fills). Label
+ * text is interned once in a pool of string blocks, so a label has no
+ * length limit and symbols[] entries never move their text.
+ */
 typedef struct {
-    char label[MAX_LABEL_LENGTH];
-    uint16_t address;
+    const char* label;      /* interned; valid until free_assembler */
+    int length;
+    uint32_t hash;
+    uint16_t address;       /* or the value of a .equ constant */
+    int absolute;           /* .equ constant: never moved or relocated */
+    int global;             /* number of .global lines exporting it */
+    int defined;            /* 0 while only referenced so far */
+    int changed;            /* moved during assembler_update */
 } __attribute__((aligned(8))) symbol_t;
 
+typedef struct string_block string_block;
+
 typedef struct {
     uint8_t opcode;
     uint16_t operand;
     int has_label_ref;
-    char label_ref[MAX_LABEL_LENGTH];
+    int symbol;             /* symbols[] index when has_label_ref */
+    int addend;             /* NAME+N: added to the symbol's address */
+    int offset_symbol;      /* NAME+SYM: symbols[] index of SYM, -1 = none */
+    int data;               /* .word, .fill, .space or .org word: operand is all 16 bits */
+    int line;               /* source line, 1-based */
+    int org;                /* line of the .org that placed this word, 0 = none */
 } __attribute__((aligned(8))) instruction_t;
 
+/* .macro NAME p1, p2 ... .endm; the body is kept as text and expanded on each use */
+typedef struct {
+    const char* name;       /* interned */
+    int length;
+    const char* params[MAX_MACRO_PARAMS];
+    int param_count;
+    char* body;             /* body lines, each ended by '\n' */
+    int body_length;
+    int body_capacity;
+    int line;               /* of the .macro */
+} macro_t;
+
+/* What one source line produced; kept for assembler_update */
+typedef struct {
+    int offset;             /* of the line in the source */
+    int address;            /* first word it emitted */
+    int label;              /* symbol it defined, or -1 */
+    int global;             /* symbol it exported, or -1 */
+    int flags;              /* LINE_* */
+} line_t;
+
+/* How the last assembler_update went */
 typedef struct {
-    symbol_t symbols[MAX_LABELS];
+    int full;               /* 1 if the whole source was assembled */
+    int first_line;         /* first line parsed again (1-based) */
+    int reparsed;           /* lines parsed again */
+    int moved_from;         /* old words from this address on ... */
+    int moved_by;           /* ... now sit this many words further */
+} update_t;
+
+/* What assembler_optimize changed */
+typedef struct {
+    int store_loads;        /* LODD X dropped after STOD X */
+    int jumps_to_next;      /* JUMP to the next word dropped */
+    int stack_pairs;        /* INSP N / DESP N pairs dropped */
+    int jump_chains;        /* jumps and CALLs sent past the JUMP they landed on */
+    int removed;            /* words dropped (a .org fills the gap it leaves with zeros) */
+    int blocked_line;       /* a number pointing into the code here kept words in place, 0 = none */
+    int skipped[256];       /* instructions no longer run per pass, by top byte with operand bits clear */
+} optimize_t;
+
+typedef struct {
+    symbol_t* symbols;
     int symbol_count;
+    int symbol_capacity;
+    int* slots;             /* hash table of symbols[] indices, -1 = empty */
+    int slot_count;         /* power of two */
+    string_block* strings;  /* label text pool */
     instruction_t instructions[MAX_INSTRUCTIONS];
     int instruction_count;
+    int fixups[MAX_INSTRUCTIONS];   /* instructions waiting for a later label */
+    int fixup_count;
     int current_address;
     int error_count;
+    int error_line;         /* line of the last error, 0 if not tied to one */
     char error_msg[256];
+    int last_label;         /* symbol defined by the last parse_line, or -1 */
+    int last_global;        /* symbol exported by the last parse_line, or -1 */
+    int last_flags;         /* LINE_* of the last parse_line */
+    int org_line;           /* .org waiting for its first word, 0 = none */
+    macro_t* macros;
+    int macro_count;
+    int macro_capacity;
+    int defining;           /* macros[] index inside .macro ... .endm, else -1 */
+    int expanding;          /* macro expansions under way */
+    int expanded;           /* macro body lines expanded so far */
+
+    /* Previous parse, for assembler_update; source is NULL when there is none */
+    char* source;
+    int source_length;
+    line_t* lines;
+    int line_count;
+    int line_capacity;
+    update_t update;
+    uint16_t patched[MAX_INSTRUCTIONS];     /* addresses rewritten by the last update */
+    int patch_count;
 } __attribute__((aligned(16))) assembler_t;
 
+/*
+ * Re-entrant interface. All state, the line map included, lives in the
+ * assembler_t and output goes to caller buffers, so threads with one
+ * context each can assemble at the same time. init_assembler once, run
+ * any number of times, free_assembler at the end. Errors are left in
+ * error_msg / error_line; nothing is printed. After a run the context
+ * still answers lookup_symbol and assembler_source_line.
+ */
+void init_assembler(assembler_t* as);
+void free_assembler(assembler_t* as);
+int assembler_run(assembler_t* as, const char* source, uint16_t* output, int capacity,
+                  int* output_size);
+int assembler_object(assembler_t* as, const char* source, mic1_object* obj);
+
+/*
+ * Incremental reassembly. image[0..*image_size) is what the previous
+ * call produced (nothing on the first call). Only the lines between the
+ * first and last edit are parsed again; the unchanged tail is shifted,
+ * references to labels that moved are resolved again, and only the
+ * words that differ are rewritten in image, their addresses listed in
+ * as->patched. After an error the next call assembles from scratch.
+ */
+int assembler_update(assembler_t* as, const char* source, uint16_t* image, int capacity,
+                     int* image_size);
+
+/*
+ * Streaming interface: source is read from `in_fd` (a file or a pipe)
+ * through a fixed buffer, never held whole, so memory does not grow with
+ * the input. A line longer than MAX_LINE_LENGTH is an error. Each word is
+ * written to `out_fd` as soon as no later line can change it, that is
+ * once every label it refers to is known. On error part of the image
+ * may already be written.
+ */
+int assembler_stream(assembler_t* as, int in_fd, int out_fd, int* output_size);
+
+/*
+ * Peephole pass over what assembler_run or assembler_stream left in
+ * `as`, with every label resolved: jumps and CALLs landing on a JUMP go
+ * straight to its target; then JUMP to the next word, LODD X right after
+ * STOD X, and INSP N next to DESP N are dropped. The second word of a
+ * pattern never carries a label or a jump target, so no path into the
+ * middle of one is lost, and a loop of JUMPs never becomes a halt.
+ * Later words move up and references to them are resolved again; words
+ * after a .org keep their address. A number used as an address into the
+ * code (in LODD..CALL, or a .equ in LOCO) pins every word: then only
+ * jumps are retargeted. Returns the words dropped; `stats` may be NULL.
+ * Afterwards the context is good for encoding and assembler_write_map only.
+ */
+int assembler_optimize(assembler_t* as, optimize_t* stats);
+
+/* Source line (1-based) of the word at `address`, or -1 */
+int assembler_source_line(const assembler_t* as, uint16_t address);
+
+/*
+ * Source map: the text sidecar assemble_file leaves next to an image
+ * (prog.bin -> prog.map) so the simulator and TUI can show source lines
+ * and labels after the assembler has exited. Addresses are hex:
+ *   mic1map 1
+ *   source PATH            the .asm it came from; absent for stdin
+ *   line ADDR LINE [N]     N words (default 1) from ADDR came from LINE
+ *   label ADDR NAME
+ *   equ VALUE NAME         a .equ constant
+ * Read back with srcmap.h.
+ */
+/* prog.bin -> prog.map; -1 (and "") when the name does not fit in `size` */
+int assembler_map_file(char* out, size_t size, const char* image_file);
+int assembler_write_map(const assembler_t* as, const char* source_file, const char* map_file);
+
+/*
+ * One-shot wrappers that report errors on stderr; output holds
+ * MAX_INSTRUCTIONS. The file forms stream their input ("-" is standard
+ * input) and remove a partly written output on error. assemble_file
+ * writes the source map as well; assemble_file_optimized assembles the
+ * whole source first, runs assembler_optimize, then writes both.
+ */
 int assemble_file(const char* input_file, const char* output_file);
+int assemble_file_optimized(const char* input_file, const char* output_file, optimize_t* stats);
 int assemble_string(const char* source, uint16_t* output, int* output_size);
-void init_assembler(assembler_t* as);
-int pass1(assembler_t* as, const char* source);
-int pass2(assembler_t* as, uint16_t* output);
-int parse_line(assembler_t* as, const char* line, int pass, int line_num);
+int assemble_object(const char* source, mic1_object* obj);
+int assemble_object_file(const char* input_file, const char* output_file);
+
+/*
+ * Besides `[label:] MNEMONIC [operand] [; comment]` a line may hold:
+ *   .org ADDR              continue at ADDR, zero-filling the gap (never backwards)
+ *   .word V, V, ...        data words: -32768..65535, NAME, NAME+N or NAME-N
+ *   .space N, .fill N, V   N zero words, N words of V
+ *   .equ NAME, V           a constant, usable wherever a number is
+ *   .macro NAME a, b ... .endm   text expanded with its arguments on each use
+ * Operands also take NAME+N and NAME-N, N a number or a symbol defined
+ * above. The values of .org, .space, .fill and .equ must be numbers or
+ * symbols defined above them. Macro bodies hold instructions, .word,
+ * .space and .fill only, with no labels.
+ */
+int parse_line(assembler_t* as, const char* line, int length, int line_num);
 int add_symbol(assembler_t* as, const char* label, uint16_t address);
-int lookup_symbol(assembler_t* as, const char* label);
+int lookup_symbol(const assembler_t* as, const char* label);
 uint8_t parse_opcode(const char* mnemonic);
 int is_valid_opcode(const char* mnemonic);
-void trim_whitespace(char* str);
-void remove_comments(char* line);
 int parse_operand(const char* operand_str);
 
-// Source line mapping (debug symbols)
-// Returns the source line number (1-based) for a given memory address
-// Returns -1 if no mapping exists
-int get_source_line(uint16_t address);
-
-// Clears the source line mapping
-void clear_source_line_map(void);
-
 #endif
@@ -0,0 +1,57 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+#include "mic1.h"
+
+/*
+ * Batch engine: N independent CPUs running the macro ISA with the
+ * direct engine's semantics, kept as struct-of-arrays. PC, AC, SP and
+ * IR are one array per register; memory is address-major, so word
+ * `addr` of every lane sits in one contiguous row.
+ *
+ * batch_step fetches for every lane, groups the lanes by instruction
+ * (opcode, or sub-opcode for 0xF) and runs each group through one loop
+ * over its lanes. When all lanes agree the loop covers the whole batch
+ * with no index list, and lanes sharing an operand read and write a
+ * contiguous row; a lane that diverged runs the same loop alone.
+ *
+ * Faults follow fault_action for every lane: HALT stops the lane
+ * (stopped[lane]), TRAP sends its PC to trap_vector, IGNORE runs on.
+ * The last fault of each lane is kept in fault[lane].
+ */
+
+#define BATCH_ALL_LANES -1
+
+typedef struct mic1_batch {
+    int lanes;
+    uint16_t* pc;
+    uint16_t* ac;
+    uint16_t* sp;
+    uint16_t* ir;
+    uint16_t* memory;           /* memory[addr * lanes + lane] */
+    int* cycle_count;           /* instructions executed per lane */
+    uint8_t* fault;             /* FAULT_* last raised, per lane */
+    uint8_t* stopped;           /* halted by a fault */
+    int fault_action;           /* FAULT_ACTION_*, for every lane */
+    int trap_vector;
+    uint8_t* group;             /* scratch: instruction class of each lane */
+    int* order;                 /* scratch: lanes sorted by class */
+} mic1_batch;
+
+/* Every lane reset as init_mic1 leaves a CPU; returns -1 if out of memory */
+int init_batch(mic1_batch* b, int lanes);
+void free_batch(mic1_batch* b);
+
+/* lane = BATCH_ALL_LANES writes the word in every lane */
+void batch_store_word(mic1_batch* b, int lane, int addr, int value);
+int batch_load_word(const mic1_batch* b, int lane, int addr);
+
+/* Copy one lane from or into a scalar CPU (PC, AC, SP, IR, memory) */
+void batch_load_cpu(mic1_batch* b, int lane, const mic1_cpu* cpu);
+void batch_store_cpu(const mic1_batch* b, int lane, mic1_cpu* cpu);
+
+/* step_mic1 on the direct engine, for every lane not stopped */
+void batch_step(mic1_batch* b);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef BITSLICE_H
+#define BITSLICE_H
+
+#include <stdint.h>
+#include "mic1.h"
+
+/*
+ * Bit-sliced microcode engine: 64 independent MIC-1 instances run the
+ * same control store, one instance per bit of a uint64_t. Bit i of a
+ * register, of MAR/MBR or of a memory word holds that bit for all 64
+ * lanes, so the ALU and shifter are a handful of bitwise operations
+ * for every lane at once.
+ *
+ * Each microcycle groups the lanes by MPC and runs every group's
+ * microinstruction once, masked to its lanes; memory accesses and
+ * dispatch are grouped the same way by address and by key. Lanes that
+ * agree (same program, same path) cost as much as a single lane.
+ * slice_step regroups at the fetch: a lane back at MPC 0 waits there
+ * until every other lane has finished its instruction.
+ *
+ * Same architectural effects as the microcode engine, without its
+ * cache, watchpoints or profiler. A lane whose MPC leaves the control
+ * store stops and is reported in `faulted`.
+ */
+
+#define SLICE_LANES     64
+#define SLICE_ALL_LANES (~(uint64_t)0)
+
+typedef struct mic1_slice {
+    uint64_t reg[16][16];               /* [register][bit], bit 0 = LSB */
+    uint64_t mar[12];
+    uint64_t mbr[16];
+    uint64_t mpc[MICROADDR_BITS];
+    uint64_t memory[MEMORY_SIZE][16];
+    const control_memory* cm;
+    uint64_t active;                    /* lanes that execute */
+    uint64_t faulted;                   /* lanes stopped on an MPC outside the store */
+    int cycle_count[SLICE_LANES];       /* microcycles per lane */
+} mic1_slice;
+
+/* Every lane in the state init_mic1 leaves a CPU in */
+void init_slice(mic1_slice* s, const control_memory* cm);
+
+void slice_store_word(mic1_slice* s, uint64_t lanes, int addr, int value);
+int slice_load_word(const mic1_slice* s, int lane, int addr);
+void slice_set_register(mic1_slice* s, uint64_t lanes, int reg, int value);
+int slice_register(const mic1_slice* s, int lane, int reg);
+int slice_mpc(const mic1_slice* s, int lane);
+
+/* Copy one lane from or into a scalar CPU (registers, MAR, MBR, MPC, memory) */
+void slice_load_cpu(mic1_slice* s, int lane, const mic1_cpu* cpu);
+void slice_store_cpu(const mic1_slice* s, int lane, mic1_cpu* cpu);
+
+/* One microcycle in every active lane */
+void slice_cycle(mic1_slice* s);
+
+/* One macro instruction in every active lane: microcycles until MPC 0 */
+void slice_step(mic1_slice* s);
+
+#endif
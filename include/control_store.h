@@ -0,0 +1,48 @@
+#ifndef CONTROL_STORE_H
+#define CONTROL_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "control_unit.h"
+
+/*
+ * Binary control-store format (.mcs)
+ *
+ * A prebuilt microprogram that loads with one read and no text parsing.
+ * Multi-byte fields are little-endian.
+ *
+ *   header    "M1CS", u16 version, u16 count, u32 flags, u32 checksum
+ *   words     u32 words[count]            (microinstructions, bit 31 = ADDR MSB)
+ *   extension u16 size, u8 ext[count]     (only with CS_FLAG_EXTENDED: store
+ *                                          size and MICRO_EXT_* bytes)
+ *   ops       micro_op ops[count]         (only with CS_FLAG_PREDECODED;
+ *                                          9 bytes each: u16 addr, then a..flags
+ *                                          in struct order; units is not stored)
+ *   dispatch  u8 bits, u16 table[1 << bits] (only with CS_FLAG_DISPATCH)
+ *
+ * The checksum is FNV-1a over everything after the header. Addresses past
+ * `count` are zero, as with a short text microprogram. Without a dispatch
+ * section the default table (dispatch_target) is used; without an
+ * extension section the store is a classic 256-word one.
+ * save_control_store adds CS_FLAG_EXTENDED itself when the store needs it.
+ */
+
+#define CS_MAGIC            "M1CS"
+#define CS_VERSION          2
+#define CS_HEADER_SIZE      16
+#define CS_OP_SIZE          9
+
+#define CS_FLAG_PREDECODED  0x1
+#define CS_FLAG_DISPATCH    0x2
+#define CS_FLAG_EXTENDED    0x4
+#define CS_FLAGS            (CS_FLAG_PREDECODED | CS_FLAG_DISPATCH | CS_FLAG_EXTENDED)
+
+#define CS_MAX_FILE_SIZE    (CS_HEADER_SIZE + 2 + MICROPROGRAM_SIZE * (4 + 1 + CS_OP_SIZE) + \
+                             1 + 2 * DISPATCH_TABLE_SIZE)
+
+uint32_t control_store_checksum(const uint8_t* data, size_t size);
+int is_control_store_file(const char* filename);
+int save_control_store(const control_memory* cm, int count, int flags, const char* filename);
+int load_control_store(control_memory* cm, const char* filename);
+
+#endif
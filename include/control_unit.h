@@ -1,7 +1,47 @@
 #ifndef CONTROL_UNIT_H
 #define CONTROL_UNIT_H
 
-#define MICROPROGRAM_SIZE 256
+#include <stdint.h>
+
+/*
+ * Control-store capacity. MICROADDR_BITS is the MPC width, fixed at
+ * build time (make MICROADDR_BITS=12); a loaded store uses `size` words
+ * of it (control_memory.size, 256 unless the file says otherwise), and
+ * the MPC wraps at that size.
+ */
+#ifndef MICROADDR_BITS
+#define MICROADDR_BITS      10
+#endif
+#if MICROADDR_BITS < 8 || MICROADDR_BITS > 12
+#error "MICROADDR_BITS must be between 8 and 12"
+#endif
+#define MICROPROGRAM_SIZE   (1 << MICROADDR_BITS)
+#define CLASSIC_STORE_SIZE  256
+
+/*
+ * Extended microinstructions. The 32-bit word only has room for an
+ * 8-bit ADDR, so a word may carry an extension byte (control_memory.ext,
+ * written as 8 extra leading bits in the text format):
+ *
+ *   bit 7      WIDE      set on every extended word
+ *   bit 6      DISPATCH  next MPC comes from the dispatch table
+ *   bits 3-0   ADDR_HI   ADDR[11:8]
+ *
+ * Words without the extension are classic: ADDR is 8 bits and
+ * COND = always with ADDR = 0xFF is the dispatch marker. In extended
+ * words 0xFF is an ordinary address and only DISPATCH dispatches.
+ */
+#define MICRO_EXT_WIDE      0x80
+#define MICRO_EXT_DISPATCH  0x40
+#define MICRO_EXT_ADDR_HI   0x0F
+
+/*
+ * Macro-opcode dispatch: the next MPC is dispatch[key], where key is the
+ * low dispatch_bits of MBR. 4 bits keys on the opcode alone; 8 bits lets
+ * the microprogram key on opcode and sub-opcode together.
+ */
+#define DISPATCH_TABLE_SIZE 256
+#define DISPATCH_ADDR       0xFF    /* classic dispatch marker */
 
 typedef struct amux {
     int control_amux;
@@ -21,21 +61,71 @@ typedef struct mir {
     int c[4];
     int b[4];
     int a[4];
-    int addr[8];
+    int addr[MICROADDR_BITS];
+    int ext;            /* extension byte fetched with data, MICRO_EXT_* */
+    int dispatch;       /* next MPC from the dispatch table */
+    int units;          /* UNIT_* the datapath evaluates this cycle */
 } mir;
 
 typedef struct mpc {
-    int address[8];
+    int address[MICROADDR_BITS];
 } mpc;
 
 typedef struct mmux {
     int control_cond[2];
     int alu_n;
     int alu_z;
+    const struct control_memory* cm;    /* dispatch table; NULL = built-in layout */
 } mmux;
 
+/*
+ * Predecoded microinstruction: the fields decode_microinstruction would
+ * extract, as plain integers. Built once when the control store is
+ * loaded (or read straight from a binary control-store file).
+ */
+#define MICRO_AMUX      0x01
+#define MICRO_MBR       0x02
+#define MICRO_MAR       0x04
+#define MICRO_RD        0x08
+#define MICRO_WR        0x10
+#define MICRO_ENC       0x20
+#define MICRO_DISPATCH  0x40    /* either dispatch encoding */
+
+/*
+ * Active datapath units (micro_op.units). A unit is active only when
+ * something observable consumes its output: the ALU when its result
+ * reaches MBR, a register or an N/Z branch; bus A/B when the ALU or MAR
+ * reads them; the shifter when MBR or a register takes its output.
+ * MAR, RD and WR are single flags and need no bit of their own.
+ */
+#define UNIT_BUS_A      0x01
+#define UNIT_BUS_B      0x02
+#define UNIT_ALU        0x04
+#define UNIT_SHIFTER    0x08
+#define UNIT_BUS_C      0x10
+#define UNIT_ALL        0x1F
+
+typedef struct micro_op {
+    uint16_t addr;      /* full next address, ADDR_HI included */
+    uint8_t a;
+    uint8_t b;
+    uint8_t c;
+    uint8_t alu;
+    uint8_t sh;
+    uint8_t cond;
+    uint8_t flags;      /* MICRO_* */
+    uint8_t units;      /* UNIT_*, derived from the fields above */
+} micro_op;
+
 typedef struct control_memory {
     int microinstructions[MICROPROGRAM_SIZE][32];
+    uint32_t words[MICROPROGRAM_SIZE];      /* same bits, packed MSB first */
+    uint8_t ext[MICROPROGRAM_SIZE];         /* MICRO_EXT_*, 0 = classic word */
+    micro_op ops[MICROPROGRAM_SIZE];
+    uint16_t dispatch[DISPATCH_TABLE_SIZE];
+    int dispatch_bits;                      /* 4 or 8 */
+    int size;                               /* words in use; power of two */
+    struct fault_register* fault;
 } control_memory;
 
 #define COND_NONE       0b00
@@ -44,18 +134,26 @@ typedef struct control_memory {
 #define COND_ALWAYS     0b11
 
 struct mbr;
+struct fault_register;
 
 void decode_microinstruction(mir* m);
 void init_mir(mir* m);
 void run_mpc(mpc* p, mir* m, control_memory* cm);
-void increment_mpc(mpc* p);
+void increment_mpc(mpc* p, int size);
 void init_mpc(mpc* p);
 void run_mmux(mmux* m, mpc* p, mir* mir, struct mbr* mb);
+int dispatch_target(int opcode);
+void default_dispatch_table(control_memory* cm);
 int should_branch(mmux* m);
 void init_mmux(mmux* m);
 void init_amux(amux* a);
 void init_control_memory(control_memory* cm);
+void decode_micro_op(uint32_t word, micro_op* op);
+void decode_micro_op_ext(uint32_t word, uint8_t ext, micro_op* op);
+uint8_t micro_op_units(const micro_op* op);
+void predecode_microprogram(control_memory* cm);
 int load_microprogram(control_memory* cm, const char* filename);
+int load_microprogram_text(control_memory* cm, const char* text);     /* text format only */
 void fetch_microinstruction(control_memory* cm, mpc* p, mir* m);
 void update_control(mpc* p, mmux* mmux, mir* m, struct mbr* mb);
 int bits_to_int(int bits[], int size);
@@ -1,6 +1,8 @@
 #ifndef DATAPATH_H
 #define DATAPATH_H
 
+struct fault_register;
+
 typedef struct mic1_register {
     int data[16];
 } mic1_register;
@@ -31,6 +33,7 @@ typedef struct latch {
 
 typedef struct decoder {
     register_bank *rb;
+    struct fault_register *fault;
 
     int control[4];
 } decoder;
@@ -38,6 +41,7 @@ typedef struct decoder {
 typedef struct decoderC {
 
     register_bank *rb;
+    struct fault_register *fault;
     int control_c[4];
     int control_enc;
 } decoderC;
@@ -0,0 +1,42 @@
+#ifndef FAULT_H
+#define FAULT_H
+
+/*
+ * Fault register.
+ *
+ * Units on the hot path (memory, decoders, control store) never print.
+ * They raise a fault into the register they were connected to, and the
+ * CPU applies the configured action at the end of the cycle/step.
+ */
+
+#define FAULT_NONE          0
+#define FAULT_MEM_READ      1   /* m_read outside main memory */
+#define FAULT_MEM_WRITE     2   /* m_write outside main memory */
+#define FAULT_DECODER       3   /* invalid register selector */
+#define FAULT_MPC_BOUNDS    4   /* MPC outside the control store */
+#define FAULT_PC_BOUNDS     5   /* macro PC outside main memory */
+#define FAULT_ILLEGAL_OP    6   /* reserved: every 16-bit word decodes, odd 0xF
+                                   sub-opcodes run as a NOP on all engines */
+
+#define FAULT_ACTION_HALT   0   /* stop the CPU (default) */
+#define FAULT_ACTION_TRAP   1   /* PC <- trap_vector, MPC <- 0 */
+#define FAULT_ACTION_IGNORE 2   /* record and keep running */
+
+typedef struct fault_register {
+    int kind;           /* last fault taken (FAULT_*) */
+    int address;        /* faulting address or selector */
+    int cycle;          /* cycle_count when the fault was taken */
+    int pc;             /* macro PC when the fault was taken */
+    int pending;        /* raised, not yet handled by the CPU */
+    int count;          /* faults raised since reset */
+    int action;         /* FAULT_ACTION_* */
+    int trap_vector;    /* handler address for FAULT_ACTION_TRAP */
+} fault_register;
+
+void init_fault_register(fault_register* f);
+void raise_fault(fault_register* f, int kind, int address);
+void clear_fault(fault_register* f);
+const char* fault_kind_name(int kind);
+int parse_fault_action(const char* spec, int* trap_vector);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef LIBMIC1_H
+#define LIBMIC1_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Embedding interface of libmic1.a / libmic1.so: assemble, load and run
+ * programs without files or a child process. A mic1_sim is one CPU on
+ * the heap; any number can exist, and threads may each drive their own.
+ * Nothing here prints except the microprogram loader's warnings.
+ *
+ *     uint16_t image[MIC1_SIM_WORDS];
+ *     int size;
+ *     char error[128];
+ *     mic1_sim* sim = mic1_sim_create(NULL);
+ *     if (mic1_sim_assemble(source, image, MIC1_SIM_WORDS, &size, error, sizeof(error)) == 0 &&
+ *         mic1_sim_load(sim, image, 0, size) == 0 &&
+ *         mic1_sim_run(sim, 10000) == MIC1_SIM_HALT) {
+ *         printf("AC = %d\n", mic1_sim_register(sim, MIC1_SIM_AC));
+ *     }
+ *     mic1_sim_destroy(sim);
+ */
+
+typedef struct mic1_sim mic1_sim;
+
+/* libmic1.so is built with -fvisibility=hidden: only these are exported */
+#if defined(__GNUC__) && __GNUC__ >= 4
+#define MIC1_SIM_API __attribute__((visibility("default")))
+#else
+#define MIC1_SIM_API
+#endif
+
+#define MIC1_SIM_WORDS 4096     /* main memory, and the largest image */
+
+/* Why mic1_sim_run returned */
+#define MIC1_SIM_BUDGET 0       /* cycle budget used up; run again to go on */
+#define MIC1_SIM_HALT   1       /* the next instruction is a JUMP to itself */
+#define MIC1_SIM_FAULT  2       /* a fault stopped the CPU */
+#define MIC1_SIM_WATCH  3       /* a watchpoint stopped the CPU */
+
+/* Registers for mic1_sim_register */
+#define MIC1_SIM_PC 0
+#define MIC1_SIM_AC 1
+#define MIC1_SIM_SP 2
+#define MIC1_SIM_IR 3
+
+/*
+ * A CPU as mic1_simulator starts one: memory cleared, PC 0, SP 0x0FFF.
+ * engine is "direct" (NULL), "microcode" or "compiled"; the microcode
+ * engine needs mic1_sim_load_microcode first. NULL if out of memory or
+ * the engine is unknown.
+ */
+MIC1_SIM_API mic1_sim* mic1_sim_create(const char* engine);
+MIC1_SIM_API void mic1_sim_destroy(mic1_sim* sim);
+
+/* Registers back to their start values; memory and microcode are kept */
+MIC1_SIM_API void mic1_sim_reset(mic1_sim* sim);
+
+/*
+ * Assemble `source` into image[0..*size). On error returns -1 with
+ * "line N: message" in `error` (if not NULL).
+ */
+MIC1_SIM_API int mic1_sim_assemble(const char* source, uint16_t* image, int capacity, int* size,
+                                   char* error, size_t error_size);
+
+/* Copy `size` words into memory from `base` on; -1 if they do not fit */
+MIC1_SIM_API int mic1_sim_load(mic1_sim* sim, const uint16_t* image, int base, int size);
+
+/* Control store for the microcode engine, in the text format of data/basic_microcode.txt */
+MIC1_SIM_API int mic1_sim_load_microcode(mic1_sim* sim, const char* text);
+
+/*
+ * Run until the program halts or stops, or `budget` cycles have gone by
+ * (instructions for the direct engine, microcycles otherwise; the
+ * instruction in flight is finished). Returns MIC1_SIM_*, -1 on bad
+ * arguments.
+ */
+MIC1_SIM_API int mic1_sim_run(mic1_sim* sim, long budget);
+
+MIC1_SIM_API int mic1_sim_register(const mic1_sim* sim, int reg);
+MIC1_SIM_API int mic1_sim_read(const mic1_sim* sim, int address);
+MIC1_SIM_API int mic1_sim_write(mic1_sim* sim, int address, int value);
+MIC1_SIM_API long mic1_sim_cycles(const mic1_sim* sim);
+MIC1_SIM_API uint64_t mic1_sim_digest(const mic1_sim* sim);
+
+#endif
@@ -1,12 +1,23 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+#include <stdint.h>
 #include "datapath.h"
 #include "shifter.h"
 
 #define MEMORY_SIZE 4096
 
+/*
+ * Running memory digest: every word contributes digest_word(addr, value)
+ * (0 for a zero word), XORed into its page and into the root. A write
+ * only has to XOR out the old contribution and XOR in the new one.
+ */
+#define DIGEST_PAGE_WORDS 64
+#define DIGEST_PAGES (MEMORY_SIZE / DIGEST_PAGE_WORDS)
+
 struct cache;
+struct fault_register;
+struct watch_table;
 
 typedef struct mar {
     int control_mar;
@@ -22,6 +33,10 @@ typedef struct mbr {
 
 typedef struct memory {
     int data[MEMORY_SIZE][16];
+    uint64_t page_digest[DIGEST_PAGES];
+    uint64_t digest;                    /* XOR of page_digest[] */
+    struct fault_register* fault;
+    struct watch_table* watch;
 } memory;
 
 void run_mar(mar* a, latch* lB);
@@ -31,6 +46,13 @@ void m_read(mar* a, mbr* b, memory* mem, struct cache* c);
 void m_write(mar* a, mbr* b, memory* mem, struct cache* c);
 void init_mbr(mbr* b);
 void init_memory(memory* mem);
+int mem_load_word(memory* mem, int addr);
+void mem_store_word(memory* mem, int addr, int value);
+uint64_t digest_word(int addr, int value);
+void mem_rehash(memory* mem);
+void mem_rehash_page(memory* mem, int page);
+uint64_t mem_digest(const memory* mem);
+uint64_t mem_page_digest(const memory* mem, int page);
 void load_program(memory* mem, const char* filename);
 int address_to_int(int address[12]);
 void int_to_address(int addr, int address[12]);
@@ -12,6 +12,9 @@
 #include "control_unit.h"
 #include "cache.h"
 #include "connections.h"
+#include "fault.h"
+#include "watch.h"
+#include "profile.h"
 
 typedef struct mic1_cpu {
     register_bank reg_bank;
@@ -32,7 +35,12 @@ typedef struct mic1_cpu {
     amux amux;
     control_memory ctrl_mem;
     barrC bus_c;
+    fault_register fault;
+    watch_table watch;
+    micro_profile* profile; /* NULL = not profiling; owned by the caller */
+    int engine;             /* MIC1_ENGINE_*; survives reset */
     int running;
+    int stop_reason;
     int cycle_count;
     int clock;
 } mic1_cpu;
@@ -40,20 +48,44 @@ typedef struct mic1_cpu {
 void init_mic1(mic1_cpu* cpu);
 void reset_mic1(mic1_cpu* cpu);
 void run_mic1_cycle(mic1_cpu* cpu);
+void run_compiled_cycle(mic1_cpu* cpu);
 void execute_datapath(mic1_cpu* cpu);
 void run_mic1_program(mic1_cpu* cpu);
 void step_mic1(mic1_cpu* cpu);
 int load_microprogram_file(mic1_cpu* cpu, const char* filename);
 int load_program_file(mic1_cpu* cpu, const char* filename);
+int load_program_image(mic1_cpu* cpu, const uint16_t* image, int base, int size);
+void patch_program(mic1_cpu* cpu, const uint16_t* image, const uint16_t* addresses, int count);
 void print_cpu_state(mic1_cpu* cpu);
 void print_registers(mic1_cpu* cpu);
 void print_memory_range(mic1_cpu* cpu, int start, int end);
 void print_microinstruction(mir* mir);
 void connect_components(mic1_cpu* cpu);
 int is_cpu_halted(mic1_cpu* cpu);
+void take_fault(mic1_cpu* cpu, int cycle);
+uint64_t mic1_state_digest(const mic1_cpu* cpu);
+int mic1_engine_from_name(const char* name);
+const char* mic1_engine_name(int engine);
+
+/* Why the CPU last stopped running (mic1_cpu.stop_reason) */
+#define MIC1_STOP_NONE  0
+#define MIC1_STOP_FAULT 1
+#define MIC1_STOP_WATCH 2
+
+/*
+ * Execution engines used by step_mic1 (mic1_cpu.engine).
+ * DIRECT interprets one macro instruction per step; MICROCODE and
+ * COMPILED run microcycles until the MPC returns to 0, and count
+ * microcycles in cycle_count.
+ */
+#define MIC1_ENGINE_DIRECT     0
+#define MIC1_ENGINE_MICROCODE  1    /* control store loaded at run time */
+#define MIC1_ENGINE_COMPILED   2    /* control store compiled by mic1mcc */
+
+#define MIC1_MAX_MICROSTEPS    1024 /* per macro step, guards runaway loops */
 
 #define MIC1_WORD_SIZE 16
 #define MIC1_ADDRESS_SIZE 12
-#define MIC1_MICROADDR_SIZE 8
+#define MIC1_MICROADDR_SIZE MICROADDR_BITS
 
 #endif
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef MICROANALYSIS_H
+#define MICROANALYSIS_H
+
+#include <stdio.h>
+#include "control_unit.h"
+
+/*
+ * Static microcode analysis
+ *
+ * Walks the control store from address 0 (fetch) and from every dispatch
+ * target without executing anything. Each conditional microinstruction
+ * forks the walk, so every N/Z path through a routine is costed in
+ * microcycles; paths are syntactic (data-dependent infeasibility is not
+ * detected). A macro instruction costs its fetch path up to the dispatch
+ * plus one routine path back to MPC 0.
+ *
+ * Findings per control-store address:
+ *   unreachable      word no walk ever reaches (dead code), other than
+ *                    padding: empty words and bare "goto 0" fillers
+ *   no write         reachable, touches no register, MAR, MBR or memory;
+ *                    with COND_NONE it is an idle cycle, with an
+ *                    unconditional jump it could be merged upwards
+ *   fall-through     reachable and continues at address + 1 into an empty
+ *                    word, into another routine's dispatch entry, or past
+ *                    the last word back to 0
+ */
+
+#define MCA_MAX_PATHS       16      /* per entry point; more are truncated */
+#define MCA_MAX_BRANCHES    16      /* decisions recorded per path */
+#define MCA_MAX_DEPTH       256     /* microinstructions per path */
+
+/* How a path ended */
+#define MCA_END_FETCH       0       /* back at MPC 0: instruction complete */
+#define MCA_END_DISPATCH    1       /* reached a dispatch microinstruction */
+#define MCA_END_LOOP        2       /* revisited an address: unbounded */
+
+#define MCA_PADDING(word)   ((word) == 0 || (word) == (uint32_t)(COND_ALWAYS << 1))
+
+/* Findings (mca_report.flags) */
+#define MCA_REACHABLE       0x01
+#define MCA_UNREACHABLE     0x02
+#define MCA_NO_WRITE        0x04
+#define MCA_FALL_EMPTY      0x08
+#define MCA_FALL_ENTRY      0x10
+#define MCA_FALL_WRAP       0x20
+#define MCA_HAZARDS         (MCA_FALL_EMPTY | MCA_FALL_ENTRY | MCA_FALL_WRAP)
+
+typedef struct mca_path {
+    int cycles;
+    int end;                                /* MCA_END_* */
+    char trace[MCA_MAX_BRANCHES + 1];       /* 'N'/'Z' taken, 'n'/'z' not taken */
+} mca_path;
+
+typedef struct mca_routine {
+    int path_count;
+    int truncated;                          /* more than MCA_MAX_PATHS paths */
+    int min_cycles;                         /* paths that finish; -1 = none does */
+    int max_cycles;                         /* -1 when a path loops */
+    mca_path paths[MCA_MAX_PATHS];
+} mca_routine;
+
+typedef struct mca_report {
+    int dispatch_bits;
+    uint16_t dispatch[DISPATCH_TABLE_SIZE]; /* copied from the control store */
+    mca_routine fetch;                      /* from 0 to the dispatch */
+    mca_routine routines[MICROPROGRAM_SIZE]; /* by entry address; valid if is_entry */
+    uint8_t is_entry[MICROPROGRAM_SIZE];
+    uint8_t flags[MICROPROGRAM_SIZE];       /* MCA_* findings */
+    int unreachable_count;
+    int no_write_count;
+    int hazard_count;
+} mca_report;
+
+int mca_analyze(const control_memory* cm, mca_report* report);
+
+/* Routine that executes a macro instruction word */
+const mca_routine* mca_routine_for(const mca_report* report, int instruction);
+
+/*
+ * Worst-case microcycles for one macro instruction, fetch included;
+ * -1 when a path loops. mca_instruction_min_cycles is the best case over
+ * paths that return to fetch or dispatch; -1 when none does.
+ */
+int mca_instruction_cycles(const mca_report* report, int instruction);
+int mca_instruction_min_cycles(const mca_report* report, int instruction);
+
+/*
+ * Cost table, one line per dispatch key, meant for other tools:
+ *   fetch MIN MAX
+ *   key KEY ENTRY MIN MAX PATHS     (MIN/MAX include the fetch; -1 = loop,
+ *                                    for MIN: no path finishes)
+ */
+int mca_write_cost_table(const mca_report* report, FILE* out);
+int mca_write_report(const mca_report* report, const control_memory* cm, FILE* out);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef MICROASM_H
+#define MICROASM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "control_unit.h"
+
+/*
+ * Symbolic micro-assembler (MAL)
+ *
+ * One microinstruction per line, statements separated by ';':
+ *
+ *   label:  dst := expr          dst is a register, mbr or alu (flags only)
+ *           mar := reg           MAR is loaded from the B bus
+ *           rd / wr              memory read / write
+ *           goto L               unconditional branch
+ *           if n goto L          branch on the ALU result (before shifting)
+ *           if z goto L
+ *           goto dispatch        jump through the opcode dispatch table
+ *
+ *   expr:   lshift(e) | rshift(e) | e
+ *   e:      x + y | band(x, y) | inv(x) | x
+ *
+ * Operands are register names (pc ac ir tir sp amask smask r0 r1 rm1
+ * a..f), the constants 0, 1 and -1 (r0, r1, rm1) and mbr, which selects
+ * the A-mux. Several ':=' statements may share one ALU operation when
+ * their expressions are identical. Directives:
+ *
+ *   .size N                    extended control store of N words (a power
+ *                              of two up to MICROPROGRAM_SIZE): words carry
+ *                              the extension byte, so addresses past 0xFF
+ *                              can be targets and goto dispatch uses the
+ *                              dedicated DISPATCH bit; before any code
+ *   .org ADDR                  continue at control-store address ADDR
+ *   .dispatch OPCODE LABEL     dispatch table entry for macro opcode
+ *   .dispatch OPCODE SUB LABEL entry for one sub-opcode (MBR[3:0]) of
+ *                              OPCODE; switches the table to 8-bit keys,
+ *                              where OPCODE-only entries cover the
+ *                              sub-opcodes not listed explicitly
+ *
+ * '#' starts a comment. Numbers are decimal or 0x hex.
+ */
+
+#define MAL_MAX_LABEL       32
+
+typedef struct mal_program {
+    uint32_t words[MICROPROGRAM_SIZE];
+    uint8_t ext[MICROPROGRAM_SIZE];         /* MICRO_EXT_*, extended programs only */
+    int line[MICROPROGRAM_SIZE];            /* source line, 0 = unused */
+    int dispatch[DISPATCH_TABLE_SIZE];      /* control-store address, -1 = none */
+    int dispatch_bits;                      /* 4, or 8 with sub-opcode entries */
+    int size;                               /* highest used address + 1 */
+    int store_size;                         /* 256, or the .size argument */
+    int extended;                           /* .size given: extended words */
+    int error_count;
+    char error_msg[160];
+} mal_program;
+
+int mal_assemble(const char* source, mal_program* prog);
+int mal_assemble_file(const char* filename, mal_program* prog);
+int mal_write_control_store(const mal_program* prog, const char* source, const char* source_name,
+                            FILE* out);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef MICROCODE_COMPILED_H
+#define MICROCODE_COMPILED_H
+
+#include "mic1.h"
+
+/*
+ * Compiled microcode engine.
+ *
+ * The implementation is generated at build time by mic1mcc from the
+ * control-store text file (see the Makefile). Each control-store address
+ * becomes one specialised case that updates the architectural state
+ * (registers, MAR, MBR, memory) exactly like one pass of
+ * execute_datapath + update_control, and returns the next MPC.
+ * MIR, latches and unit control lines are not updated.
+ */
+
+extern const char* const mic1_compiled_source;
+
+int mic1_compiled_execute(mic1_cpu* cpu, int mpc);
+
+#endif
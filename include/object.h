@@ -0,0 +1,95 @@
+#ifndef OBJECT_H
+#define OBJECT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Relocatable object format (.o)
+ *
+ * All offsets are word offsets relative to the start of the object; the
+ * loader adds the load address when it applies OBJ_RELOC_ABS entries.
+ * Multi-byte fields are little-endian, like the raw .bin images.
+ *
+ *   header    "M1OB", u16 version, u16 load_address, u16 entry,
+ *             u16 sections, u16 symbols, u16 relocs, u16 lines
+ *   section   u16 type, u16 offset, u16 size, u16 words[size]
+ *   symbol    u16 flags, u16 value, u8 length, char name[length]
+ *   reloc     u16 offset, u8 kind, u8 bits, u16 symbol
+ *   line      u16 offset, u16 line
+ */
+
+#define OBJ_MAGIC           "M1OB"
+#define OBJ_VERSION         1
+
+#define OBJ_SECTION_CODE    0
+#define OBJ_SECTION_DATA    1
+
+#define OBJ_SYM_LOCAL       0x0     /* defined here, private to the object */
+#define OBJ_SYM_GLOBAL      0x1     /* defined here, visible to the linker */
+#define OBJ_SYM_UNDEF       0x2     /* referenced here, defined elsewhere */
+#define OBJ_SYM_ABS         0x4     /* constant; never relocated */
+
+#define OBJ_RELOC_ABS       0       /* field += load address */
+#define OBJ_RELOC_SYM       1       /* field += value of symbol */
+
+#define OBJ_MAX_NAME        255
+
+typedef struct obj_section {
+    int type;
+    uint16_t offset;
+    uint16_t size;
+    uint16_t* words;
+} obj_section;
+
+typedef struct obj_symbol {
+    char* name;
+    int flags;
+    uint16_t value;
+} obj_symbol;
+
+typedef struct obj_reloc {
+    uint16_t offset;
+    uint8_t kind;
+    uint8_t bits;           /* width of the patched field: 12, 8 or 16 (.word) */
+    uint16_t symbol;
+} obj_reloc;
+
+typedef struct obj_line {
+    uint16_t offset;
+    uint16_t line;
+} obj_line;
+
+typedef struct mic1_object {
+    uint16_t load_address;
+    uint16_t entry;
+    obj_section* sections;
+    int section_count;
+    obj_symbol* symbols;
+    int symbol_count;
+    obj_reloc* relocs;
+    int reloc_count;
+    obj_line* lines;
+    int line_count;
+} mic1_object;
+
+void init_object(mic1_object* obj);
+void free_object(mic1_object* obj);
+int object_add_section(mic1_object* obj, int type, uint16_t offset,
+                       const uint16_t* words, uint16_t size);
+int object_add_symbol(mic1_object* obj, const char* name, int flags, uint16_t value);
+int object_find_symbol(const mic1_object* obj, const char* name);
+int object_add_reloc(mic1_object* obj, uint16_t offset, int kind, int bits, int symbol);
+int object_add_line(mic1_object* obj, uint16_t offset, int line);
+int object_size(const mic1_object* obj);
+
+int write_object_file(const mic1_object* obj, const char* filename);
+int read_object_file(mic1_object* obj, const char* filename);
+int is_object_file(const char* filename);
+
+int object_image(const mic1_object* obj, int base, uint16_t* image, int capacity,
+                 char* error, size_t error_size);
+int link_objects(mic1_object* out, const mic1_object* in, int count,
+                 char* error, size_t error_size);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "control_unit.h"
+
+/*
+ * Per-microinstruction execution profile.
+ *
+ * Attached to a CPU through mic1_cpu.profile; while that pointer is NULL
+ * the microcode engines pay one test per microcycle and nothing else.
+ * Every microcycle counts an execution of its control-store address, a
+ * taken or not-taken outcome for N/Z branches, and one hit in the row of
+ * the macro instruction being executed. A branch whose target is the
+ * next address cannot be told apart and counts as not taken.
+ *
+ * Macro instructions are grouped in classes: opcodes 0x0-0xE are their
+ * own class, 0xF instructions are split by sub-opcode (IR[11:8]).
+ */
+
+#define PROFILE_CLASSES     32
+#define PROFILE_NO_CLASS    -1
+
+typedef struct micro_profile {
+    uint64_t exec[MICROPROGRAM_SIZE];
+    uint64_t taken[MICROPROGRAM_SIZE];
+    uint64_t not_taken[MICROPROGRAM_SIZE];
+    uint32_t by_class[PROFILE_CLASSES][MICROPROGRAM_SIZE];
+    uint64_t class_instructions[PROFILE_CLASSES];
+    uint64_t class_cycles[PROFILE_CLASSES];
+    uint64_t cycles;
+    uint64_t instructions;
+    int current;                /* class of the instruction in flight */
+} micro_profile;
+
+/* Control-store address -> source line, from the text control store */
+typedef struct profile_source {
+    int line[MICROPROGRAM_SIZE];            /* line of the word in the file, 0 = none */
+    int mal_line[MICROPROGRAM_SIZE];        /* MAL line from mic1mal comments, 0 = none */
+    char text[MICROPROGRAM_SIZE][64];       /* MAL statement text */
+} profile_source;
+
+void init_profile(micro_profile* p);
+int profile_class(int instruction);
+const char* profile_class_name(int cls);
+
+/* Called by the CPU: at MPC 0 with the word at PC, then once per microcycle */
+void profile_instruction(micro_profile* p, int instruction);
+void profile_microcycle(micro_profile* p, const control_memory* cm, int mpc, int next_mpc);
+
+int load_profile_source(profile_source* src, const char* filename);
+int write_profile_report(const micro_profile* p, const profile_source* src, FILE* out);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef SRCMAP_H
+#define SRCMAP_H
+
+#include "memory.h"
+
+/*
+ * Source map of a program image, read from the .map sidecar mic1asm
+ * writes next to it (format in assembler.h). Nothing is read until the
+ * first lookup, so a program without a map costs nothing; the source
+ * file itself is read only when its text is asked for.
+ */
+
+typedef struct source_label {
+    int address;
+    int order;                  /* position in the map, first wins a tie */
+    char* name;
+} source_label;
+
+typedef struct source_map {
+    char file[512];             /* the .map sidecar */
+    int state;                  /* SOURCE_MAP_* */
+    char source[512];           /* the .asm it names, "" if none */
+    int line[MEMORY_SIZE];      /* source line of each word, 0 = none */
+    source_label* labels;       /* sorted by address */
+    int label_count;
+    source_label* constants;    /* .equ, in map order */
+    int constant_count;
+
+    /* Source text, read on the first source_map_text */
+    int text_state;             /* SOURCE_MAP_* */
+    char* text;
+    int* text_lines;            /* offset of each line in text */
+    int text_line_count;
+} source_map;
+
+#define SOURCE_MAP_UNREAD   0
+#define SOURCE_MAP_LOADED   1
+#define SOURCE_MAP_MISSING  2
+
+/* Map for `program` (prog.bin -> prog.map), or the map file itself with `is_map` */
+void init_source_map(source_map* map, const char* program, int is_map);
+void free_source_map(source_map* map);
+
+/* Read the map now; number of words it covers, or -1 */
+int load_source_map(source_map* map);
+
+/* Source line of the word at `address`, 0 if unknown */
+int source_map_line(source_map* map, int address);
+
+/* Nearest label at or below `address`, its distance in *offset; NULL if none */
+const char* source_map_label(source_map* map, int address, int* offset);
+
+/* Address of a label or value of a constant, -1 if unknown */
+int source_map_symbol(source_map* map, const char* name);
+
+/* Text of source line `line` (no newline), NULL if the source is unavailable */
+const char* source_map_text(source_map* map, int line, int* length);
+
+#endif
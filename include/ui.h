@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include "mic1.h"
+#include "srcmap.h"
 
 /* Box drawing characters (Unicode) */
 #define BOX_TL 0x250C  /* ┌ */
@@ -68,7 +69,7 @@ void ui_fill_rect(int x, int y, int w, int h, uint32_t ch, uint16_t fg, uint16_t
 
 /* High-level panels */
 void ui_draw_registers(int x, int y, mic1_cpu *cpu);
-void ui_draw_code(int x, int y, int w, int h, mic1_cpu *cpu, int highlight_pc);
+void ui_draw_code(int x, int y, int w, int h, mic1_cpu *cpu, int highlight_pc, source_map *map);
 void ui_draw_stack(int x, int y, int h, mic1_cpu *cpu);
 void ui_draw_memory(int x, int y, int w, int h, mic1_cpu *cpu, int start_addr);
 void ui_draw_help(int x, int y);
@@ -0,0 +1,42 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "memory.h"
+
+/*
+ * Memory watchpoints.
+ *
+ * One flag byte per memory word; m_read/m_write and the direct engine
+ * test it in constant time, and skip the test entirely while no
+ * watchpoint is armed (active == 0).
+ */
+
+#define WATCH_READ   0x1
+#define WATCH_WRITE  0x2
+#define WATCH_CHANGE 0x4    /* write that changes the stored value */
+
+typedef struct watch_hit {
+    int pending;        /* set by the memory system, taken by the CPU */
+    int kind;           /* WATCH_* that fired */
+    int address;
+    int old_value;
+    int new_value;
+    int cycle;          /* cycle_count when the CPU stopped */
+    int pc;             /* macro PC when the CPU stopped */
+    int count;          /* hits since the table was initialised */
+} watch_hit;
+
+typedef struct watch_table {
+    unsigned char flags[MEMORY_SIZE];
+    int active;         /* number of words with at least one flag */
+    watch_hit hit;
+} watch_table;
+
+void init_watch_table(watch_table* w);
+int set_watchpoint(watch_table* w, int start, int end, int kind);
+int clear_watchpoint(watch_table* w, int start, int end);
+void watch_access(watch_table* w, int address, int kind, int old_value, int new_value);
+int parse_watch_spec(const char* spec, int* start, int* end, int* kind);
+const char* watch_kind_name(int kind);
+
+#endif
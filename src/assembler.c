@@ -2,444 +2,2055 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define STRING_BLOCK_SIZE 4096
+#define MIN_SLOTS 64
+#define STREAM_BUFFER 65536     /* bytes of source held at once by assembler_stream */
+#define STREAM_WORDS 512        /* words encoded per write */
+
+struct string_block {
+    string_block* next;
+    size_t used;
+    size_t size;
+    char text[];
+};
 
-// Global source line mapping: memory_address -> source_line (1-based)
-// -1 means no mapping
-static int g_source_line_map[SOURCE_LINE_MAP_SIZE];
+void init_assembler(assembler_t* as) {
+    as->symbols = NULL;
+    as->symbol_count = 0;
+    as->symbol_capacity = 0;
+    as->slots = NULL;
+    as->slot_count = 0;
+    as->strings = NULL;
+    as->instruction_count = 0;
+    as->fixup_count = 0;
+    as->current_address = 0;
+    as->error_count = 0;
+    as->error_line = 0;
+    memset(as->error_msg, 0, sizeof(as->error_msg));
+    as->last_label = -1;
+    as->last_global = -1;
+    as->last_flags = 0;
+    as->org_line = 0;
+    as->macros = NULL;
+    as->macro_count = 0;
+    as->macro_capacity = 0;
+    as->defining = -1;
+    as->expanding = 0;
+    as->expanded = 0;
+    as->source = NULL;
+    as->source_length = 0;
+    as->lines = NULL;
+    as->line_count = 0;
+    as->line_capacity = 0;
+    memset(&as->update, 0, sizeof(as->update));
+    as->patch_count = 0;
+}
 
-void clear_source_line_map(void) {
-    for (int i = 0; i < SOURCE_LINE_MAP_SIZE; i++) {
-        g_source_line_map[i] = -1;
+void free_assembler(assembler_t* as) {
+    while (as->strings) {
+        string_block* next = as->strings->next;
+        free(as->strings);
+        as->strings = next;
+    }
+    for (int i = 0; i < as->macro_count; i++) {
+        free(as->macros[i].body);
     }
+    free(as->macros);
+    free(as->symbols);
+    free(as->slots);
+    free(as->source);
+    free(as->lines);
+    as->macros = NULL;
+    as->macro_count = as->macro_capacity = 0;
+    as->defining = -1;
+    as->symbols = NULL;
+    as->slots = NULL;
+    as->source = NULL;
+    as->lines = NULL;
+    as->symbol_count = as->symbol_capacity = as->slot_count = 0;
+    as->line_count = as->line_capacity = 0;
 }
 
-int get_source_line(uint16_t address) {
-    if (address >= SOURCE_LINE_MAP_SIZE) {
-        return -1;
+/* A piece of a source line; points into the source, never copied */
+typedef struct {
+    const char* text;
+    int length;
+} span_t;
+
+static span_t make_span(const char* text) {
+    span_t s = { text, (int)strlen(text) };
+    return s;
+}
+
+static span_t trim(span_t s) {
+    while (s.length > 0 && isspace((unsigned char)s.text[0])) {
+        s.text++;
+        s.length--;
     }
-    return g_source_line_map[address];
+    while (s.length > 0 && isspace((unsigned char)s.text[s.length - 1])) {
+        s.length--;
+    }
+    return s;
 }
 
-void init_assembler(assembler_t* as) {
-    as->symbol_count = 0;
-    as->instruction_count = 0;
-    as->current_address = 0;
-    as->error_count = 0;
-    memset(as->error_msg, 0, sizeof(as->error_msg));
+/* Next blank-separated word of *s; *s is left just past it */
+static span_t next_word(span_t* s) {
+    *s = trim(*s);
+    span_t word = { s->text, 0 };
+    while (word.length < s->length && !isspace((unsigned char)word.text[word.length])) {
+        word.length++;
+    }
+    s->text += word.length;
+    s->length -= word.length;
+    return word;
+}
+
+static int span_equals_nocase(span_t s, const char* word) {
+    for (int i = 0; i < s.length; i++) {
+        if (toupper((unsigned char)s.text[i]) != word[i]) return 0;
+    }
+    return word[s.length] == '\0';
+}
+
+static const struct {
+    const char* name;
+    uint8_t opcode;
+} mnemonics[] = {
+    { "LODD", OP_LODD }, { "STOD", OP_STOD }, { "ADDD", OP_ADDD }, { "SUBD", OP_SUBD },
+    { "JPOS", OP_JPOS }, { "JZER", OP_JZER }, { "JUMP", OP_JUMP }, { "LOCO", OP_LOCO },
+    { "LODL", OP_LODL }, { "STOL", OP_STOL }, { "ADDL", OP_ADDL }, { "SUBL", OP_SUBL },
+    { "JNEG", OP_JNEG }, { "JNZE", OP_JNZE }, { "CALL", OP_CALL },
+
+    { "PSHI", 0xF0 }, { "POPI", 0xF2 }, { "PUSH", 0xF4 }, { "POP", 0xF6 },
+    { "RETN", 0xF8 }, { "SWAP", 0xFA }, { "INSP", 0xFC }, { "DESP", 0xFE }
+};
+
+/* Opcode for a mnemonic in any case, or -1 */
+static int find_mnemonic(span_t word) {
+    for (size_t i = 0; i < sizeof(mnemonics) / sizeof(mnemonics[0]); i++) {
+        if (span_equals_nocase(word, mnemonics[i].name)) {
+            return mnemonics[i].opcode;
+        }
+    }
+    return -1;
 }
 
-void trim_whitespace(char* str) {
-    if (!str || *str == '\0') return;
+int is_valid_opcode(const char* mnemonic) {
+    return find_mnemonic(make_span(mnemonic)) >= 0;
+}
 
-    char* start = str;
-    char* end;
-    size_t len;
+uint8_t parse_opcode(const char* mnemonic) {
+    int opcode = find_mnemonic(make_span(mnemonic));
+    return opcode < 0 ? 0xFF : (uint8_t)opcode;
+}
 
-    while (*start && isspace((unsigned char)*start)) start++;
+/* Decimal or 0x-prefixed hex in 0..max, or -1 */
+static int parse_unsigned(span_t s, int max) {
+    int base = 10;
+    int i = 0;
+    int value = 0;
 
-    if (*start == '\0') {
-        str[0] = '\0';
-        return;
+    if (s.length > 2 && s.text[0] == '0' && (s.text[1] == 'x' || s.text[1] == 'X')) {
+        base = 16;
+        i = 2;
     }
+    if (i >= s.length) return -1;
 
-    len = strlen(start);
-    if (len == 0) {
-        str[0] = '\0';
-        return;
+    for (; i < s.length; i++) {
+        int c = (unsigned char)s.text[i];
+        int digit;
+
+        if (isdigit(c)) {
+            digit = c - '0';
+        } else if (base == 16 && isxdigit(c)) {
+            digit = tolower(c) - 'a' + 10;
+        } else {
+            return -1;
+        }
+
+        value = value * base + digit;
+        if (value > max) return -1;
     }
+    return value;
+}
+
+/* A number in the 12-bit operand range, or -1 */
+static int parse_number(span_t s) {
+    return parse_unsigned(s, 4095);
+}
 
-    end = start + len - 1;
-    while (end > start && isspace((unsigned char)*end)) {
-        end--;
+int parse_operand(const char* operand_str) {
+    return parse_number(trim(make_span(operand_str)));
+}
+
+/* FNV-1a */
+static uint32_t hash_span(span_t s) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < s.length; i++) {
+        h = (h ^ (unsigned char)s.text[i]) * 16777619u;
     }
+    return h;
+}
 
-    *(end + 1) = '\0';
+static int find_symbol(const assembler_t* as, span_t name, uint32_t hash) {
+    if (!as->slot_count) return -1;
 
-    if (start != str) {
-        size_t trim_len = (end - start) + 1;
-        memmove(str, start, trim_len + 1);
+    int mask = as->slot_count - 1;
+    for (int i = (int)(hash & (uint32_t)mask); as->slots[i] >= 0; i = (i + 1) & mask) {
+        const symbol_t* s = &as->symbols[as->slots[i]];
+        if (s->hash == hash && s->length == name.length &&
+            memcmp(s->label, name.text, name.length) == 0) {
+            return as->slots[i];
+        }
     }
+    return -1;
 }
 
-void remove_comments(char* line) {
-    char* comment = strchr(line, ';');
-    if (comment) {
-        *comment = '\0';
+static void insert_slot(int* slots, int slot_count, uint32_t hash, int sym) {
+    int mask = slot_count - 1;
+    int i = (int)(hash & (uint32_t)mask);
+    while (slots[i] >= 0) {
+        i = (i + 1) & mask;
     }
+    slots[i] = sym;
 }
 
-int is_valid_opcode(const char* mnemonic) {
-    if (strcmp(mnemonic, "LODD") == 0) return 1;
-    if (strcmp(mnemonic, "STOD") == 0) return 1;
-    if (strcmp(mnemonic, "ADDD") == 0) return 1;
-    if (strcmp(mnemonic, "SUBD") == 0) return 1;
-    if (strcmp(mnemonic, "JPOS") == 0) return 1;
-    if (strcmp(mnemonic, "JZER") == 0) return 1;
-    if (strcmp(mnemonic, "JUMP") == 0) return 1;
-    if (strcmp(mnemonic, "LOCO") == 0) return 1;
-    if (strcmp(mnemonic, "LODL") == 0) return 1;
-    if (strcmp(mnemonic, "STOL") == 0) return 1;
-    if (strcmp(mnemonic, "ADDL") == 0) return 1;
-    if (strcmp(mnemonic, "SUBL") == 0) return 1;
-    if (strcmp(mnemonic, "JNEG") == 0) return 1;
-    if (strcmp(mnemonic, "JNZE") == 0) return 1;
-    if (strcmp(mnemonic, "CALL") == 0) return 1;
-
-    if (strcmp(mnemonic, "PSHI") == 0) return 1;
-    if (strcmp(mnemonic, "POPI") == 0) return 1;
-    if (strcmp(mnemonic, "PUSH") == 0) return 1;
-    if (strcmp(mnemonic, "POP") == 0) return 1;
-    if (strcmp(mnemonic, "RETN") == 0) return 1;
-    if (strcmp(mnemonic, "SWAP") == 0) return 1;
-    if (strcmp(mnemonic, "INSP") == 0) return 1;
-    if (strcmp(mnemonic, "DESP") == 0) return 1;
+/* Make room for one more symbol: array doubled, table kept at most half full */
+static int grow_symbols(assembler_t* as) {
+    if (as->symbol_count == as->symbol_capacity) {
+        int capacity = as->symbol_capacity ? as->symbol_capacity * 2 : MIN_SLOTS / 2;
+        symbol_t* grown = realloc(as->symbols, (size_t)capacity * sizeof(symbol_t));
+        if (!grown) return -1;
+        as->symbols = grown;
+        as->symbol_capacity = capacity;
+    }
+
+    if ((as->symbol_count + 1) * 2 > as->slot_count) {
+        int slot_count = as->slot_count ? as->slot_count * 2 : MIN_SLOTS;
+        int* slots = malloc((size_t)slot_count * sizeof(int));
+        if (!slots) return -1;
 
+        memset(slots, 0xFF, (size_t)slot_count * sizeof(int));
+        for (int i = 0; i < as->symbol_count; i++) {
+            insert_slot(slots, slot_count, as->symbols[i].hash, i);
+        }
+        free(as->slots);
+        as->slots = slots;
+        as->slot_count = slot_count;
+    }
     return 0;
 }
 
-uint8_t parse_opcode(const char* mnemonic) {
-    if (strcmp(mnemonic, "LODD") == 0) return OP_LODD;
-    if (strcmp(mnemonic, "STOD") == 0) return OP_STOD;
-    if (strcmp(mnemonic, "ADDD") == 0) return OP_ADDD;
-    if (strcmp(mnemonic, "SUBD") == 0) return OP_SUBD;
-    if (strcmp(mnemonic, "JPOS") == 0) return OP_JPOS;
-    if (strcmp(mnemonic, "JZER") == 0) return OP_JZER;
-    if (strcmp(mnemonic, "JUMP") == 0) return OP_JUMP;
-    if (strcmp(mnemonic, "LOCO") == 0) return OP_LOCO;
-    if (strcmp(mnemonic, "LODL") == 0) return OP_LODL;
-    if (strcmp(mnemonic, "STOL") == 0) return OP_STOL;
-    if (strcmp(mnemonic, "ADDL") == 0) return OP_ADDL;
-    if (strcmp(mnemonic, "SUBL") == 0) return OP_SUBL;
-    if (strcmp(mnemonic, "JNEG") == 0) return OP_JNEG;
-    if (strcmp(mnemonic, "JNZE") == 0) return OP_JNZE;
-    if (strcmp(mnemonic, "CALL") == 0) return OP_CALL;
-
-    if (strcmp(mnemonic, "PSHI") == 0) return 0xF0;
-    if (strcmp(mnemonic, "POPI") == 0) return 0xF2;
-    if (strcmp(mnemonic, "PUSH") == 0) return 0xF4;
-    if (strcmp(mnemonic, "POP") == 0) return 0xF6;
-    if (strcmp(mnemonic, "RETN") == 0) return 0xF8;
-    if (strcmp(mnemonic, "SWAP") == 0) return 0xFA;
-    if (strcmp(mnemonic, "INSP") == 0) return 0xFC;
-    if (strcmp(mnemonic, "DESP") == 0) return 0xFE;
-
-    return 0xFF;
+/* Copy of `s`, NUL-terminated, in the assembler's string pool */
+static const char* intern_string(assembler_t* as, span_t s) {
+    size_t need = (size_t)s.length + 1;
+    string_block* b = as->strings;
+
+    if (!b || b->size - b->used < need) {
+        size_t size = need > STRING_BLOCK_SIZE ? need : STRING_BLOCK_SIZE;
+        b = malloc(sizeof(string_block) + size);
+        if (!b) return NULL;
+        b->next = as->strings;
+        b->used = 0;
+        b->size = size;
+        as->strings = b;
+    }
+
+    char* text = b->text + b->used;
+    memcpy(text, s.text, s.length);
+    text[s.length] = '\0';
+    b->used += need;
+    return text;
 }
 
-int parse_operand(const char* operand_str) {
-    char* endptr;
-    long value;
+/* Index of `name`, entered as not yet defined on first sight; -1 on error */
+static int intern_symbol(assembler_t* as, span_t name) {
+    uint32_t hash = hash_span(name);
+    int sym = find_symbol(as, name, hash);
+    if (sym >= 0) return sym;
 
-    if (strncmp(operand_str, "0x", 2) == 0 || strncmp(operand_str, "0X", 2) == 0) {
-        value = strtol(operand_str, &endptr, 16);
-    } else {
-        value = strtol(operand_str, &endptr, 10);
+    const char* label = grow_symbols(as) == 0 ? intern_string(as, name) : NULL;
+    if (!label) {
+        snprintf(as->error_msg, sizeof(as->error_msg), "Out of memory");
+        return -1;
     }
 
-    if (*endptr != '\0' && !isspace((unsigned char)*endptr)) {
+    symbol_t* s = &as->symbols[as->symbol_count];
+    s->label = label;
+    s->length = name.length;
+    s->hash = hash;
+    s->address = 0;
+    s->absolute = 0;
+    s->global = 0;
+    s->defined = 0;
+    s->changed = 0;
+    insert_slot(as->slots, as->slot_count, hash, as->symbol_count);
+    return as->symbol_count++;
+}
+
+static int define_symbol(assembler_t* as, span_t name, uint16_t address) {
+    int sym = intern_symbol(as, name);
+    if (sym < 0) return -1;
+
+    if (as->symbols[sym].defined) {
+        snprintf(as->error_msg, sizeof(as->error_msg), "Duplicate label: %.*s", name.length, name.text);
         return -1;
     }
+    as->symbols[sym].address = address;
+    as->symbols[sym].defined = 1;
+    as->last_label = sym;
+    return 0;
+}
+
+int add_symbol(assembler_t* as, const char* label, uint16_t address) {
+    return define_symbol(as, make_span(label), address);
+}
 
-    // MAC-1 ISA supports 12-bit operands (0-4095 / 0x000-0xFFF)
-    if (value < 0 || value > 4095) {
+int lookup_symbol(const assembler_t* as, const char* label) {
+    span_t name = make_span(label);
+    int sym = find_symbol(as, name, hash_span(name));
+    if (sym < 0 || !as->symbols[sym].defined) {
         return -1;
     }
+    return as->symbols[sym].address;
+}
+
+/* Leave a formatted message in error_msg and count the error; returns -1 */
+static int syntax_error(assembler_t* as, const char* format, ...) {
+    va_list args;
 
-    return (int)value;
+    va_start(args, format);
+    vsnprintf(as->error_msg, sizeof(as->error_msg), format, args);
+    va_end(args);
+    as->error_count++;
+    return -1;
 }
 
-int add_symbol(assembler_t* as, const char* label, uint16_t address) {
-    if (as->symbol_count >= MAX_LABELS) {
-        snprintf(as->error_msg, sizeof(as->error_msg), "Symbol table full");
+/* .global NAME - export a label to the linker; it may be defined later */
+static int parse_global(assembler_t* as, span_t name) {
+    if (name.length == 0) {
+        return syntax_error(as, "Missing symbol for .global");
+    }
+
+    int sym = intern_symbol(as, name);
+    if (sym < 0) {
+        as->error_count++;
         return -1;
     }
+    as->symbols[sym].global++;
+    as->last_global = sym;
+    return 0;
+}
 
-    for (int i = 0; i < as->symbol_count; i++) {
-        if (strcmp(as->symbols[i].label, label) == 0) {
-            snprintf(as->error_msg, sizeof(as->error_msg), "Duplicate label: %s", label);
-            return -1;
+/* Next comma-separated item of *s, trimmed; *s is left past the comma */
+static span_t next_item(span_t* s) {
+    const char* comma = memchr(s->text, ',', s->length);
+    span_t item = { s->text, comma ? (int)(comma - s->text) : s->length };
+
+    s->text += item.length + (comma ? 1 : 0);
+    s->length -= item.length + (comma ? 1 : 0);
+    return trim(item);
+}
+
+static void resolve(instruction_t* inst, const symbol_t* sym) {
+    inst->operand = (uint16_t)(sym->address + inst->addend);
+}
+
+/*
+ * A number in -32768..65535, or NAME, NAME+N or NAME-N where N is a
+ * number or a symbol defined above. Sets *symbol to the symbols[] index
+ * of NAME, -1 for a plain number, *value to the number or the offset,
+ * and *offset_symbol to the symbol N names, -1 if none. Returns -1
+ * (error set) if it is malformed.
+ */
+static int parse_term(assembler_t* as, span_t s, int* symbol, int* value, int* offset_symbol) {
+    *symbol = -1;
+    *offset_symbol = -1;
+
+    if (s.length > 0 && (isdigit((unsigned char)s.text[0]) || s.text[0] == '-')) {
+        int negative = s.text[0] == '-';
+        span_t digits = { s.text + negative, s.length - negative };
+        int n = parse_unsigned(digits, 0xFFFFFF);
+        if (n < 0) {
+            return syntax_error(as, "Invalid number: %.*s", s.length, s.text);
         }
+        if (n > (negative ? 32768 : 65535)) {
+            return syntax_error(as, "Value out of range: %.*s", s.length, s.text);
+        }
+        *value = negative ? -n : n;
+        return 0;
     }
 
-    strncpy(as->symbols[as->symbol_count].label, label, MAX_LABEL_LENGTH - 1);
-    as->symbols[as->symbol_count].label[MAX_LABEL_LENGTH - 1] = '\0';
-    as->symbols[as->symbol_count].address = address;
-    as->symbol_count++;
+    span_t name = s;
+    *value = 0;
+    for (int i = 1; i < s.length; i++) {
+        if (s.text[i] == '+' || s.text[i] == '-') {
+            span_t offset = trim((span_t){ s.text + i + 1, s.length - i - 1 });
+            int n = parse_unsigned(offset, 4095);
+            if (n < 0) {
+                int sym = find_symbol(as, offset, hash_span(offset));
+                n = sym >= 0 && as->symbols[sym].defined ? as->symbols[sym].address : -1;
+                if (n >= 0) *offset_symbol = sym;
+            }
+            if (n < 0) {
+                return syntax_error(as, "Invalid offset: %.*s", s.length, s.text);
+            }
+            *value = s.text[i] == '-' ? -n : n;
+            name.length = i;
+            break;
+        }
+    }
 
+    *symbol = intern_symbol(as, trim(name));
+    if (*symbol < 0) {
+        as->error_count++;
+        return -1;
+    }
     return 0;
 }
 
-int lookup_symbol(assembler_t* as, const char* label) {
-    for (int i = 0; i < as->symbol_count; i++) {
-        if (strcmp(as->symbols[i].label, label) == 0) {
-            return as->symbols[i].address;
+/*
+ * Operand or .word value `s` into `inst`. A plain number must lie in
+ * min..max; a symbol is resolved now if defined, else queued in fixups.
+ */
+static int parse_value(assembler_t* as, span_t s, instruction_t* inst, int min, int max) {
+    int sym;
+    int value;
+    int offset;
+
+    if (parse_term(as, s, &sym, &value, &offset) != 0) return -1;
+
+    if (sym < 0) {
+        if (value < min || value > max) {
+            return syntax_error(as, "Value out of range: %.*s", s.length, s.text);
         }
+        inst->operand = (uint16_t)value;
+        return 0;
     }
-    return -1;
+
+    inst->has_label_ref = 1;
+    inst->symbol = sym;
+    inst->addend = value;
+    inst->offset_symbol = offset;
+    if (as->symbols[sym].defined) {
+        resolve(inst, &as->symbols[sym]);
+    } else {
+        inst->operand = (uint16_t)value;
+        as->fixups[as->fixup_count++] = (int)(inst - as->instructions);
+    }
+    return 0;
 }
 
-int parse_line(assembler_t* as, const char* line, int pass, int line_num) {
-    static __attribute__((aligned(16))) char line_copy[MAX_LINE_LENGTH];
-    static __attribute__((aligned(16))) char label[MAX_LABEL_LENGTH];
-    static __attribute__((aligned(16))) char mnemonic[16];
-    static __attribute__((aligned(16))) char operand_str[MAX_LABEL_LENGTH];
+/* A value needed now (.org, .space, .fill, .equ): symbols must be defined above */
+static int parse_constant(assembler_t* as, span_t s, int min, int max, int* value) {
+    int sym;
+    int offset;
+
+    if (s.length == 0) {
+        return syntax_error(as, "Missing value");
+    }
+    if (parse_term(as, s, &sym, value, &offset) != 0) return -1;
+
+    if (sym >= 0) {
+        if (!as->symbols[sym].defined) {
+            return syntax_error(as, "Not defined yet: %.*s", s.length, s.text);
+        }
+        *value += as->symbols[sym].address;
+    }
+    if (*value < min || *value > max) {
+        return syntax_error(as, "Value out of range: %.*s", s.length, s.text);
+    }
+    return 0;
+}
 
-    char* token;
-    char* rest;
+/* The next word of the program, cleared; NULL (error set) once it is full */
+static instruction_t* emit_word(assembler_t* as, int line_num) {
+    if (as->instruction_count >= MAX_INSTRUCTIONS) {
+        syntax_error(as, "Program too large (%d words max)", MAX_INSTRUCTIONS);
+        return NULL;
+    }
 
-    memset(line_copy, 0, sizeof(line_copy));
-    memset(label, 0, sizeof(label));
-    memset(mnemonic, 0, sizeof(mnemonic));
-    memset(operand_str, 0, sizeof(operand_str));
+    instruction_t* inst = &as->instructions[as->instruction_count++];
+    inst->opcode = 0;
+    inst->operand = 0;
+    inst->has_label_ref = 0;
+    inst->symbol = -1;
+    inst->addend = 0;
+    inst->offset_symbol = -1;
+    inst->data = 0;
+    inst->line = line_num;
+    inst->org = as->org_line;
+    as->org_line = 0;
+    as->current_address++;
+    return inst;
+}
 
-    if (!line || !as) return -1;
+/* `count` data words of `value` */
+static int emit_fill(assembler_t* as, int count, int value, int line_num) {
+    if (as->instruction_count + count > MAX_INSTRUCTIONS) {
+        return syntax_error(as, "Program too large (%d words max)", MAX_INSTRUCTIONS);
+    }
+    for (int i = 0; i < count; i++) {
+        instruction_t* inst = emit_word(as, line_num);
+        inst->data = 1;
+        inst->operand = (uint16_t)value;
+    }
+    return 0;
+}
 
-    size_t line_len = strlen(line);
-    if (line_len >= MAX_LINE_LENGTH) {
-        line_len = MAX_LINE_LENGTH - 1;
+static int parse_words(assembler_t* as, span_t args, int line_num) {
+    if (args.length == 0) {
+        return syntax_error(as, "Missing value for .word");
     }
-    memcpy(line_copy, line, line_len);
-    line_copy[line_len] = '\0';
+    while (args.length > 0) {
+        span_t item = next_item(&args);
+        if (item.length == 0) {
+            return syntax_error(as, "Missing value for .word");
+        }
 
-    remove_comments(line_copy);
+        instruction_t* inst = emit_word(as, line_num);
+        if (!inst) return -1;
+        inst->data = 1;
+        if (parse_value(as, item, inst, -32768, 65535) != 0) return -1;
+    }
+    return 0;
+}
 
-    trim_whitespace(line_copy);
+/* .space N, or .fill N, V */
+static int parse_fill(assembler_t* as, span_t args, int with_value, int line_num) {
+    int count;
+    int value = 0;
 
-    if (line_copy[0] == '\0') {
-        return 0;
+    if (parse_constant(as, next_item(&args), 0, MAX_INSTRUCTIONS, &count) != 0) return -1;
+    if (with_value && parse_constant(as, next_item(&args), -32768, 65535, &value) != 0) return -1;
+    return emit_fill(as, count, value, line_num);
+}
+
+static int parse_org(assembler_t* as, span_t args, int line_num) {
+    int address;
+
+    if (parse_constant(as, args, 0, MAX_INSTRUCTIONS, &address) != 0) return -1;
+    if (address < as->current_address) {
+        return syntax_error(as, ".org %d is behind the current address %d", address,
+                            as->current_address);
     }
+    as->last_flags |= LINE_ORG;
+    if (emit_fill(as, address - as->current_address, 0, line_num) != 0) return -1;
+    as->org_line = line_num;
+    return 0;
+}
 
-    rest = line_copy;
-    if (strchr(line_copy, ':')) {
-        token = strtok(line_copy, ":");
-        if (token) {
-            strncpy(label, token, MAX_LABEL_LENGTH - 1);
-            label[MAX_LABEL_LENGTH - 1] = '\0';
-            trim_whitespace(label);
+/* .equ NAME, VALUE (the comma is optional) */
+static int parse_equ(assembler_t* as, span_t args) {
+    span_t name;
+    int value;
 
-            if (pass == 1 && strlen(label) > 0) {
-                if (add_symbol(as, label, as->current_address) != 0) {
-                    as->error_count++;
-                    return -1;
-                }
-            }
+    if (memchr(args.text, ',', args.length)) {
+        name = next_item(&args);
+    } else {
+        name = next_word(&args);
+    }
+    if (name.length == 0) {
+        return syntax_error(as, "Missing name for .equ");
+    }
+    if (parse_constant(as, trim(args), -32768, 65535, &value) != 0) return -1;
+
+    if (define_symbol(as, name, (uint16_t)value) != 0) {
+        as->error_count++;
+        return -1;
+    }
+    as->symbols[as->last_label].absolute = 1;
+    as->last_flags |= LINE_EQU;
+    return 0;
+}
 
-            rest = strtok(NULL, "");
-            if (!rest) rest = "";
+static int find_macro(const assembler_t* as, span_t name) {
+    for (int i = 0; i < as->macro_count; i++) {
+        const macro_t* m = &as->macros[i];
+        if (m->length == name.length && memcmp(m->name, name.text, name.length) == 0) {
+            return i;
         }
     }
+    return -1;
+}
 
-    trim_whitespace(rest);
-    if (strlen(rest) == 0) {
-        return 0;
+/* .macro NAME p1, p2, ...: the lines up to .endm become its body */
+static int parse_macro(assembler_t* as, span_t args, int line_num) {
+    span_t name = next_word(&args);
+
+    if (name.length == 0) {
+        return syntax_error(as, "Missing name for .macro");
+    }
+    if (find_mnemonic(name) >= 0 || find_macro(as, name) >= 0) {
+        return syntax_error(as, "Macro name already in use: %.*s", name.length, name.text);
     }
 
-    token = strtok(rest, " \t");
-    if (token) {
-        strncpy(mnemonic, token, sizeof(mnemonic) - 1);
-        mnemonic[sizeof(mnemonic) - 1] = '\0';
+    if (as->macro_count == as->macro_capacity) {
+        int capacity = as->macro_capacity ? as->macro_capacity * 2 : 8;
+        macro_t* grown = realloc(as->macros, (size_t)capacity * sizeof(macro_t));
+        if (!grown) return syntax_error(as, "Out of memory");
+        as->macros = grown;
+        as->macro_capacity = capacity;
+    }
 
-        for (int i = 0; mnemonic[i]; i++) {
-            mnemonic[i] = toupper((unsigned char)mnemonic[i]);
+    macro_t* m = &as->macros[as->macro_count];
+    memset(m, 0, sizeof(*m));
+    m->name = intern_string(as, name);
+    m->length = name.length;
+    m->line = line_num;
+    if (!m->name) return syntax_error(as, "Out of memory");
+
+    args = trim(args);
+    while (args.length > 0) {
+        span_t param = next_item(&args);
+        if (param.length == 0) {
+            return syntax_error(as, "Missing parameter name in .macro %.*s", name.length, name.text);
         }
-
-        token = strtok(NULL, " \t");
-        if (token) {
-            strncpy(operand_str, token, MAX_LABEL_LENGTH - 1);
-            operand_str[MAX_LABEL_LENGTH - 1] = '\0';
-            trim_whitespace(operand_str);
+        if (m->param_count == MAX_MACRO_PARAMS) {
+            return syntax_error(as, "Too many macro parameters (%d max)", MAX_MACRO_PARAMS);
         }
+        m->params[m->param_count] = intern_string(as, param);
+        if (!m->params[m->param_count++]) return syntax_error(as, "Out of memory");
     }
 
-    if (!is_valid_opcode(mnemonic)) {
-        snprintf(as->error_msg, sizeof(as->error_msg), "Invalid opcode: %s", mnemonic);
-        as->error_count++;
-        return -1;
-    }
+    as->defining = as->macro_count++;
+    as->last_flags |= LINE_MACRO;
+    return 0;
+}
 
-    uint8_t opcode = parse_opcode(mnemonic);
+/* One line inside .macro ... .endm: kept as text, not assembled */
+static int macro_line(assembler_t* as, span_t rest) {
+    macro_t* m = &as->macros[as->defining];
+    span_t text = trim(rest);
+    span_t first = next_word(&rest);
 
-    if (pass == 1) {
-        as->current_address += 2;
+    as->last_flags |= LINE_MACRO;
+    if (span_equals_nocase(first, ".ENDM")) {
+        as->defining = -1;
         return 0;
     }
+    if (span_equals_nocase(first, ".MACRO")) {
+        return syntax_error(as, "Nested .macro in %s", m->name);
+    }
+    if (memchr(text.text, ':', text.length)) {
+        return syntax_error(as, "Labels are not allowed inside a macro");
+    }
+    if (text.length == 0) return 0;
 
-    if (pass == 2) {
-        instruction_t* inst = &as->instructions[as->instruction_count];
-        inst->opcode = opcode;
-        inst->has_label_ref = 0;
-
-        // Register source line mapping for debug symbols
-        uint16_t memory_address = as->instruction_count;
-        if (memory_address < SOURCE_LINE_MAP_SIZE) {
-            g_source_line_map[memory_address] = line_num;
+    if (m->body_length + text.length + 1 > m->body_capacity) {
+        int capacity = m->body_capacity ? m->body_capacity : 128;
+        while (capacity < m->body_length + text.length + 1) {
+            capacity *= 2;
         }
+        char* grown = realloc(m->body, (size_t)capacity);
+        if (!grown) return syntax_error(as, "Out of memory");
+        m->body = grown;
+        m->body_capacity = capacity;
+    }
+    memcpy(m->body + m->body_length, text.text, text.length);
+    m->body_length += text.length;
+    m->body[m->body_length++] = '\n';
+    return 0;
+}
 
-        if (opcode >= 0xF0 && opcode <= 0xFA && opcode != 0xFC && opcode != 0xFE) {
-            inst->operand = 0;
-        } else {
-            if (strlen(operand_str) == 0) {
-                snprintf(as->error_msg, sizeof(as->error_msg), "Missing operand for %s", mnemonic);
-                as->error_count++;
-                return -1;
-            }
+static int is_name_char(int c) {
+    return isalnum(c) || c == '_';
+}
 
-            int value = parse_operand(operand_str);
-            if (value >= 0) {
-                inst->operand = (uint16_t)value;
-            } else {
-                inst->has_label_ref = 1;
-                strncpy(inst->label_ref, operand_str, MAX_LABEL_LENGTH - 1);
-                inst->label_ref[MAX_LABEL_LENGTH - 1] = '\0';
+/* `line` with each whole-word parameter replaced by its argument, into *text */
+static int substitute(const macro_t* m, span_t line, const span_t* args, char** text,
+                      int* capacity) {
+    int length = 0;
+    int i = 0;
+
+    while (i < line.length) {
+        span_t word = { line.text + i, 1 };
+        span_t piece = word;
+
+        if (is_name_char((unsigned char)line.text[i])) {
+            while (i + word.length < line.length &&
+                   is_name_char((unsigned char)line.text[i + word.length])) {
+                word.length++;
+            }
+            piece = word;
+            for (int p = 0; p < m->param_count; p++) {
+                if ((int)strlen(m->params[p]) == word.length &&
+                    memcmp(m->params[p], word.text, word.length) == 0) {
+                    piece = args[p];
+                    break;
+                }
             }
         }
 
-        as->instruction_count++;
-        as->current_address += 2;
+        if (length + piece.length > *capacity) {
+            int grown_capacity = *capacity ? *capacity * 2 : 128;
+            while (grown_capacity < length + piece.length) {
+                grown_capacity *= 2;
+            }
+            char* grown = realloc(*text, (size_t)grown_capacity);
+            if (!grown) return -1;
+            *text = grown;
+            *capacity = grown_capacity;
+        }
+        memcpy(*text + length, piece.text, piece.length);
+        length += piece.length;
+        i += word.length;
     }
-
-    return 0;
+    return length;
 }
 
-int pass1(assembler_t* as, const char* source) {
-    char line[MAX_LINE_LENGTH];
-    const char* ptr = source;
-    int line_num = 0;
+static int parse_statement(assembler_t* as, span_t rest, int line_num);
 
-    while (*ptr) {
-        int i = 0;
-        while (*ptr && *ptr != '\n' && i < MAX_LINE_LENGTH - 1) {
-            line[i++] = *ptr++;
+/* A use of macro `index`: each body line, arguments substituted, assembled in turn */
+static int expand_macro(assembler_t* as, int index, span_t args, int line_num) {
+    const macro_t* m = &as->macros[index];
+    span_t values[MAX_MACRO_PARAMS];
+    int count = 0;
+
+    if (as->expanding >= MAX_MACRO_DEPTH) {
+        return syntax_error(as, "Macros nested too deep (%d max) in %s", MAX_MACRO_DEPTH, m->name);
+    }
+
+    args = trim(args);
+    while (args.length > 0) {
+        span_t value = next_item(&args);
+        if (count == MAX_MACRO_PARAMS || value.length == 0) {
+            return syntax_error(as, "Bad arguments for %s", m->name);
         }
-        line[i] = '\0';
+        values[count++] = value;
+    }
+    if (count != m->param_count) {
+        return syntax_error(as, "%s takes %d arguments, %d given", m->name, m->param_count, count);
+    }
 
-        if (*ptr == '\n') ptr++;
-        line_num++;
+    char* text = NULL;
+    int capacity = 0;
+    int result = 0;
+
+    as->expanding++;
+    for (int at = 0; at < m->body_length && result == 0;) {
+        const char* eol = memchr(m->body + at, '\n', (size_t)(m->body_length - at));
+        span_t line = { m->body + at, (int)(eol - (m->body + at)) };
+        at += line.length + 1;
+
+        /* Depth alone does not bound the work: nested uses multiply */
+        if (++as->expanded > MAX_MACRO_LINES) {
+            result = syntax_error(as, "Macro expansion too large (%d lines max) in %s",
+                                  MAX_MACRO_LINES, m->name);
+            break;
+        }
 
-        if (parse_line(as, line, 1, line_num) != 0) {
-            fprintf(stderr, "Error on line %d: %s\n", line_num, as->error_msg);
-            return -1;
+        int length = substitute(m, line, values, &text, &capacity);
+        if (length < 0) {
+            result = syntax_error(as, "Out of memory");
+        } else {
+            span_t expanded = { text, length };
+            result = parse_statement(as, expanded, line_num);
         }
     }
+    as->expanding--;
+    free(text);
+    return result;
+}
 
-    return 0;
+/* Directives allowed inside a macro body */
+static int is_data_directive(span_t name) {
+    return span_equals_nocase(name, ".WORD") || span_equals_nocase(name, ".SPACE") ||
+           span_equals_nocase(name, ".FILL");
 }
 
-int pass2(assembler_t* as, uint16_t* output) {
-    (void)output;
+static int parse_directive(assembler_t* as, span_t name, span_t args, int line_num) {
+    if (as->expanding && !is_data_directive(name)) {
+        return syntax_error(as, "%.*s is not allowed inside a macro", name.length, name.text);
+    }
 
-    as->current_address = 0;
-    as->instruction_count = 0;
+    if (span_equals_nocase(name, ".GLOBAL")) return parse_global(as, next_word(&args));
+    if (span_equals_nocase(name, ".WORD")) return parse_words(as, args, line_num);
+    if (span_equals_nocase(name, ".SPACE")) return parse_fill(as, args, 0, line_num);
+    if (span_equals_nocase(name, ".FILL")) return parse_fill(as, args, 1, line_num);
+    if (span_equals_nocase(name, ".ORG")) return parse_org(as, args, line_num);
+    if (span_equals_nocase(name, ".EQU")) return parse_equ(as, args);
+    if (span_equals_nocase(name, ".MACRO")) return parse_macro(as, args, line_num);
+    if (span_equals_nocase(name, ".ENDM")) return syntax_error(as, ".endm without .macro");
 
-    return 0;
+    return syntax_error(as, "Invalid directive: %.*s", name.length, name.text);
 }
 
-int assemble_string(const char* source, uint16_t* output, int* output_size) {
-    // Clear source line mapping for new assembly
-    clear_source_line_map();
-    
-    assembler_t as;
-    init_assembler(&as);
+/* What follows the label: an instruction, a directive or a macro use */
+static int parse_statement(assembler_t* as, span_t rest, int line_num) {
+    span_t mnemonic = next_word(&rest);
+    if (mnemonic.length == 0) {
+        return 0;
+    }
 
-    if (pass1(&as, source) != 0) {
-        return -1;
+    if (mnemonic.text[0] == '.') {
+        return parse_directive(as, mnemonic, trim(rest), line_num);
     }
 
-    as.current_address = 0;
-    as.instruction_count = 0;
+    int opcode = find_mnemonic(mnemonic);
+    if (opcode < 0) {
+        int macro = find_macro(as, mnemonic);
+        if (macro >= 0) {
+            return expand_macro(as, macro, rest, line_num);
+        }
+        return syntax_error(as, "Invalid opcode: %.*s", mnemonic.length, mnemonic.text);
+    }
 
-    char line[MAX_LINE_LENGTH];
-    const char* ptr = source;
-    int line_num = 0;
+    span_t operand = next_word(&rest);
+    instruction_t* inst = emit_word(as, line_num);
+    if (!inst) return -1;
+    inst->opcode = (uint8_t)opcode;
 
-    while (*ptr) {
-        int i = 0;
-        while (*ptr && *ptr != '\n' && i < MAX_LINE_LENGTH - 1) {
-            line[i++] = *ptr++;
+    // PSHI..SWAP take no operand; INSP and DESP take an 8-bit one
+    if (opcode < 0xF0 || opcode == 0xFC || opcode == 0xFE) {
+        if (operand.length == 0) {
+            return syntax_error(as, "Missing operand for %.*s", mnemonic.length, mnemonic.text);
         }
-        line[i] = '\0';
+        return parse_value(as, operand, inst, 0, 4095);
+    }
+    return 0;
+}
 
-        if (*ptr == '\n') ptr++;
-        line_num++;
+/*
+ * Assemble one line of `length` bytes. The line is tokenised in place:
+ * label, mnemonic and operand are spans of it, so it needs no NUL and
+ * is not copied. Labels are defined and words emitted on the spot; an
+ * operand naming a label not seen yet is queued in fixups.
+ */
+int parse_line(assembler_t* as, const char* line, int length, int line_num) {
+    if (!line || !as) return -1;
+
+    as->last_label = -1;
+    as->last_global = -1;
+    as->last_flags = 0;
+
+    span_t rest = { line, length };
+    const char* comment = memchr(line, ';', length);
+    if (comment) {
+        rest.length = (int)(comment - line);
+    }
+
+    if (as->defining >= 0) {
+        return macro_line(as, rest);
+    }
+
+    const char* colon = memchr(rest.text, ':', rest.length);
+    if (colon) {
+        span_t label = { rest.text, (int)(colon - rest.text) };
+        label = trim(label);
 
-        if (parse_line(&as, line, 2, line_num) != 0) {
-            fprintf(stderr, "Error on line %d: %s\n", line_num, as.error_msg);
+        if (label.length > 0 && define_symbol(as, label, (uint16_t)as->current_address) != 0) {
+            as->error_count++;
             return -1;
         }
+        rest.length -= (int)(colon + 1 - rest.text);
+        rest.text = colon + 1;
     }
 
-    for (int i = 0; i < as.instruction_count; i++) {
-        instruction_t* inst = &as.instructions[i];
+    return parse_statement(as, rest, line_num);
+}
 
-        if (inst->has_label_ref) {
-            int addr = lookup_symbol(&as, inst->label_ref);
-            if (addr < 0) {
-                fprintf(stderr, "Undefined label: %s\n", inst->label_ref);
-                return -1;
-            }
-            inst->operand = (uint16_t)(addr / 2);
-        }
+/*
+ * Patch the forward references whose label turned up later in the source.
+ * Those still undefined stay in fixups (externals, for objects).
+ */
+static void backpatch(assembler_t* as) {
+    int pending = 0;
 
-        // Encoding depends on instruction type:
-        // - Normal instructions (0x0-0xE): 4-bit opcode + 12-bit operand
-        // - Special instructions (0xF_): 8-bit opcode + 8-bit operand
-        if (inst->opcode >= 0xF0) {
-            // Special instructions: opcode already includes sub-opcode
-            output[i] = ((uint16_t)inst->opcode << 8) | (inst->operand & 0xFF);
+    for (int i = 0; i < as->fixup_count; i++) {
+        instruction_t* inst = &as->instructions[as->fixups[i]];
+        const symbol_t* sym = &as->symbols[inst->symbol];
+
+        if (sym->defined) {
+            resolve(inst, sym);
         } else {
-            // Normal instructions: 4-bit opcode in upper nibble
-            output[i] = ((uint16_t)inst->opcode << 12) | (inst->operand & 0x0FFF);
+            as->fixups[pending++] = as->fixups[i];
         }
     }
+    as->fixup_count = pending;
+}
 
-    *output_size = as.instruction_count;
+/* Room for `count` line records */
+static int reserve_lines(assembler_t* as, int count) {
+    if (count <= as->line_capacity) return 0;
+
+    int capacity = as->line_capacity ? as->line_capacity : 64;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    line_t* grown = realloc(as->lines, (size_t)capacity * sizeof(line_t));
+    if (!grown) return -1;
+    as->lines = grown;
+    as->line_capacity = capacity;
     return 0;
 }
 
-int assemble_file(const char* input_file, const char* output_file) {
-    FILE* fp = fopen(input_file, "r");
-    if (!fp) {
-        fprintf(stderr, "Error: Cannot open input file: %s\n", input_file);
+/* parse_line, noting what the line produced in `record` when there is one */
+static int assemble_line(assembler_t* as, const char* source, int offset, int length,
+                         int line_num, line_t* record) {
+    int address = as->current_address;
+
+    if (length > MAX_LINE_LENGTH) {
+        as->error_line = line_num;
+        return syntax_error(as, "Line too long (%d characters max)", MAX_LINE_LENGTH);
+    }
+    if (parse_line(as, source + offset, length, line_num) != 0) {
+        as->error_line = line_num;
         return -1;
     }
+    if (record) {
+        record->offset = offset;
+        record->address = address;
+        record->label = as->last_label;
+        record->global = as->last_global;
+        record->flags = as->last_flags;
+    }
+    return 0;
+}
+
+static int check_globals(assembler_t* as) {
+    for (int i = 0; i < as->symbol_count; i++) {
+        if (as->symbols[i].global && !as->symbols[i].defined) {
+            snprintf(as->error_msg, sizeof(as->error_msg), "Undefined global: %s", as->symbols[i].label);
+            as->error_count++;
+            return -1;
+        }
+    }
+    return 0;
+}
 
-    fseek(fp, 0, SEEK_END);
-    long file_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
+/* Raw images have no externals: any fixup left is an error */
+static int check_labels(assembler_t* as) {
+    if (as->fixup_count == 0) return 0;
 
-    char* source = (char*)malloc(file_size + 1);
-    if (!source) {
-        fprintf(stderr, "Error: Memory allocation failed\n");
-        fclose(fp);
-        return -1;
+    const instruction_t* inst = &as->instructions[as->fixups[0]];
+    snprintf(as->error_msg, sizeof(as->error_msg), "Undefined label: %s",
+             as->symbols[inst->symbol].label);
+    as->error_line = inst->line;
+    as->error_count++;
+    return -1;
+}
+
+/* After the last line: no open macro, references patched, globals defined */
+static int finish_source(assembler_t* as) {
+    if (as->defining >= 0) {
+        as->error_line = as->macros[as->defining].line;
+        return syntax_error(as, "Missing .endm for macro %s", as->macros[as->defining].name);
     }
 
-    fread(source, 1, file_size, fp);
-    source[file_size] = '\0';
-    fclose(fp);
+    backpatch(as);
+    return check_globals(as);
+}
 
-    uint16_t output[MAX_INSTRUCTIONS];
-    int output_size;
+/*
+ * One pass over `source`, then backpatching; undefined labels are left
+ * pending. `as` is reset first, so a context can be reused. With
+ * `record`, what each line produced is kept in as->lines.
+ */
+static int assemble_source(assembler_t* as, const char* source, int record) {
+    free_assembler(as);
+    init_assembler(as);
 
-    if (assemble_string(source, output, &output_size) != 0) {
-        free(source);
-        return -1;
+    const char* ptr = source;
+    int line_num = 0;
+
+    while (*ptr) {
+        const char* end = strchr(ptr, '\n');
+        int length = end ? (int)(end - ptr) : (int)strlen(ptr);
+        line_num++;
+
+        line_t* line = NULL;
+        if (record) {
+            if (reserve_lines(as, line_num) != 0) {
+                snprintf(as->error_msg, sizeof(as->error_msg), "Out of memory");
+                return -1;
+            }
+            line = &as->lines[line_num - 1];
+            as->line_count = line_num;
+        }
+        if (assemble_line(as, source, (int)(ptr - source), length, line_num, line) != 0) {
+            return -1;
+        }
+
+        ptr += length;
+        if (*ptr == '\n') ptr++;
     }
+    return finish_source(as);
+}
 
-    free(source);
+static uint16_t encode_instruction(const instruction_t* inst) {
+    if (inst->data) {
+        return inst->operand;
+    }
+    // Encoding depends on instruction type:
+    // - Normal instructions (0x0-0xE): 4-bit opcode + 12-bit operand
+    // - Special instructions (0xF_): 8-bit opcode + 8-bit operand
+    if (inst->opcode >= 0xF0) {
+        // Special instructions: opcode already includes sub-opcode
+        return ((uint16_t)inst->opcode << 8) | (inst->operand & 0xFF);
+    }
+    // Normal instructions: 4-bit opcode in upper nibble
+    return ((uint16_t)inst->opcode << 12) | (inst->operand & 0x0FFF);
+}
 
-    fp = fopen(output_file, "wb");
-    if (!fp) {
-        fprintf(stderr, "Error: Cannot create output file: %s\n", output_file);
+int assembler_run(assembler_t* as, const char* source, uint16_t* output, int capacity,
+                  int* output_size) {
+    if (assemble_source(as, source, 0) != 0 || check_labels(as) != 0) {
         return -1;
     }
 
-    fwrite(output, sizeof(uint16_t), output_size, fp);
-    fclose(fp);
+    if (as->instruction_count > capacity) {
+        snprintf(as->error_msg, sizeof(as->error_msg), "Output buffer too small: %d words needed",
+                 as->instruction_count);
+        as->error_count++;
+        return -1;
+    }
+
+    for (int i = 0; i < as->instruction_count; i++) {
+        output[i] = encode_instruction(&as->instructions[i]);
+    }
+    *output_size = as->instruction_count;
+    return 0;
+}
+
+/* Object symbol for assembler symbol `sym`, added on first use */
+static int object_symbol(assembler_t* as, mic1_object* obj, const symbol_t* sym, int flags,
+                         int* index) {
+    if (*index >= 0) return *index;
+
+    if (sym->length > OBJ_MAX_NAME) {
+        snprintf(as->error_msg, sizeof(as->error_msg),
+                 "Label too long for an object (%d characters max): %.32s...", OBJ_MAX_NAME, sym->label);
+        return -1;
+    }
+    *index = object_add_symbol(obj, sym->label, flags, sym->address);
+    if (*index < 0) {
+        snprintf(as->error_msg, sizeof(as->error_msg), "Memory allocation failed");
+    }
+    return *index;
+}
+
+/*
+ * The object for what `as` just assembled, based at 0. References to
+ * local labels get an OBJ_RELOC_ABS fixup (16 bits wide for .word);
+ * .equ constants need none and are exported as OBJ_SYM_ABS. References
+ * to labels not defined here become undefined symbols for the linker.
+ */
+static int build_object(assembler_t* as, mic1_object* obj) {
+    uint16_t words[MAX_INSTRUCTIONS];
+    int* index = NULL;      /* object symbol of each assembler symbol, -1 = none yet */
+
+    index = malloc(((size_t)as->symbol_count + 1) * sizeof(int));
+    if (!index) goto oom;
+    memset(index, 0xFF, ((size_t)as->symbol_count + 1) * sizeof(int));
+
+    for (int i = 0; i < as->symbol_count; i++) {
+        if (!as->symbols[i].defined) continue;
+
+        int flags = as->symbols[i].global ? OBJ_SYM_GLOBAL : OBJ_SYM_LOCAL;
+        if (as->symbols[i].absolute) flags |= OBJ_SYM_ABS;
+        if (object_symbol(as, obj, &as->symbols[i], flags, &index[i]) < 0) goto fail;
+    }
+
+    for (int i = 0; i < as->instruction_count; i++) {
+        const instruction_t* inst = &as->instructions[i];
+        int bits = inst->data ? 16 : inst->opcode >= 0xF0 ? 8 : 12;
+        int added = 0;
+
+        if (inst->has_label_ref && !as->symbols[inst->symbol].absolute) {
+            const symbol_t* label = &as->symbols[inst->symbol];
+            if (label->defined) {
+                added = object_add_reloc(obj, (uint16_t)i, OBJ_RELOC_ABS, bits, 0);
+            } else {
+                int sym = object_symbol(as, obj, label, OBJ_SYM_UNDEF, &index[inst->symbol]);
+                if (sym < 0) goto fail;
+                added = object_add_reloc(obj, (uint16_t)i, OBJ_RELOC_SYM, bits, sym);
+            }
+        }
+
+        words[i] = encode_instruction(inst);
+        if (added < 0 || object_add_line(obj, (uint16_t)i, inst->line) < 0) {
+            goto oom;
+        }
+    }
+
+    if (object_add_section(obj, OBJ_SECTION_CODE, 0, words, (uint16_t)as->instruction_count) < 0) {
+        goto oom;
+    }
+    free(index);
+    return 0;
+
+oom:
+    snprintf(as->error_msg, sizeof(as->error_msg), "Memory allocation failed");
+fail:
+    as->error_count++;
+    free(index);
+    free_object(obj);
+    return -1;
+}
+
+/* Assemble `source` into a relocatable object; see build_object */
+int assembler_object(assembler_t* as, const char* source, mic1_object* obj) {
+    init_object(obj);
+    if (assemble_source(as, source, 0) != 0) {
+        return -1;
+    }
+    return build_object(as, obj);
+}
+
+/* Rewrite one word of the caller's image if it differs */
+static void patch_word(assembler_t* as, uint16_t* image, int old_size, int address, uint16_t word) {
+    if (address >= old_size || image[address] != word) {
+        image[address] = word;
+        as->patched[as->patch_count++] = (uint16_t)address;
+    }
+}
+
+/* After a failed update the previous parse is no longer usable */
+static int drop_update(assembler_t* as) {
+    free(as->source);
+    as->source = NULL;
+    as->line_count = 0;
+    return -1;
+}
+
+static int keep_source(assembler_t* as, const char* source, int length) {
+    char* copy = realloc(as->source, (size_t)length + 1);
+    if (!copy) {
+        snprintf(as->error_msg, sizeof(as->error_msg), "Out of memory");
+        return drop_update(as);
+    }
+    memcpy(copy, source, (size_t)length + 1);
+    as->source = copy;
+    as->source_length = length;
+    return 0;
+}
+
+static int update_full(assembler_t* as, const char* source, int length, uint16_t* image,
+                       int capacity, int* image_size, int old_size) {
+    if (assemble_source(as, source, 1) != 0 || check_labels(as) != 0) {
+        return drop_update(as);
+    }
+    if (as->instruction_count > capacity) {
+        snprintf(as->error_msg, sizeof(as->error_msg), "Output buffer too small: %d words needed",
+                 as->instruction_count);
+        as->error_count++;
+        return drop_update(as);
+    }
+
+    for (int i = 0; i < as->instruction_count; i++) {
+        patch_word(as, image, old_size, i, encode_instruction(&as->instructions[i]));
+    }
+    for (int i = as->instruction_count; i < old_size; i++) {
+        patch_word(as, image, old_size, i, 0);
+    }
+    *image_size = as->instruction_count;
+
+    as->update.full = 1;
+    as->update.first_line = 1;
+    as->update.reparsed = as->line_count;
+    return keep_source(as, source, length);
+}
+
+/* Index of the line holding byte `offset` of the previous source */
+static int line_at(const assembler_t* as, int offset) {
+    int lo = 0;
+    int hi = as->line_count - 1;
+
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (as->lines[mid].offset <= offset) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+/* Whether any of lines [from, to) is one of `flags` */
+static int lines_have(const assembler_t* as, int from, int to, int flags) {
+    if (from < 0) from = 0;
+    if (to > as->line_count) to = as->line_count;
+
+    for (int i = from; i < to; i++) {
+        if (as->lines[i].flags & flags) return 1;
+    }
+    return 0;
+}
+
+int assembler_update(assembler_t* as, const char* source, uint16_t* image, int capacity,
+                     int* image_size) {
+    int length = (int)strlen(source);
+    int old_size = *image_size < MAX_INSTRUCTIONS ? *image_size : MAX_INSTRUCTIONS;
+
+    memset(&as->update, 0, sizeof(as->update));
+    as->patch_count = 0;
+    as->error_line = 0;
+    as->expanded = 0;
+
+    if (!as->source) {
+        return update_full(as, source, length, image, capacity, image_size, old_size);
+    }
+
+    /* The edit: longest common prefix and suffix, widened to whole lines */
+    const char* old = as->source;
+    int old_length = as->source_length;
+    int limit = old_length < length ? old_length : length;
+    int prefix = 0;
+    int suffix = 0;
+
+    while (prefix < limit && old[prefix] == source[prefix]) prefix++;
+    if (prefix == old_length && prefix == length) return 0;
+
+    /* The suffix may reach back to the '\n' ending the last unchanged line */
+    int first = line_at(as, prefix);
+    int start = first < as->line_count ? as->lines[first].offset : 0;
+    int floor = start > 0 ? start - 1 : 0;
+    while (suffix < limit - floor &&
+           old[old_length - 1 - suffix] == source[length - 1 - suffix]) suffix++;
+
+    /* Old lines [first, end) are replaced; a tail line starts after a shared '\n' */
+    int end = first;
+    while (end < as->line_count && as->lines[end].offset <= old_length - suffix) end++;
+
+    int shift = length - old_length;
+    int stop = (end < as->line_count ? as->lines[end].offset : old_length) + shift;
+    int first_word = first < as->line_count ? as->lines[first].address : 0;
+    int end_word = end < as->line_count ? as->lines[end].address : as->instruction_count;
+    int tail_words = as->instruction_count - end_word;
+    int tail_lines = as->line_count - end;
+
+    int region_lines = 0;
+    for (int i = start; i < stop; i++) {
+        if (source[i] == '\n') region_lines++;
+    }
+    if (stop > start && source[stop - 1] != '\n') region_lines++;
+
+    /*
+     * .org, .equ and macro definitions reach past their own line, and a
+     * line inserted next to a macro body may belong to it: assemble it all
+     */
+    if (lines_have(as, first, end, LINE_ORG | LINE_EQU | LINE_MACRO) ||
+        lines_have(as, first - 1, first, LINE_MACRO) || lines_have(as, end, end + 1, LINE_MACRO)) {
+        return update_full(as, source, length, image, capacity, image_size, old_size);
+    }
+
+    /* Forget what the replaced lines defined */
+    for (int i = first; i < end; i++) {
+        const line_t* line = &as->lines[i];
+        if (line->label >= 0) {
+            as->symbols[line->label].defined = 0;
+            as->symbols[line->label].changed = 1;
+        }
+        if (line->global >= 0) {
+            as->symbols[line->global].global--;
+        }
+    }
+
+    instruction_t* tail = malloc(((size_t)tail_words + 1) * sizeof(instruction_t));
+    if (!tail || reserve_lines(as, first + region_lines + tail_lines) != 0) {
+        free(tail);
+        snprintf(as->error_msg, sizeof(as->error_msg), "Out of memory");
+        return drop_update(as);
+    }
+    memcpy(tail, &as->instructions[end_word], (size_t)tail_words * sizeof(instruction_t));
+    memmove(&as->lines[first + region_lines], &as->lines[end], (size_t)tail_lines * sizeof(line_t));
+    as->line_count = first + region_lines + tail_lines;
+
+    /* Parse the edited lines only */
+    as->instruction_count = first_word;
+    as->current_address = first_word;
+    as->fixup_count = 0;
+
+    const char* ptr = source + start;
+    int line_num = first;
+    while (ptr < source + stop) {
+        const char* eol = memchr(ptr, '\n', (size_t)(source + stop - ptr));
+        int line_length = eol ? (int)(eol - ptr) : (int)(source + stop - ptr);
+        line_num++;
+
+        if (assemble_line(as, source, (int)(ptr - source), line_length, line_num,
+                          &as->lines[line_num - 1]) != 0) {
+            free(tail);
+            return drop_update(as);
+        }
+        ptr += line_length + (eol ? 1 : 0);
+    }
+
+    int new_words = as->instruction_count - first_word;
+    int moved = new_words - (end_word - first_word);
+    int line_shift = region_lines - (end - first);
+
+    /* The same for the new lines, and for a .org below that would absorb the move */
+    if (lines_have(as, first, first + region_lines, LINE_ORG | LINE_EQU | LINE_MACRO) ||
+        (moved && lines_have(as, first + region_lines, as->line_count, LINE_ORG))) {
+        free(tail);
+        return update_full(as, source, length, image, capacity, image_size, old_size);
+    }
+
+    if (as->instruction_count + tail_words > MAX_INSTRUCTIONS) {
+        free(tail);
+        snprintf(as->error_msg, sizeof(as->error_msg), "Program too large (%d words max)",
+                 MAX_INSTRUCTIONS);
+        as->error_count++;
+        return drop_update(as);
+    }
+
+    /* Shift the unchanged tail */
+    for (int i = 0; i < tail_words; i++) {
+        tail[i].line += line_shift;
+    }
+    memcpy(&as->instructions[as->instruction_count], tail, (size_t)tail_words * sizeof(instruction_t));
+    free(tail);
+    as->instruction_count += tail_words;
+    as->current_address = as->instruction_count;
+
+    for (int i = first + region_lines; i < as->line_count; i++) {
+        line_t* line = &as->lines[i];
+        line->offset += shift;
+        line->address += moved;
+        if (moved && line->label >= 0 && !as->symbols[line->label].absolute) {
+            as->symbols[line->label].address = (uint16_t)(as->symbols[line->label].address + moved);
+            as->symbols[line->label].changed = 1;
+        }
+    }
+
+    /* Resolve the new lines' references and those to labels that moved */
+    int region_end = moved ? as->instruction_count : first_word + new_words;
+    as->fixup_count = 0;
+    for (int i = 0; i < as->instruction_count; i++) {
+        instruction_t* inst = &as->instructions[i];
+        if (!inst->has_label_ref) continue;
+
+        /* NAME+SYM took SYM's address when it was parsed */
+        if (inst->offset_symbol >= 0 && as->symbols[inst->offset_symbol].changed) {
+            return update_full(as, source, length, image, capacity, image_size, old_size);
+        }
+
+        const symbol_t* sym = &as->symbols[inst->symbol];
+        if (!sym->changed && (i < first_word || i >= first_word + new_words)) continue;
+
+        if (sym->defined) {
+            resolve(inst, sym);
+        } else {
+            as->fixups[as->fixup_count++] = i;
+        }
+    }
+    if (check_labels(as) != 0 || check_globals(as) != 0) {
+        return drop_update(as);
+    }
+    if (as->instruction_count > capacity) {
+        snprintf(as->error_msg, sizeof(as->error_msg), "Output buffer too small: %d words needed",
+                 as->instruction_count);
+        as->error_count++;
+        return drop_update(as);
+    }
+
+    /* Patch: the edited words, the shifted tail, and words whose label moved */
+    for (int i = first_word; i < region_end; i++) {
+        patch_word(as, image, old_size, i, encode_instruction(&as->instructions[i]));
+    }
+    for (int i = 0; i < as->instruction_count; i++) {
+        const instruction_t* inst = &as->instructions[i];
+        if ((i < first_word || i >= region_end) && inst->has_label_ref &&
+            as->symbols[inst->symbol].changed) {
+            patch_word(as, image, old_size, i, encode_instruction(inst));
+        }
+    }
+    for (int i = as->instruction_count; i < old_size; i++) {
+        patch_word(as, image, old_size, i, 0);
+    }
+    *image_size = as->instruction_count;
+
+    for (int i = 0; i < as->symbol_count; i++) {
+        as->symbols[i].changed = 0;
+    }
+
+    as->update.first_line = first + 1;
+    as->update.reparsed = region_lines;
+    as->update.moved_from = end_word;
+    as->update.moved_by = moved;
+    return keep_source(as, source, length);
+}
+
+/* Jumps followed through a chain of JUMPs before giving up */
+#define MAX_JUMP_CHAIN 64
+/* Optimisation rounds; one seldom leaves anything for the next */
+#define MAX_OPT_PASSES 8
+
+static int is_branch(const instruction_t* inst) {
+    if (inst->data) return 0;
+    switch (inst->opcode) {
+        case OP_JPOS: case OP_JZER: case OP_JUMP: case OP_JNEG: case OP_JNZE: case OP_CALL:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* LODD..JUMP and JNEG..CALL: the operand is a memory address */
+static int takes_address(const instruction_t* inst) {
+    return !inst->data && inst->opcode != OP_LOCO &&
+           (inst->opcode <= OP_JUMP || (inst->opcode >= OP_JNEG && inst->opcode <= OP_CALL));
+}
+
+/* Reference to a label, which moves with the code (a .equ does not) */
+static int is_label_ref(const assembler_t* as, const instruction_t* inst) {
+    return inst->has_label_ref && !as->symbols[inst->symbol].absolute;
+}
+
+static int ref_target(const assembler_t* as, const instruction_t* inst) {
+    return as->symbols[inst->symbol].address + inst->addend;
+}
+
+/* Address a branch goes to */
+static int branch_target(const assembler_t* as, const instruction_t* inst) {
+    return is_label_ref(as, inst) ? ref_target(as, inst) : inst->operand & 0x0FFF;
+}
+
+/* Index into optimize_t.skipped: the top byte of the word, operand bits clear */
+static int opcode_key(const instruction_t* inst) {
+    return inst->opcode >= 0xF0 ? inst->opcode : inst->opcode << 4;
+}
+
+/* Send each jump or CALL that lands on a JUMP to where that JUMP goes */
+static void retarget_jumps(assembler_t* as, optimize_t* stats) {
+    for (int i = 0; i < as->instruction_count; i++) {
+        instruction_t* inst = &as->instructions[i];
+        if (!is_branch(inst) || !is_label_ref(as, inst)) continue;
+
+        int first = ref_target(as, inst);
+        int target = first;
+        const instruction_t* last = NULL;
+        int hops = 0;
+        int bypassed = 0;
+
+        while (target >= 0 && target < as->instruction_count && hops < MAX_JUMP_CHAIN) {
+            const instruction_t* next = &as->instructions[target];
+            if (next->data || next->opcode != OP_JUMP || !is_label_ref(as, next)) break;
+
+            /* A JUMP to itself (a halt) ends the chain; a loop of JUMPs is left alone */
+            int to = ref_target(as, next);
+            if (to == target) break;
+            if (to == first || to == i) {
+                last = NULL;
+                break;
+            }
+            /* A JUMP to the next word is dropped later and counted then */
+            if (to != target + 1) bypassed++;
+            last = next;
+            target = to;
+            hops++;
+        }
+        if (!last || hops == MAX_JUMP_CHAIN) continue;
+
+        inst->symbol = last->symbol;
+        inst->addend = last->addend;
+        inst->offset_symbol = last->offset_symbol;
+        resolve(inst, &as->symbols[inst->symbol]);
+        stats->jump_chains++;
+        stats->skipped[OP_JUMP << 4] += bypassed;
+    }
+}
+
+/* Words a path can enter other than from the word above: labels, jump targets, .org */
+static void mark_entries(const assembler_t* as, uint8_t* entry) {
+    int count = as->instruction_count;
+
+    memset(entry, 0, (size_t)count);
+    for (int i = 0; i < as->symbol_count; i++) {
+        const symbol_t* sym = &as->symbols[i];
+        if (sym->defined && !sym->absolute && sym->address < count) {
+            entry[sym->address] = 1;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        const instruction_t* inst = &as->instructions[i];
+        int target = -1;
+
+        if (is_label_ref(as, inst)) {
+            target = ref_target(as, inst);
+        } else if (is_branch(inst)) {
+            target = inst->operand & 0x0FFF;
+        }
+        if (target >= 0 && target < count) entry[target] = 1;
+        if (inst->org) entry[i] = 1;
+    }
+}
+
+/* Opcode bytes of the special instructions the patterns look at */
+#define RETN_BYTE (OP_RETN >> 4)
+#define INSP_BYTE (OP_INSP >> 4)
+#define DESP_BYTE (OP_DESP >> 4)
+
+/* Why a word is dropped (the removed[] marks) */
+#define DROP_STORE_LOAD 1
+#define DROP_JUMP_NEXT  2
+#define DROP_PAIR       3
+
+/*
+ * Mark the words the patterns drop in `removed`, and for a pair the
+ * other half in `partner`. Candidates to pair with are kept on a stack,
+ * so INSP 1, INSP 2, DESP 2, DESP 1 goes whole; an entry starts the
+ * stack afresh, and a dropped entry passes that on to the next word.
+ */
+static int mark_removals(const assembler_t* as, const uint8_t* entry, uint8_t* removed,
+                         int* partner) {
+    int* stack = malloc((size_t)as->instruction_count * sizeof(int));
+    int depth = 0;
+    int base_entry = 0;     /* stack[0] was an entry */
+    int carry = 0;
+    int total = 0;
+
+    if (!stack) return 0;
+    for (int i = 0; i < as->instruction_count; i++) {
+        const instruction_t* inst = &as->instructions[i];
+        int boundary = entry[i] || carry;
+
+        carry = 0;
+        if (boundary) depth = 0;
+        if (inst->data) {
+            depth = 0;
+            continue;
+        }
+
+        const instruction_t* prev = depth > 0 ? &as->instructions[stack[depth - 1]] : NULL;
+
+        if (inst->opcode == OP_JUMP && i + 1 < as->instruction_count &&
+            branch_target(as, inst) == i + 1) {
+            removed[i] = DROP_JUMP_NEXT;
+            carry = boundary;
+            total++;
+        } else if (prev && prev->opcode == OP_STOD && inst->opcode == OP_LODD &&
+                   (prev->operand & 0x0FFF) == (inst->operand & 0x0FFF)) {
+            removed[i] = DROP_STORE_LOAD;
+            total++;
+        } else if (prev && ((prev->opcode == INSP_BYTE && inst->opcode == DESP_BYTE) ||
+                            (prev->opcode == DESP_BYTE && inst->opcode == INSP_BYTE)) &&
+                   (prev->operand & 0xFF) == (inst->operand & 0xFF)) {
+            int first = stack[--depth];
+            removed[first] = removed[i] = DROP_PAIR;
+            partner[first] = i;
+            partner[i] = first;
+            carry = depth == 0 && base_entry;
+            total += 2;
+        } else {
+            if (depth == 0) base_entry = boundary;
+            stack[depth++] = i;
+        }
+    }
+    free(stack);
+    return total;
+}
+
+/* Unmark removed[from..to), and the other half of any pair among them */
+static void keep_words(uint8_t* removed, const int* partner, int from, int to) {
+    for (int k = from; k < to; k++) {
+        if (removed[k] == DROP_PAIR) removed[partner[k]] = 0;
+        removed[k] = 0;
+    }
+}
+
+/*
+ * A JUMP back over nothing but dropped words would become a JUMP to
+ * itself, which the simulator takes for a halt; and code running on
+ * into a word placed by .org would run into the zeros that now fill
+ * the gap. Keep the words either would need.
+ */
+static void keep_control_flow(const assembler_t* as, uint8_t* removed, const int* partner) {
+    int segment = 0;
+
+    for (int j = 0; j < as->instruction_count; j++) {
+        const instruction_t* inst = &as->instructions[j];
+
+        if (inst->org && j > 0) {
+            const instruction_t* prev = &as->instructions[j - 1];
+            int falls = !prev->data &&
+                        (removed[j - 1] || (prev->opcode != OP_JUMP && prev->opcode != RETN_BYTE));
+            if (falls) keep_words(removed, partner, segment, j);
+            segment = j;
+        }
+        if (removed[j] || inst->data || inst->opcode != OP_JUMP) continue;
+
+        int target = branch_target(as, inst);
+        if (target < 0 || target >= j) continue;
+
+        int k = target;
+        while (k < j && removed[k]) k++;
+        if (k == j) keep_words(removed, partner, target, j);
+    }
+}
+
+/* Count what stays marked into `found`; the number of words dropped */
+static int tally_removals(const assembler_t* as, const uint8_t* removed, optimize_t* found) {
+    int total = 0;
+    int pair_words = 0;
+
+    for (int i = 0; i < as->instruction_count; i++) {
+        if (removed[i] == DROP_STORE_LOAD) {
+            found->store_loads++;
+        } else if (removed[i] == DROP_JUMP_NEXT) {
+            found->jumps_to_next++;
+        } else if (removed[i] == DROP_PAIR) {
+            pair_words++;
+        } else {
+            continue;
+        }
+        found->skipped[opcode_key(&as->instructions[i])]++;
+        total++;
+    }
+    found->stack_pairs = pair_words / 2;
+    return total;
+}
+
+/* Line of a number used as an address at or after `from` inside the code, 0 if none */
+static int numeric_address(const assembler_t* as, int from) {
+    for (int i = 0; i < as->instruction_count; i++) {
+        const instruction_t* inst = &as->instructions[i];
+        int address = inst->operand & 0x0FFF;
+
+        if (is_label_ref(as, inst)) continue;
+        if (takes_address(inst) || (inst->opcode == OP_LOCO && !inst->data && inst->has_label_ref)) {
+            if (address >= from && address < as->instruction_count) return inst->line;
+        }
+    }
+    return 0;
+}
+
+/* New address of old address `address`, given moved[0..count] */
+static int moved_address(const int* moved, int count, int address) {
+    if (address < 0) return address;
+    if (address <= count) return moved[address];
+    return address - count + moved[count];
+}
+
+/*
+ * Drop the marked words: the rest move up, except that a word placed by
+ * .org stays put with zeros in front of it. Then labels and references
+ * to them follow their words; a reference to a dropped word goes to the
+ * word after it.
+ */
+static int compact(assembler_t* as, const uint8_t* removed) {
+    int count = as->instruction_count;
+    int* moved = malloc(((size_t)count + 1) * sizeof(int));
+    int* targets = malloc(((size_t)count + 1) * sizeof(int));
+    int to = 0;
+
+    if (!moved || !targets) {
+        free(moved);
+        free(targets);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        targets[i] = is_label_ref(as, &as->instructions[i]) ? ref_target(as, &as->instructions[i]) : 0;
+    }
+
+    for (int from = 0; from < count; from++) {
+        instruction_t inst = as->instructions[from];
+
+        moved[from] = -1;
+        if (removed[from]) continue;
+        while (inst.org && to < from) {
+            instruction_t* pad = &as->instructions[to++];
+            memset(pad, 0, sizeof(*pad));
+            pad->symbol = -1;
+            pad->data = 1;
+            pad->line = inst.org;
+        }
+        targets[to] = targets[from];
+        moved[from] = to;
+        as->instructions[to++] = inst;
+    }
+    moved[count] = to;
+    for (int i = count - 1; i >= 0; i--) {
+        if (moved[i] < 0) moved[i] = moved[i + 1];
+    }
+
+    for (int i = 0; i < as->symbol_count; i++) {
+        symbol_t* sym = &as->symbols[i];
+        if (sym->defined && !sym->absolute) {
+            sym->address = (uint16_t)moved_address(moved, count, sym->address);
+        }
+    }
+    for (int i = 0; i < to; i++) {
+        instruction_t* inst = &as->instructions[i];
+        if (!is_label_ref(as, inst)) continue;
+
+        inst->addend = moved_address(moved, count, targets[i]) - as->symbols[inst->symbol].address;
+        resolve(inst, &as->symbols[inst->symbol]);
+    }
+
+    as->instruction_count = to;
+    as->current_address = to;
+    free(moved);
+    free(targets);
+    return 0;
+}
+
+int assembler_optimize(assembler_t* as, optimize_t* stats) {
+    optimize_t local;
+    uint8_t entry[MAX_INSTRUCTIONS];
+    uint8_t removed[MAX_INSTRUCTIONS];
+    int partner[MAX_INSTRUCTIONS];
+
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+    if (as->instruction_count <= 0) return 0;
+
+    for (int pass = 0; pass < MAX_OPT_PASSES; pass++) {
+        optimize_t found;
+
+        retarget_jumps(as, stats);
+        mark_entries(as, entry);
+        memset(removed, 0, (size_t)as->instruction_count);
+        if (mark_removals(as, entry, removed, partner) == 0) break;
+
+        keep_control_flow(as, removed, partner);
+        memset(&found, 0, sizeof(found));
+        int dropped = tally_removals(as, removed, &found);
+        if (dropped == 0) break;
+
+        int first = 0;
+        while (!removed[first]) first++;
+        stats->blocked_line = numeric_address(as, first);
+        if (stats->blocked_line || compact(as, removed) != 0) break;
+
+        stats->store_loads += found.store_loads;
+        stats->jumps_to_next += found.jumps_to_next;
+        stats->stack_pairs += found.stack_pairs;
+        for (int i = 0; i < 256; i++) {
+            stats->skipped[i] += found.skipped[i];
+        }
+        stats->removed += dropped;
+    }
+    return stats->removed;
+}
+
+int assembler_source_line(const assembler_t* as, uint16_t address) {
+    if (address >= as->instruction_count) {
+        return -1;
+    }
+    return as->instructions[address].line;
+}
+
+int assembler_map_file(char* out, size_t size, const char* image_file) {
+    size_t length = strlen(image_file);
+    const char* dot = strrchr(image_file, '.');
+    const char* slash = strrchr(image_file, '/');
+    if (dot && dot != image_file && (!slash || dot > slash + 1)) {
+        length = (size_t)(dot - image_file);
+    }
+
+    /* A cut-short name would point at some other file */
+    if (length + sizeof(".map") > size) {
+        if (size > 0) out[0] = '\0';
+        return -1;
+    }
+    memcpy(out, image_file, length);
+    memcpy(out + length, ".map", sizeof(".map"));
+    return 0;
+}
+
+int assembler_write_map(const assembler_t* as, const char* source_file, const char* map_file) {
+    FILE* fp = fopen(map_file, "w");
+    if (!fp) return -1;
+
+    fprintf(fp, "mic1map 1\n");
+    if (source_file && strcmp(source_file, "-") != 0) {
+        fprintf(fp, "source %s\n", source_file);
+    }
+
+    /* One record per run of words from the same line (.word, .fill, .org) */
+    for (int address = 0; address < as->instruction_count; ) {
+        int line = as->instructions[address].line;
+        int count = 1;
+        while (address + count < as->instruction_count &&
+               as->instructions[address + count].line == line) {
+            count++;
+        }
+        if (count == 1) {
+            fprintf(fp, "line %03X %d\n", address, line);
+        } else {
+            fprintf(fp, "line %03X %d %d\n", address, line, count);
+        }
+        address += count;
+    }
+
+    for (int i = 0; i < as->symbol_count; i++) {
+        const symbol_t* sym = &as->symbols[i];
+        if (!sym->defined) continue;
+        fprintf(fp, "%s %03X %.*s\n", sym->absolute ? "equ" : "label", sym->address,
+                sym->length, sym->label);
+    }
+
+    int failed = ferror(fp);
+    return fclose(fp) != 0 || failed ? -1 : 0;
+}
+
+static int write_all(int fd, const void* data, size_t size) {
+    const char* p = data;
+
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Write out the words no later line can change: those before the first pending fixup */
+static int flush_words(assembler_t* as, int fd, int* written) {
+    uint16_t block[STREAM_WORDS];
+    int limit = as->fixup_count ? as->fixups[0] : as->instruction_count;
+
+    while (*written < limit) {
+        int count = limit - *written < STREAM_WORDS ? limit - *written : STREAM_WORDS;
+        for (int i = 0; i < count; i++) {
+            block[i] = encode_instruction(&as->instructions[*written + i]);
+        }
+        if (write_all(fd, block, (size_t)count * sizeof(uint16_t)) != 0) {
+            return syntax_error(as, "Write error: %s", strerror(errno));
+        }
+        *written += count;
+    }
+    return 0;
+}
+
+/*
+ * One pass over the source read from `in_fd`, holding at most
+ * STREAM_BUFFER bytes of it. With out_fd >= 0, words are written as soon
+ * as they are final; `written` counts them.
+ */
+static int assemble_fd(assembler_t* as, int in_fd, int out_fd, int* written) {
+    char* buffer = malloc(STREAM_BUFFER);
+    int filled = 0;
+    int eof = 0;
+    int line_num = 0;
+
+    free_assembler(as);
+    init_assembler(as);
+    *written = 0;
+    if (!buffer) return syntax_error(as, "Out of memory");
+
+    while (!eof || filled > 0) {
+        if (!eof) {
+            ssize_t n = read(in_fd, buffer + filled, (size_t)(STREAM_BUFFER - filled));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                syntax_error(as, "Read error: %s", strerror(errno));
+                goto fail;
+            }
+            eof = n == 0;
+            filled += (int)n;
+        }
+
+        /* Every complete line, and at the end whatever is left */
+        int start = 0;
+        for (;;) {
+            const char* eol = memchr(buffer + start, '\n', (size_t)(filled - start));
+            if (!eol && !(eof && start < filled)) break;
+
+            int length = eol ? (int)(eol - (buffer + start)) : filled - start;
+            if (assemble_line(as, buffer, start, length, ++line_num, NULL) != 0) goto fail;
+
+            /* A label some word was waiting for: that word may now be final */
+            if (as->last_label >= 0 && as->fixup_count > 0) backpatch(as);
+            start += length + (eol ? 1 : 0);
+        }
+
+        if (filled - start > MAX_LINE_LENGTH) {
+            as->error_line = line_num + 1;
+            syntax_error(as, "Line too long (%d characters max)", MAX_LINE_LENGTH);
+            goto fail;
+        }
+        memmove(buffer, buffer + start, (size_t)(filled - start));
+        filled -= start;
+
+        if (out_fd >= 0 && flush_words(as, out_fd, written) != 0) goto fail;
+    }
+
+    free(buffer);
+    return finish_source(as);
+
+fail:
+    free(buffer);
+    return -1;
+}
+
+int assembler_stream(assembler_t* as, int in_fd, int out_fd, int* output_size) {
+    int written = 0;
+
+    if (assemble_fd(as, in_fd, out_fd, &written) != 0 || check_labels(as) != 0 ||
+        flush_words(as, out_fd, &written) != 0) {
+        return -1;
+    }
+    *output_size = written;
+    return 0;
+}
+
+/* The command-line form of the error left in `as` */
+static void report_error(const assembler_t* as) {
+    if (as->error_line > 0) {
+        fprintf(stderr, "Error on line %d: %s\n", as->error_line, as->error_msg);
+    } else {
+        fprintf(stderr, "Error: %s\n", as->error_msg);
+    }
+}
+
+int assemble_string(const char* source, uint16_t* output, int* output_size) {
+    assembler_t as;
+
+    init_assembler(&as);
+    int result = assembler_run(&as, source, output, MAX_INSTRUCTIONS, output_size);
+    if (result != 0) {
+        report_error(&as);
+    }
+    free_assembler(&as);
+    return result;
+}
+
+int assemble_object(const char* source, mic1_object* obj) {
+    assembler_t as;
+
+    init_assembler(&as);
+    int result = assembler_object(&as, source, obj);
+    if (result != 0) {
+        report_error(&as);
+    }
+    free_assembler(&as);
+    return result;
+}
+
+/* `input_file` opened for reading; "-" is standard input */
+static int open_source(const char* input_file) {
+    if (strcmp(input_file, "-") == 0) {
+        return STDIN_FILENO;
+    }
+
+    int fd = open(input_file, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open input file: %s\n", input_file);
+    }
+    return fd;
+}
+
+static void close_source(int fd) {
+    if (fd != STDIN_FILENO) close(fd);
+}
+
+/* The whole source first, then assembler_optimize, then the image */
+static int assemble_optimized(assembler_t* as, int in_fd, int out_fd, int* output_size,
+                              optimize_t* stats) {
+    int written = 0;
+
+    if (assemble_fd(as, in_fd, -1, &written) != 0 || check_labels(as) != 0) {
+        return -1;
+    }
+    assembler_optimize(as, stats);
+    if (flush_words(as, out_fd, &written) != 0) {
+        return -1;
+    }
+    *output_size = written;
+    return 0;
+}
+
+/* assemble_file, optimised when `stats` is not NULL */
+static int assemble_image(const char* input_file, const char* output_file, optimize_t* stats) {
+    int in = open_source(input_file);
+    if (in < 0) return -1;
+
+    int out = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        fprintf(stderr, "Error: Cannot create output file: %s\n", output_file);
+        close_source(in);
+        return -1;
+    }
+
+    assembler_t as;
+    int output_size = 0;
+    char map_file[512];
+    int map_named = assembler_map_file(map_file, sizeof(map_file), output_file) == 0;
+
+    init_assembler(&as);
+    int result = stats ? assemble_optimized(&as, in, out, &output_size, stats)
+                       : assembler_stream(&as, in, out, &output_size);
+    if (result != 0) {
+        report_error(&as);
+    }
+    close_source(in);
+
+    if (close(out) != 0 && result == 0) {
+        fprintf(stderr, "Error: Cannot write output file: %s\n", output_file);
+        result = -1;
+    }
+
+    /* A map left over from an earlier build would point at the wrong lines */
+    int own_map = map_named && strcmp(map_file, output_file) != 0;
+    int mapped = own_map && result == 0 && assembler_write_map(&as, input_file, map_file) == 0;
+    free_assembler(&as);
+    if (own_map && !mapped) {
+        remove(map_file);
+    }
+    if (result != 0) {
+        remove(output_file);
+        return -1;
+    }
 
     printf("Assembly successful: %d instructions, %d bytes\n",
            output_size, output_size * 2);
+    if (mapped) {
+        printf("Source map: %s\n", map_file);
+    } else if (own_map) {
+        fprintf(stderr, "Warning: Cannot write source map: %s\n", map_file);
+    } else if (!map_named) {
+        fprintf(stderr, "Warning: Output path too long, no source map written\n");
+    }
 
     return 0;
 }
+
+int assemble_file(const char* input_file, const char* output_file) {
+    return assemble_image(input_file, output_file, NULL);
+}
+
+int assemble_file_optimized(const char* input_file, const char* output_file, optimize_t* stats) {
+    optimize_t local;
+    return assemble_image(input_file, output_file, stats ? stats : &local);
+}
+
+int assemble_object_file(const char* input_file, const char* output_file) {
+    int in = open_source(input_file);
+    if (in < 0) return -1;
+
+    assembler_t as;
+    mic1_object obj;
+    int written;
+
+    init_assembler(&as);
+    init_object(&obj);
+    int result = assemble_fd(&as, in, -1, &written) == 0 ? build_object(&as, &obj) : -1;
+    if (result != 0) {
+        report_error(&as);
+    }
+    free_assembler(&as);
+    close_source(in);
+    if (result != 0) return -1;
+
+    result = write_object_file(&obj, output_file);
+    if (result == 0) {
+        printf("Assembly successful: %d instructions, %d symbols, %d relocations\n",
+               object_size(&obj), obj.symbol_count, obj.reloc_count);
+    }
+
+    free_object(&obj);
+    return result;
+}
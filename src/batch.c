@@ -0,0 +1,262 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../include/batch.h"
+#include "../include/utils/conversions.h"
+
+/* Word `addr` of lane `l`; rows are contiguous across lanes */
+#define MEM(b, addr, l) ((b)->memory[(size_t)(addr) * (size_t)(b)->lanes + (size_t)(l)])
+
+/* Instruction classes are the profiler's: opcode, or 16 + sub-opcode */
+#define BATCH_IDLE PROFILE_CLASSES
+
+int init_batch(mic1_batch* b, int lanes) {
+    if (!b || lanes <= 0) return -1;
+
+    memset(b, 0, sizeof(*b));
+    b->lanes = lanes;
+    b->fault_action = FAULT_ACTION_HALT;
+
+    size_t n = (size_t)lanes;
+    b->pc = calloc(n, sizeof(*b->pc));
+    b->ac = calloc(n, sizeof(*b->ac));
+    b->sp = calloc(n, sizeof(*b->sp));
+    b->ir = calloc(n, sizeof(*b->ir));
+    b->memory = calloc(n * MEMORY_SIZE, sizeof(*b->memory));
+    b->cycle_count = calloc(n, sizeof(*b->cycle_count));
+    b->fault = calloc(n, sizeof(*b->fault));
+    b->stopped = calloc(n, sizeof(*b->stopped));
+    b->group = calloc(n, sizeof(*b->group));
+    b->order = calloc(n, sizeof(*b->order));
+
+    if (!b->pc || !b->ac || !b->sp || !b->ir || !b->memory || !b->cycle_count ||
+        !b->fault || !b->stopped || !b->group || !b->order) {
+        free_batch(b);
+        return -1;
+    }
+
+    register_bank rb;
+    init_register_bank(&rb);
+    for (int l = 0; l < lanes; l++) {
+        b->sp[l] = (uint16_t)bits_to_int(rb.SP.data, 16);
+    }
+    return 0;
+}
+
+void free_batch(mic1_batch* b) {
+    if (!b) return;
+
+    free(b->pc);
+    free(b->ac);
+    free(b->sp);
+    free(b->ir);
+    free(b->memory);
+    free(b->cycle_count);
+    free(b->fault);
+    free(b->stopped);
+    free(b->group);
+    free(b->order);
+    memset(b, 0, sizeof(*b));
+}
+
+void batch_store_word(mic1_batch* b, int lane, int addr, int value) {
+    addr &= 0xFFF;
+    if (lane == BATCH_ALL_LANES) {
+        for (int l = 0; l < b->lanes; l++) {
+            MEM(b, addr, l) = (uint16_t)value;
+        }
+    } else {
+        MEM(b, addr, lane) = (uint16_t)value;
+    }
+}
+
+int batch_load_word(const mic1_batch* b, int lane, int addr) {
+    return MEM(b, addr & 0xFFF, lane);
+}
+
+void batch_load_cpu(mic1_batch* b, int lane, const mic1_cpu* cpu) {
+    b->pc[lane] = (uint16_t)bits_to_int((int*)cpu->reg_bank.PC.data, 16);
+    b->ac[lane] = (uint16_t)bits_to_int((int*)cpu->reg_bank.AC.data, 16);
+    b->sp[lane] = (uint16_t)bits_to_int((int*)cpu->reg_bank.SP.data, 16);
+    b->ir[lane] = (uint16_t)bits_to_int((int*)cpu->reg_bank.IR.data, 16);
+    for (int addr = 0; addr < MEMORY_SIZE; addr++) {
+        MEM(b, addr, lane) = (uint16_t)bits_to_int((int*)cpu->main_memory.data[addr], 16);
+    }
+    b->cycle_count[lane] = cpu->cycle_count;
+    b->fault[lane] = FAULT_NONE;
+    b->stopped[lane] = 0;
+}
+
+void batch_store_cpu(const mic1_batch* b, int lane, mic1_cpu* cpu) {
+    int_to_bits(b->pc[lane], cpu->reg_bank.PC.data, 16);
+    int_to_bits(b->ac[lane], cpu->reg_bank.AC.data, 16);
+    int_to_bits(b->sp[lane], cpu->reg_bank.SP.data, 16);
+    int_to_bits(b->ir[lane], cpu->reg_bank.IR.data, 16);
+    for (int addr = 0; addr < MEMORY_SIZE; addr++) {
+        int_to_bits(MEM(b, addr, lane), cpu->main_memory.data[addr], 16);
+    }
+    mem_rehash(&cpu->main_memory);
+    cpu->cycle_count = b->cycle_count[lane];
+}
+
+/*
+ * Record a fault on one lane and apply fault_action. Returns 1 when the
+ * lane carries on with the instruction (IGNORE), 0 when it does not.
+ */
+static int lane_fault(mic1_batch* b, int l, int kind) {
+    b->fault[l] = (uint8_t)kind;
+
+    switch (b->fault_action) {
+        case FAULT_ACTION_IGNORE:
+            return 1;
+        case FAULT_ACTION_TRAP:
+            b->pc[l] = (uint16_t)b->trap_vector;
+            return 0;
+        default:
+            b->stopped[l] = 1;
+            return 0;
+    }
+}
+
+/* Runs `body` for each lane `l` of the group; idx NULL = lanes 0..count-1 */
+#define FOR_EACH_LANE(body) \
+    for (int i = 0; i < count; i++) { \
+        int l = idx ? idx[i] : i; \
+        body \
+    }
+
+/*
+ * One instruction class over a group of lanes. Same effects as
+ * execute_instruction_direct on each lane.
+ */
+static void execute_class(mic1_batch* b, int cls, const int* idx, int count) {
+    uint16_t* pc = b->pc;
+    uint16_t* ac = b->ac;
+    uint16_t* sp = b->sp;
+    const uint16_t* ir = b->ir;
+
+    switch (cls) {
+        case 0x0:  /* LODD */
+            FOR_EACH_LANE(ac[l] = MEM(b, ir[l] & 0xFFF, l); pc[l]++;)
+            break;
+        case 0x1:  /* STOD */
+            FOR_EACH_LANE(MEM(b, ir[l] & 0xFFF, l) = ac[l]; pc[l]++;)
+            break;
+        case 0x2:  /* ADDD */
+            FOR_EACH_LANE(ac[l] = (uint16_t)(ac[l] + MEM(b, ir[l] & 0xFFF, l)); pc[l]++;)
+            break;
+        case 0x3:  /* SUBD */
+            FOR_EACH_LANE(ac[l] = (uint16_t)(ac[l] - MEM(b, ir[l] & 0xFFF, l)); pc[l]++;)
+            break;
+        case 0x4:  /* JPOS */
+            FOR_EACH_LANE(pc[l] = (ac[l] > 0 && ac[l] < 0x8000) ? (ir[l] & 0xFFF) : pc[l] + 1;)
+            break;
+        case 0x5:  /* JZER */
+            FOR_EACH_LANE(pc[l] = ac[l] == 0 ? (ir[l] & 0xFFF) : pc[l] + 1;)
+            break;
+        case 0x6:  /* JUMP */
+            FOR_EACH_LANE(pc[l] = ir[l] & 0xFFF;)
+            break;
+        case 0x7:  /* LOCO */
+            FOR_EACH_LANE(ac[l] = ir[l] & 0xFFF; pc[l]++;)
+            break;
+        case 0x8:  /* LODL */
+            FOR_EACH_LANE(ac[l] = MEM(b, (sp[l] + (ir[l] & 0xFFF)) & 0xFFF, l); pc[l]++;)
+            break;
+        case 0x9:  /* STOL */
+            FOR_EACH_LANE(MEM(b, (sp[l] + (ir[l] & 0xFFF)) & 0xFFF, l) = ac[l]; pc[l]++;)
+            break;
+        case 0xA:  /* ADDL */
+            FOR_EACH_LANE(ac[l] = (uint16_t)(ac[l] + MEM(b, (sp[l] + (ir[l] & 0xFFF)) & 0xFFF, l)); pc[l]++;)
+            break;
+        case 0xB:  /* SUBL */
+            FOR_EACH_LANE(ac[l] = (uint16_t)(ac[l] - MEM(b, (sp[l] + (ir[l] & 0xFFF)) & 0xFFF, l)); pc[l]++;)
+            break;
+        case 0xC:  /* JNEG */
+            FOR_EACH_LANE(pc[l] = ac[l] >= 0x8000 ? (ir[l] & 0xFFF) : pc[l] + 1;)
+            break;
+        case 0xD:  /* JNZE */
+            FOR_EACH_LANE(pc[l] = ac[l] != 0 ? (ir[l] & 0xFFF) : pc[l] + 1;)
+            break;
+        case 0xE:  /* CALL */
+            FOR_EACH_LANE(sp[l]--; MEM(b, sp[l] & 0xFFF, l) = (uint16_t)(pc[l] + 1); pc[l] = ir[l] & 0xFFF;)
+            break;
+
+        case 16 + 0x0:  /* PSHI */
+            FOR_EACH_LANE(sp[l]--; MEM(b, sp[l] & 0xFFF, l) = MEM(b, ac[l] & 0xFFF, l); pc[l]++;)
+            break;
+        case 16 + 0x2:  /* POPI */
+            FOR_EACH_LANE(MEM(b, ac[l] & 0xFFF, l) = MEM(b, sp[l] & 0xFFF, l); sp[l]++; pc[l]++;)
+            break;
+        case 16 + 0x4:  /* PUSH */
+            FOR_EACH_LANE(sp[l]--; MEM(b, sp[l] & 0xFFF, l) = ac[l]; pc[l]++;)
+            break;
+        case 16 + 0x6:  /* POP */
+            FOR_EACH_LANE(ac[l] = MEM(b, sp[l] & 0xFFF, l); sp[l]++; pc[l]++;)
+            break;
+        case 16 + 0x8:  /* RETN */
+            FOR_EACH_LANE(pc[l] = MEM(b, sp[l] & 0xFFF, l) & 0xFFF; sp[l]++;)
+            break;
+        case 16 + 0xA:  /* SWAP */
+            FOR_EACH_LANE(uint16_t t = ac[l]; ac[l] = sp[l]; sp[l] = t; pc[l]++;)
+            break;
+        case 16 + 0xC:  /* INSP */
+            FOR_EACH_LANE(sp[l] = (uint16_t)(sp[l] + (ir[l] & 0xFF)); pc[l]++;)
+            break;
+        case 16 + 0xE:  /* DESP */
+            FOR_EACH_LANE(sp[l] = (uint16_t)(sp[l] - (ir[l] & 0xFF)); pc[l]++;)
+            break;
+
+        default:   /* Odd sub-opcodes: a NOP, as in data/mic1.mal */
+            FOR_EACH_LANE(pc[l]++;)
+            break;
+    }
+
+    FOR_EACH_LANE(b->cycle_count[l]++;)
+}
+
+void batch_step(mic1_batch* b) {
+    if (!b || !b->lanes) return;
+
+    int count[PROFILE_CLASSES + 1] = {0};
+    int n = b->lanes;
+
+    /* Fetch and classify */
+    for (int l = 0; l < n; l++) {
+        int cls = BATCH_IDLE;
+
+        if (!b->stopped[l] && (b->pc[l] < MEMORY_SIZE || lane_fault(b, l, FAULT_PC_BOUNDS))) {
+            b->pc[l] &= 0xFFF;
+            b->ir[l] = MEM(b, b->pc[l], l);
+            cls = profile_class(b->ir[l]);
+        }
+        b->group[l] = (uint8_t)cls;
+        count[cls]++;
+    }
+
+    /* Every lane on the same instruction: one pass, no index list */
+    for (int cls = 0; cls < PROFILE_CLASSES; cls++) {
+        if (count[cls] == n) {
+            execute_class(b, cls, NULL, n);
+            return;
+        }
+    }
+
+    /* Otherwise sort the lanes by class and run each group */
+    int start[PROFILE_CLASSES + 1];
+    int next = 0;
+    for (int cls = 0; cls <= PROFILE_CLASSES; cls++) {
+        start[cls] = next;
+        next += count[cls];
+    }
+    int fill[PROFILE_CLASSES + 1];
+    memcpy(fill, start, sizeof(fill));
+    for (int l = 0; l < n; l++) {
+        b->order[fill[b->group[l]]++] = l;
+    }
+
+    for (int cls = 0; cls < PROFILE_CLASSES; cls++) {
+        if (count[cls]) {
+            execute_class(b, cls, b->order + start[cls], count[cls]);
+        }
+    }
+}
@@ -0,0 +1,263 @@
+#include <string.h>
+#include "../include/bitslice.h"
+#include "../include/utils/conversions.h"
+
+/* Registers in decoder order (the A, B and C field values) */
+static mic1_register* bank_register(register_bank* rb, int index) {
+    mic1_register* regs[16] = {
+        &rb->PC, &rb->AC, &rb->IR, &rb->TIR, &rb->SP, &rb->AMASK, &rb->SMASK, &rb->R0,
+        &rb->R1, &rb->Rm1, &rb->A, &rb->B, &rb->C, &rb->D, &rb->E, &rb->F
+    };
+    return regs[index];
+}
+
+/* Index of the lowest set bit (de Bruijn multiply; lanes != 0) */
+static int lowest_lane(uint64_t lanes) {
+    static const int index[64] = {
+         0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+        62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+        63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+        46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6
+    };
+    return index[((lanes & (~lanes + 1)) * 0x03F79D71B4CB0A89ULL) >> 58];
+}
+
+/* Value of one lane in a sliced field of `bits` bits */
+static int lane_value(const uint64_t* field, int bits, int lane) {
+    int value = 0;
+    for (int i = bits - 1; i >= 0; i--) {
+        value = (value << 1) | (int)((field[i] >> lane) & 1);
+    }
+    return value;
+}
+
+/* Lanes in which a sliced field equals value */
+static uint64_t lanes_equal(const uint64_t* field, int bits, int value) {
+    uint64_t equal = SLICE_ALL_LANES;
+    for (int i = 0; i < bits; i++) {
+        equal &= ((value >> i) & 1) ? field[i] : ~field[i];
+    }
+    return equal;
+}
+
+static void set_lanes(uint64_t* field, int bits, uint64_t lanes, int value) {
+    for (int i = 0; i < bits; i++) {
+        field[i] = ((value >> i) & 1) ? field[i] | lanes : field[i] & ~lanes;
+    }
+}
+
+/* field := source in the given lanes */
+static void blend(uint64_t* field, const uint64_t* source, int bits, uint64_t lanes) {
+    for (int i = 0; i < bits; i++) {
+        field[i] ^= (field[i] ^ source[i]) & lanes;
+    }
+}
+
+void init_slice(mic1_slice* s, const control_memory* cm) {
+    if (!s) return;
+
+    memset(s, 0, sizeof(*s));
+    s->cm = cm;
+    s->active = SLICE_ALL_LANES;
+
+    register_bank rb;
+    init_register_bank(&rb);
+    for (int reg = 0; reg < 16; reg++) {
+        set_lanes(s->reg[reg], 16, SLICE_ALL_LANES, bits_to_int(bank_register(&rb, reg)->data, 16));
+    }
+}
+
+void slice_store_word(mic1_slice* s, uint64_t lanes, int addr, int value) {
+    set_lanes(s->memory[addr & 0xFFF], 16, lanes, value);
+}
+
+int slice_load_word(const mic1_slice* s, int lane, int addr) {
+    return lane_value(s->memory[addr & 0xFFF], 16, lane);
+}
+
+void slice_set_register(mic1_slice* s, uint64_t lanes, int reg, int value) {
+    set_lanes(s->reg[reg & 0xF], 16, lanes, value);
+}
+
+int slice_register(const mic1_slice* s, int lane, int reg) {
+    return lane_value(s->reg[reg & 0xF], 16, lane);
+}
+
+int slice_mpc(const mic1_slice* s, int lane) {
+    return lane_value(s->mpc, MICROADDR_BITS, lane);
+}
+
+void slice_load_cpu(mic1_slice* s, int lane, const mic1_cpu* cpu) {
+    uint64_t bit = (uint64_t)1 << lane;
+    register_bank* rb = (register_bank*)&cpu->reg_bank;
+
+    for (int reg = 0; reg < 16; reg++) {
+        set_lanes(s->reg[reg], 16, bit, bits_to_int(bank_register(rb, reg)->data, 16));
+    }
+    set_lanes(s->mar, 12, bit, bits_to_int((int*)cpu->mar.address, 12));
+    set_lanes(s->mbr, 16, bit, bits_to_int((int*)cpu->mbr.data, 16));
+    set_lanes(s->mpc, MICROADDR_BITS, bit, bits_to_int((int*)cpu->mpc.address, MICROADDR_BITS));
+    for (int addr = 0; addr < MEMORY_SIZE; addr++) {
+        set_lanes(s->memory[addr], 16, bit, bits_to_int((int*)cpu->main_memory.data[addr], 16));
+    }
+    s->cycle_count[lane] = cpu->cycle_count;
+}
+
+/* The memory is rewritten behind the cache's back, so the cache is emptied */
+void slice_store_cpu(const mic1_slice* s, int lane, mic1_cpu* cpu) {
+    for (int reg = 0; reg < 16; reg++) {
+        int_to_bits(slice_register(s, lane, reg), bank_register(&cpu->reg_bank, reg)->data, 16);
+    }
+    int_to_bits(lane_value(s->mar, 12, lane), cpu->mar.address, 12);
+    int_to_bits(lane_value(s->mbr, 16, lane), cpu->mbr.data, 16);
+    int_to_bits(slice_mpc(s, lane), cpu->mpc.address, MICROADDR_BITS);
+    for (int addr = 0; addr < MEMORY_SIZE; addr++) {
+        int_to_bits(slice_load_word(s, lane, addr), cpu->main_memory.data[addr], 16);
+    }
+    mem_rehash(&cpu->main_memory);
+    init_cache(&cpu->unified_cache);
+    cpu->cycle_count = s->cycle_count[lane];
+}
+
+/* Memory accesses, one per distinct MAR among the lanes */
+static void read_memory(mic1_slice* s, uint64_t lanes) {
+    while (lanes) {
+        int addr = lane_value(s->mar, 12, lowest_lane(lanes));
+        uint64_t same = lanes & lanes_equal(s->mar, 12, addr);
+        blend(s->mbr, s->memory[addr], 16, same);
+        lanes &= ~same;
+    }
+}
+
+static void write_memory(mic1_slice* s, uint64_t lanes) {
+    while (lanes) {
+        int addr = lane_value(s->mar, 12, lowest_lane(lanes));
+        uint64_t same = lanes & lanes_equal(s->mar, 12, addr);
+        blend(s->memory[addr], s->mbr, 16, same);
+        lanes &= ~same;
+    }
+}
+
+/* Next MPC from the dispatch table, one lookup per distinct key */
+static void dispatch(mic1_slice* s, uint64_t lanes) {
+    int bits = s->cm->dispatch_bits;
+
+    while (lanes) {
+        int key = lane_value(s->mbr, bits, lowest_lane(lanes));
+        uint64_t same = lanes & lanes_equal(s->mbr, bits, key);
+        set_lanes(s->mpc, MICROADDR_BITS, same, s->cm->dispatch[key]);
+        lanes &= ~same;
+    }
+}
+
+/*
+ * One microinstruction in the given lanes, all at MPC `mpc`. Same order
+ * and active-unit rule as execute_datapath followed by run_mmux.
+ */
+static void execute_op(mic1_slice* s, const micro_op* op, int mpc, uint64_t lanes) {
+    uint64_t a[16], b[16], r[16];
+    uint64_t taken = op->cond == COND_ALWAYS ? lanes : 0;
+    int units = op->units;
+
+    if (units & UNIT_BUS_A) memcpy(a, s->reg[op->a], sizeof(a));
+    if (units & UNIT_BUS_B) memcpy(b, s->reg[op->b], sizeof(b));
+
+    if (op->flags & MICRO_MAR) blend(s->mar, b, 12, lanes);
+    if (op->flags & MICRO_RD) read_memory(s, lanes);
+
+    if (units & UNIT_ALU) {
+        const uint64_t* in = (op->flags & MICRO_AMUX) ? s->mbr : a;
+        uint64_t carry = 0, any = 0;
+
+        for (int i = 0; i < 16; i++) {
+            switch (op->alu) {
+                case ALU_A_PLUS_B: {
+                    uint64_t half = in[i] ^ b[i];
+                    r[i] = half ^ carry;
+                    carry = (in[i] & b[i]) | (carry & half);
+                    break;
+                }
+                case ALU_A_AND_B: r[i] = in[i] & b[i]; break;
+                case ALU_A:       r[i] = in[i]; break;
+                default:          r[i] = ~in[i]; break;
+            }
+            any |= r[i];
+        }
+
+        /* Condition is taken from the ALU output, before the shifter */
+        if (op->cond == COND_IF_N) taken = lanes & r[15];
+        if (op->cond == COND_IF_Z) taken = lanes & ~any;
+
+        if (op->sh == SHIFT_RIGHT) {
+            for (int i = 0; i < 15; i++) r[i] = r[i + 1];
+        } else if (op->sh == SHIFT_LEFT) {
+            for (int i = 15; i > 0; i--) r[i] = r[i - 1];
+            r[0] = 0;
+        }
+
+        if (op->flags & MICRO_MBR) blend(s->mbr, r, 16, lanes);
+        if (units & UNIT_BUS_C) blend(s->reg[op->c], r, 16, lanes);
+    }
+
+    if (op->flags & MICRO_WR) write_memory(s, lanes);
+
+    if (op->flags & MICRO_DISPATCH) {
+        dispatch(s, lanes);
+        return;
+    }
+    if (taken) {
+        set_lanes(s->mpc, MICROADDR_BITS, taken, op->addr);
+    }
+    if (lanes & ~taken) {
+        set_lanes(s->mpc, MICROADDR_BITS, lanes & ~taken, (mpc + 1) & (s->cm->size - 1));
+    }
+}
+
+/* One microcycle in the given lanes: one control-store fetch per distinct MPC */
+static void run_lanes(mic1_slice* s, uint64_t lanes) {
+    while (lanes) {
+        int mpc = slice_mpc(s, lowest_lane(lanes));
+        uint64_t group = lanes & lanes_equal(s->mpc, MICROADDR_BITS, mpc);
+        lanes &= ~group;
+
+        if (mpc >= s->cm->size) {
+            s->faulted |= group;
+            s->active &= ~group;
+            continue;
+        }
+        execute_op(s, &s->cm->ops[mpc], mpc, group);
+    }
+}
+
+static void count_cycles(mic1_slice* s, uint64_t lanes, int cycles) {
+    while (lanes) {
+        int lane = lowest_lane(lanes);
+        s->cycle_count[lane] += cycles;
+        lanes &= lanes - 1;
+    }
+}
+
+void slice_cycle(mic1_slice* s) {
+    if (!s || !s->cm) return;
+
+    uint64_t lanes = s->active;
+    run_lanes(s, lanes);
+    count_cycles(s, lanes & s->active, 1);
+}
+
+void slice_step(mic1_slice* s) {
+    if (!s || !s->cm) return;
+
+    uint64_t running = s->active;
+
+    for (int i = 1; i <= MIC1_MAX_MICROSTEPS && running; i++) {
+        run_lanes(s, running);
+
+        uint64_t stopped = running & ~s->active;
+        uint64_t done = running & s->active & lanes_equal(s->mpc, MICROADDR_BITS, 0);
+        count_cycles(s, stopped, i - 1);
+        count_cycles(s, done, i);
+        running &= ~(stopped | done);
+    }
+    count_cycles(s, running, MIC1_MAX_MICROSTEPS);
+}
@@ -0,0 +1,266 @@
+
+#include <stdio.h>
+#include <string.h>
+#include "../include/control_store.h"
+
+/* ============================================================
+ * ENCODING HELPERS
+ * ============================================================ */
+
+static void put_u16(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    put_u16(p, v & 0xFFFF);
+    put_u16(p + 2, v >> 16);
+}
+
+static uint32_t get_u16(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    return get_u16(p) | (get_u16(p + 2) << 16);
+}
+
+uint32_t control_store_checksum(const uint8_t* data, size_t size) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void put_op(uint8_t* p, const micro_op* op) {
+    put_u16(p, op->addr);
+    p[2] = op->a;
+    p[3] = op->b;
+    p[4] = op->c;
+    p[5] = op->alu;
+    p[6] = op->sh;
+    p[7] = op->cond;
+    p[8] = op->flags;
+}
+
+static void get_op(const uint8_t* p, micro_op* op) {
+    op->addr = (uint16_t)get_u16(p);
+    op->a = p[2];
+    op->b = p[3];
+    op->c = p[4];
+    op->alu = p[5];
+    op->sh = p[6];
+    op->cond = p[7];
+    op->flags = p[8];
+    op->units = micro_op_units(op);
+}
+
+/*
+ * The predecoded ops must be exactly what the words decode to, and every
+ * dispatch entry must land inside the store: the engines index registers
+ * and the store with these fields without further checks.
+ */
+static int tables_valid(const uint8_t* p, int count, uint32_t flags, int store_size) {
+    const uint8_t* words = p;
+    const uint8_t* ext = NULL;
+    p += (size_t)count * 4;
+    if (flags & CS_FLAG_EXTENDED) {
+        ext = p + 2;
+        p += 2 + count;
+    }
+    if (flags & CS_FLAG_PREDECODED) {
+        for (int i = 0; i < count; i++, p += CS_OP_SIZE) {
+            micro_op op;
+            uint8_t expected[CS_OP_SIZE];
+            decode_micro_op_ext(get_u32(words + 4 * i), ext ? ext[i] : 0, &op);
+            put_op(expected, &op);
+            if (memcmp(expected, p, CS_OP_SIZE) != 0) return 0;
+        }
+    }
+    if (flags & CS_FLAG_DISPATCH) {
+        int bits = *p++;
+        for (int key = 0; key < (1 << bits); key++, p += 2) {
+            if ((int)get_u16(p) >= store_size) return 0;
+        }
+    }
+    return 1;
+}
+
+/* Needs the extension section: not 256 words, or extended words */
+static int is_extended(const control_memory* cm, int count) {
+    if (cm->size != CLASSIC_STORE_SIZE) return 1;
+    for (int i = 0; i < count; i++) {
+        if (cm->ext[i]) return 1;
+    }
+    return 0;
+}
+
+/* ============================================================
+ * FILE I/O
+ * ============================================================ */
+
+int is_control_store_file(const char* filename) {
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) return 0;
+
+    char magic[4];
+    int match = fread(magic, 1, 4, fp) == 4 && memcmp(magic, CS_MAGIC, 4) == 0;
+    fclose(fp);
+    return match;
+}
+
+int save_control_store(const control_memory* cm, int count, int flags, const char* filename) {
+    if (!cm || !filename || count < 1 || count > cm->size || (flags & ~CS_FLAGS)) {
+        return -1;
+    }
+
+    flags &= ~CS_FLAG_EXTENDED;
+    if (is_extended(cm, count)) {
+        flags |= CS_FLAG_EXTENDED;
+    }
+
+    uint8_t buffer[CS_MAX_FILE_SIZE];
+    uint8_t* p = buffer + CS_HEADER_SIZE;
+
+    for (int i = 0; i < count; i++, p += 4) {
+        put_u32(p, cm->words[i]);
+    }
+    if (flags & CS_FLAG_EXTENDED) {
+        put_u16(p, (uint32_t)cm->size);
+        p += 2;
+        memcpy(p, cm->ext, (size_t)count);
+        p += count;
+    }
+    if (flags & CS_FLAG_PREDECODED) {
+        for (int i = 0; i < count; i++, p += CS_OP_SIZE) {
+            put_op(p, &cm->ops[i]);
+        }
+    }
+    if (flags & CS_FLAG_DISPATCH) {
+        int entries = 1 << cm->dispatch_bits;
+        *p++ = (uint8_t)cm->dispatch_bits;
+        for (int key = 0; key < entries; key++, p += 2) {
+            put_u16(p, cm->dispatch[key]);
+        }
+    }
+
+    size_t size = (size_t)(p - buffer);
+    memcpy(buffer, CS_MAGIC, 4);
+    put_u16(buffer + 4, CS_VERSION);
+    put_u16(buffer + 6, (uint32_t)count);
+    put_u32(buffer + 8, (uint32_t)flags);
+    put_u32(buffer + 12, control_store_checksum(buffer + CS_HEADER_SIZE, size - CS_HEADER_SIZE));
+
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot create control-store file: %s\n", filename);
+        return -1;
+    }
+    int failed = fwrite(buffer, 1, size, fp) != size;
+    failed |= ferror(fp);
+    fclose(fp);
+    return failed ? -1 : 0;
+}
+
+/*
+ * Loads a binary control store into `cm`. The whole file is read in one
+ * call and validated before `cm` is touched. Returns the number of
+ * microinstructions, or -1.
+ */
+int load_control_store(control_memory* cm, const char* filename) {
+    if (!cm || !filename) {
+        return -1;
+    }
+
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open microprogram file: %s\n", filename);
+        return -1;
+    }
+
+    /* One byte of slack so oversized files are detected */
+    uint8_t buffer[CS_MAX_FILE_SIZE + 1];
+    size_t size = fread(buffer, 1, sizeof(buffer), fp);
+    fclose(fp);
+
+    if (size < CS_HEADER_SIZE || memcmp(buffer, CS_MAGIC, 4) != 0 ||
+        get_u16(buffer + 4) != CS_VERSION) {
+        fprintf(stderr, "Error: %s is not a version %d control-store file\n", filename, CS_VERSION);
+        return -1;
+    }
+
+    int count = (int)get_u16(buffer + 6);
+    uint32_t flags = get_u32(buffer + 8);
+    size_t expected = CS_HEADER_SIZE + (size_t)count * 4;
+    int store_size = CLASSIC_STORE_SIZE;
+    if ((flags & CS_FLAG_EXTENDED) && expected + 2 <= size) {
+        store_size = (int)get_u16(buffer + expected);
+        expected += 2 + (size_t)count;
+    }
+    if (flags & CS_FLAG_PREDECODED) {
+        expected += (size_t)count * CS_OP_SIZE;
+    }
+    int dispatch_bits = 0;
+    if ((flags & CS_FLAG_DISPATCH) && expected < size) {
+        dispatch_bits = buffer[expected];
+        expected += 1 + ((size_t)2 << (dispatch_bits & 0xF));
+    }
+
+    if (count < 1 || store_size < CLASSIC_STORE_SIZE || store_size > MICROPROGRAM_SIZE ||
+        (store_size & (store_size - 1)) || count > store_size || (flags & ~CS_FLAGS) ||
+        size != expected || ((flags & CS_FLAG_DISPATCH) && dispatch_bits != 4 && dispatch_bits != 8)) {
+        fprintf(stderr, "Error: Malformed control-store file: %s\n", filename);
+        return -1;
+    }
+    if (control_store_checksum(buffer + CS_HEADER_SIZE, size - CS_HEADER_SIZE) !=
+        get_u32(buffer + 12)) {
+        fprintf(stderr, "Error: Checksum mismatch in control-store file: %s\n", filename);
+        return -1;
+    }
+    if (!tables_valid(buffer + CS_HEADER_SIZE, count, flags, store_size)) {
+        fprintf(stderr, "Error: Malformed control-store file: %s\n", filename);
+        return -1;
+    }
+
+    struct fault_register* fault = cm->fault;
+    init_control_memory(cm);
+    cm->fault = fault;
+    cm->size = store_size;
+
+    const uint8_t* p = buffer + CS_HEADER_SIZE;
+    for (int i = 0; i < count; i++, p += 4) {
+        uint32_t w = get_u32(p);
+        cm->words[i] = w;
+        for (int j = 0; j < 32; j++) {
+            cm->microinstructions[i][j] = (w >> (31 - j)) & 1;
+        }
+    }
+    if (flags & CS_FLAG_EXTENDED) {
+        memcpy(cm->ext, p + 2, (size_t)count);
+        p += 2 + count;
+    }
+
+    if (flags & CS_FLAG_PREDECODED) {
+        for (int i = 0; i < count; i++, p += CS_OP_SIZE) {
+            get_op(p, &cm->ops[i]);
+        }
+    } else {
+        for (int i = 0; i < count; i++) {
+            decode_micro_op_ext(cm->words[i], cm->ext[i], &cm->ops[i]);
+        }
+    }
+
+    if (flags & CS_FLAG_DISPATCH) {
+        memset(cm->dispatch, 0, sizeof(cm->dispatch));
+        cm->dispatch_bits = *p++;
+        for (int key = 0; key < (1 << cm->dispatch_bits); key++, p += 2) {
+            cm->dispatch[key] = (uint16_t)get_u16(p);
+        }
+    } else {
+        default_dispatch_table(cm);
+    }
+
+    return count;
+}
@@ -8,6 +8,8 @@
 #include "../include/alu.h"
 #include "../include/shifter.h"
 #include "../include/utils/conversions.h"
+#include "../include/fault.h"
+#include "../include/control_store.h"
 
 void init_mir(mir* m) {
     if (!m) {
@@ -38,9 +40,13 @@ void init_mir(mir* m) {
         m->a[i] = 0;
     }
 
-    for (int i = 0; i < 8; i++) {
+    for (int i = 0; i < MICROADDR_BITS; i++) {
         m->addr[i] = 0;
     }
+
+    m->ext = 0;
+    m->dispatch = 0;
+    m->units = UNIT_ALL;
 }
 
 void decode_microinstruction(mir* m) {
@@ -63,6 +69,8 @@ void decode_microinstruction(mir* m) {
      * data[27..28] = ALU[1:0]   (bits 4-3: ALU operation)
      * data[29..30] = COND[1:0]  (bits 2-1: branch condition)
      * data[31]     = AMUX       (bit 0: A-mux select)
+     *
+     * ext holds the extension byte of extended words (MICRO_EXT_*).
      */
 
     m->amux = m->data[31];
@@ -97,13 +105,19 @@ void decode_microinstruction(mir* m) {
     }
 
     /*
-     * ADDR field: bits_to_int expects MSB first (index 0 = MSB).
-     * The string stores data[0..7] as ADDR[7..0] (MSB first), so we
-     * copy directly since bits_to_int will interpret addr[0] as MSB.
+     * ADDR field: data[0..7] holds ADDR[7..0] MSB first; extended words
+     * add ADDR[11:8] from ext. addr[] is MSB first as bits_to_int expects.
      */
-    for (int i = 0; i < 8; i++) {
-        m->addr[i] = m->data[i];  /* ADDR: data[0..7] -> addr[0..7] directly */
+    uint32_t word = 0;
+    micro_op op;
+    for (int i = 0; i < 32; i++) {
+        word = (word << 1) | (uint32_t)(m->data[i] & 1);
     }
+    decode_micro_op_ext(word, (uint8_t)m->ext, &op);
+
+    int_to_bits(op.addr, m->addr, MICROADDR_BITS);
+    m->dispatch = (op.flags & MICRO_DISPATCH) != 0;
+    m->units = op.units;
 }
 
 void run_mir(mir* m, mbr* mb, mar* ma, mmux* mmu, amux* amu,
@@ -170,21 +184,22 @@ void init_mpc(mpc* p) {
         return;
     }
 
-    for (int i = 0; i < 8; i++) {
+    for (int i = 0; i < MICROADDR_BITS; i++) {
         p->address[i] = 0;
     }
 }
 
-void increment_mpc(mpc* p) {
+/* `size` is the control-store size, a power of two */
+void increment_mpc(mpc* p, int size) {
     if (!p) {
         return;
     }
 
-    int addr = bits_to_int(p->address, 8);
+    int addr = bits_to_int(p->address, MICROADDR_BITS);
 
-    addr = (addr + 1) & 0xFF;
+    addr = (addr + 1) & (size - 1);
 
-    int_to_bits(addr, p->address, 8);
+    int_to_bits(addr, p->address, MICROADDR_BITS);
 }
 
 void run_mpc(mpc* p, mir* m, control_memory* cm) {
@@ -193,18 +208,20 @@ void run_mpc(mpc* p, mir* m, control_memory* cm) {
         return;
     }
 
-    int index = bits_to_int(p->address, 8);
+    int index = bits_to_int(p->address, MICROADDR_BITS);
 
-    if (index < 0 || index >= MICROPROGRAM_SIZE) {
+    if (index < 0 || index >= cm->size) {
         for (int i = 0; i < 32; i++) {
             m->data[i] = 0;
         }
+        m->ext = 0;
         return;
     }
 
     for (int i = 0; i < 32; i++) {
         m->data[i] = cm->microinstructions[index][i];
     }
+    m->ext = cm->ext[index];
 }
 
 void init_mmux(mmux* m) {
@@ -217,6 +234,7 @@ void init_mmux(mmux* m) {
 
     m->alu_n = 0;
     m->alu_z = 0;
+    m->cm = NULL;
 }
 
 int should_branch(mmux* m) {
@@ -248,41 +266,47 @@ int should_branch(mmux* m) {
     return result;
 }
 
+/*
+ * Control-store address of the routine for macro opcode `opcode` in the
+ * layout of data/basic_microcode.txt; the default dispatch table for
+ * microprograms that do not provide their own.
+ */
+int dispatch_target(int opcode) {
+    int target = 0x14 + (opcode << 2);
+
+    if (opcode >= 0x4) target += 4;
+    if (opcode >= 0x9) target += 4;
+    if (opcode >= 0xA) target += 4;
+    if (opcode >= 0xB) target += 4;
+    if (opcode >= 0xC) target += 4;
+    if (opcode >= 0xF) target += 4;
+
+    return target & 0xFF;
+}
+
 void run_mmux(mmux* m, mpc* p, mir* mir, mbr* mb) {
 
     if (!m || !p || !mir) {
         return;
     }
 
-        if (should_branch(m)) {
-            int addr_value = bits_to_int(mir->addr, 8);
-            int cond = (m->control_cond[1] << 1) | m->control_cond[0];
-
-            if (cond == COND_ALWAYS && addr_value == 0xFF && mb) {
-                int opcode = 0;
-                for (int i = 0; i < 4; i++) {
-                    opcode |= (mb->data[12 + i] << (3 - i));
-                }
-
-                int base = 0x14;
-                int target = base + (opcode << 2);
-
-                if (opcode >= 0x4) target += 4;
-                if (opcode >= 0x9) target += 4;
-                if (opcode >= 0xA) target += 4;
-                if (opcode >= 0xB) target += 4;
-                if (opcode >= 0xC) target += 4;
-                if (opcode >= 0xF) target += 4;
-
-                int_to_bits(target, p->address, 8);
-            } else {
-                for (int i = 0; i < 8; i++) {
-                    p->address[i] = mir->addr[i];
-                }
-            }
+    if (mir->dispatch && mb) {
+        int target;
+        if (m->cm) {
+            int bits = m->cm->dispatch_bits;
+            target = m->cm->dispatch[bits_to_int(&mb->data[16 - bits], bits)];
         } else {
-            increment_mpc(p);
+            target = dispatch_target(bits_to_int(&mb->data[12], 4));
         }
+
+        int_to_bits(target, p->address, MICROADDR_BITS);
+    } else if (should_branch(m)) {
+        for (int i = 0; i < MICROADDR_BITS; i++) {
+            p->address[i] = mir->addr[i];
+        }
+    } else {
+        increment_mpc(p, m->cm ? m->cm->size : CLASSIC_STORE_SIZE);
+    }
 }
 
 void init_amux(amux* a) {
@@ -314,76 +338,301 @@ void init_control_memory(control_memory* cm) {
             cm->microinstructions[i][j] = 0;
         }
     }
+    memset(cm->words, 0, sizeof(cm->words));
+    memset(cm->ext, 0, sizeof(cm->ext));
+    memset(cm->ops, 0, sizeof(cm->ops));
+    cm->size = CLASSIC_STORE_SIZE;
+    default_dispatch_table(cm);
+    cm->fault = NULL;
 }
 
-int load_microprogram(control_memory* cm, const char* filename) {
-    if (!cm || !filename) {
-        return -1;
+void default_dispatch_table(control_memory* cm) {
+    if (!cm) {
+        return;
     }
 
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Error: Could not open microprogram file: %s\n", filename);
-        return -1;
+    memset(cm->dispatch, 0, sizeof(cm->dispatch));
+    for (int opcode = 0; opcode < 16; opcode++) {
+        cm->dispatch[opcode] = (uint16_t)dispatch_target(opcode);
     }
+    cm->dispatch_bits = 4;
+}
 
+/* Field layout as documented in decode_microinstruction; classic word */
+void decode_micro_op(uint32_t word, micro_op* op) {
+    if (!op) {
+        return;
+    }
+
+    op->addr = (word >> 24) & 0xFF;
+    op->a    = (word >> 20) & 0xF;
+    op->b    = (word >> 16) & 0xF;
+    op->c    = (word >> 12) & 0xF;
+    op->sh   = (word >> 5) & 0x3;
+    op->alu  = (word >> 3) & 0x3;
+    op->cond = (word >> 1) & 0x3;
+
+    op->flags = 0;
+    if (word & (1u << 11)) op->flags |= MICRO_ENC;
+    if (word & (1u << 10)) op->flags |= MICRO_WR;
+    if (word & (1u << 9))  op->flags |= MICRO_RD;
+    if (word & (1u << 8))  op->flags |= MICRO_MAR;
+    if (word & (1u << 7))  op->flags |= MICRO_MBR;
+    if (word & 1u)         op->flags |= MICRO_AMUX;
+    if (op->cond == COND_ALWAYS && op->addr == DISPATCH_ADDR) op->flags |= MICRO_DISPATCH;
+
+    op->units = micro_op_units(op);
+}
+
+/* Word plus extension byte; ext == 0 is a classic word */
+void decode_micro_op_ext(uint32_t word, uint8_t ext, micro_op* op) {
+    decode_micro_op(word, op);
+    if (!op || !(ext & MICRO_EXT_WIDE)) {
+        return;
+    }
+
+    /* The MPC is MICROADDR_BITS wide; higher address bits are dropped */
+    op->addr = (uint16_t)((op->addr | (ext & MICRO_EXT_ADDR_HI) << 8) & (MICROPROGRAM_SIZE - 1));
+    op->flags &= (uint8_t)~MICRO_DISPATCH;
+    if (ext & MICRO_EXT_DISPATCH) op->flags |= MICRO_DISPATCH;
+}
+
+uint8_t micro_op_units(const micro_op* op) {
+    uint8_t units = 0;
+    int stored = (op->flags & (MICRO_ENC | MICRO_MBR)) != 0;
+
+    if (stored || op->cond == COND_IF_N || op->cond == COND_IF_Z) {
+        units |= UNIT_ALU;
+        if (!(op->flags & MICRO_AMUX)) units |= UNIT_BUS_A;
+        if (op->alu == ALU_A_PLUS_B || op->alu == ALU_A_AND_B) units |= UNIT_BUS_B;
+    }
+    if (op->flags & MICRO_MAR) units |= UNIT_BUS_B;
+    if (stored) units |= UNIT_SHIFTER;
+    if (op->flags & MICRO_ENC) units |= UNIT_BUS_C;
+
+    return units;
+}
+
+/* Rebuild words[] and ops[] from the bit arrays */
+void predecode_microprogram(control_memory* cm) {
+    if (!cm) {
+        return;
+    }
+
+    for (int i = 0; i < MICROPROGRAM_SIZE; i++) {
+        uint32_t w = 0;
+        for (int j = 0; j < 32; j++) {
+            w = (w << 1) | (uint32_t)(cm->microinstructions[i][j] & 1);
+        }
+        cm->words[i] = w;
+        decode_micro_op_ext(w, cm->ext[i], &cm->ops[i]);
+    }
+}
+
+/*
+ * '@size N', '@dispatch_bits N' and '@dispatch KEY ADDRESS' lines.
+ * @size comes before the first word; the first @dispatch entry replaces
+ * the default table, and keys without an entry dispatch to 0.
+ */
+static int parse_directive_line(control_memory* cm, const char* line, int* seen, int words) {
+    char name[32];
+    int key, address;
+
+    if (sscanf(line, "@%31s %i %i", name, &key, &address) == 3 && strcmp(name, "dispatch") == 0) {
+        if (key < 0 || key >= (1 << cm->dispatch_bits) ||
+            address < 0 || address >= cm->size) {
+            return -1;
+        }
+        if (!*seen) {
+            memset(cm->dispatch, 0, sizeof(cm->dispatch));
+            *seen = 1;
+        }
+        cm->dispatch[key] = (uint16_t)address;
+        return 0;
+    }
+
+    if (sscanf(line, "@%31s %i", name, &key) == 2 && strcmp(name, "dispatch_bits") == 0 &&
+        (key == 4 || key == 8) && !*seen) {
+        cm->dispatch_bits = key;
+        return 0;
+    }
+
+    if (sscanf(line, "@%31s %i", name, &key) == 2 && strcmp(name, "size") == 0 &&
+        key >= CLASSIC_STORE_SIZE && key <= MICROPROGRAM_SIZE && (key & (key - 1)) == 0 &&
+        words == 0 && !*seen) {
+        cm->size = key;
+        return 0;
+    }
+
+    return -1;
+}
+
+/* Lines of a text microprogram, from a file or from a string in memory */
+typedef struct {
+    FILE* file;
+    const char* text;
+} micro_reader;
+
+/* fgets on either source: at most size - 1 characters, up to and including '\n' */
+static int read_micro_line(micro_reader* r, char* line, int size) {
+    if (r->file) {
+        return fgets(line, size, r->file) != NULL;
+    }
+    if (!*r->text) return 0;
+
+    int n = 0;
+    while (n < size - 1 && r->text[n]) {
+        line[n] = r->text[n];
+        if (line[n++] == '\n') break;
+    }
+    line[n] = '\0';
+    r->text += n;
+    return 1;
+}
+
+static int parse_microprogram(control_memory* cm, micro_reader* reader, const char* name) {
     char line[128];
     int instruction_count = 0;
+    int dispatch_seen = 0;
+    int line_number = 0;
+
+    default_dispatch_table(cm);
+    cm->size = CLASSIC_STORE_SIZE;
 
-    while (fgets(line, sizeof(line), file) && instruction_count < MICROPROGRAM_SIZE) {
-        if (line[0] == '#' || line[0] == ';' || line[0] == '\n' || line[0] == '\r') {
+    while (read_micro_line(reader, line, sizeof(line))) {
+        line_number++;
+        if (line[0] == '@') {
+            if (parse_directive_line(cm, line, &dispatch_seen, instruction_count) < 0) {
+                fprintf(stderr, "Warning: Invalid directive line %d: %s", line_number, line);
+            }
+            continue;
+        }
+        if (line[0] == '#' || line[0] == ';' || line[0] == '\n' || line[0] == '\r' ||
+            instruction_count >= cm->size) {
             continue;
         }
 
+        /* 32 bits, or 40 with the extension byte in front */
+        int bits[40];
         int valid_bits = 0;
-        for (int i = 0; i < 32 && line[i] != '\0' && line[i] != '\n'; i++) {
-            if (line[i] == '0') {
-                cm->microinstructions[instruction_count][i] = 0;
-                valid_bits++;
-            } else if (line[i] == '1') {
-                cm->microinstructions[instruction_count][i] = 1;
+        for (int i = 0; line[i] != '\0' && line[i] != '\n' && line[i] != '\r'; i++) {
+            if (line[i] == '0' || line[i] == '1') {
+                if (valid_bits < 40) bits[valid_bits] = line[i] - '0';
                 valid_bits++;
             } else if (line[i] != ' ' && line[i] != '\t') {
                 fprintf(stderr, "Warning: Invalid character '%c' at instruction %d, bit %d\n",
-                        line[i], instruction_count, i);
+                        line[i], instruction_count, valid_bits);
             }
         }
 
-        if (valid_bits == 32) {
+        if (valid_bits == 40 && !bits[0]) {
+            fprintf(stderr, "Warning: Extension byte without the WIDE bit at line %d\n", line_number);
+        } else if (valid_bits == 32 || valid_bits == 40) {
+            int ext = 0;
+            for (int i = 0; i < valid_bits - 32; i++) {
+                ext = (ext << 1) | bits[i];
+            }
+            cm->ext[instruction_count] = (uint8_t)ext;
+            memcpy(cm->microinstructions[instruction_count], &bits[valid_bits - 32], 32 * sizeof(int));
             instruction_count++;
         } else if (valid_bits > 0) {
-            fprintf(stderr, "Warning: Incomplete microinstruction at line %d (got %d bits, expected 32)\n",
+            fprintf(stderr, "Warning: Incomplete microinstruction at line %d (got %d bits, expected 32 or 40)\n",
                     instruction_count + 1, valid_bits);
         }
     }
 
-    fclose(file);
-
     if (instruction_count == 0) {
-        fprintf(stderr, "Error: No valid microinstructions loaded from %s\n", filename);
+        fprintf(stderr, "Error: No valid microinstructions loaded from %s\n", name);
         return -1;
     }
 
+    predecode_microprogram(cm);
     return instruction_count;
 }
 
+int load_microprogram(control_memory* cm, const char* filename) {
+    if (!cm || !filename) {
+        return -1;
+    }
+
+    if (is_control_store_file(filename)) {
+        return load_control_store(cm, filename);
+    }
+
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open microprogram file: %s\n", filename);
+        return -1;
+    }
+
+    micro_reader reader = { file, NULL };
+    int result = parse_microprogram(cm, &reader, filename);
+    fclose(file);
+    return result;
+}
+
+int load_microprogram_text(control_memory* cm, const char* text) {
+    if (!cm || !text) {
+        return -1;
+    }
+
+    micro_reader reader = { NULL, text };
+    return parse_microprogram(cm, &reader, "microprogram text");
+}
+
+/* Same result as decode_microinstruction, from a predecoded op */
+static void load_mir(mir* m, const int* bits, uint8_t ext, const micro_op* op) {
+    for (int i = 0; i < 32; i++) {
+        m->data[i] = bits[i];
+    }
+
+    m->amux = (op->flags & MICRO_AMUX) != 0;
+    m->mbr = (op->flags & MICRO_MBR) != 0;
+    m->mar = (op->flags & MICRO_MAR) != 0;
+    m->rd = (op->flags & MICRO_RD) != 0;
+    m->wr = (op->flags & MICRO_WR) != 0;
+    m->enc = (op->flags & MICRO_ENC) != 0;
+
+    m->cond[0] = op->cond & 1;
+    m->cond[1] = op->cond >> 1;
+    m->alu[0] = op->alu & 1;
+    m->alu[1] = op->alu >> 1;
+    m->sh[0] = op->sh & 1;
+    m->sh[1] = op->sh >> 1;
+
+    for (int i = 0; i < 4; i++) {
+        m->c[i] = (op->c >> i) & 1;
+        m->b[i] = (op->b >> i) & 1;
+        m->a[i] = (op->a >> i) & 1;
+    }
+    int_to_bits(op->addr, m->addr, MICROADDR_BITS);
+    m->ext = ext;
+    m->dispatch = (op->flags & MICRO_DISPATCH) != 0;
+    m->units = op->units;
+}
+
 void fetch_microinstruction(control_memory* cm, mpc* p, mir* m) {
     if (!cm || !p || !m) {
         return;
     }
 
-    int address = bits_to_int(p->address, 8);
+    int address = bits_to_int(p->address, MICROADDR_BITS);
 
-    if (address < 0 || address >= MICROPROGRAM_SIZE) {
-        fprintf(stderr, "Error: MPC address out of bounds: %d\n", address);
+    if (address < 0 || address >= cm->size) {
+        /* Never rerun the previous MIR: load "goto 0", which changes nothing */
+        uint32_t word = (uint32_t)COND_ALWAYS << 1;
+        int bits[32];
+        micro_op op;
+        for (int i = 0; i < 32; i++) {
+            bits[i] = (word >> (31 - i)) & 1;
+        }
+        decode_micro_op_ext(word, 0, &op);
+        load_mir(m, bits, 0, &op);
+        raise_fault(cm->fault, FAULT_MPC_BOUNDS, address);
         return;
     }
 
-    for (int i = 0; i < 32; i++) {
-        m->data[i] = cm->microinstructions[address][i];
-    }
-
-    decode_microinstruction(m);
+    load_mir(m, cm->microinstructions[address], cm->ext[address], &cm->ops[address]);
 }
 
 void update_control(mpc* p, mmux* mmux, mir* m, mbr* mb) {
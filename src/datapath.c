@@ -1,6 +1,7 @@
 #include "../include/datapath.h"
 #include "../include/shifter.h"
 #include "../include/utils/conversions.h"
+#include "../include/fault.h"
 
 #include <stdio.h>
 #include <stddef.h>
@@ -44,12 +45,14 @@ void init_register_bank(register_bank *rb){
 void init_decoder(decoder*d, register_bank*rb){
     if (!d || !rb) return;
     d->rb = rb;
+    d->fault = NULL;
     for(int i = 0; i < 4; i++) d->control[i] = 0;
 }
 
 void init_decoderC(decoderC*d, register_bank*rb){
     if (!d || !rb) return;
     d->rb = rb;
+    d->fault = NULL;
     for(int i = 0; i < 4; i++) d->control_c[i] = 0;
     d->control_enc = 0;
 }
@@ -87,7 +90,7 @@ void run_decoder(decoder* d, latch* l) {
         case 14: selected_register = &d->rb->E; break;
         case 15: selected_register = &d->rb->F; break;
         default:
-            printf("Erro: Sinal de controle do decoder inválido (%d).\n", reg_index);
+            raise_fault(d->fault, FAULT_DECODER, reg_index);
             return;
     }
 
@@ -102,7 +105,7 @@ void run_decoderC(decoderC* d, shifter* s) {
     if (d->control_enc == 0) return;
     
     if (!d->rb) {
-        printf("Erro: decoderC->rb é NULL!\n");
+        raise_fault(d->fault, FAULT_DECODER, -1);
         return;
     }
 
@@ -128,7 +131,7 @@ void run_decoderC(decoderC* d, shifter* s) {
         case 14: selected_register = &d->rb->E; break;
         case 15: selected_register = &d->rb->F; break;
         default:
-            printf("Erro: Sinal de controle do decoderC inválido (%d).\n", reg_index);
+            raise_fault(d->fault, FAULT_DECODER, reg_index);
             return;
     }
 
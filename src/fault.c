@@ -0,0 +1,80 @@
+#include "../include/fault.h"
+#include <stdlib.h>
+#include <string.h>
+
+void init_fault_register(fault_register* f) {
+    if (!f) return;
+
+    f->kind = FAULT_NONE;
+    f->address = 0;
+    f->cycle = 0;
+    f->pc = 0;
+    f->pending = 0;
+    f->count = 0;
+    f->action = FAULT_ACTION_HALT;
+    f->trap_vector = 0;
+}
+
+void raise_fault(fault_register* f, int kind, int address) {
+    if (!f) return;
+
+    f->count++;
+
+    /* Keep the first fault of a cycle; later ones only bump the count */
+    if (f->pending) return;
+
+    f->kind = kind;
+    f->address = address;
+    f->pending = 1;
+}
+
+void clear_fault(fault_register* f) {
+    if (!f) return;
+
+    f->kind = FAULT_NONE;
+    f->address = 0;
+    f->cycle = 0;
+    f->pc = 0;
+    f->pending = 0;
+    f->count = 0;
+}
+
+const char* fault_kind_name(int kind) {
+    switch (kind) {
+        case FAULT_NONE:       return "NONE";
+        case FAULT_MEM_READ:   return "MEM_READ";
+        case FAULT_MEM_WRITE:  return "MEM_WRITE";
+        case FAULT_DECODER:    return "DECODER";
+        case FAULT_MPC_BOUNDS: return "MPC_BOUNDS";
+        case FAULT_PC_BOUNDS:  return "PC_BOUNDS";
+        case FAULT_ILLEGAL_OP: return "ILLEGAL_OP";
+        default:               return "UNKNOWN";
+    }
+}
+
+/**
+ * Parse "halt", "ignore" or "trap[:addr]".
+ * Returns the FAULT_ACTION_* value, or -1 on a bad spec.
+ */
+int parse_fault_action(const char* spec, int* trap_vector) {
+    if (!spec) return -1;
+
+    if (strcmp(spec, "halt") == 0) return FAULT_ACTION_HALT;
+    if (strcmp(spec, "ignore") == 0) return FAULT_ACTION_IGNORE;
+
+    if (strncmp(spec, "trap", 4) == 0) {
+        if (spec[4] == '\0') {
+            if (trap_vector) *trap_vector = 0;
+            return FAULT_ACTION_TRAP;
+        }
+        if (spec[4] == ':') {
+            char* end;
+            long addr = strtol(spec + 5, &end, 0);
+            if (*end != '\0' || addr < 0 || addr > 0xFFF) return -1;
+            if (trap_vector) *trap_vector = (int)addr;
+            return FAULT_ACTION_TRAP;
+        }
+    }
+
+    return -1;
+}
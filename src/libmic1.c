@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/libmic1.h"
+#include "../include/mic1.h"
+#include "../include/assembler.h"
+#include "../include/utils/conversions.h"
+
+#define REG16(reg) bits_to_int((int*)(reg).data, 16)
+
+struct mic1_sim {
+    mic1_cpu cpu;
+};
+
+/* As mic1_simulator leaves the CPU before its first step */
+static void start_cpu(mic1_cpu* cpu) {
+    int_to_bits(0x0FFF, cpu->reg_bank.SP.data, 16);
+    cpu->running = 1;
+}
+
+mic1_sim* mic1_sim_create(const char* engine) {
+    int kind = engine ? mic1_engine_from_name(engine) : MIC1_ENGINE_DIRECT;
+    if (kind < 0) return NULL;
+
+    mic1_sim* sim = malloc(sizeof(mic1_sim));
+    if (!sim) return NULL;
+
+    init_mic1(&sim->cpu);
+    sim->cpu.engine = kind;
+    start_cpu(&sim->cpu);
+    return sim;
+}
+
+void mic1_sim_destroy(mic1_sim* sim) {
+    free(sim);
+}
+
+void mic1_sim_reset(mic1_sim* sim) {
+    if (!sim) return;
+
+    reset_mic1(&sim->cpu);
+    start_cpu(&sim->cpu);
+}
+
+int mic1_sim_assemble(const char* source, uint16_t* image, int capacity, int* size,
+                      char* error, size_t error_size) {
+    if (!source || !image || !size) return -1;
+
+    /* Too big for the stack of an embedding thread */
+    assembler_t* as = malloc(sizeof(assembler_t));
+    if (!as) {
+        if (error) snprintf(error, error_size, "out of memory");
+        return -1;
+    }
+
+    init_assembler(as);
+    int result = assembler_run(as, source, image, capacity, size);
+    if (result != 0 && error) {
+        if (as->error_line > 0) {
+            snprintf(error, error_size, "line %d: %s", as->error_line, as->error_msg);
+        } else {
+            snprintf(error, error_size, "%s", as->error_msg);
+        }
+    }
+    free_assembler(as);
+    free(as);
+    return result != 0 ? -1 : 0;
+}
+
+int mic1_sim_load(mic1_sim* sim, const uint16_t* image, int base, int size) {
+    if (!sim) return -1;
+    return load_program_image(&sim->cpu, image, base, size);
+}
+
+int mic1_sim_load_microcode(mic1_sim* sim, const char* text) {
+    if (!sim || !text) return -1;
+
+    init_control_memory(&sim->cpu.ctrl_mem);
+    sim->cpu.ctrl_mem.fault = &sim->cpu.fault;
+    return load_microprogram_text(&sim->cpu.ctrl_mem, text) > 0 ? 0 : -1;
+}
+
+/* The word at PC is a JUMP to itself: mic1_simulator's halt */
+static int at_halt(const mic1_cpu* cpu) {
+    int pc = REG16(cpu->reg_bank.PC);
+    if (pc >= MEMORY_SIZE) return 0;
+
+    int instr = bits_to_int((int*)cpu->main_memory.data[pc], 16);
+    return (instr >> 12) == 0x6 && (instr & 0x0FFF) == pc;
+}
+
+int mic1_sim_run(mic1_sim* sim, long budget) {
+    if (!sim || budget < 0) return -1;
+
+    mic1_cpu* cpu = &sim->cpu;
+    long end = (long)cpu->cycle_count + budget;
+
+    /* A run after a watchpoint stop goes on past it */
+    if (cpu->stop_reason == MIC1_STOP_WATCH) {
+        cpu->stop_reason = MIC1_STOP_NONE;
+        cpu->running = 1;
+    }
+
+    while (1) {
+        if (!cpu->running) {
+            return cpu->stop_reason == MIC1_STOP_WATCH ? MIC1_SIM_WATCH : MIC1_SIM_FAULT;
+        }
+        if (at_halt(cpu)) return MIC1_SIM_HALT;
+        if (cpu->cycle_count >= end) return MIC1_SIM_BUDGET;
+
+        step_mic1(cpu);
+    }
+}
+
+int mic1_sim_register(const mic1_sim* sim, int reg) {
+    if (!sim) return -1;
+
+    switch (reg) {
+        case MIC1_SIM_PC: return REG16(sim->cpu.reg_bank.PC);
+        case MIC1_SIM_AC: return REG16(sim->cpu.reg_bank.AC);
+        case MIC1_SIM_SP: return REG16(sim->cpu.reg_bank.SP);
+        case MIC1_SIM_IR: return REG16(sim->cpu.reg_bank.IR);
+        default:          return -1;
+    }
+}
+
+int mic1_sim_read(const mic1_sim* sim, int address) {
+    if (!sim || address < 0 || address >= MEMORY_SIZE) return -1;
+    return bits_to_int((int*)sim->cpu.main_memory.data[address], 16);
+}
+
+int mic1_sim_write(mic1_sim* sim, int address, int value) {
+    if (!sim) return -1;
+
+    uint16_t word = (uint16_t)value;
+    return load_program_image(&sim->cpu, &word, address, 1);
+}
+
+long mic1_sim_cycles(const mic1_sim* sim) {
+    return sim ? sim->cpu.cycle_count : 0;
+}
+
+uint64_t mic1_sim_digest(const mic1_sim* sim) {
+    return sim ? mic1_state_digest(&sim->cpu) : 0;
+}
@@ -4,14 +4,19 @@
  * Non-interactive, deterministic trace output.
  * Runs exactly N cycles and prints register state each cycle.
  *
- * Usage: ./mic1_simulator <program.bin> [cycles]
+ * Usage: ./mic1_simulator <program.bin> [cycles] [options]
  */
 
 #include "../include/mic1.h"
+#include "../include/microcode_compiled.h"
+#include "../include/srcmap.h"
+#include "../include/object.h"
 #include "../include/utils/conversions.h"
 
 #define DEFAULT_CYCLES 50
 #define MAX_CYCLES 10000
+#define MAX_WATCH_ARGS 16
+#define DEFAULT_MICROCODE "data/mic1_microcode.txt"
 
 /* Helper macros using existing bits_to_int function */
 #define REG16(reg) bits_to_int((reg).data, 16)
@@ -32,25 +37,52 @@ static void print_header(void) {
 }
 
 /**
- * Get opcode mnemonic
+ * Get opcode mnemonic (0xF: sub-opcode in bits 11-8 of the operand)
  */
-static const char* opcode_mnemonic(int opcode) {
+static const char* opcode_mnemonic(int opcode, int operand) {
     static const char* mnemonics[] = {
         "LODD", "STOD", "ADDD", "SUBD",  /* 0-3 */
         "JPOS", "JZER", "JUMP", "LOCO",  /* 4-7 */
         "LODL", "STOL", "ADDL", "SUBL",  /* 8-B */
-        "JNEG", "JNZE", "CALL", "PSHI",  /* C-F */
+        "JNEG", "JNZE", "CALL", "",      /* C-F */
     };
+    static const char* special[] = {
+        "PSHI", "????", "POPI", "????",  /* F0-F3 */
+        "PUSH", "????", "POP",  "????",  /* F4-F7 */
+        "RETN", "????", "SWAP", "????",  /* F8-FB */
+        "INSP", "????", "DESP", "????",  /* FC-FF */
+    };
+    if (opcode == 0xF) {
+        return special[(operand >> 8) & 0xF];
+    }
     if (opcode >= 0 && opcode <= 0xF) {
         return mnemonics[opcode];
     }
     return "????";
 }
 
+/**
+ * Print where the instruction came from: nearest label and source line
+ */
+static void print_source(source_map* map, int pc) {
+    int line = source_map_line(map, pc);
+    if (!line) return;
+
+    int offset = 0;
+    const char* label = source_map_label(map, pc, &offset);
+    if (label && offset) {
+        printf("  ; %s+%d, line %d", label, offset, line);
+    } else if (label) {
+        printf("  ; %s, line %d", label, line);
+    } else {
+        printf("  ; line %d", line);
+    }
+}
+
 /**
  * Print single trace line
  */
-static void print_trace_line(int cycle, mic1_cpu* cpu) {
+static void print_trace_line(int cycle, mic1_cpu* cpu, source_map* map) {
     int pc  = REG16(cpu->reg_bank.PC);
     int ac  = REG16(cpu->reg_bank.AC);
     int sp  = REG16(cpu->reg_bank.SP);
@@ -67,7 +99,7 @@ static void print_trace_line(int cycle, mic1_cpu* cpu) {
 
     printf(" %5d | %04X | %04X | %04X | %04X | %-4s %03X |",
            cycle, pc, ac, sp, ir,
-           opcode_mnemonic(opcode), operand);
+           opcode_mnemonic(opcode, operand), operand);
 
     /* Brief meaning */
     switch (opcode) {
@@ -86,9 +118,22 @@ static void print_trace_line(int cycle, mic1_cpu* cpu) {
         case 0xC: printf(" if AC<0: goto %03X", operand); break;
         case 0xD: printf(" if AC!=0: goto %03X", operand); break;
         case 0xE: printf(" call %03X", operand); break;
-        case 0xF: printf(" push indirect"); break;
+        case 0xF:
+            switch (operand >> 8) {
+                case 0x0: printf(" push M[AC]"); break;
+                case 0x2: printf(" M[AC]<-pop"); break;
+                case 0x4: printf(" push AC"); break;
+                case 0x6: printf(" AC<-pop"); break;
+                case 0x8: printf(" return"); break;
+                case 0xA: printf(" AC<->SP"); break;
+                case 0xC: printf(" SP+=%d", operand & 0xFF); break;
+                case 0xE: printf(" SP-=%d", operand & 0xFF); break;
+                default:  printf(" (illegal)"); break;
+            }
+            break;
         default:  printf(" (unknown)"); break;
     }
+    print_source(map, pc);
     printf("\n");
 }
 
@@ -118,6 +163,75 @@ static void init_sp(mic1_cpu* cpu) {
     }
 }
 
+/**
+ * Print the fault register if a fault was ever taken
+ */
+static void print_fault(mic1_cpu* cpu) {
+    if (cpu->fault.kind == FAULT_NONE) return;
+
+    printf(" ** FAULT %s at %03X (cycle %d, PC=%04X, %d total) **\n",
+           fault_kind_name(cpu->fault.kind), cpu->fault.address & 0xFFFF,
+           cpu->fault.cycle, cpu->fault.pc, cpu->fault.count);
+}
+
+/**
+ * Print the watchpoint hit that stopped the CPU
+ */
+static void print_watch_hit(mic1_cpu* cpu) {
+    watch_hit* hit = &cpu->watch.hit;
+
+    if (hit->kind == WATCH_READ) {
+        printf(" ** WATCHPOINT read %03X = %04X (cycle %d, PC=%04X) **\n",
+               hit->address, hit->new_value, hit->cycle, hit->pc);
+    } else {
+        printf(" ** WATCHPOINT %s %03X: %04X -> %04X (cycle %d, PC=%04X) **\n",
+               watch_kind_name(hit->kind), hit->address,
+               hit->old_value, hit->new_value, hit->cycle, hit->pc);
+    }
+}
+
+/**
+ * Print usage
+ */
+static void print_usage(const char* prog) {
+    fprintf(stderr, "MIC-1 Execution Trace Logger\n");
+    fprintf(stderr, "Usage: %s <program.bin> [cycles] [options]\n", prog);
+    fprintf(stderr, "  cycles: number of cycles to execute (default: %d, max: %d)\n",
+            DEFAULT_CYCLES, MAX_CYCLES);
+    fprintf(stderr, "\nOptions:\n");
+    fprintf(stderr, "  --fault=halt|ignore|trap[:addr]  action on faults (default: halt)\n");
+    fprintf(stderr, "  --watch=ADDR[-END][:rwc]         stop on read/write/change (default: w)\n");
+    fprintf(stderr, "  --engine=direct|microcode|compiled  execution engine (default: direct)\n");
+    fprintf(stderr, "  --microcode=FILE                 control store for --engine=microcode\n");
+    fprintf(stderr, "                                   (default: %s)\n", DEFAULT_MICROCODE);
+    fprintf(stderr, "  --profile[=FILE]                 per-microinstruction profile (microcode and\n");
+    fprintf(stderr, "                                   compiled engines), to FILE or stdout\n");
+    fprintf(stderr, "  --map=FILE                       source map for the trace (default: the\n");
+    fprintf(stderr, "                                   program's .map from mic1asm, if any)\n");
+}
+
+/**
+ * Write the profile report, mapped to the lines of the control store
+ */
+static int write_profile(const micro_profile* profile, const char* microcode, const char* filename) {
+    static profile_source source;
+    int have_source = load_profile_source(&source, microcode) > 0;
+
+    FILE* out = filename ? fopen(filename, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Error: Cannot create profile file: %s\n", filename);
+        return -1;
+    }
+
+    fprintf(out, "\n");
+    int result = write_profile_report(profile, have_source ? &source : NULL, out);
+    if (filename) {
+        fclose(out);
+        printf("Profile written to %s\n", filename);
+    }
+    return result;
+}
+
 /**
  * Check if filename ends with given extension
  */
@@ -130,16 +244,64 @@ static int has_extension(const char* filename, const char* ext) {
 
 int main(int argc, char* argv[]) {
     /* Parse arguments */
-    if (argc < 2) {
-        fprintf(stderr, "MIC-1 Execution Trace Logger\n");
-        fprintf(stderr, "Usage: %s <program.bin> [cycles]\n", argv[0]);
-        fprintf(stderr, "  cycles: number of cycles to execute (default: %d, max: %d)\n",
-                DEFAULT_CYCLES, MAX_CYCLES);
+    const char* program = NULL;
+    const char* cycles_arg = NULL;
+    int fault_action = FAULT_ACTION_HALT;
+    int trap_vector = 0;
+    const char* watch_args[MAX_WATCH_ARGS];
+    int watch_arg_count = 0;
+    int engine = MIC1_ENGINE_DIRECT;
+    const char* microcode = DEFAULT_MICROCODE;
+    int profiling = 0;
+    const char* profile_file = NULL;
+    const char* map_file = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--fault=", 8) == 0) {
+            fault_action = parse_fault_action(argv[i] + 8, &trap_vector);
+            if (fault_action < 0) {
+                fprintf(stderr, "Error: Invalid fault action '%s'\n", argv[i] + 8);
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--watch=", 8) == 0) {
+            if (watch_arg_count >= MAX_WATCH_ARGS) {
+                fprintf(stderr, "Error: Too many watchpoints (max %d)\n", MAX_WATCH_ARGS);
+                return 1;
+            }
+            watch_args[watch_arg_count++] = argv[i] + 8;
+        } else if (strncmp(argv[i], "--engine=", 9) == 0) {
+            engine = mic1_engine_from_name(argv[i] + 9);
+            if (engine < 0) {
+                fprintf(stderr, "Error: Unknown engine '%s'\n", argv[i] + 9);
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--microcode=", 12) == 0) {
+            microcode = argv[i] + 12;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profiling = 1;
+        } else if (strncmp(argv[i], "--profile=", 10) == 0) {
+            profiling = 1;
+            profile_file = argv[i] + 10;
+        } else if (strncmp(argv[i], "--map=", 6) == 0) {
+            map_file = argv[i] + 6;
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        } else if (!program) {
+            program = argv[i];
+        } else if (!cycles_arg) {
+            cycles_arg = argv[i];
+        }
+    }
+
+    if (!program) {
+        print_usage(argv[0]);
         return 1;
     }
 
     /* Protect against running .asm files directly */
-    if (has_extension(argv[1], ".asm")) {
+    if (has_extension(program, ".asm")) {
         fprintf(stderr, "\n");
         fprintf(stderr, "ERROR: Cannot execute .asm files directly!\n");
         fprintf(stderr, "\n");
@@ -148,19 +310,19 @@ int main(int argc, char* argv[]) {
         fprintf(stderr, "\n");
         fprintf(stderr, "Correct workflow:\n");
         fprintf(stderr, "  1. Assemble:  ./mic1asm %s %.*s.bin\n",
-                argv[1], (int)(strlen(argv[1]) - 4), argv[1]);
+                program, (int)(strlen(program) - 4), program);
         fprintf(stderr, "  2. Run:       ./mic1_simulator %.*s.bin\n",
-                (int)(strlen(argv[1]) - 4), argv[1]);
+                (int)(strlen(program) - 4), program);
         fprintf(stderr, "\n");
         fprintf(stderr, "Or use the helper script:\n");
-        fprintf(stderr, "  ./run_test.sh %s\n", argv[1]);
+        fprintf(stderr, "  ./run_test.sh %s\n", program);
         fprintf(stderr, "\n");
         return 1;
     }
 
     int num_cycles = DEFAULT_CYCLES;
-    if (argc >= 3) {
-        num_cycles = atoi(argv[2]);
+    if (cycles_arg) {
+        num_cycles = atoi(cycles_arg);
         if (num_cycles <= 0) num_cycles = DEFAULT_CYCLES;
         if (num_cycles > MAX_CYCLES) num_cycles = MAX_CYCLES;
     }
@@ -169,14 +331,57 @@ int main(int argc, char* argv[]) {
     mic1_cpu cpu;
     init_mic1(&cpu);
     init_sp(&cpu);
+    cpu.fault.action = fault_action;
+    cpu.fault.trap_vector = trap_vector;
+    cpu.engine = engine;
+
+    if (engine == MIC1_ENGINE_MICROCODE && load_microprogram_file(&cpu, microcode) != 0) {
+        fprintf(stderr, "Error: Failed to load microprogram '%s'\n", microcode);
+        return 1;
+    }
+
+    static micro_profile profile;
+    if (profiling) {
+        if (engine == MIC1_ENGINE_DIRECT) {
+            fprintf(stderr, "Error: --profile needs --engine=microcode or --engine=compiled\n");
+            return 1;
+        }
+        /* The compiled engine has no control store of its own to decode */
+        if (engine == MIC1_ENGINE_COMPILED) {
+            microcode = mic1_compiled_source;
+            if (load_microprogram_file(&cpu, microcode) != 0) {
+                fprintf(stderr, "Error: Failed to load microprogram '%s'\n", microcode);
+                return 1;
+            }
+        }
+        init_profile(&profile);
+        cpu.profile = &profile;
+    }
+
+    for (int i = 0; i < watch_arg_count; i++) {
+        int start, end, kind;
+        if (parse_watch_spec(watch_args[i], &start, &end, &kind) != 0 ||
+            set_watchpoint(&cpu.watch, start, end, kind) != 0) {
+            fprintf(stderr, "Error: Invalid watchpoint '%s'\n", watch_args[i]);
+            return 1;
+        }
+    }
 
     /* Load program */
-    printf("Loading: %s\n", argv[1]);
-    if (load_program_file(&cpu, argv[1]) != 0) {
-        fprintf(stderr, "Error: Failed to load '%s'\n", argv[1]);
+    printf("Loading: %s (engine: %s)\n", program, mic1_engine_name(engine));
+    if (load_program_file(&cpu, program) != 0) {
+        fprintf(stderr, "Error: Failed to load '%s'\n", program);
         return 1;
     }
 
+    /* Read on the first trace line, and only if it exists. An object has
+     * no sidecar of its own: prog.map would belong to prog.bin. */
+    static source_map map;
+    init_source_map(&map, map_file ? map_file : program, map_file != NULL);
+    if (!map_file && is_object_file(program)) {
+        map.state = SOURCE_MAP_MISSING;
+    }
+
     /* Show loaded code */
     print_memory_dump(&cpu, "CODE", 0x000, 16);
     print_memory_dump(&cpu, "DATA", 0x064, 8);  /* Around address 100 */
@@ -199,14 +404,14 @@ int main(int argc, char* argv[]) {
     /* Execute trace loop */
     for (int cycle = 0; cycle < num_cycles; cycle++) {
         /* Print state BEFORE step */
-        print_trace_line(cycle, &cpu);
+        print_trace_line(cycle, &cpu, &map);
 
         /* Execute one step */
         step_mic1(&cpu);
 
         /* Check for halt (JUMP to self or CPU stopped) */
         int pc = REG16(cpu.reg_bank.PC);
-        int instr = MEM16(cpu.main_memory.data[pc]);
+        int instr = pc < MEMORY_SIZE ? MEM16(cpu.main_memory.data[pc]) : 0;
         int opcode = (instr >> 12) & 0xF;
         int operand = instr & 0x0FFF;
 
@@ -217,6 +422,12 @@ int main(int argc, char* argv[]) {
             break;
         }
 
+        if (cpu.stop_reason == MIC1_STOP_WATCH) {
+            printf("-------|------|------|------|------|----------|------------------\n");
+            print_watch_hit(&cpu);
+            break;
+        }
+
         if (!cpu.running || is_cpu_halted(&cpu)) {
             printf("-------|------|------|------|------|----------|------------------\n");
             printf(" ** CPU HALTED **\n");
@@ -234,11 +445,22 @@ int main(int argc, char* argv[]) {
            REG16(cpu.reg_bank.AC),
            REG16(cpu.reg_bank.SP),
            REG16(cpu.reg_bank.IR));
+    printf("  DIGEST=%016llX  (memory %016llX)\n",
+           (unsigned long long)mic1_state_digest(&cpu),
+           (unsigned long long)mem_digest(&cpu.main_memory));
+    if (cpu.fault.count > 0) {
+        print_fault(&cpu);
+    }
 
     /* Show memory regions that might have changed */
     print_memory_dump(&cpu, "DATA AFTER", 0x064, 8);
 
+    if (profiling && write_profile(&profile, microcode, profile_file) != 0) {
+        return 1;
+    }
+
     printf("\n--- END OF TRACE ---\n");
+    free_source_map(&map);
 
     return 0;
 }
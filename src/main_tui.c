@@ -3,7 +3,12 @@
  *
  * Terminal-based visual debugger using termbox2.
  *
- * Usage: ./mic1_tui <program.bin>
+ * Usage: ./mic1_tui <program.bin|program.asm> [--watch=ADDR[-END][:rwc] ...]
+ *
+ * A .asm file is assembled in memory. After an edit (e opens $EDITOR, u
+ * picks up changes saved elsewhere) only the changed lines are assembled
+ * again and only the words that differ are patched into the running CPU.
+ * A .bin shows labels and source lines when mic1asm left its .map beside it.
  *
  * Controls:
  *   s     - Step (execute 1 cycle)
@@ -11,16 +16,24 @@
  *   x     - Reset CPU
  *   +/-   - Adjust speed
  *   m     - Toggle memory view
+ *   w     - Toggle write watchpoint at memory view address
+ *   e     - Edit the .asm source, then patch the running program
+ *   u     - Reassemble the .asm source after an outside edit
  *   q/ESC - Quit
  */
 
 #include "../include/mic1.h"
+#include "../include/assembler.h"
 #include "../include/ui.h"
 #include "../include/termbox2.h"
 #include "../include/utils/conversions.h"
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/wait.h>
 #include <time.h>
+#include <unistd.h>
 
 /* Helper macros */
 #define REG16(reg) bits_to_int((reg).data, 16)
@@ -32,6 +45,15 @@ static ui_state_t ui_state;
 static int show_memory_panel = 0;
 static int memory_view_addr = 0x000;
 
+/* Program assembled from a .asm source (edit-and-continue) */
+static int from_source = 0;
+static assembler_t as;
+static uint16_t program[MAX_INSTRUCTIONS];
+static int program_size = 0;
+
+/* Source map of a .bin from mic1asm, read on the first draw */
+static source_map map;
+
 /**
  * Initialize SP to top of stack (0x0FFF)
  */
@@ -48,7 +70,11 @@ static void init_sp(mic1_cpu *cpu) {
  * Reset CPU state
  */
 static void reset_cpu(void) {
+    /* Watchpoints survive a reset */
+    watch_table saved = cpu.watch;
     init_mic1(&cpu);
+    memcpy(cpu.watch.flags, saved.flags, sizeof(saved.flags));
+    cpu.watch.active = saved.active;
     init_sp(&cpu);
     cpu.running = 1;
     ui_state.cycle_count = 0;
@@ -56,6 +82,152 @@ static void reset_cpu(void) {
     strcpy(ui_state.status_msg, "CPU Reset");
 }
 
+/**
+ * Whole file as a NUL-terminated string, or NULL
+ */
+static char *read_text(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+
+    size_t size = 0, capacity = 4096;
+    char *text = malloc(capacity);
+    size_t n;
+    while (text && (n = fread(text + size, 1, capacity - size - 1, fp)) > 0) {
+        size += n;
+        if (capacity - size - 1 == 0) {
+            char *grown = realloc(text, capacity * 2);
+            if (!grown) {
+                free(text);
+                text = NULL;
+                break;
+            }
+            text = grown;
+            capacity *= 2;
+        }
+    }
+    fclose(fp);
+    if (text) text[size] = '\0';
+    return text;
+}
+
+/**
+ * Return addresses on the stack (SP up to the 0x0FFF top) that point at
+ * old words from `from` on. They may be stale once that code has moved.
+ */
+static int stale_returns(int from, int old_size) {
+    int count = 0;
+    for (int addr = REG16(cpu.reg_bank.SP); addr >= 0 && addr < 0xFFF; addr++) {
+        int word = MEM16(cpu.main_memory.data[addr]);
+        if (word >= from && word < old_size) count++;
+    }
+    return count;
+}
+
+/**
+ * Assemble the source again and patch the words that changed into the
+ * running CPU. Code that moved takes the PC along with it; after a full
+ * reassembly there is no such mapping, so the CPU restarts.
+ */
+static int reassemble(void) {
+    char *source = read_text(ui_state.loaded_file);
+    if (!source) {
+        snprintf(ui_state.status_msg, sizeof(ui_state.status_msg), "Cannot read source");
+        return -1;
+    }
+
+    int old_size = program_size;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int result = assembler_update(&as, source, program, MAX_INSTRUCTIONS, &program_size);
+    if (result == 0) {
+        patch_program(&cpu, program, as.patched, as.patch_count);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    free(source);
+
+    if (result != 0) {
+        snprintf(ui_state.status_msg, sizeof(ui_state.status_msg), "Line %d: %.50s",
+                 as.error_line, as.error_msg);
+        return -1;
+    }
+
+    long us = (t1.tv_sec - t0.tv_sec) * 1000000L + (t1.tv_nsec - t0.tv_nsec) / 1000;
+
+    if (as.update.full && old_size > 0 && as.patch_count > 0) {
+        reset_cpu();
+        patch_program(&cpu, program, NULL, program_size);
+        snprintf(ui_state.status_msg, sizeof(ui_state.status_msg),
+                 "Reassembled %d lines, %ld us: CPU reset", as.update.reparsed, us);
+        return 0;
+    }
+
+    int stale = 0;
+    int pc = REG16(cpu.reg_bank.PC);
+    if (as.update.moved_by) {
+        if (pc >= as.update.moved_from) {
+            int_to_bits((pc + as.update.moved_by) & 0xFFF, cpu.reg_bank.PC.data, 16);
+        }
+        stale = stale_returns(as.update.moved_from, old_size);
+    }
+
+    if (stale) {
+        snprintf(ui_state.status_msg, sizeof(ui_state.status_msg),
+                 "Patched %d words; %d stack words point into moved code (x resets)",
+                 as.patch_count, stale);
+    } else {
+        snprintf(ui_state.status_msg, sizeof(ui_state.status_msg), "Patched %d words, %d lines, %ld us",
+                 as.patch_count, as.update.reparsed, us);
+    }
+    return 0;
+}
+
+/**
+ * Open the source in $EDITOR, then patch what changed
+ */
+static void edit_source(void) {
+    /* $EDITOR may carry options ("code -w"); the file name is passed as
+     * its own argument, never through a shell */
+    char editor[256];
+    char *args[16];
+    int n = 0;
+
+    snprintf(editor, sizeof(editor), "%s", getenv("EDITOR") ? getenv("EDITOR") : "");
+    for (char *word = strtok(editor, " \t"); word && n < 14; word = strtok(NULL, " \t")) {
+        args[n++] = word;
+    }
+    if (n == 0) args[n++] = "vi";
+    args[n++] = ui_state.loaded_file;
+    args[n] = NULL;
+
+    ui_shutdown();
+    int status = -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp(args[0], args);
+        _exit(127);
+    }
+    while (pid > 0 && waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    ui_init();
+
+    if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        snprintf(ui_state.status_msg, sizeof(ui_state.status_msg), "Editor exited with %d",
+                 pid > 0 && WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        return;
+    }
+    reassemble();
+}
+
+/**
+ * Resume after a watchpoint stop
+ */
+static void resume_from_watch(void) {
+    if (cpu.stop_reason == MIC1_STOP_WATCH) {
+        cpu.stop_reason = MIC1_STOP_NONE;
+        cpu.running = 1;
+    }
+}
+
 /**
  * Execute one step
  */
@@ -65,6 +237,22 @@ static void do_step(void) {
     step_mic1(&cpu);
     ui_state.cycle_count++;
 
+    if (!cpu.running && cpu.fault.kind != FAULT_NONE) {
+        ui_state.auto_run = 0;
+        snprintf(ui_state.status_msg, sizeof(ui_state.status_msg), "FAULT %s @%03X",
+                 fault_kind_name(cpu.fault.kind), cpu.fault.address & 0xFFF);
+        return;
+    }
+
+    if (cpu.stop_reason == MIC1_STOP_WATCH) {
+        ui_state.auto_run = 0;
+        snprintf(ui_state.status_msg, sizeof(ui_state.status_msg), "WATCH %s %03X: %04X->%04X",
+                 watch_kind_name(cpu.watch.hit.kind), cpu.watch.hit.address,
+                 cpu.watch.hit.old_value, cpu.watch.hit.new_value);
+        memory_view_addr = cpu.watch.hit.address & ~7;
+        return;
+    }
+
     /* Check for halt */
     int pc = REG16(cpu.reg_bank.PC);
     int instr = MEM16(cpu.main_memory.data[pc]);
@@ -109,7 +297,7 @@ static void draw_ui(void) {
     int code_x = 23;
     int code_w = 38;
     int pc = REG16(cpu.reg_bank.PC);
-    ui_draw_code(code_x, panel_y, code_w, code_h, &cpu, pc);
+    ui_draw_code(code_x, panel_y, code_w, code_h, &cpu, pc, from_source ? NULL : &map);
 
     /* Right: Stack or Memory */
     int right_x = code_x + code_w + 1;
@@ -155,12 +343,14 @@ static int handle_input(void) {
         case 's':
         case 'S':
             /* Single step */
+            resume_from_watch();
             do_step();
             break;
 
         case 'r':
         case 'R':
             /* Toggle run/pause */
+            resume_from_watch();
             ui_state.auto_run = !ui_state.auto_run;
             strcpy(ui_state.status_msg, ui_state.auto_run ? "Running..." : "Paused");
             break;
@@ -170,11 +360,28 @@ static int handle_input(void) {
             /* Reset */
             reset_cpu();
             /* Reload program */
-            if (ui_state.loaded_file[0]) {
+            if (from_source) {
+                patch_program(&cpu, program, NULL, program_size);
+            } else if (ui_state.loaded_file[0]) {
                 load_program_file(&cpu, ui_state.loaded_file);
             }
             break;
 
+        case 'e':
+        case 'E':
+            /* Edit and continue */
+            if (from_source) {
+                ui_state.auto_run = 0;
+                edit_source();
+            }
+            break;
+
+        case 'u':
+        case 'U':
+            /* Pick up an outside edit */
+            if (from_source) reassemble();
+            break;
+
         case '+':
         case '=':
             /* Speed up */
@@ -193,6 +400,21 @@ static int handle_input(void) {
             show_memory_panel = !show_memory_panel;
             break;
 
+        case 'w':
+        case 'W':
+            /* Toggle write watchpoint on the first word of the memory view */
+            if (cpu.watch.flags[memory_view_addr]) {
+                clear_watchpoint(&cpu.watch, memory_view_addr, memory_view_addr);
+                snprintf(ui_state.status_msg, sizeof(ui_state.status_msg),
+                         "Watch off %03X", memory_view_addr);
+            } else {
+                set_watchpoint(&cpu.watch, memory_view_addr, memory_view_addr, WATCH_WRITE);
+                snprintf(ui_state.status_msg, sizeof(ui_state.status_msg),
+                         "Watch write %03X", memory_view_addr);
+            }
+            show_memory_panel = 1;
+            break;
+
         case '[':
             /* Memory view: previous page */
             if (memory_view_addr >= 64) memory_view_addr -= 64;
@@ -259,37 +481,53 @@ int main(int argc, char *argv[]) {
     /* Parse arguments */
     if (argc < 2) {
         fprintf(stderr, "MIC-1 Interactive TUI\n");
-        fprintf(stderr, "Usage: %s <program.bin>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <program.bin|program.asm> [--watch=ADDR[-END][:rwc] ...]\n", argv[0]);
         fprintf(stderr, "\nControls:\n");
         fprintf(stderr, "  s     - Step (1 cycle)\n");
         fprintf(stderr, "  r     - Run/Pause\n");
         fprintf(stderr, "  x     - Reset CPU\n");
         fprintf(stderr, "  m     - Toggle memory view\n");
+        fprintf(stderr, "  w     - Toggle write watchpoint\n");
+        fprintf(stderr, "  e/u   - Edit/reload the .asm source and patch it in\n");
         fprintf(stderr, "  q/ESC - Quit\n");
         return 1;
     }
 
-    /* Check for .asm files */
-    if (has_extension(argv[1], ".asm")) {
-        fprintf(stderr, "Error: Cannot load .asm files directly.\n");
-        fprintf(stderr, "First compile with: ./mic1asm %s output.bin\n", argv[1]);
-        return 1;
-    }
-
     /* Initialize CPU */
     init_mic1(&cpu);
     init_sp(&cpu);
 
-    /* Load program */
-    if (load_program_file(&cpu, argv[1]) != 0) {
-        fprintf(stderr, "Error: Failed to load '%s'\n", argv[1]);
-        return 1;
+    for (int i = 2; i < argc; i++) {
+        int start, end, kind;
+        if (strncmp(argv[i], "--watch=", 8) != 0 ||
+            parse_watch_spec(argv[i] + 8, &start, &end, &kind) != 0 ||
+            set_watchpoint(&cpu.watch, start, end, kind) != 0) {
+            fprintf(stderr, "Error: Invalid argument '%s'\n", argv[i]);
+            return 1;
+        }
     }
 
     /* Initialize UI state */
     memset(&ui_state, 0, sizeof(ui_state));
     ui_state.speed_ms = 100;
     strncpy(ui_state.loaded_file, argv[1], sizeof(ui_state.loaded_file) - 1);
+
+    /* Load program: a .asm source is assembled here and kept for edits */
+    if (has_extension(argv[1], ".asm")) {
+        from_source = 1;
+        init_assembler(&as);
+        if (reassemble() != 0) {
+            fprintf(stderr, "Error: %s: line %d: %s\n", argv[1], as.error_line, as.error_msg);
+            return 1;
+        }
+    } else if (load_program_file(&cpu, argv[1]) != 0) {
+        fprintf(stderr, "Error: Failed to load '%s'\n", argv[1]);
+        return 1;
+    }
+    init_source_map(&map, argv[1], 0);
+    if (is_object_file(argv[1])) {
+        map.state = SOURCE_MAP_MISSING;
+    }
     strcpy(ui_state.status_msg, "Ready");
     cpu.running = 1;
 
@@ -304,6 +542,8 @@ int main(int argc, char *argv[]) {
 
     /* Cleanup */
     ui_shutdown();
+    free_assembler(&as);
+    free_source_map(&map);
 
     printf("\nExited after %d cycles.\n", ui_state.cycle_count);
     printf("Final state: PC=%04X AC=%04X SP=%04X\n",
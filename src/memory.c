@@ -2,6 +2,8 @@
 #include "../include/datapath.h"
 #include "../include/shifter.h"
 #include "../include/cache.h"
+#include "../include/fault.h"
+#include "../include/watch.h"
 #include "../include/utils/conversions.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -51,6 +53,93 @@ void init_memory(memory* mem) {
             mem->data[i][j] = 0;
         }
     }
+    for (int p = 0; p < DIGEST_PAGES; p++) {
+        mem->page_digest[p] = 0;
+    }
+    mem->digest = 0;
+    mem->fault = NULL;
+    mem->watch = NULL;
+}
+
+/* splitmix64 finaliser over (address, value); zero words hash to 0 */
+uint64_t digest_word(int addr, int value) {
+    if (value == 0) return 0;
+
+    uint64_t z = ((uint64_t)(unsigned)addr << 16) | (uint64_t)(value & 0xFFFF);
+    z += 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void update_digest(memory* mem, int addr, int old_value, int new_value) {
+    uint64_t delta = digest_word(addr, old_value) ^ digest_word(addr, new_value);
+    mem->page_digest[addr / DIGEST_PAGE_WORDS] ^= delta;
+    mem->digest ^= delta;
+}
+
+/**
+ * Recompute the digest of one page from mem->data. Only needed after words
+ * were written behind the memory system's back (program loaders, tests).
+ */
+void mem_rehash_page(memory* mem, int page) {
+    if (!mem || page < 0 || page >= DIGEST_PAGES) return;
+
+    uint64_t h = 0;
+    for (int i = 0; i < DIGEST_PAGE_WORDS; i++) {
+        int addr = page * DIGEST_PAGE_WORDS + i;
+        h ^= digest_word(addr, bits_to_int(mem->data[addr], 16));
+    }
+    mem->digest ^= mem->page_digest[page] ^ h;
+    mem->page_digest[page] = h;
+}
+
+/* Every page; see mem_rehash_page */
+void mem_rehash(memory* mem) {
+    if (!mem) return;
+
+    mem->digest = 0;
+    for (int p = 0; p < DIGEST_PAGES; p++) {
+        mem->page_digest[p] = 0;
+        mem_rehash_page(mem, p);
+    }
+}
+
+uint64_t mem_digest(const memory* mem) {
+    return mem ? mem->digest : 0;
+}
+
+uint64_t mem_page_digest(const memory* mem, int page) {
+    if (!mem || page < 0 || page >= DIGEST_PAGES) return 0;
+    return mem->page_digest[page];
+}
+
+/* Constant-time watch test; free while no watchpoint is armed */
+#define WATCHED(mem, addr) \
+    ((mem)->watch && (mem)->watch->active && (mem)->watch->flags[addr])
+
+/**
+ * Word-level access for the direct engine (bypasses MAR/MBR and cache)
+ */
+int mem_load_word(memory* mem, int addr) {
+    int value = bits_to_int(mem->data[addr], 16);
+
+    if (WATCHED(mem, addr)) {
+        watch_access(mem->watch, addr, WATCH_READ, value, value);
+    }
+    return value;
+}
+
+void mem_store_word(memory* mem, int addr, int value) {
+    int old_value = bits_to_int(mem->data[addr], 16);
+    int watched = WATCHED(mem, addr);
+
+    int_to_bits(value & 0xFFFF, mem->data[addr], 16);
+    update_digest(mem, addr, old_value, value & 0xFFFF);
+
+    if (watched) {
+        watch_access(mem->watch, addr, WATCH_WRITE, old_value, value & 0xFFFF);
+    }
 }
 
 void m_read(mar* a, mbr* b, memory* mem, cache* c) {
@@ -58,7 +147,7 @@ void m_read(mar* a, mbr* b, memory* mem, cache* c) {
 
     int addr = address_to_int(a->address);
     if (addr < 0 || addr >= MEMORY_SIZE) {
-        printf("Erro: Endereço de memória inválido: %d\n", addr);
+        raise_fault(mem->fault, FAULT_MEM_READ, addr);
         return;
     }
 
@@ -68,6 +157,11 @@ void m_read(mar* a, mbr* b, memory* mem, cache* c) {
 
         copy_data(b->data, mem->data[addr]);
     }
+
+    if (WATCHED(mem, addr)) {
+        int value = bits_to_int(b->data, 16);
+        watch_access(mem->watch, addr, WATCH_READ, value, value);
+    }
 }
 
 void m_write(mar* a, mbr* b, memory* mem, cache* c) {
@@ -75,16 +169,24 @@ void m_write(mar* a, mbr* b, memory* mem, cache* c) {
 
     int addr = address_to_int(a->address);
     if (addr < 0 || addr >= MEMORY_SIZE) {
-        printf("Erro: Endereço de memória inválido: %d\n", addr);
+        raise_fault(mem->fault, FAULT_MEM_WRITE, addr);
         return;
     }
 
+    int old_value = bits_to_int(mem->data[addr], 16);
+    int new_value = bits_to_int(b->data, 16);
+
     if (c) {
         cache_write(c, mem, a->address, b->data);
     } else {
 
         copy_data(mem->data[addr], b->data);
     }
+    update_digest(mem, addr, old_value, new_value);
+
+    if (WATCHED(mem, addr)) {
+        watch_access(mem->watch, addr, WATCH_WRITE, old_value, new_value);
+    }
 }
 
 void load_program(memory* mem, const char* filename) {
@@ -115,5 +217,6 @@ void load_program(memory* mem, const char* filename) {
     }
 
     fclose(file);
+    mem_rehash(mem);
     printf("Programa carregado: %d palavras lidas de %s\n", addr, filename);
 }
\ No newline at end of file
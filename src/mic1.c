@@ -1,10 +1,15 @@
 
 #include "../include/mic1.h"
 #include "../include/utils/conversions.h"
+#include "../include/object.h"
+#include "../include/microcode_compiled.h"
 
 void init_mic1(mic1_cpu* cpu) {
     if (!cpu) return;
+    cpu->engine = MIC1_ENGINE_DIRECT;
+    cpu->profile = NULL;
     cpu->running = 0;
+    cpu->stop_reason = MIC1_STOP_NONE;
     cpu->cycle_count = 0;
     cpu->clock = 0;
 
@@ -20,10 +25,10 @@ void init_mic1(mic1_cpu* cpu) {
     init_mmux(&cpu->mmux);
     init_amux(&cpu->amux);
     init_control_memory(&cpu->ctrl_mem);
+    init_fault_register(&cpu->fault);
+    init_watch_table(&cpu->watch);
 
-    cpu->decoder_a.rb = &cpu->reg_bank;
-    cpu->decoder_b.rb = &cpu->reg_bank;
-    cpu->decoder_c.rb = &cpu->reg_bank;
+    connect_components(cpu);
 
     for(int i = 0; i < 4; i++) {
         cpu->decoder_a.control[i] = 0;
@@ -37,6 +42,7 @@ void reset_mic1(mic1_cpu* cpu) {
     if (!cpu) return;
 
     cpu->running = 0;
+    cpu->stop_reason = MIC1_STOP_NONE;
     cpu->cycle_count = 0;
     cpu->clock = 0;
 
@@ -57,9 +63,13 @@ void reset_mic1(mic1_cpu* cpu) {
     init_mmux(&cpu->mmux);
     init_amux(&cpu->amux);
 
-    cpu->decoder_a.rb = &cpu->reg_bank;
-    cpu->decoder_b.rb = &cpu->reg_bank;
-    cpu->decoder_c.rb = &cpu->reg_bank;
+    /* Fault log is cleared; the configured action survives a reset */
+    clear_fault(&cpu->fault);
+
+    /* Watchpoints stay armed; only the last hit is forgotten */
+    memset(&cpu->watch.hit, 0, sizeof(cpu->watch.hit));
+
+    connect_components(cpu);
 
     for(int i = 0; i < 4; i++) {
         cpu->decoder_a.control[i] = 0;
@@ -69,10 +79,16 @@ void reset_mic1(mic1_cpu* cpu) {
     cpu->decoder_c.control_enc = 0;
 }
 
+/*
+ * One microcycle through the datapath. Only the units in mir.units are
+ * evaluated; the others would only overwrite latches, ALU and shifter
+ * outputs that nothing reads before the next cycle recomputes them.
+ */
 void execute_datapath(mic1_cpu* cpu) {
     if (!cpu) return;
 
     mir* m = &cpu->mir;
+    int units = m->units;
 
     if (!cpu->decoder_c.rb) {
         cpu->decoder_c.rb = &cpu->reg_bank;
@@ -85,8 +101,12 @@ void execute_datapath(mic1_cpu* cpu) {
     }
     cpu->decoder_c.control_enc = m->enc;
 
-    run_decoder(&cpu->decoder_a, &cpu->latch_a);
-    run_decoder(&cpu->decoder_b, &cpu->latch_b);
+    if (units & UNIT_BUS_A) {
+        run_decoder(&cpu->decoder_a, &cpu->latch_a);
+    }
+    if (units & UNIT_BUS_B) {
+        run_decoder(&cpu->decoder_b, &cpu->latch_b);
+    }
 
     cpu->mar.control_mar = m->mar;
     if (m->mar) {
@@ -99,17 +119,19 @@ void execute_datapath(mic1_cpu* cpu) {
     }
 
     cpu->amux.control_amux = m->amux;
-    run_amux(&cpu->amux, &cpu->mbr, &cpu->latch_a, &cpu->alu);
-
-    copy_array(cpu->latch_b.data, cpu->alu.input_b);
-
     for (int i = 0; i < 2; i++) {
         cpu->alu.control[i] = m->alu[i];
     }
-    run_alu(&cpu->alu);
+    if (units & UNIT_ALU) {
+        run_amux(&cpu->amux, &cpu->mbr, &cpu->latch_a, &cpu->alu);
+        if (units & UNIT_BUS_B) {
+            copy_array(cpu->latch_b.data, cpu->alu.input_b);
+        }
+        run_alu(&cpu->alu);
 
-    cpu->mmux.alu_n = cpu->alu.flag_n;
-    cpu->mmux.alu_z = cpu->alu.flag_z;
+        cpu->mmux.alu_n = cpu->alu.flag_n;
+        cpu->mmux.alu_z = cpu->alu.flag_z;
+    }
 
     for (int i = 0; i < 2; i++) {
         cpu->mmux.control_cond[i] = m->cond[i];
@@ -118,9 +140,10 @@ void execute_datapath(mic1_cpu* cpu) {
     for (int i = 0; i < 2; i++) {
         cpu->shifter.control_sh[i] = m->sh[i];
     }
-    copy_array(cpu->alu.output, cpu->shifter.data);
-
-    run_shifter(&cpu->shifter, &cpu->mbr, &cpu->bus_c);
+    if (units & UNIT_SHIFTER) {
+        copy_array(cpu->alu.output, cpu->shifter.data);
+        run_shifter(&cpu->shifter, &cpu->mbr, &cpu->bus_c);
+    }
 
     cpu->mbr.control_mbr = m->mbr;
     if (m->mbr) {
@@ -128,7 +151,9 @@ void execute_datapath(mic1_cpu* cpu) {
         copy_array(cpu->shifter.data, cpu->mbr.data);
     }
 
-    run_decoderC(&cpu->decoder_c, &cpu->shifter);
+    if (units & UNIT_BUS_C) {
+        run_decoderC(&cpu->decoder_c, &cpu->shifter);
+    }
 
     cpu->mbr.control_wr = m->wr;
     if (m->wr) {
@@ -137,13 +162,75 @@ void execute_datapath(mic1_cpu* cpu) {
     }
 }
 
+/**
+ * Take pending faults and watchpoint hits raised during the cycle/step
+ */
+static void check_stop_conditions(mic1_cpu* cpu, int cycle) {
+    if (cpu->fault.pending) {
+        take_fault(cpu, cycle);
+    }
+
+    if (cpu->watch.hit.pending) {
+        cpu->watch.hit.pending = 0;
+        cpu->watch.hit.cycle = cycle;
+        cpu->watch.hit.pc = bits_to_int(cpu->reg_bank.PC.data, 16);
+        cpu->running = 0;
+        cpu->stop_reason = MIC1_STOP_WATCH;
+    }
+}
+
+/**
+ * Profiler hook, before a microcycle: returns the MPC and, at the start
+ * of an instruction, tells the profiler which one (the word at PC)
+ */
+static int profile_enter(mic1_cpu* cpu) {
+    int mpc = bits_to_int(cpu->mpc.address, MICROADDR_BITS);
+
+    if (mpc == 0) {
+        int pc = bits_to_int(cpu->reg_bank.PC.data, 16);
+        profile_instruction(cpu->profile,
+                            pc < MEMORY_SIZE ? bits_to_int(cpu->main_memory.data[pc], 16) : -1);
+    }
+    return mpc;
+}
+
 void run_mic1_cycle(mic1_cpu* cpu) {
     if (!cpu) return;
 
+    int mpc = cpu->profile ? profile_enter(cpu) : 0;
+
     fetch_microinstruction(&cpu->ctrl_mem, &cpu->mpc, &cpu->mir);
     execute_datapath(cpu);
     update_control(&cpu->mpc, &cpu->mmux, &cpu->mir, &cpu->mbr);
 
+    if (cpu->profile) {
+        profile_microcycle(cpu->profile, &cpu->ctrl_mem, mpc,
+                           bits_to_int(cpu->mpc.address, MICROADDR_BITS));
+    }
+
+    check_stop_conditions(cpu, cpu->cycle_count);
+
+    cpu->cycle_count++;
+    cpu->clock++;
+}
+
+/**
+ * One microcycle through the code generated by mic1mcc. Architectural
+ * effects match run_mic1_cycle for the same control store.
+ */
+void run_compiled_cycle(mic1_cpu* cpu) {
+    if (!cpu) return;
+
+    int mpc = cpu->profile ? profile_enter(cpu) : bits_to_int(cpu->mpc.address, MICROADDR_BITS);
+    int next = mic1_compiled_execute(cpu, mpc);
+    int_to_bits(next, cpu->mpc.address, MICROADDR_BITS);
+
+    if (cpu->profile) {
+        profile_microcycle(cpu->profile, &cpu->ctrl_mem, mpc, next);
+    }
+
+    check_stop_conditions(cpu, cpu->cycle_count);
+
     cpu->cycle_count++;
     cpu->clock++;
 }
@@ -164,11 +251,12 @@ static void execute_instruction_direct(mic1_cpu* cpu) {
     /* Fetch instruction at PC */
     int pc = bits_to_int(cpu->reg_bank.PC.data, 16);
     if (pc >= MEMORY_SIZE) {
-        cpu->running = 0;
-        return;
+        raise_fault(&cpu->fault, FAULT_PC_BOUNDS, pc);
+        if (cpu->fault.action != FAULT_ACTION_IGNORE) return;
+        pc &= 0xFFF;
     }
 
-    int instr = bits_to_int(cpu->main_memory.data[pc], 16);
+    int instr = mem_load_word(&cpu->main_memory, pc);
     int opcode = (instr >> 12) & 0xF;
     int operand = instr & 0x0FFF;
 
@@ -187,21 +275,21 @@ static void execute_instruction_direct(mic1_cpu* cpu) {
 
     switch (opcode) {
         case 0x0:  /* LODD - Load Direct: AC <- M[addr] */
-            mem_val = bits_to_int(cpu->main_memory.data[operand], 16);
+            mem_val = mem_load_word(&cpu->main_memory, operand);
             new_ac = mem_val;
             break;
 
         case 0x1:  /* STOD - Store Direct: M[addr] <- AC */
-            int_to_bits(ac, cpu->main_memory.data[operand], 16);
+            mem_store_word(&cpu->main_memory, operand, ac);
             break;
 
         case 0x2:  /* ADDD - Add Direct: AC <- AC + M[addr] */
-            mem_val = bits_to_int(cpu->main_memory.data[operand], 16);
+            mem_val = mem_load_word(&cpu->main_memory, operand);
             new_ac = (ac + mem_val) & 0xFFFF;
             break;
 
         case 0x3:  /* SUBD - Subtract Direct: AC <- AC - M[addr] */
-            mem_val = bits_to_int(cpu->main_memory.data[operand], 16);
+            mem_val = mem_load_word(&cpu->main_memory, operand);
             new_ac = (ac - mem_val) & 0xFFFF;
             break;
 
@@ -228,24 +316,24 @@ static void execute_instruction_direct(mic1_cpu* cpu) {
 
         case 0x8:  /* LODL - Load Local: AC <- M[SP + offset] */
             mem_addr = (sp + operand) & 0xFFF;
-            mem_val = bits_to_int(cpu->main_memory.data[mem_addr], 16);
+            mem_val = mem_load_word(&cpu->main_memory, mem_addr);
             new_ac = mem_val;
             break;
 
         case 0x9:  /* STOL - Store Local: M[SP + offset] <- AC */
             mem_addr = (sp + operand) & 0xFFF;
-            int_to_bits(ac, cpu->main_memory.data[mem_addr], 16);
+            mem_store_word(&cpu->main_memory, mem_addr, ac);
             break;
 
         case 0xA:  /* ADDL - Add Local: AC <- AC + M[SP + offset] */
             mem_addr = (sp + operand) & 0xFFF;
-            mem_val = bits_to_int(cpu->main_memory.data[mem_addr], 16);
+            mem_val = mem_load_word(&cpu->main_memory, mem_addr);
             new_ac = (ac + mem_val) & 0xFFFF;
             break;
 
         case 0xB:  /* SUBL - Subtract Local: AC <- AC - M[SP + offset] */
             mem_addr = (sp + operand) & 0xFFF;
-            mem_val = bits_to_int(cpu->main_memory.data[mem_addr], 16);
+            mem_val = mem_load_word(&cpu->main_memory, mem_addr);
             new_ac = (ac - mem_val) & 0xFFFF;
             break;
 
@@ -263,21 +351,57 @@ static void execute_instruction_direct(mic1_cpu* cpu) {
             break;
 
         case 0xE:  /* CALL - Call subroutine: SP <- SP - 1; M[SP] <- PC + 1; PC <- addr */
-            new_sp = (sp - 1) & 0xFFF;
-            int_to_bits(pc + 1, cpu->main_memory.data[new_sp], 16);
+            new_sp = (sp - 1) & 0xFFFF;
+            mem_store_word(&cpu->main_memory, new_sp & 0xFFF, pc + 1);
             next_pc = operand;
             break;
 
-        case 0xF:  /* PSHI - Push Indirect: SP <- SP - 1; M[SP] <- M[AC] */
-            new_sp = (sp - 1) & 0xFFF;
-            mem_val = bits_to_int(cpu->main_memory.data[ac & 0xFFF], 16);
-            int_to_bits(mem_val, cpu->main_memory.data[new_sp], 16);
+        case 0xF:  /* Special group: sub-opcode in bits 11-8, 8-bit operand */
+            switch (operand >> 8) {
+                case 0x0:  /* PSHI - Push Indirect: SP <- SP - 1; M[SP] <- M[AC] */
+                    new_sp = (sp - 1) & 0xFFFF;
+                    mem_store_word(&cpu->main_memory, new_sp & 0xFFF,
+                                   mem_load_word(&cpu->main_memory, ac & 0xFFF));
+                    break;
+
+                case 0x2:  /* POPI - Pop Indirect: M[AC] <- M[SP]; SP <- SP + 1 */
+                    mem_store_word(&cpu->main_memory, ac & 0xFFF,
+                                   mem_load_word(&cpu->main_memory, sp & 0xFFF));
+                    new_sp = (sp + 1) & 0xFFFF;
+                    break;
+
+                case 0x4:  /* PUSH - SP <- SP - 1; M[SP] <- AC */
+                    new_sp = (sp - 1) & 0xFFFF;
+                    mem_store_word(&cpu->main_memory, new_sp & 0xFFF, ac);
+                    break;
+
+                case 0x6:  /* POP - AC <- M[SP]; SP <- SP + 1 */
+                    new_ac = mem_load_word(&cpu->main_memory, sp & 0xFFF);
+                    new_sp = (sp + 1) & 0xFFFF;
+                    break;
+
+                case 0x8:  /* RETN - Return: PC <- M[SP]; SP <- SP + 1 */
+                    next_pc = mem_load_word(&cpu->main_memory, sp & 0xFFF) & 0xFFF;
+                    new_sp = (sp + 1) & 0xFFFF;
+                    break;
+
+                case 0xA:  /* SWAP - AC <-> SP */
+                    new_ac = sp;
+                    new_sp = ac;
+                    break;
+
+                case 0xC:  /* INSP - Increment SP: SP <- SP + y */
+                    new_sp = (sp + (operand & 0xFF)) & 0xFFFF;
+                    break;
+
+                case 0xE:  /* DESP - Decrement SP: SP <- SP - y */
+                    new_sp = (sp - (operand & 0xFF)) & 0xFFFF;
+                    break;
+
+                default:   /* Odd sub-opcodes: a NOP, as in data/mic1.mal */
+                    break;
+            }
             break;
-
-        default:
-            /* Unknown opcode - halt */
-            cpu->running = 0;
-            return;
     }
 
     /* Update registers */
@@ -288,10 +412,53 @@ static void execute_instruction_direct(mic1_cpu* cpu) {
     cpu->cycle_count++;
 }
 
+/* Run microcycles until the microprogram is back at its fetch (MPC 0) */
+static void step_microcoded(mic1_cpu* cpu, void (*cycle)(mic1_cpu*)) {
+    int was_running = cpu->running;
+
+    for (int i = 0; i < MIC1_MAX_MICROSTEPS; i++) {
+        cycle(cpu);
+        if (bits_to_int(cpu->mpc.address, MICROADDR_BITS) == 0) break;
+        if (was_running && !cpu->running) break;
+    }
+}
+
 void step_mic1(mic1_cpu* cpu) {
     if (!cpu) return;
-    /* Use direct execution for now (microprogram not loaded) */
-    execute_instruction_direct(cpu);
+
+    switch (cpu->engine) {
+        case MIC1_ENGINE_MICROCODE:
+            step_microcoded(cpu, run_mic1_cycle);
+            break;
+
+        case MIC1_ENGINE_COMPILED:
+            step_microcoded(cpu, run_compiled_cycle);
+            break;
+
+        default: {
+            int cycle = cpu->cycle_count;
+            execute_instruction_direct(cpu);
+            check_stop_conditions(cpu, cycle);
+            break;
+        }
+    }
+}
+
+int mic1_engine_from_name(const char* name) {
+    if (!name) return -1;
+    if (strcmp(name, "direct") == 0) return MIC1_ENGINE_DIRECT;
+    if (strcmp(name, "microcode") == 0) return MIC1_ENGINE_MICROCODE;
+    if (strcmp(name, "compiled") == 0) return MIC1_ENGINE_COMPILED;
+    return -1;
+}
+
+const char* mic1_engine_name(int engine) {
+    switch (engine) {
+        case MIC1_ENGINE_DIRECT:    return "direct";
+        case MIC1_ENGINE_MICROCODE: return "microcode";
+        case MIC1_ENGINE_COMPILED:  return "compiled";
+        default:                    return "unknown";
+    }
 }
 
 void print_cpu_state(mic1_cpu* cpu) {
@@ -350,14 +517,70 @@ void print_microinstruction(mir* mir) {
 }
 
 int load_microprogram_file(mic1_cpu* cpu, const char* filename) {
-    if (!cpu || !filename) return 0;
-    printf("Loading microprogram: %s\n", filename);
-    return 1;
+    if (!cpu || !filename) return -1;
+
+    init_control_memory(&cpu->ctrl_mem);
+    cpu->ctrl_mem.fault = &cpu->fault;
+
+    return load_microprogram(&cpu->ctrl_mem, filename) > 0 ? 0 : -1;
+}
+
+/*
+ * Relocate a .o image to its load address and start the CPU at its
+ * entry point. Unresolved symbols are an error: link with mic1ld first.
+ */
+static int load_object_file(mic1_cpu* cpu, const char* filename) {
+    mic1_object obj;
+    if (read_object_file(&obj, filename) != 0) return -1;
+
+    uint16_t image[MEMORY_SIZE];
+    char error[128];
+    int base = obj.load_address;
+    int end = object_image(&obj, base, image, MEMORY_SIZE, error, sizeof(error));
+    int entry = base + obj.entry;
+    free_object(&obj);
+
+    if (end < 0) {
+        fprintf(stderr, "Error: %s: %s\n", filename, error);
+        return -1;
+    }
+
+    load_program_image(cpu, image + base, base, end - base);
+    int_to_bits(entry & 0xFFF, cpu->reg_bank.PC.data, 16);
+    return 0;
+}
+
+/*
+ * Store `size` words of a program image from `base` on, as patch_program
+ * does: no watchpoint fires and cached copies are updated, so it is safe
+ * on a CPU that has run. An image past the end of memory is an error and
+ * nothing is stored.
+ */
+int load_program_image(mic1_cpu* cpu, const uint16_t* image, int base, int size) {
+    if (!cpu || !image || base < 0 || size < 0 || base + size > MEMORY_SIZE) return -1;
+
+    for (int i = 0; i < size; i++) {
+        int address[12], data[16];
+
+        int_to_address(base + i, address);
+        int_to_bits(image[i], data, 16);
+        cache_write(&cpu->unified_cache, &cpu->main_memory, address, data);
+    }
+    /* Only the pages the image covers */
+    int last = (base + size - 1) / DIGEST_PAGE_WORDS;
+    for (int page = base / DIGEST_PAGE_WORDS; size > 0 && page <= last; page++) {
+        mem_rehash_page(&cpu->main_memory, page);
+    }
+    return 0;
 }
 
 int load_program_file(mic1_cpu* cpu, const char* filename) {
     if (!cpu || !filename) return -1;
 
+    if (is_object_file(filename)) {
+        return load_object_file(cpu, filename);
+    }
+
     FILE* fp = fopen(filename, "rb");
     if (!fp) {
         fprintf(stderr, "Error: Cannot open file '%s'\n", filename);
@@ -375,30 +598,109 @@ int load_program_file(mic1_cpu* cpu, const char* filename) {
         return -1;
     }
 
-    /* Read 16-bit instructions (big-endian) */
-    int address = 0;
+    /* Read 16-bit instructions */
+    uint16_t image[MEMORY_SIZE];
+    int size = 0;
     unsigned char buf[2];
 
-    while (fread(buf, 1, 2, fp) == 2 && address < MEMORY_SIZE) {
+    while (size < MEMORY_SIZE && fread(buf, 1, 2, fp) == 2) {
         /* Little-endian: low byte first (matches assembler output) */
-        int instruction = (buf[1] << 8) | buf[0];
-
-        /* Convert to bit array (MSB first) */
-        for (int i = 0; i < 16; i++) {
-            cpu->main_memory.data[address][i] = (instruction >> (15 - i)) & 1;
-        }
-        address++;
+        image[size++] = (uint16_t)((buf[1] << 8) | buf[0]);
     }
 
     fclose(fp);
-    return 0;  /* Success */
+    return load_program_image(cpu, image, 0, size);
+}
+
+/**
+ * Edit-and-continue: store image[addr] at each listed address (the first
+ * `count` words when addresses is NULL). Registers and all other words
+ * are left alone, no watchpoint fires, and cached copies are updated.
+ */
+void patch_program(mic1_cpu* cpu, const uint16_t* image, const uint16_t* addresses, int count) {
+    if (!cpu || !image) return;
+
+    unsigned char touched[DIGEST_PAGES] = { 0 };
+    for (int i = 0; i < count; i++) {
+        int addr = (addresses ? addresses[i] : i) & 0xFFF;
+        int address[12], data[16];
+
+        int_to_address(addr, address);
+        int_to_bits(image[addr], data, 16);
+        cache_write(&cpu->unified_cache, &cpu->main_memory, address, data);
+        touched[addr / DIGEST_PAGE_WORDS] = 1;
+    }
+    for (int page = 0; page < DIGEST_PAGES; page++) {
+        if (touched[page]) mem_rehash_page(&cpu->main_memory, page);
+    }
+}
+
+/**
+ * 64-bit digest of the architectural state: the running memory digest
+ * folded with PC, AC, SP and IR. Scratch registers, masks and TIR are
+ * microcode internals the direct engine never writes, so they are left
+ * out: every engine digests the same state alike. Constant cost.
+ */
+uint64_t mic1_state_digest(const mic1_cpu* cpu) {
+    if (!cpu) return 0;
+
+    const mic1_register* regs[] = {
+        &cpu->reg_bank.PC, &cpu->reg_bank.AC, &cpu->reg_bank.SP, &cpu->reg_bank.IR
+    };
+
+    uint64_t h = mem_digest(&cpu->main_memory);
+    for (int i = 0; i < 4; i++) {
+        h ^= digest_word(MEMORY_SIZE + i, bits_to_int((int*)regs[i]->data, 16));
+    }
+    return h;
 }
 
 void connect_components(mic1_cpu* cpu) {
     if (!cpu) return;
+
+    cpu->decoder_a.rb = &cpu->reg_bank;
+    cpu->decoder_b.rb = &cpu->reg_bank;
+    cpu->decoder_c.rb = &cpu->reg_bank;
+
+    /* Every unit that can fault reports into the CPU's fault register */
+    cpu->decoder_a.fault = &cpu->fault;
+    cpu->decoder_b.fault = &cpu->fault;
+    cpu->decoder_c.fault = &cpu->fault;
+    cpu->main_memory.fault = &cpu->fault;
+    cpu->main_memory.watch = &cpu->watch;
+    cpu->ctrl_mem.fault = &cpu->fault;
+    cpu->mmux.cm = &cpu->ctrl_mem;
 }
 
 int is_cpu_halted(mic1_cpu* cpu) {
     if (!cpu) return 1;
     return !cpu->running;
 }
+
+/**
+ * Apply the configured fault action to a pending fault.
+ * Called by the engines at the end of the cycle/step numbered `cycle`;
+ * never does I/O.
+ */
+void take_fault(mic1_cpu* cpu, int cycle) {
+    if (!cpu || !cpu->fault.pending) return;
+
+    fault_register* f = &cpu->fault;
+    f->pending = 0;
+    f->cycle = cycle;
+    f->pc = bits_to_int(cpu->reg_bank.PC.data, 16);
+
+    switch (f->action) {
+        case FAULT_ACTION_TRAP:
+            int_to_bits(f->trap_vector, cpu->reg_bank.PC.data, 16);
+            init_mpc(&cpu->mpc);
+            break;
+        case FAULT_ACTION_IGNORE:
+            break;
+        case FAULT_ACTION_HALT:
+        default:
+            cpu->running = 0;
+            cpu->stop_reason = MIC1_STOP_FAULT;
+            break;
+    }
+}
@@ -4,37 +4,122 @@
 #include <stdint.h>
 #include <string.h>
 #include "../include/assembler.h"
+#include "../include/control_unit.h"
+#include "../include/microanalysis.h"
+#include "../include/microcode_compiled.h"
 
 void print_usage(const char* prog_name) {
     printf("MIC-1 Assembler v1.0\n");
-    printf("Usage: %s <input.asm> [output.bin]\n", prog_name);
+    printf("Usage: %s [-c | -O [--microcode=FILE]] <input.asm> [output.bin]\n", prog_name);
     printf("\n");
     printf("If output file is not specified, uses input name with .bin extension\n");
+    printf("  -c   Emit a relocatable object (.o) for mic1ld instead of a raw image\n");
+    printf("  -O   Peephole pass: drop redundant STOD/LODD, JUMP to next, INSP/DESP pairs\n");
+    printf("       and shortcut jump chains; reports the microcycles saved\n");
+    printf("  --microcode=FILE  control store the savings are costed with\n");
+    printf("                    (default: the one the compiled engine was built from)\n");
+    printf("Input '-' reads the source from standard input; the output must be named\n");
     printf("\n");
     printf("Example:\n");
     printf("  %s program.asm program.bin\n", prog_name);
     printf("  %s program.asm              (outputs to program.bin)\n", prog_name);
+    printf("  %s -c lib.asm               (outputs to lib.o)\n", prog_name);
+    printf("  %s -O program.asm           (optimised program.bin)\n", prog_name);
+    printf("  gen | %s - program.bin\n", prog_name);
+}
+
+/*
+ * What -O changed, and the microcycles that no longer run each time
+ * control passes through the changed code (a shortcut jump saves its
+ * JUMP only when taken). Costs are mic1mca's worst case per opcode.
+ */
+static void print_optimization(const optimize_t* stats, const char* microcode) {
+    static control_memory cm;
+    static mca_report report;
+
+    printf("Peephole: %d instructions removed\n", stats->removed);
+    printf("  STOD X, LODD X   %d\n", stats->store_loads);
+    printf("  JUMP to next     %d\n", stats->jumps_to_next);
+    printf("  INSP N, DESP N   %d pairs\n", stats->stack_pairs);
+    printf("  Jump chains      %d shortened\n", stats->jump_chains);
+    if (stats->blocked_line) {
+        printf("  Nothing moved: line %d uses a number as an address in the code\n",
+               stats->blocked_line);
+    }
+
+    init_control_memory(&cm);
+    if (load_microprogram(&cm, microcode) <= 0) {
+        fprintf(stderr, "Warning: No cycle costs without the control store %s\n", microcode);
+        return;
+    }
+    mca_analyze(&cm, &report);
+
+    long saved = 0;
+    int unbounded = 0;
+    for (int key = 0; key < 256; key++) {
+        if (stats->skipped[key] == 0) continue;
+
+        int cycles = mca_instruction_cycles(&report, key << 8);
+        if (cycles < 0) {
+            unbounded += stats->skipped[key];
+        } else {
+            saved += (long)cycles * stats->skipped[key];
+        }
+    }
+    printf("  Saved per pass   %ld microcycles (%s)\n", saved, microcode);
+    if (unbounded) {
+        printf("  Not costed       %d instructions whose microcode loops\n", unbounded);
+    }
 }
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
+    int object = 0;
+    int optimize = 0;
+    const char* microcode = mic1_compiled_source;
+    int arg = 1;
+
+    while (arg < argc && argv[arg][0] == '-' && argv[arg][1] != '\0') {
+        if (strcmp(argv[arg], "-c") == 0) {
+            object = 1;
+        } else if (strcmp(argv[arg], "-O") == 0) {
+            optimize = 1;
+        } else if (strncmp(argv[arg], "--microcode=", 12) == 0) {
+            microcode = argv[arg] + 12;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+        arg++;
+    }
+
+    if (object && optimize) {
+        fprintf(stderr, "Error: -O applies to raw images, not to objects (-c)\n");
+        return 1;
+    }
+
+    if (argc - arg < 1) {
         print_usage(argv[0]);
         return 1;
     }
 
-    const char* input_file = argv[1];
+    const char* input_file = argv[arg];
+    const char* out_ext = object ? ".o" : ".bin";
     char output_file[512];
 
-    if (argc >= 3) {
-        strncpy(output_file, argv[2], sizeof(output_file) - 1);
+    if (argc - arg >= 2) {
+        strncpy(output_file, argv[arg + 1], sizeof(output_file) - 1);
+    } else if (strcmp(input_file, "-") == 0) {
+        print_usage(argv[0]);
+        return 1;
     } else {
 
         strncpy(output_file, input_file, sizeof(output_file) - 1);
+        output_file[sizeof(output_file) - 5] = '\0';
         char* ext = strrchr(output_file, '.');
         if (ext && strcmp(ext, ".asm") == 0) {
-            strcpy(ext, ".bin");
+            strcpy(ext, out_ext);
         } else {
-            strcat(output_file, ".bin");
+            strcat(output_file, out_ext);
         }
     }
     output_file[sizeof(output_file) - 1] = '\0';
@@ -46,7 +131,14 @@ int main(int argc, char* argv[]) {
     printf("Output: %s\n", output_file);
     printf("───────────────────────────────────────\n");
 
-    int result = assemble_file(input_file, output_file);
+    optimize_t stats;
+    int result = object   ? assemble_object_file(input_file, output_file)
+               : optimize ? assemble_file_optimized(input_file, output_file, &stats)
+                          : assemble_file(input_file, output_file);
+
+    if (result == 0 && optimize) {
+        print_optimization(&stats, microcode);
+    }
 
     if (result == 0) {
         printf("───────────────────────────────────────\n");
@@ -0,0 +1,97 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/control_unit.h"
+#include "../include/control_store.h"
+
+/*
+ * Control-store converter: text microprogram <-> binary .mcs file.
+ * The binary form carries the predecoded micro_op table and the
+ * dispatch table by default so that loading it needs no decoding at all.
+ */
+
+void print_usage(const char* prog_name) {
+    printf("MIC-1 Control Store Converter v1.0\n");
+    printf("Usage: %s [-n] <microcode.txt> <output.mcs>\n", prog_name);
+    printf("       %s -d <microcode.mcs> <output.txt>\n", prog_name);
+    printf("\n");
+    printf("  -n   Do not store the predecoded table (smaller file)\n");
+    printf("  -d   Convert a binary control store back to text\n");
+}
+
+static int write_text(const control_memory* cm, int count, const char* source, const char* filename) {
+    FILE* fp = fopen(filename, "w");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot create output file: %s\n", filename);
+        return -1;
+    }
+
+    fprintf(fp, "# Converted from %s by mic1cs\n", source);
+    if (cm->size != CLASSIC_STORE_SIZE) {
+        fprintf(fp, "@size %d\n", cm->size);
+    }
+    for (int i = 0; i < count; i++) {
+        if (cm->ext[i]) {
+            for (int bit = 7; bit >= 0; bit--) {
+                fputc('0' + ((cm->ext[i] >> bit) & 1), fp);
+            }
+            fputc(' ', fp);
+        }
+        for (int j = 0; j < 32; j++) {
+            fputc('0' + cm->microinstructions[i][j], fp);
+        }
+        fprintf(fp, "\n");
+    }
+
+    fprintf(fp, "@dispatch_bits %d\n", cm->dispatch_bits);
+    for (int key = 0; key < (1 << cm->dispatch_bits); key++) {
+        fprintf(fp, "@dispatch 0x%02X 0x%02X\n", key, cm->dispatch[key]);
+    }
+
+    int failed = ferror(fp);
+    fclose(fp);
+    return failed ? -1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    int flags = CS_FLAG_PREDECODED | CS_FLAG_DISPATCH;
+    int dump = 0;
+    int arg = 1;
+
+    while (arg < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-n") == 0) {
+            flags &= ~CS_FLAG_PREDECODED;
+        } else if (strcmp(argv[arg], "-d") == 0) {
+            dump = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+        arg++;
+    }
+
+    if (argc - arg != 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    static control_memory cm;
+    init_control_memory(&cm);
+
+    int count = load_microprogram(&cm, argv[arg]);
+    if (count < 0) {
+        return 1;
+    }
+
+    int result = dump ? write_text(&cm, count, argv[arg], argv[arg + 1])
+                      : save_control_store(&cm, count, flags, argv[arg + 1]);
+    if (result != 0) {
+        fprintf(stderr, "Error: Failed writing %s\n", argv[arg + 1]);
+        remove(argv[arg + 1]);
+        return 1;
+    }
+
+    printf("Converted %d microinstructions: %s -> %s\n", count, argv[arg], argv[arg + 1]);
+    return 0;
+}
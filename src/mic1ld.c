@@ -0,0 +1,126 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../include/object.h"
+#include "../include/memory.h"
+
+void print_usage(const char* prog_name) {
+    printf("MIC-1 Linker v1.0\n");
+    printf("Usage: %s [-b base] [-o output] <input.o> [input.o ...]\n", prog_name);
+    printf("\n");
+    printf("Objects are placed one after another starting at the base address\n");
+    printf("(default 0). A .bin output is a raw image padded from address 0;\n");
+    printf("any other output name produces a linked object that the simulator\n");
+    printf("relocates to the base address when it loads it.\n");
+    printf("\n");
+    printf("Example:\n");
+    printf("  %s -o program.bin main.o lib.o\n", prog_name);
+    printf("  %s -b 0x100 -o program.o main.o lib.o\n", prog_name);
+}
+
+static int has_extension(const char* name, const char* ext) {
+    size_t n = strlen(name), e = strlen(ext);
+    return n >= e && strcmp(name + n - e, ext) == 0;
+}
+
+static int write_image(const mic1_object* obj, int base, const char* filename) {
+    static uint16_t image[MEMORY_SIZE];
+    char error[128];
+
+    int end = object_image(obj, base, image, MEMORY_SIZE, error, sizeof(error));
+    if (end < 0) {
+        fprintf(stderr, "Error: %s\n", error);
+        return -1;
+    }
+
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot create output file: %s\n", filename);
+        return -1;
+    }
+
+    /* Little-endian words, same as mic1asm output */
+    for (int address = 0; address < end; address++) {
+        fputc(image[address] & 0xFF, fp);
+        fputc(image[address] >> 8, fp);
+    }
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    const char* output_file = "a.bin";
+    int base = 0;
+    int arg = 1;
+
+    while (arg < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-o") == 0 && arg + 1 < argc) {
+            output_file = argv[arg + 1];
+            arg += 2;
+        } else if (strcmp(argv[arg], "-b") == 0 && arg + 1 < argc) {
+            char* end;
+            base = (int)strtol(argv[arg + 1], &end, 0);
+            if (*end != '\0' || base < 0 || base >= MEMORY_SIZE) {
+                fprintf(stderr, "Error: Invalid base address '%s'\n", argv[arg + 1]);
+                return 1;
+            }
+            arg += 2;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    int count = argc - arg;
+    if (count < 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    mic1_object* inputs = calloc((size_t)count, sizeof(mic1_object));
+    if (!inputs) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 1;
+    }
+
+    int result = 0;
+    int loaded = 0;
+    for (; loaded < count; loaded++) {
+        if (read_object_file(&inputs[loaded], argv[arg + loaded]) != 0) {
+            result = 1;
+            break;
+        }
+    }
+
+    mic1_object linked;
+    char error[128];
+    init_object(&linked);
+
+    if (result == 0 && link_objects(&linked, inputs, count, error, sizeof(error)) != 0) {
+        fprintf(stderr, "Error: %s\n", error);
+        result = 1;
+    }
+
+    if (result == 0) {
+        linked.load_address = (uint16_t)base;
+        if (has_extension(output_file, ".bin")) {
+            result = write_image(&linked, base, output_file) != 0;
+        } else {
+            result = write_object_file(&linked, output_file) != 0;
+        }
+    }
+
+    if (result == 0) {
+        printf("Linked %d object(s): %d words at %03X -> %s\n",
+               count, object_size(&linked), base, output_file);
+    }
+
+    free_object(&linked);
+    for (int i = 0; i < loaded; i++) {
+        free_object(&inputs[i]);
+    }
+    free(inputs);
+    return result;
+}
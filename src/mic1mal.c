@@ -0,0 +1,91 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/microasm.h"
+
+void print_usage(const char* prog_name) {
+    printf("MIC-1 Micro-Assembler v1.0\n");
+    printf("Usage: %s <input.mal> [output.txt]\n", prog_name);
+    printf("\n");
+    printf("Assembles symbolic microcode into a control-store text file that\n");
+    printf("the simulator loads with --microcode=, including the opcode\n");
+    printf("dispatch table (@dispatch lines).\n");
+    printf("\n");
+    printf("Example:\n");
+    printf("  %s data/mic1.mal data/mic1_microcode.txt\n", prog_name);
+}
+
+static char* read_file(const char* filename) {
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot open input file: %s\n", filename);
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char* text = malloc((size_t)size + 1);
+    if (text) {
+        size_t n = fread(text, 1, (size_t)size, fp);
+        text[n] = '\0';
+    }
+    fclose(fp);
+    return text;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const char* input_file = argv[1];
+    char output_file[256];
+
+    if (argc >= 3) {
+        snprintf(output_file, sizeof(output_file), "%s", argv[2]);
+    } else {
+        /* input.mal -> input.txt */
+        snprintf(output_file, sizeof(output_file), "%s", input_file);
+        char* dot = strrchr(output_file, '.');
+        if (dot && !strchr(dot, '/')) *dot = '\0';
+        strncat(output_file, ".txt", sizeof(output_file) - strlen(output_file) - 1);
+    }
+
+    char* source = read_file(input_file);
+    if (!source) return 1;
+
+    static mal_program prog;
+    if (mal_assemble(source, &prog) != 0) {
+        fprintf(stderr, "Assembly failed with %d error(s)\n", prog.error_count);
+        free(source);
+        return 1;
+    }
+
+    FILE* out = fopen(output_file, "w");
+    if (!out) {
+        fprintf(stderr, "Error: Cannot create output file: %s\n", output_file);
+        free(source);
+        return 1;
+    }
+    int result = mal_write_control_store(&prog, source, input_file, out);
+    fclose(out);
+    free(source);
+
+    if (result != 0) {
+        fprintf(stderr, "Error: Failed writing %s\n", output_file);
+        remove(output_file);
+        return 1;
+    }
+
+    int used = 0, dispatched = 0;
+    for (int i = 0; i < MICROPROGRAM_SIZE; i++) used += prog.line[i] != 0;
+    for (int i = 0; i < DISPATCH_TABLE_SIZE; i++) dispatched += prog.dispatch[i] >= 0;
+
+    printf("Assembled %d microinstructions (%d dispatch entries): %s -> %s\n",
+           used, dispatched, input_file, output_file);
+    return 0;
+}
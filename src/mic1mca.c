@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/control_unit.h"
+#include "../include/microanalysis.h"
+
+/*
+ * Static microcode analyzer: per-opcode cycle costs for every N/Z path,
+ * dead code, microinstructions that write nothing and fall-through
+ * hazards, without running a program.
+ */
+
+void print_usage(const char* prog_name) {
+    printf("MIC-1 Microcode Analyzer v1.0\n");
+    printf("Usage: %s [-t] <microcode.txt|.mcs> [output]\n", prog_name);
+    printf("\n");
+    printf("  -t   Write only the cost table (fetch and one line per dispatch key)\n");
+    printf("\n");
+    printf("Writes to stdout when no output file is given.\n");
+}
+
+int main(int argc, char* argv[]) {
+    int table_only = 0;
+    int arg = 1;
+
+    while (arg < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-t") == 0) {
+            table_only = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+        arg++;
+    }
+
+    if (argc - arg < 1 || argc - arg > 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    static control_memory cm;
+    static mca_report report;
+    init_control_memory(&cm);
+
+    if (load_microprogram(&cm, argv[arg]) < 0) {
+        return 1;
+    }
+    mca_analyze(&cm, &report);
+
+    FILE* out = stdout;
+    if (argc - arg == 2) {
+        out = fopen(argv[arg + 1], "w");
+        if (!out) {
+            fprintf(stderr, "Error: Cannot create output file: %s\n", argv[arg + 1]);
+            return 1;
+        }
+    }
+
+    int result;
+    if (table_only) {
+        fprintf(out, "# Cost table for %s (microcycles, fetch included)\n", argv[arg]);
+        result = mca_write_cost_table(&report, out);
+    } else {
+        fprintf(out, "Microcode analysis of %s\n\n", argv[arg]);
+        result = mca_write_report(&report, &cm, out);
+    }
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    if (result != 0) {
+        fprintf(stderr, "Error: Failed writing the report\n");
+        return 1;
+    }
+    return 0;
+}
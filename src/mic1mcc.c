@@ -0,0 +1,222 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/control_unit.h"
+#include "../include/shifter.h"
+
+/*
+ * Microcode compiler: turns a control-store text file into C source with
+ * one specialised case per control-store address. Register indices are
+ * constants, and units whose result nobody consumes are not emitted.
+ */
+
+static const char* register_names[16] = {
+    "PC", "AC", "IR", "TIR", "SP", "AMASK", "SMASK", "R0",
+    "R1", "Rm1", "A", "B", "C", "D", "E", "F"
+};
+
+/* Decoded fields of one microinstruction, widened from the predecoded table */
+typedef struct micro_fields {
+    unsigned word;
+    int ext;
+    int addr, a, b, c;
+    int enc, wr, rd, mar, mbr;
+    int sh, alu, cond, amux;
+    int dispatch;
+    int units;
+} micro_fields;
+
+static void decode_fields(const control_memory* cm, int address, micro_fields* f) {
+    const micro_op* op = &cm->ops[address];
+
+    f->word = cm->words[address];
+    f->ext  = cm->ext[address];
+    f->addr = op->addr;
+    f->a    = op->a;
+    f->b    = op->b;
+    f->c    = op->c;
+    f->enc  = (op->flags & MICRO_ENC) != 0;
+    f->wr   = (op->flags & MICRO_WR) != 0;
+    f->rd   = (op->flags & MICRO_RD) != 0;
+    f->mar  = (op->flags & MICRO_MAR) != 0;
+    f->mbr  = (op->flags & MICRO_MBR) != 0;
+    f->sh   = op->sh;
+    f->alu  = op->alu;
+    f->cond = op->cond;
+    f->amux = (op->flags & MICRO_AMUX) != 0;
+    f->dispatch = (op->flags & MICRO_DISPATCH) != 0;
+    f->units = op->units;
+}
+
+/* Same active-unit rule as the microcode engine (micro_op_units) */
+static int result_used(const micro_fields* f) {
+    return (f->units & UNIT_ALU) != 0;
+}
+
+static int uses_a(const micro_fields* f) {
+    return (f->units & UNIT_BUS_A) != 0;
+}
+
+static int uses_b(const micro_fields* f) {
+    return (f->units & UNIT_BUS_B) != 0;
+}
+
+static void emit_case(FILE* out, int address, const micro_fields* f, int dispatch_bits, int size) {
+    int next = (address + 1) & (size - 1);
+
+    if (f->ext) {
+        fprintf(out, "    case 0x%02X:  /* %02X %08X */\n", address, f->ext, f->word);
+    } else {
+        fprintf(out, "    case 0x%02X:  /* %08X */\n", address, f->word);
+    }
+
+    if (uses_b(f)) {
+        fprintf(out, "        b = REG(%s);\n", register_names[f->b]);
+    }
+    if (uses_a(f)) {
+        fprintf(out, "        a = REG(%s);\n", register_names[f->a]);
+    }
+    if (f->mar) {
+        fprintf(out, "        int_to_bits(b & 0xFFF, cpu->mar.address, 12);\n");
+    }
+    if (f->rd) {
+        fprintf(out, "        m_read(&cpu->mar, &cpu->mbr, &cpu->main_memory, &cpu->unified_cache);\n");
+    }
+
+    if (result_used(f)) {
+        if (f->amux) {
+            fprintf(out, "        a = bits_to_int(cpu->mbr.data, 16);\n");
+        }
+        switch (f->alu) {
+            case 0: fprintf(out, "        r = (a + b) & 0xFFFF;\n"); break;
+            case 1: fprintf(out, "        r = a & b;\n"); break;
+            case 2: fprintf(out, "        r = a;\n"); break;
+            case 3: fprintf(out, "        r = ~a & 0xFFFF;\n"); break;
+        }
+
+        /* Condition is taken from the ALU output, before the shifter */
+        if (f->cond == COND_IF_N) {
+            fprintf(out, "        next = (r & 0x8000) ? 0x%02X : 0x%02X;\n", f->addr, next);
+        } else if (f->cond == COND_IF_Z) {
+            fprintf(out, "        next = (r == 0) ? 0x%02X : 0x%02X;\n", f->addr, next);
+        }
+
+        if (f->sh == SHIFT_RIGHT) {
+            fprintf(out, "        r = (r >> 1) | (r & 0x8000);\n");
+        } else if (f->sh == SHIFT_LEFT) {
+            fprintf(out, "        r = (r << 1) & 0xFFFF;\n");
+        }
+
+        if (f->mbr) {
+            fprintf(out, "        int_to_bits(r, cpu->mbr.data, 16);\n");
+        }
+        if (f->enc) {
+            fprintf(out, "        int_to_bits(r, rb->%s.data, 16);\n", register_names[f->c]);
+        }
+    }
+
+    if (f->wr) {
+        fprintf(out, "        m_write(&cpu->mar, &cpu->mbr, &cpu->main_memory, &cpu->unified_cache);\n");
+    }
+
+    if (f->dispatch) {
+        fprintf(out, "        return dispatch_table[bits_to_int(&cpu->mbr.data[%d], %d)];\n",
+                16 - dispatch_bits, dispatch_bits);
+        return;
+    }
+
+    switch (f->cond) {
+        case COND_NONE:
+            fprintf(out, "        return 0x%02X;\n", next);
+            break;
+        case COND_ALWAYS:
+            fprintf(out, "        return 0x%02X;\n", f->addr);
+            break;
+        default:
+            fprintf(out, "        return next;\n");
+            break;
+    }
+}
+
+static int generate(const control_memory* cm, const char* source, FILE* out) {
+    static micro_fields fields[MICROPROGRAM_SIZE];
+    int need_a = 0, need_b = 0, need_r = 0, need_next = 0, need_dispatch = 0;
+
+    for (int i = 0; i < cm->size; i++) {
+        decode_fields(cm, i, &fields[i]);
+        need_a |= uses_a(&fields[i]) || (result_used(&fields[i]) && fields[i].amux);
+        need_b |= uses_b(&fields[i]);
+        need_r |= result_used(&fields[i]);
+        need_next |= fields[i].cond == COND_IF_N || fields[i].cond == COND_IF_Z;
+        need_dispatch |= fields[i].dispatch;
+    }
+
+    fprintf(out, "/* Generated by mic1mcc from %s - do not edit */\n\n", source);
+    fprintf(out, "#include \"../include/microcode_compiled.h\"\n");
+    fprintf(out, "#include \"../include/utils/conversions.h\"\n\n");
+    fprintf(out, "#define REG(name) bits_to_int(rb->name.data, 16)\n\n");
+    fprintf(out, "const char* const mic1_compiled_source = \"%s\";\n\n", source);
+
+    if (need_dispatch) {
+        int entries = 1 << cm->dispatch_bits;
+        fprintf(out, "static const unsigned short dispatch_table[%d] = {", entries);
+        for (int key = 0; key < entries; key++) {
+            fprintf(out, "%s0x%02X,", key % 8 ? " " : "\n    ", cm->dispatch[key]);
+        }
+        fprintf(out, "\n};\n\n");
+    }
+    fprintf(out, "int mic1_compiled_execute(mic1_cpu* cpu, int mpc) {\n");
+    fprintf(out, "    register_bank* rb = &cpu->reg_bank;\n");
+    if (need_a) fprintf(out, "    int a = 0;\n");
+    if (need_b) fprintf(out, "    int b = 0;\n");
+    if (need_r) fprintf(out, "    int r = 0;\n");
+    if (need_next) fprintf(out, "    int next;\n");
+    fprintf(out, "    (void)rb;\n\n");
+    fprintf(out, "    /* Same fault as fetch_microinstruction, then a 'goto 0' */\n");
+    fprintf(out, "    if (mpc < 0 || mpc >= 0x%X) {\n", cm->size);
+    fprintf(out, "        raise_fault(&cpu->fault, FAULT_MPC_BOUNDS, mpc);\n");
+    fprintf(out, "        return 0;\n");
+    fprintf(out, "    }\n\n");
+    fprintf(out, "    switch (mpc) {\n");
+
+    for (int i = 0; i < cm->size; i++) {
+        emit_case(out, i, &fields[i], cm->dispatch_bits, cm->size);
+    }
+
+    fprintf(out, "    }\n");
+    fprintf(out, "    return 0;\n");
+    fprintf(out, "}\n");
+
+    return ferror(out) ? -1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printf("MIC-1 Microcode Compiler v1.0\n");
+        printf("Usage: %s <microcode.txt|.mcs> <output.c>\n", argv[0]);
+        return 1;
+    }
+
+    static control_memory cm;
+    init_control_memory(&cm);
+    if (load_microprogram(&cm, argv[1]) < 0) {
+        return 1;
+    }
+
+    FILE* out = fopen(argv[2], "w");
+    if (!out) {
+        fprintf(stderr, "Error: Cannot create output file: %s\n", argv[2]);
+        return 1;
+    }
+
+    int result = generate(&cm, argv[1], out);
+    fclose(out);
+
+    if (result != 0) {
+        fprintf(stderr, "Error: Failed writing %s\n", argv[2]);
+        remove(argv[2]);
+        return 1;
+    }
+    return 0;
+}
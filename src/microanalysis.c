@@ -0,0 +1,363 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../include/microanalysis.h"
+
+/* Paths walked per entry point before giving up on the rest */
+#define MCA_PATH_BUDGET 4096
+
+typedef struct mca_walk {
+    const control_memory* cm;
+    mca_routine* routine;
+    uint8_t on_path[MICROPROGRAM_SIZE];
+    char trace[MCA_MAX_BRANCHES + 1];
+    int branches;
+    int walked;
+} mca_walk;
+
+static int is_dispatch(const micro_op* op) {
+    return (op->flags & MICRO_DISPATCH) != 0;
+}
+
+static void record_path(mca_walk* w, int cycles, int end) {
+    mca_routine* r = w->routine;
+
+    /* Where the walk cut a looping path off says nothing about the best case */
+    w->walked++;
+    if (end != MCA_END_LOOP && (r->min_cycles < 0 || cycles < r->min_cycles)) {
+        r->min_cycles = cycles;
+    }
+    if (end == MCA_END_LOOP) {
+        r->max_cycles = -1;
+    } else if (r->max_cycles >= 0 && cycles > r->max_cycles) {
+        r->max_cycles = cycles;
+    }
+
+    if (r->path_count >= MCA_MAX_PATHS) {
+        r->truncated = 1;
+        return;
+    }
+    mca_path* p = &r->paths[r->path_count++];
+    p->cycles = cycles;
+    p->end = end;
+    memcpy(p->trace, w->trace, sizeof(p->trace));
+}
+
+static void walk_from(mca_walk* w, int addr, int cycles);
+
+/* Continues a path at `next`, appending one branch decision if `decision` */
+static void follow(mca_walk* w, int next, int cycles, char decision) {
+    int saved = w->branches;
+
+    if (decision && w->branches < MCA_MAX_BRANCHES) {
+        w->trace[w->branches++] = decision;
+        w->trace[w->branches] = '\0';
+    }
+
+    if (next == 0) {
+        record_path(w, cycles, MCA_END_FETCH);
+    } else {
+        walk_from(w, next, cycles);
+    }
+
+    w->branches = saved;
+    w->trace[saved] = '\0';
+}
+
+static void walk_from(mca_walk* w, int addr, int cycles) {
+    if (w->walked >= MCA_PATH_BUDGET) {
+        w->routine->truncated = 1;
+        return;
+    }
+    if (w->on_path[addr] || cycles >= MCA_MAX_DEPTH) {
+        record_path(w, cycles, MCA_END_LOOP);
+        return;
+    }
+
+    const micro_op* op = &w->cm->ops[addr];
+    int next = (addr + 1) & (w->cm->size - 1);
+
+    cycles++;
+    if (is_dispatch(op)) {
+        record_path(w, cycles, MCA_END_DISPATCH);
+        return;
+    }
+
+    w->on_path[addr] = 1;
+    switch (op->cond) {
+        case COND_NONE:
+            follow(w, next, cycles, 0);
+            break;
+        case COND_ALWAYS:
+            follow(w, op->addr, cycles, 0);
+            break;
+        default: {
+            char flag = op->cond == COND_IF_N ? 'N' : 'Z';
+            follow(w, op->addr, cycles, flag);
+            follow(w, next, cycles, (char)(flag - 'A' + 'a'));
+            break;
+        }
+    }
+    w->on_path[addr] = 0;
+}
+
+static void analyze_routine(const control_memory* cm, int entry, mca_routine* r) {
+    mca_walk w;
+
+    memset(&w, 0, sizeof(w));
+    memset(r, 0, sizeof(*r));
+    r->min_cycles = -1;
+    w.cm = cm;
+    w.routine = r;
+    walk_from(&w, entry, 0);
+}
+
+/* Marks everything reachable from address 0 through any dispatch key */
+static void mark_reachable(const control_memory* cm, mca_report* report) {
+    int stack[MICROPROGRAM_SIZE];
+    int top = 0;
+
+    report->flags[0] |= MCA_REACHABLE;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        int addr = stack[--top];
+        const micro_op* op = &cm->ops[addr];
+        int succ[DISPATCH_TABLE_SIZE];
+        int count = 0;
+
+        if (is_dispatch(op)) {
+            for (int key = 0; key < (1 << cm->dispatch_bits); key++) {
+                succ[count++] = cm->dispatch[key];
+            }
+        } else {
+            if (op->cond != COND_ALWAYS) succ[count++] = (addr + 1) & (cm->size - 1);
+            if (op->cond != COND_NONE) succ[count++] = op->addr;
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (!(report->flags[succ[i]] & MCA_REACHABLE)) {
+                report->flags[succ[i]] |= MCA_REACHABLE;
+                stack[top++] = succ[i];
+            }
+        }
+    }
+}
+
+static void find_hazards(const control_memory* cm, mca_report* report) {
+    for (int addr = 0; addr < cm->size; addr++) {
+        const micro_op* op = &cm->ops[addr];
+        int next = (addr + 1) & (cm->size - 1);
+
+        if (!(report->flags[addr] & MCA_REACHABLE)) {
+            if (!MCA_PADDING(cm->words[addr])) {
+                report->flags[addr] |= MCA_UNREACHABLE;
+                report->unreachable_count++;
+            }
+            continue;
+        }
+        if (cm->words[addr] == 0) {
+            continue;   /* reached by falling through; flagged where it starts */
+        }
+
+        if (!(op->flags & (MICRO_ENC | MICRO_MBR | MICRO_MAR | MICRO_RD | MICRO_WR)) &&
+            (op->cond == COND_NONE || (op->cond == COND_ALWAYS && !is_dispatch(op)))) {
+            report->flags[addr] |= MCA_NO_WRITE;
+            report->no_write_count++;
+        }
+
+        if (op->cond == COND_ALWAYS) {
+            continue;
+        }
+        if (next == 0) {
+            report->flags[addr] |= MCA_FALL_WRAP;
+        } else if (cm->words[next] == 0) {
+            report->flags[addr] |= MCA_FALL_EMPTY;
+        } else if (report->is_entry[next]) {
+            report->flags[addr] |= MCA_FALL_ENTRY;
+        }
+        if (report->flags[addr] & MCA_HAZARDS) {
+            report->hazard_count++;
+        }
+    }
+}
+
+int mca_analyze(const control_memory* cm, mca_report* report) {
+    if (!cm || !report) {
+        return -1;
+    }
+
+    memset(report, 0, sizeof(*report));
+    report->dispatch_bits = cm->dispatch_bits;
+    memcpy(report->dispatch, cm->dispatch, sizeof(report->dispatch));
+
+    analyze_routine(cm, 0, &report->fetch);
+
+    for (int key = 0; key < (1 << cm->dispatch_bits); key++) {
+        int entry = cm->dispatch[key];
+        if (report->is_entry[entry]) {
+            continue;
+        }
+        report->is_entry[entry] = 1;
+        if (entry == 0) {
+            /* Dispatch straight back to fetch: the instruction ends there */
+            memset(&report->routines[0], 0, sizeof(mca_routine));
+            report->routines[0].path_count = 1;
+        } else {
+            analyze_routine(cm, entry, &report->routines[entry]);
+        }
+    }
+
+    mark_reachable(cm, report);
+    find_hazards(cm, report);
+    return 0;
+}
+
+const mca_routine* mca_routine_for(const mca_report* report, int instruction) {
+    if (!report) {
+        return NULL;
+    }
+    int bits = report->dispatch_bits;
+    int key = (instruction & 0xFFFF) >> (16 - bits);
+    return &report->routines[report->dispatch[key]];
+}
+
+static int total_cycles(int fetch, int routine) {
+    return fetch < 0 || routine < 0 ? -1 : fetch + routine;
+}
+
+int mca_instruction_cycles(const mca_report* report, int instruction) {
+    const mca_routine* r = mca_routine_for(report, instruction);
+    return r ? total_cycles(report->fetch.max_cycles, r->max_cycles) : -1;
+}
+
+int mca_instruction_min_cycles(const mca_report* report, int instruction) {
+    const mca_routine* r = mca_routine_for(report, instruction);
+    return r ? total_cycles(report->fetch.min_cycles, r->min_cycles) : -1;
+}
+
+int mca_write_cost_table(const mca_report* report, FILE* out) {
+    fprintf(out, "fetch %d %d\n", report->fetch.min_cycles, report->fetch.max_cycles);
+
+    for (int key = 0; key < (1 << report->dispatch_bits); key++) {
+        int entry = report->dispatch[key];
+        const mca_routine* r = &report->routines[entry];
+        fprintf(out, "key 0x%02X 0x%02X %d %d %d\n", key, entry,
+                total_cycles(report->fetch.min_cycles, r->min_cycles),
+                total_cycles(report->fetch.max_cycles, r->max_cycles), r->path_count);
+    }
+
+    return ferror(out) ? -1 : 0;
+}
+
+static const char* const opcode_names[16] = {
+    "LODD", "STOD", "ADDD", "SUBD", "JPOS", "JZER", "JUMP", "LOCO",
+    "LODL", "STOL", "ADDL", "SUBL", "JNEG", "JNZE", "CALL", "0xF"
+};
+
+static const char* const special_names[8] = {
+    "PSHI", "POPI", "PUSH", "POP", "RETN", "SWAP", "INSP", "DESP"
+};
+
+static const char* key_name(int key, int bits) {
+    if (bits == 4) {
+        return opcode_names[key];
+    }
+    if ((key >> 4) != 0xF) {
+        return opcode_names[key >> 4];
+    }
+    return key & 1 ? "-" : special_names[(key & 0xF) >> 1];
+}
+
+/* Lists the paths of `r`, adding `base` cycles to each */
+static void write_routine(FILE* out, const mca_routine* r, int base) {
+    for (int i = 0; i < r->path_count; i++) {
+        const mca_path* p = &r->paths[i];
+        fprintf(out, "        %-18s %3d%s\n", p->trace[0] ? p->trace : "(straight)", base + p->cycles,
+                p->end == MCA_END_LOOP ? "  loops" :
+                p->end == MCA_END_DISPATCH ? "  dispatches" : "");
+    }
+    if (r->truncated) {
+        fprintf(out, "        ... more than %d paths\n", MCA_MAX_PATHS);
+    }
+}
+
+static void write_cycles(FILE* out, int min, int max) {
+    if (min < 0) {
+        fprintf(out, "  -  loop");
+    } else if (max < 0) {
+        fprintf(out, "%3d  loop", min);
+    } else {
+        fprintf(out, "%3d  %4d", min, max);
+    }
+}
+
+static void write_findings(FILE* out, const control_memory* cm, const mca_report* report,
+                           int mask, const char* title, int count) {
+    fprintf(out, "\n%s: %d\n", title, count);
+    for (int addr = 0; addr < MICROPROGRAM_SIZE; addr++) {
+        int f = report->flags[addr] & mask;
+        if (!f) continue;
+        fprintf(out, "  0x%02X  %08X", addr, cm->words[addr]);
+        if (f & MCA_NO_WRITE) {
+            fprintf(out, "  %s", cm->ops[addr].cond == COND_NONE ? "idle cycle" : "jump only");
+        }
+        if (f & MCA_FALL_EMPTY) fprintf(out, "  falls into an empty word");
+        if (f & MCA_FALL_ENTRY) fprintf(out, "  falls into the entry at 0x%02X", addr + 1);
+        if (f & MCA_FALL_WRAP) fprintf(out, "  falls past the last word to 0");
+        fprintf(out, "\n");
+    }
+}
+
+int mca_write_report(const mca_report* report, const control_memory* cm, FILE* out) {
+    int keys = 1 << report->dispatch_bits;
+
+    if (report->fetch.min_cycles < 0) {
+        fprintf(out, "Fetch: loops, never reaches the dispatch\n");
+    } else if (report->fetch.max_cycles < 0) {
+        fprintf(out, "Fetch: at least %d microcycles, loops\n", report->fetch.min_cycles);
+    } else if (report->fetch.min_cycles == report->fetch.max_cycles) {
+        fprintf(out, "Fetch: %d microcycles\n", report->fetch.max_cycles);
+    } else {
+        fprintf(out, "Fetch: %d-%d microcycles\n", report->fetch.min_cycles, report->fetch.max_cycles);
+    }
+    if (report->fetch.path_count > 1 || report->fetch.truncated) {
+        write_routine(out, &report->fetch, 0);
+    }
+
+    fprintf(out, "\nCycles per instruction (fetch included), %d-bit dispatch:\n", report->dispatch_bits);
+    fprintf(out, "  key        name  entry  min   max  paths\n");
+
+    /* Consecutive keys sharing an entry point are listed once */
+    for (int key = 0; key < keys; ) {
+        int entry = report->dispatch[key];
+        int last = key;
+        while (last + 1 < keys && report->dispatch[last + 1] == entry &&
+               strcmp(key_name(last + 1, report->dispatch_bits),
+                      key_name(key, report->dispatch_bits)) == 0) {
+            last++;
+        }
+
+        const mca_routine* r = &report->routines[entry];
+        if (last > key) {
+            fprintf(out, "  0x%02X-0x%02X", key, last);
+        } else {
+            fprintf(out, "  0x%02X     ", key);
+        }
+        fprintf(out, "  %4s   0x%02X  ", key_name(key, report->dispatch_bits), entry);
+        write_cycles(out, total_cycles(report->fetch.min_cycles, r->min_cycles),
+                     total_cycles(report->fetch.max_cycles, r->max_cycles));
+        fprintf(out, "  %5d\n", r->path_count);
+        if (r->path_count > 1 || r->truncated) {
+            write_routine(out, r, report->fetch.max_cycles > 0 ? report->fetch.max_cycles : 0);
+        }
+        key = last + 1;
+    }
+
+    write_findings(out, cm, report, MCA_UNREACHABLE, "Unreachable microinstructions",
+                   report->unreachable_count);
+    write_findings(out, cm, report, MCA_NO_WRITE, "Microinstructions that write nothing",
+                   report->no_write_count);
+    write_findings(out, cm, report, MCA_HAZARDS, "Fall-through hazards", report->hazard_count);
+
+    return ferror(out) ? -1 : 0;
+}
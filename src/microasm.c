@@ -0,0 +1,678 @@
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/microasm.h"
+#include "../include/shifter.h"
+
+/* Operand code for the MBR input of the A-mux */
+#define MAL_MBR         16
+
+static const char* register_names[16] = {
+    "pc", "ac", "ir", "tir", "sp", "amask", "smask", "r0",
+    "r1", "rm1", "a", "b", "c", "d", "e", "f"
+};
+
+/* One ALU operation: alu/sh as encoded, y < 0 for unary operations */
+typedef struct mal_expr {
+    int alu;
+    int sh;
+    int x;
+    int y;
+} mal_expr;
+
+/* Fields collected from the statements of one line */
+typedef struct mal_micro {
+    int has_expr;
+    mal_expr expr;
+    int dest;               /* register written through C, -1 = none */
+    int mar_reg;            /* register loaded into MAR, -1 = none */
+    int mbr;
+    int rd;
+    int wr;
+    int cond;
+    int dispatch;
+    char target[MAL_MAX_LABEL];
+} mal_micro;
+
+typedef struct mal_label {
+    char name[MAL_MAX_LABEL];
+    int addr;
+} mal_label;
+
+typedef struct mal_state {
+    mal_program* prog;
+    mal_label labels[MICROPROGRAM_SIZE];
+    int label_count;
+    char targets[MICROPROGRAM_SIZE][MAL_MAX_LABEL];
+    char dispatch_labels[DISPATCH_TABLE_SIZE][MAL_MAX_LABEL];  /* keyed OPCODE << 4 | SUB */
+    int dispatch_lines[DISPATCH_TABLE_SIZE];
+    char opcode_labels[16][MAL_MAX_LABEL];
+    int opcode_lines[16];
+    int location;
+    int line;
+} mal_state;
+
+static void mal_error(mal_state* st, const char* fmt, ...) {
+    char msg[128];
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+
+    if (st->prog->error_count++ == 0) {
+        snprintf(st->prog->error_msg, sizeof(st->prog->error_msg), "line %d: %s", st->line, msg);
+    }
+    fprintf(stderr, "Error on line %d: %s\n", st->line, msg);
+}
+
+/* ============================================================
+ * LEXING
+ * ============================================================ */
+
+static void skip_spaces(const char** p) {
+    while (**p == ' ' || **p == '\t') (*p)++;
+}
+
+/* Reads [A-Za-z0-9_] into `out` (lower-cased); returns its length */
+static int read_word(const char** p, char* out, size_t size) {
+    size_t n = 0;
+    skip_spaces(p);
+    while (isalnum((unsigned char)**p) || **p == '_') {
+        if (n + 1 < size) out[n++] = (char)tolower((unsigned char)**p);
+        (*p)++;
+    }
+    out[n] = '\0';
+    return (int)n;
+}
+
+static int expect(const char** p, char c) {
+    skip_spaces(p);
+    if (**p != c) return 0;
+    (*p)++;
+    return 1;
+}
+
+static int register_index(const char* name) {
+    for (int i = 0; i < 16; i++) {
+        if (strcmp(name, register_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+/* Register, mbr, or one of the constants 0, 1, -1, (-1) */
+static int parse_operand(const char** p) {
+    char word[MAL_MAX_LABEL];
+
+    skip_spaces(p);
+    if (**p == '(') {
+        (*p)++;
+        int r = parse_operand(p);
+        return expect(p, ')') ? r : -1;
+    }
+    if (**p == '-') {
+        (*p)++;
+        return read_word(p, word, sizeof(word)) && strcmp(word, "1") == 0 ? 9 : -1;
+    }
+
+    if (!read_word(p, word, sizeof(word))) return -1;
+    if (strcmp(word, "0") == 0) return 7;
+    if (strcmp(word, "1") == 0) return 8;
+    if (strcmp(word, "mbr") == 0) return MAL_MBR;
+    return register_index(word);
+}
+
+/* x + y | band(x, y) | inv(x) | x */
+static int parse_term(const char** p, mal_expr* e) {
+    const char* start = *p;
+    char word[MAL_MAX_LABEL];
+
+    read_word(p, word, sizeof(word));
+    if (strcmp(word, "band") == 0 && expect(p, '(')) {
+        e->alu = 1;
+        e->x = parse_operand(p);
+        if (!expect(p, ',')) return -1;
+        e->y = parse_operand(p);
+        return expect(p, ')') && e->x >= 0 && e->y >= 0 ? 0 : -1;
+    }
+    if (strcmp(word, "inv") == 0 && expect(p, '(')) {
+        e->alu = 3;
+        e->x = parse_operand(p);
+        return expect(p, ')') && e->x >= 0 ? 0 : -1;
+    }
+
+    *p = start;
+    e->x = parse_operand(p);
+    if (e->x < 0) return -1;
+    if (expect(p, '+')) {
+        e->alu = 0;
+        e->y = parse_operand(p);
+        return e->y >= 0 ? 0 : -1;
+    }
+    e->alu = 2;
+    return 0;
+}
+
+static int parse_expr(const char* text, mal_expr* e) {
+    const char* p = text;
+    char word[MAL_MAX_LABEL];
+
+    e->sh = 0;
+    e->y = -1;
+
+    read_word(&p, word, sizeof(word));
+    if ((strcmp(word, "lshift") == 0 || strcmp(word, "rshift") == 0) && expect(&p, '(')) {
+        e->sh = word[0] == 'l' ? SHIFT_LEFT : SHIFT_RIGHT;
+        if (parse_term(&p, e) < 0 || !expect(&p, ')')) return -1;
+    } else {
+        p = text;
+        if (parse_term(&p, e) < 0) return -1;
+    }
+
+    /* The B bus cannot carry MBR: keep it on the A side */
+    if (e->y == MAL_MBR) {
+        if (e->x == MAL_MBR) return -1;
+        e->y = e->x;
+        e->x = MAL_MBR;
+    }
+
+    skip_spaces(&p);
+    return *p == '\0' ? 0 : -1;
+}
+
+/* ============================================================
+ * STATEMENTS
+ * ============================================================ */
+
+static int same_expr(const mal_expr* a, const mal_expr* b) {
+    return a->alu == b->alu && a->sh == b->sh && a->x == b->x && a->y == b->y;
+}
+
+static void set_target(mal_state* st, mal_micro* m, int cond, const char* target) {
+    if (m->cond != COND_NONE) {
+        mal_error(st, "more than one branch");
+        return;
+    }
+    m->cond = cond;
+    if (strcmp(target, "dispatch") == 0) {
+        if (cond != COND_ALWAYS) {
+            mal_error(st, "dispatch cannot be conditional");
+        }
+        m->dispatch = 1;
+        return;
+    }
+    snprintf(m->target, sizeof(m->target), "%s", target);
+}
+
+static void parse_branch(mal_state* st, mal_micro* m, const char* text) {
+    const char* p = text;
+    char word[MAL_MAX_LABEL], target[MAL_MAX_LABEL];
+    int cond = COND_ALWAYS;
+
+    read_word(&p, word, sizeof(word));
+    if (strcmp(word, "if") == 0) {
+        read_word(&p, word, sizeof(word));
+        if (strcmp(word, "n") == 0) {
+            cond = COND_IF_N;
+        } else if (strcmp(word, "z") == 0) {
+            cond = COND_IF_Z;
+        } else {
+            mal_error(st, "unknown condition '%s' (use n or z)", word);
+            return;
+        }
+        read_word(&p, word, sizeof(word));
+        if (strcmp(word, "then") == 0) {
+            read_word(&p, word, sizeof(word));
+        }
+    }
+
+    if (strcmp(word, "goto") != 0) {
+        mal_error(st, "expected goto");
+        return;
+    }
+    skip_spaces(&p);
+    size_t n = 0;
+    while (p[n] && p[n] != ' ' && p[n] != '\t') n++;
+    if (n == 0 || n >= sizeof(target) || p[n + strspn(p + n, " \t")] != '\0') {
+        mal_error(st, "bad branch target");
+        return;
+    }
+    memcpy(target, p, n);
+    target[n] = '\0';
+    set_target(st, m, cond, target);
+}
+
+static void parse_assignment(mal_state* st, mal_micro* m, const char* lhs, const char* rhs) {
+    while (*rhs == ' ' || *rhs == '\t') rhs++;
+
+    if (strcmp(lhs, "mar") == 0) {
+        const char* p = rhs;
+        int r = parse_operand(&p);
+        skip_spaces(&p);
+        if (r < 0 || r == MAL_MBR || *p != '\0') {
+            mal_error(st, "mar can only be loaded from a register");
+            return;
+        }
+        m->mar_reg = r;
+        return;
+    }
+
+    int dest = -1;
+    if (strcmp(lhs, "mbr") == 0) {
+        m->mbr = 1;
+    } else if (strcmp(lhs, "alu") != 0) {
+        dest = register_index(lhs);
+        if (dest < 0) {
+            mal_error(st, "unknown destination '%s'", lhs);
+            return;
+        }
+        if (m->dest >= 0 && m->dest != dest) {
+            mal_error(st, "only one register can be written per microinstruction");
+            return;
+        }
+        m->dest = dest;
+    }
+
+    mal_expr e;
+    if (parse_expr(rhs, &e) < 0) {
+        mal_error(st, "bad expression '%s'", rhs);
+        return;
+    }
+    if (m->has_expr && !same_expr(&m->expr, &e)) {
+        mal_error(st, "assignments need different ALU operations");
+        return;
+    }
+    m->has_expr = 1;
+    m->expr = e;
+}
+
+static void parse_statement(mal_state* st, mal_micro* m, char* text) {
+    char* end = text + strlen(text);
+    while (*text == ' ' || *text == '\t') text++;
+    while (end > text && (end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+    if (*text == '\0') return;
+
+    char* assign = strstr(text, ":=");
+    if (assign) {
+        char lhs[MAL_MAX_LABEL];
+        const char* p = text;
+        *assign = '\0';
+        read_word(&p, lhs, sizeof(lhs));
+        skip_spaces(&p);
+        if (*p != '\0') {
+            mal_error(st, "bad destination");
+            return;
+        }
+        parse_assignment(st, m, lhs, assign + 2);
+    } else if (strcmp(text, "rd") == 0) {
+        m->rd = 1;
+    } else if (strcmp(text, "wr") == 0) {
+        m->wr = 1;
+    } else if (strncmp(text, "goto", 4) == 0 || strncmp(text, "if", 2) == 0) {
+        parse_branch(st, m, text);
+    } else {
+        mal_error(st, "unknown statement '%s'", text);
+    }
+}
+
+static uint32_t encode_micro(mal_state* st, mal_micro* m) {
+    int a = 0, b = 0, amux = 0, alu = 0, sh = 0;
+
+    if ((m->cond == COND_IF_N || m->cond == COND_IF_Z) && !m->has_expr) {
+        mal_error(st, "conditional branch without an ALU operation");
+    }
+
+    if (m->has_expr) {
+        mal_expr* e = &m->expr;
+
+        /* MAR shares the B bus with the ALU; swap commutative operands */
+        if (m->mar_reg >= 0 && e->y >= 0 && e->y != m->mar_reg) {
+            if (e->x == m->mar_reg && (e->alu == 0 || e->alu == 1)) {
+                e->x = e->y;
+                e->y = m->mar_reg;
+            } else {
+                mal_error(st, "mar := %s conflicts with the B operand %s",
+                          register_names[m->mar_reg], register_names[e->y]);
+            }
+        }
+
+        alu = e->alu;
+        sh = e->sh;
+        if (e->x == MAL_MBR) {
+            amux = 1;
+        } else {
+            a = e->x;
+        }
+        if (e->y >= 0) b = e->y;
+    }
+    if (m->mar_reg >= 0) b = m->mar_reg;
+
+    return ((uint32_t)(m->dispatch && !st->prog->extended ? DISPATCH_ADDR : 0) << 24) |
+           ((uint32_t)a << 20) | ((uint32_t)b << 16) |
+           ((uint32_t)(m->dest >= 0 ? m->dest : 0) << 12) |
+           ((uint32_t)(m->dest >= 0) << 11) |
+           ((uint32_t)m->wr << 10) | ((uint32_t)m->rd << 9) |
+           ((uint32_t)(m->mar_reg >= 0) << 8) | ((uint32_t)m->mbr << 7) |
+           ((uint32_t)sh << 5) | ((uint32_t)alu << 3) |
+           ((uint32_t)m->cond << 1) | (uint32_t)amux;
+}
+
+/* ============================================================
+ * LINES AND LABELS
+ * ============================================================ */
+
+static int find_label(mal_state* st, const char* name) {
+    for (int i = 0; i < st->label_count; i++) {
+        if (strcmp(st->labels[i].name, name) == 0) return st->labels[i].addr;
+    }
+    return -1;
+}
+
+static void define_label(mal_state* st, const char* name) {
+    if (strlen(name) >= MAL_MAX_LABEL) {
+        mal_error(st, "label too long: %s", name);
+    } else if (strcmp(name, "dispatch") == 0 || find_label(st, name) >= 0) {
+        mal_error(st, "duplicate or reserved label: %s", name);
+    } else if (st->label_count < MICROPROGRAM_SIZE) {
+        snprintf(st->labels[st->label_count].name, MAL_MAX_LABEL, "%s", name);
+        st->labels[st->label_count].addr = st->location;
+        st->label_count++;
+    } else {
+        mal_error(st, "too many labels");
+    }
+}
+
+static int parse_number(const char* text, int* value) {
+    char* end;
+    long v = strtol(text, &end, 0);
+    if (end == text || *end != '\0') return -1;
+    *value = (int)v;
+    return 0;
+}
+
+static void parse_directive(mal_state* st, char* text) {
+    char* name = strtok(text, " \t");
+    char* arg1 = strtok(NULL, " \t");
+    char* arg2 = strtok(NULL, " \t");
+    int value;
+
+    if (strcmp(name, ".org") == 0 && arg1 && !arg2) {
+        if (parse_number(arg1, &value) < 0 || value < 0 || value >= st->prog->store_size) {
+            mal_error(st, ".org address out of range");
+            return;
+        }
+        st->location = value;
+    } else if (strcmp(name, ".size") == 0 && arg1 && !arg2) {
+        if (parse_number(arg1, &value) < 0 || value < CLASSIC_STORE_SIZE ||
+            value > MICROPROGRAM_SIZE || (value & (value - 1))) {
+            mal_error(st, ".size must be a power of two from %d to %d",
+                      CLASSIC_STORE_SIZE, MICROPROGRAM_SIZE);
+        } else if (st->prog->size > 0 || st->location > 0) {
+            mal_error(st, ".size must come before the first microinstruction");
+        } else {
+            st->prog->store_size = value;
+            st->prog->extended = 1;
+        }
+    } else if (strcmp(name, ".dispatch") == 0 && arg1 && arg2) {
+        char* arg3 = strtok(NULL, " \t");
+        int sub = -1;
+        if (parse_number(arg1, &value) < 0 || value < 0 || value > 0xF) {
+            mal_error(st, ".dispatch opcode must be 0..15");
+            return;
+        }
+        if (arg3) {
+            if (parse_number(arg2, &sub) < 0 || sub < 0 || sub > 0xF) {
+                mal_error(st, ".dispatch sub-opcode must be 0..15");
+                return;
+            }
+            arg2 = arg3;
+        }
+
+        int* lines = sub < 0 ? &st->opcode_lines[value] : &st->dispatch_lines[value << 4 | sub];
+        if (*lines) {
+            mal_error(st, "opcode 0x%X%s already dispatched on line %d", value,
+                      sub < 0 ? "" : " sub-opcode", *lines);
+            return;
+        }
+        snprintf(sub < 0 ? st->opcode_labels[value] : st->dispatch_labels[value << 4 | sub],
+                 MAL_MAX_LABEL, "%s", arg2);
+        *lines = st->line;
+    } else {
+        mal_error(st, "bad directive '%s'", name);
+    }
+}
+
+static void parse_line(mal_state* st, char* text) {
+    char* hash = strchr(text, '#');
+    if (hash) *hash = '\0';
+
+    /* Leading labels */
+    for (;;) {
+        char* p = text;
+        while (*p == ' ' || *p == '\t') p++;
+        char* start = p;
+        while (isalnum((unsigned char)*p) || *p == '_') p++;
+        char* end = p;
+        while (*p == ' ' || *p == '\t') p++;
+        if (end == start || *p != ':' || p[1] == '=') {
+            text = start;
+            break;
+        }
+        *end = '\0';
+        define_label(st, start);
+        text = p + 1;
+    }
+
+    size_t len = strlen(text);
+    while (len > 0 && isspace((unsigned char)text[len - 1])) text[--len] = '\0';
+    if (len == 0) return;
+
+    if (text[0] == '.') {
+        parse_directive(st, text);
+        return;
+    }
+
+    if (st->location >= st->prog->store_size) {
+        mal_error(st, "control store full");
+        return;
+    }
+    if (st->prog->line[st->location]) {
+        mal_error(st, "address 0x%02X already used on line %d",
+                  st->location, st->prog->line[st->location]);
+        return;
+    }
+
+    mal_micro m;
+    memset(&m, 0, sizeof(m));
+    m.dest = -1;
+    m.mar_reg = -1;
+
+    for (char* stmt = strtok(text, ";"); stmt; stmt = strtok(NULL, ";")) {
+        parse_statement(st, &m, stmt);
+    }
+
+    st->prog->words[st->location] = encode_micro(st, &m);
+    if (st->prog->extended) {
+        st->prog->ext[st->location] = MICRO_EXT_WIDE | (m.dispatch ? MICRO_EXT_DISPATCH : 0);
+    }
+    st->prog->line[st->location] = st->line;
+    snprintf(st->targets[st->location], MAL_MAX_LABEL, "%s", m.target);
+    st->location++;
+    if (st->location > st->prog->size) st->prog->size = st->location;
+}
+
+/* Label or number; -1 when undefined */
+static int resolve(mal_state* st, const char* target) {
+    int value;
+    if (parse_number(target, &value) == 0) {
+        return value >= 0 && value < st->prog->store_size ? value : -1;
+    }
+    return find_label(st, target);
+}
+
+int mal_assemble(const char* source, mal_program* prog) {
+    if (!source || !prog) return -1;
+
+    memset(prog, 0, sizeof(*prog));
+    for (int i = 0; i < DISPATCH_TABLE_SIZE; i++) prog->dispatch[i] = -1;
+    prog->store_size = CLASSIC_STORE_SIZE;
+
+    mal_state* st = calloc(1, sizeof(mal_state));
+    if (!st) return -1;
+    st->prog = prog;
+
+    const char* p = source;
+    while (*p) {
+        char text[256];
+        size_t n = strcspn(p, "\n");
+        st->line++;
+        if (n >= sizeof(text)) {
+            mal_error(st, "line too long");
+        } else {
+            memcpy(text, p, n);
+            text[n] = '\0';
+            if (n > 0 && text[n - 1] == '\r') text[n - 1] = '\0';
+            parse_line(st, text);
+        }
+        p += n;
+        if (*p == '\n') p++;
+    }
+
+    for (int addr = 0; addr < MICROPROGRAM_SIZE; addr++) {
+        if (!st->targets[addr][0]) continue;
+        int target = resolve(st, st->targets[addr]);
+        st->line = prog->line[addr];
+        if (target < 0) {
+            mal_error(st, "undefined label: %s", st->targets[addr]);
+            continue;
+        }
+        prog->words[addr] |= (uint32_t)(target & 0xFF) << 24;
+        prog->ext[addr] |= (uint8_t)(target >> 8);
+    }
+
+    prog->dispatch_bits = 4;
+    for (int key = 0; key < DISPATCH_TABLE_SIZE; key++) {
+        if (st->dispatch_lines[key]) prog->dispatch_bits = 8;
+    }
+
+    for (int op = 0; op < 16; op++) {
+        if (!st->opcode_lines[op]) continue;
+        st->line = st->opcode_lines[op];
+        int target = resolve(st, st->opcode_labels[op]);
+        if (target < 0) {
+            mal_error(st, "undefined label: %s", st->opcode_labels[op]);
+            continue;
+        }
+        if (prog->dispatch_bits == 4) {
+            prog->dispatch[op] = target;
+        } else {
+            for (int sub = 0; sub < 16; sub++) prog->dispatch[op << 4 | sub] = target;
+        }
+    }
+
+    for (int key = 0; key < DISPATCH_TABLE_SIZE; key++) {
+        if (!st->dispatch_lines[key]) continue;
+        st->line = st->dispatch_lines[key];
+        prog->dispatch[key] = resolve(st, st->dispatch_labels[key]);
+        if (prog->dispatch[key] < 0) {
+            mal_error(st, "undefined label: %s", st->dispatch_labels[key]);
+        }
+    }
+
+    free(st);
+    return prog->error_count ? -1 : 0;
+}
+
+int mal_assemble_file(const char* filename, mal_program* prog) {
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot open input file: %s\n", filename);
+        return -1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char* source = malloc((size_t)size + 1);
+    if (!source) {
+        fclose(fp);
+        return -1;
+    }
+    size_t n = fread(source, 1, (size_t)size, fp);
+    source[n] = '\0';
+    fclose(fp);
+
+    int result = mal_assemble(source, prog);
+    free(source);
+    return result;
+}
+
+/* ============================================================
+ * OUTPUT
+ * ============================================================ */
+
+/* Prints source line `line` (1-based) without its newline */
+static void print_source_line(FILE* out, const char* source, int line) {
+    for (int i = 1; *source && i < line; i++) {
+        source += strcspn(source, "\n");
+        if (*source == '\n') source++;
+    }
+    size_t n = strcspn(source, "\r\n");
+    while (n > 0 && (*source == ' ' || *source == '\t')) {
+        source++;
+        n--;
+    }
+    fprintf(out, "%.*s", (int)n, source);
+}
+
+/*
+ * Writes the text control store understood by load_microprogram: one
+ * 32-character word per address (40 with the extension byte, after an
+ * '@size' line, in extended programs), each preceded by its source line,
+ * and the dispatch table as '@dispatch KEY ADDRESS' lines, preceded by
+ * '@dispatch_bits 8' when the keys include the sub-opcode.
+ */
+int mal_write_control_store(const mal_program* prog, const char* source, const char* source_name,
+                            FILE* out) {
+    fprintf(out, "# Generated by mic1mal from %s - do not edit\n", source_name);
+    if (prog->extended) {
+        fprintf(out, "@size %d\n", prog->store_size);
+    }
+
+    for (int addr = 0; addr < prog->size; addr++) {
+        fprintf(out, "\n# 0x%02X", addr);
+        if (prog->line[addr] && source) {
+            fprintf(out, "  line %d: ", prog->line[addr]);
+            print_source_line(out, source, prog->line[addr]);
+        } else if (!prog->line[addr]) {
+            fprintf(out, "  (unused)");
+        }
+        fprintf(out, "\n");
+        if (prog->extended) {
+            for (int bit = 7; bit >= 0; bit--) {
+                fputc('0' + (((prog->ext[addr] | MICRO_EXT_WIDE) >> bit) & 1), out);
+            }
+            fputc(' ', out);
+        }
+        for (int bit = 31; bit >= 0; bit--) {
+            fputc('0' + (int)((prog->words[addr] >> bit) & 1), out);
+        }
+        fprintf(out, "\n");
+    }
+
+    fprintf(out, "\n# Dispatch table\n");
+    if (prog->dispatch_bits != 4) {
+        fprintf(out, "@dispatch_bits %d\n", prog->dispatch_bits);
+    }
+    for (int key = 0; key < (1 << prog->dispatch_bits); key++) {
+        if (prog->dispatch[key] >= 0) {
+            fprintf(out, "@dispatch 0x%02X 0x%02X\n", key, prog->dispatch[key]);
+        }
+    }
+
+    return ferror(out) ? -1 : 0;
+}
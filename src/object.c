@@ -0,0 +1,424 @@
+#include "../include/object.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void init_object(mic1_object* obj) {
+    if (!obj) return;
+    memset(obj, 0, sizeof(*obj));
+}
+
+void free_object(mic1_object* obj) {
+    if (!obj) return;
+
+    for (int i = 0; i < obj->section_count; i++) {
+        free(obj->sections[i].words);
+    }
+    for (int i = 0; i < obj->symbol_count; i++) {
+        free(obj->symbols[i].name);
+    }
+    free(obj->sections);
+    free(obj->symbols);
+    free(obj->relocs);
+    free(obj->lines);
+    init_object(obj);
+}
+
+/* Grow *array to hold `count + 1` elements; capacity is 8, 16, 32, ... */
+static int reserve(void** array, int count, size_t elem_size) {
+    if (count && (count < 8 || (count & (count - 1)))) return 0;  /* still room */
+
+    int capacity = count ? count * 2 : 8;
+    void* grown = realloc(*array, (size_t)capacity * elem_size);
+    if (!grown) return -1;
+    *array = grown;
+    return 0;
+}
+
+int object_add_section(mic1_object* obj, int type, uint16_t offset,
+                       const uint16_t* words, uint16_t size) {
+    if (reserve((void**)&obj->sections, obj->section_count, sizeof(obj_section)) != 0) return -1;
+
+    obj_section* s = &obj->sections[obj->section_count];
+    s->type = type;
+    s->offset = offset;
+    s->size = size;
+    s->words = malloc(size ? size * sizeof(uint16_t) : 1);
+    if (!s->words) return -1;
+    if (size) memcpy(s->words, words, size * sizeof(uint16_t));
+
+    return obj->section_count++;
+}
+
+int object_add_symbol(mic1_object* obj, const char* name, int flags, uint16_t value) {
+    size_t len = strlen(name);
+    if (len == 0 || len > OBJ_MAX_NAME) return -1;
+    if (reserve((void**)&obj->symbols, obj->symbol_count, sizeof(obj_symbol)) != 0) return -1;
+
+    obj_symbol* s = &obj->symbols[obj->symbol_count];
+    s->name = malloc(len + 1);
+    if (!s->name) return -1;
+    memcpy(s->name, name, len + 1);
+    s->flags = flags;
+    s->value = value;
+
+    return obj->symbol_count++;
+}
+
+/* Index of the global or undefined symbol `name`, or -1 */
+int object_find_symbol(const mic1_object* obj, const char* name) {
+    for (int i = 0; i < obj->symbol_count; i++) {
+        if ((obj->symbols[i].flags & (OBJ_SYM_GLOBAL | OBJ_SYM_UNDEF)) &&
+            strcmp(obj->symbols[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int object_add_reloc(mic1_object* obj, uint16_t offset, int kind, int bits, int symbol) {
+    if (reserve((void**)&obj->relocs, obj->reloc_count, sizeof(obj_reloc)) != 0) return -1;
+
+    obj_reloc* r = &obj->relocs[obj->reloc_count];
+    r->offset = offset;
+    r->kind = (uint8_t)kind;
+    r->bits = (uint8_t)bits;
+    r->symbol = (uint16_t)symbol;
+
+    return obj->reloc_count++;
+}
+
+int object_add_line(mic1_object* obj, uint16_t offset, int line) {
+    if (reserve((void**)&obj->lines, obj->line_count, sizeof(obj_line)) != 0) return -1;
+
+    obj->lines[obj->line_count].offset = offset;
+    obj->lines[obj->line_count].line = (uint16_t)line;
+
+    return obj->line_count++;
+}
+
+/* Number of words spanned by the sections */
+int object_size(const mic1_object* obj) {
+    int size = 0;
+    for (int i = 0; i < obj->section_count; i++) {
+        int end = obj->sections[i].offset + obj->sections[i].size;
+        if (end > size) size = end;
+    }
+    return size;
+}
+
+/* ============================================================
+ * FILE I/O
+ * ============================================================ */
+
+static void put_u8(FILE* fp, int v) {
+    fputc(v & 0xFF, fp);
+}
+
+static void put_u16(FILE* fp, int v) {
+    fputc(v & 0xFF, fp);
+    fputc((v >> 8) & 0xFF, fp);
+}
+
+static int get_u8(FILE* fp, int* v) {
+    int c = fgetc(fp);
+    if (c == EOF) return -1;
+    *v = c;
+    return 0;
+}
+
+static int get_u16(FILE* fp, int* v) {
+    int lo = fgetc(fp);
+    int hi = fgetc(fp);
+    if (lo == EOF || hi == EOF) return -1;
+    *v = (hi << 8) | lo;
+    return 0;
+}
+
+int write_object_file(const mic1_object* obj, const char* filename) {
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot create object file: %s\n", filename);
+        return -1;
+    }
+
+    fwrite(OBJ_MAGIC, 1, 4, fp);
+    put_u16(fp, OBJ_VERSION);
+    put_u16(fp, obj->load_address);
+    put_u16(fp, obj->entry);
+    put_u16(fp, obj->section_count);
+    put_u16(fp, obj->symbol_count);
+    put_u16(fp, obj->reloc_count);
+    put_u16(fp, obj->line_count);
+
+    for (int i = 0; i < obj->section_count; i++) {
+        const obj_section* s = &obj->sections[i];
+        put_u16(fp, s->type);
+        put_u16(fp, s->offset);
+        put_u16(fp, s->size);
+        for (int j = 0; j < s->size; j++) {
+            put_u16(fp, s->words[j]);
+        }
+    }
+
+    for (int i = 0; i < obj->symbol_count; i++) {
+        const obj_symbol* s = &obj->symbols[i];
+        size_t len = strlen(s->name);
+        put_u16(fp, s->flags);
+        put_u16(fp, s->value);
+        put_u8(fp, (int)len);
+        fwrite(s->name, 1, len, fp);
+    }
+
+    for (int i = 0; i < obj->reloc_count; i++) {
+        const obj_reloc* r = &obj->relocs[i];
+        put_u16(fp, r->offset);
+        put_u8(fp, r->kind);
+        put_u8(fp, r->bits);
+        put_u16(fp, r->symbol);
+    }
+
+    for (int i = 0; i < obj->line_count; i++) {
+        put_u16(fp, obj->lines[i].offset);
+        put_u16(fp, obj->lines[i].line);
+    }
+
+    int failed = ferror(fp);
+    fclose(fp);
+    return failed ? -1 : 0;
+}
+
+int is_object_file(const char* filename) {
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) return 0;
+
+    char magic[4];
+    int match = fread(magic, 1, 4, fp) == 4 && memcmp(magic, OBJ_MAGIC, 4) == 0;
+    fclose(fp);
+    return match;
+}
+
+int read_object_file(mic1_object* obj, const char* filename) {
+    init_object(obj);
+
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot open object file: %s\n", filename);
+        return -1;
+    }
+
+    char magic[4];
+    int version, load_address, entry, sections, symbols, relocs, lines;
+
+    if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, OBJ_MAGIC, 4) != 0 ||
+        get_u16(fp, &version) || version != OBJ_VERSION ||
+        get_u16(fp, &load_address) || get_u16(fp, &entry) ||
+        get_u16(fp, &sections) || get_u16(fp, &symbols) ||
+        get_u16(fp, &relocs) || get_u16(fp, &lines)) {
+        goto bad;
+    }
+    obj->load_address = (uint16_t)load_address;
+    obj->entry = (uint16_t)entry;
+
+    uint16_t words[65536 / 2];
+    for (int i = 0; i < sections; i++) {
+        int type, offset, size;
+        if (get_u16(fp, &type) || get_u16(fp, &offset) || get_u16(fp, &size)) goto bad;
+        if (size > (int)(sizeof(words) / sizeof(words[0]))) goto bad;
+        for (int j = 0; j < size; j++) {
+            int w;
+            if (get_u16(fp, &w)) goto bad;
+            words[j] = (uint16_t)w;
+        }
+        if (object_add_section(obj, type, (uint16_t)offset, words, (uint16_t)size) < 0) goto bad;
+    }
+
+    for (int i = 0; i < symbols; i++) {
+        int flags, value, len;
+        char name[OBJ_MAX_NAME + 1];
+        if (get_u16(fp, &flags) || get_u16(fp, &value) || get_u8(fp, &len)) goto bad;
+        if (len == 0 || fread(name, 1, len, fp) != (size_t)len) goto bad;
+        name[len] = '\0';
+        if (object_add_symbol(obj, name, flags, (uint16_t)value) < 0) goto bad;
+    }
+
+    for (int i = 0; i < relocs; i++) {
+        int offset, kind, bits, symbol;
+        if (get_u16(fp, &offset) || get_u8(fp, &kind) || get_u8(fp, &bits) ||
+            get_u16(fp, &symbol)) goto bad;
+        if (kind == OBJ_RELOC_SYM && symbol >= obj->symbol_count) goto bad;
+        if (object_add_reloc(obj, (uint16_t)offset, kind, bits, symbol) < 0) goto bad;
+    }
+
+    for (int i = 0; i < lines; i++) {
+        int offset, line;
+        if (get_u16(fp, &offset) || get_u16(fp, &line)) goto bad;
+        if (object_add_line(obj, (uint16_t)offset, line) < 0) goto bad;
+    }
+
+    fclose(fp);
+    return 0;
+
+bad:
+    fprintf(stderr, "Error: Malformed object file: %s\n", filename);
+    fclose(fp);
+    free_object(obj);
+    return -1;
+}
+
+/* ============================================================
+ * RELOCATION AND LINKING
+ * ============================================================ */
+
+/* Word at object offset `offset`, or NULL if no section covers it */
+static uint16_t* object_word(const mic1_object* obj, int offset) {
+    for (int i = 0; i < obj->section_count; i++) {
+        const obj_section* s = &obj->sections[i];
+        if (offset >= s->offset && offset < s->offset + s->size) {
+            return &s->words[offset - s->offset];
+        }
+    }
+    return NULL;
+}
+
+/* Add `delta` to the low `bits` of *word; -1 if the field overflows */
+static int patch_field(uint16_t* word, int bits, int delta) {
+    int mask = (1 << bits) - 1;
+    int value = (*word & mask) + delta;
+    if (value < 0 || value > mask) return -1;
+
+    *word = (uint16_t)((*word & ~mask) | value);
+    return 0;
+}
+
+/**
+ * Lay the object out at `base` in `image` (indexed by absolute address)
+ * and apply its relocations. Returns the first address past the object,
+ * or -1 on error.
+ */
+int object_image(const mic1_object* obj, int base, uint16_t* image, int capacity,
+                 char* error, size_t error_size) {
+    int end = base + object_size(obj);
+    if (base < 0 || end > capacity) {
+        snprintf(error, error_size, "Object does not fit at %03X (%d words)", base, end - base);
+        return -1;
+    }
+
+    for (int i = 0; i < obj->section_count; i++) {
+        const obj_section* s = &obj->sections[i];
+        memcpy(&image[base + s->offset], s->words, s->size * sizeof(uint16_t));
+    }
+
+    for (int i = 0; i < obj->reloc_count; i++) {
+        const obj_reloc* r = &obj->relocs[i];
+        int delta = base;
+
+        if (r->kind == OBJ_RELOC_SYM) {
+            const obj_symbol* sym = &obj->symbols[r->symbol];
+            if (sym->flags & OBJ_SYM_UNDEF) {
+                snprintf(error, error_size, "Undefined symbol: %s", sym->name);
+                return -1;
+            }
+            delta = sym->value + ((sym->flags & OBJ_SYM_ABS) ? 0 : base);
+        }
+
+        if (base + r->offset >= end ||
+            patch_field(&image[base + r->offset], r->bits, delta) != 0) {
+            snprintf(error, error_size, "Relocation overflow at %03X", base + r->offset);
+            return -1;
+        }
+    }
+
+    return end;
+}
+
+/**
+ * Concatenate `count` objects into `out`, resolving symbol references
+ * between them. The result is still relocatable (OBJ_RELOC_ABS only).
+ */
+int link_objects(mic1_object* out, const mic1_object* in, int count,
+                 char* error, size_t error_size) {
+    init_object(out);
+    if (count <= 0) {
+        snprintf(error, error_size, "No input objects");
+        return -1;
+    }
+
+    int offsets[count];
+    int cursor = 0;
+    for (int i = 0; i < count; i++) {
+        offsets[i] = cursor;
+        cursor += object_size(&in[i]);
+    }
+
+    /* Sections, globals and locals, shifted to their final offsets */
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < in[i].section_count; j++) {
+            const obj_section* s = &in[i].sections[j];
+            if (object_add_section(out, s->type, (uint16_t)(s->offset + offsets[i]),
+                                   s->words, s->size) < 0) goto oom;
+        }
+
+        for (int j = 0; j < in[i].symbol_count; j++) {
+            const obj_symbol* s = &in[i].symbols[j];
+            if (s->flags & OBJ_SYM_UNDEF) continue;
+
+            if ((s->flags & OBJ_SYM_GLOBAL) && object_find_symbol(out, s->name) >= 0) {
+                snprintf(error, error_size, "Duplicate symbol: %s", s->name);
+                goto fail;
+            }
+            int value = s->value + ((s->flags & OBJ_SYM_ABS) ? 0 : offsets[i]);
+            if (object_add_symbol(out, s->name, s->flags, (uint16_t)value) < 0) goto oom;
+        }
+
+        for (int j = 0; j < in[i].line_count; j++) {
+            if (object_add_line(out, (uint16_t)(in[i].lines[j].offset + offsets[i]),
+                                in[i].lines[j].line) < 0) goto oom;
+        }
+    }
+
+    /* Relocations: resolve symbol references, keep base-relative fixups */
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < in[i].reloc_count; j++) {
+            const obj_reloc* r = &in[i].relocs[j];
+            int offset = r->offset + offsets[i];
+            int delta = offsets[i];
+            int keep = 1;
+
+            if (r->kind == OBJ_RELOC_SYM) {
+                const obj_symbol* sym = &in[i].symbols[r->symbol];
+                if (sym->flags & OBJ_SYM_UNDEF) {
+                    int k = object_find_symbol(out, sym->name);
+                    if (k < 0 || (out->symbols[k].flags & OBJ_SYM_UNDEF)) {
+                        snprintf(error, error_size, "Undefined symbol: %s", sym->name);
+                        goto fail;
+                    }
+                    sym = &out->symbols[k];
+                    delta = sym->value;
+                } else {
+                    delta = sym->value + ((sym->flags & OBJ_SYM_ABS) ? 0 : offsets[i]);
+                }
+                keep = !(sym->flags & OBJ_SYM_ABS);
+            }
+
+            uint16_t* word = object_word(out, offset);
+            if (!word || patch_field(word, r->bits, delta) != 0) {
+                snprintf(error, error_size, "Relocation overflow at %03X", offset);
+                goto fail;
+            }
+            if (keep && object_add_reloc(out, (uint16_t)offset, OBJ_RELOC_ABS, r->bits, 0) < 0) {
+                goto oom;
+            }
+        }
+    }
+
+    out->load_address = in[0].load_address;
+    out->entry = in[0].entry;
+    return 0;
+
+oom:
+    snprintf(error, error_size, "Out of memory");
+fail:
+    free_object(out);
+    return -1;
+}
@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../include/profile.h"
+
+void init_profile(micro_profile* p) {
+    if (!p) return;
+
+    memset(p, 0, sizeof(*p));
+    p->current = PROFILE_NO_CLASS;
+}
+
+int profile_class(int instruction) {
+    if (instruction < 0) return PROFILE_NO_CLASS;
+
+    int opcode = (instruction >> 12) & 0xF;
+    return opcode == 0xF ? 16 + ((instruction >> 8) & 0xF) : opcode;
+}
+
+const char* profile_class_name(int cls) {
+    static const char* const names[PROFILE_CLASSES] = {
+        "LODD", "STOD", "ADDD", "SUBD", "JPOS", "JZER", "JUMP", "LOCO",
+        "LODL", "STOL", "ADDL", "SUBL", "JNEG", "JNZE", "CALL", "-",
+        "PSHI", "F1", "POPI", "F3", "PUSH", "F5", "POP", "F7",
+        "RETN", "F9", "SWAP", "FB", "INSP", "FD", "DESP", "FF"
+    };
+    return cls >= 0 && cls < PROFILE_CLASSES ? names[cls] : "?";
+}
+
+void profile_instruction(micro_profile* p, int instruction) {
+    p->current = profile_class(instruction);
+    p->instructions++;
+    if (p->current != PROFILE_NO_CLASS) {
+        p->class_instructions[p->current]++;
+    }
+}
+
+void profile_microcycle(micro_profile* p, const control_memory* cm, int mpc, int next_mpc) {
+    const micro_op* op = &cm->ops[mpc];
+
+    p->cycles++;
+    p->exec[mpc]++;
+    if (op->cond == COND_IF_N || op->cond == COND_IF_Z) {
+        if (next_mpc == op->addr && next_mpc != ((mpc + 1) & (cm->size - 1))) {
+            p->taken[mpc]++;
+        } else {
+            p->not_taken[mpc]++;
+        }
+    }
+    if (p->current != PROFILE_NO_CLASS) {
+        p->by_class[p->current][mpc]++;
+        p->class_cycles[p->current]++;
+    }
+}
+
+/*
+ * Maps addresses to lines of a text control store: the line each word
+ * was read from (counted the way load_microprogram counts them) and, for
+ * files written by mic1mal, the "# 0xAA  line N: text" comment before it.
+ */
+int load_profile_source(profile_source* src, const char* filename) {
+    if (!src || !filename) return -1;
+    memset(src, 0, sizeof(*src));
+
+    FILE* fp = fopen(filename, "r");
+    if (!fp) return -1;
+
+    char line[256];
+    int line_number = 0;
+    int address = 0;
+    int mal_line = 0;
+    char mal_text[64] = "";
+
+    while (fgets(line, sizeof(line), fp) && address < MICROPROGRAM_SIZE) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if (line[0] == '#') {
+            unsigned int comment_addr;
+            int comment_line, n = 0;
+            if (sscanf(line, "# 0x%x line %d: %n", &comment_addr, &comment_line, &n) == 2 && n > 0) {
+                mal_line = comment_line;
+                snprintf(mal_text, sizeof(mal_text), "%s", line + n);
+            }
+            continue;
+        }
+        if (line[0] == '@' || line[0] == ';' || line[0] == '\0') {
+            continue;
+        }
+
+        int bits = 0;
+        for (const char* c = line; *c; c++) {
+            if (*c == '0' || *c == '1') bits++;
+        }
+        if (bits != 32 && bits != 40) {
+            continue;
+        }
+
+        src->line[address] = line_number;
+        src->mal_line[address] = mal_line;
+        snprintf(src->text[address], sizeof(src->text[address]), "%s", mal_line ? mal_text : "");
+        mal_line = 0;
+        address++;
+    }
+
+    fclose(fp);
+    return address;
+}
+
+static void write_source(FILE* out, const profile_source* src, int addr) {
+    if (!src) return;
+    if (src->mal_line[addr]) {
+        fprintf(out, "  line %d: %s", src->mal_line[addr], src->text[addr]);
+    } else if (src->line[addr]) {
+        fprintf(out, "  line %d", src->line[addr]);
+    }
+}
+
+/* qsort has no context argument, so each entry carries its own count */
+typedef struct {
+    uint64_t exec;
+    int addr;
+} hot_address;
+
+/* Hottest address first */
+static int compare_addresses(const void* x, const void* y) {
+    const hot_address* a = x;
+    const hot_address* b = y;
+    if (a->exec != b->exec) {
+        return a->exec < b->exec ? 1 : -1;
+    }
+    return a->addr - b->addr;
+}
+
+int write_profile_report(const micro_profile* p, const profile_source* src, FILE* out) {
+    hot_address hot[MICROPROGRAM_SIZE];
+    int order[MICROPROGRAM_SIZE];
+    int used = 0;
+
+    for (int addr = 0; addr < MICROPROGRAM_SIZE; addr++) {
+        if (p->exec[addr]) {
+            hot[used].exec = p->exec[addr];
+            hot[used++].addr = addr;
+        }
+    }
+    qsort(hot, (size_t)used, sizeof(hot[0]), compare_addresses);
+    for (int i = 0; i < used; i++) order[i] = hot[i].addr;
+
+    fprintf(out, "Microcode profile: %llu microcycles, %llu instructions\n",
+            (unsigned long long)p->cycles, (unsigned long long)p->instructions);
+
+    fprintf(out, "\nMicroinstructions by execution count:\n");
+    fprintf(out, "  addr        exec       %%      taken  not taken  source\n");
+    for (int i = 0; i < used; i++) {
+        int addr = order[i];
+        fprintf(out, "  0x%02X  %10llu  %5.1f%%", addr, (unsigned long long)p->exec[addr],
+                100.0 * (double)p->exec[addr] / (double)p->cycles);
+        if (p->taken[addr] || p->not_taken[addr]) {
+            fprintf(out, "  %9llu  %9llu", (unsigned long long)p->taken[addr],
+                    (unsigned long long)p->not_taken[addr]);
+        } else {
+            fprintf(out, "  %9s  %9s", "", "");
+        }
+        write_source(out, src, addr);
+        fprintf(out, "\n");
+    }
+
+    fprintf(out, "\nInstructions:\n");
+    fprintf(out, "  class        count  microcycles  per instr  own microinstructions\n");
+    for (int cls = 0; cls < PROFILE_CLASSES; cls++) {
+        if (!p->class_instructions[cls]) continue;
+        fprintf(out, "  %-5s %10llu  %11llu  %9.2f ", profile_class_name(cls),
+                (unsigned long long)p->class_instructions[cls],
+                (unsigned long long)p->class_cycles[cls],
+                (double)p->class_cycles[cls] / (double)p->class_instructions[cls]);
+
+        /* Addresses only this class ran (its routine, not the shared fetch) */
+        int shown = 0;
+        for (int i = 0; i < used && shown < 6; i++) {
+            int addr = order[i];
+            if (p->by_class[cls][addr] && p->by_class[cls][addr] == p->exec[addr]) {
+                fprintf(out, " 0x%02X:%u", addr, p->by_class[cls][addr]);
+                shown++;
+            }
+        }
+        fprintf(out, "\n");
+    }
+
+    return ferror(out) ? -1 : 0;
+}
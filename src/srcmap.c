@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/srcmap.h"
+#include "../include/assembler.h"
+
+#define MAP_LINE_LENGTH 1024
+
+void init_source_map(source_map* map, const char* program, int is_map) {
+    memset(map, 0, sizeof(*map));
+    if (is_map) {
+        snprintf(map->file, sizeof(map->file), "%s", program);
+    } else {
+        assembler_map_file(map->file, sizeof(map->file), program);
+    }
+}
+
+static void free_labels(source_label* labels, int count) {
+    for (int i = 0; i < count; i++) {
+        free(labels[i].name);
+    }
+    free(labels);
+}
+
+void free_source_map(source_map* map) {
+    free_labels(map->labels, map->label_count);
+    free_labels(map->constants, map->constant_count);
+    free(map->text);
+    free(map->text_lines);
+    map->labels = map->constants = NULL;
+    map->label_count = map->constant_count = 0;
+    map->text = NULL;
+    map->text_lines = NULL;
+    map->text_line_count = 0;
+    map->state = map->text_state = SOURCE_MAP_UNREAD;
+}
+
+static int add_label(source_label** labels, int* count, int address, const char* name) {
+    source_label* grown = realloc(*labels, (size_t)(*count + 1) * sizeof(source_label));
+    if (!grown) return -1;
+    *labels = grown;
+
+    source_label* l = &grown[*count];
+    l->address = address;
+    l->order = *count;
+    l->name = malloc(strlen(name) + 1);
+    if (!l->name) return -1;
+    strcpy(l->name, name);
+    (*count)++;
+    return 0;
+}
+
+static int by_address(const void* a, const void* b) {
+    const source_label* x = a;
+    const source_label* y = b;
+    if (x->address != y->address) return x->address - y->address;
+    return x->order - y->order;
+}
+
+int load_source_map(source_map* map) {
+    free_source_map(map);
+    memset(map->line, 0, sizeof(map->line));
+    map->source[0] = '\0';
+    map->state = SOURCE_MAP_MISSING;
+
+    FILE* fp = fopen(map->file, "r");
+    if (!fp) return -1;
+
+    char line[MAP_LINE_LENGTH];
+    int words = 0;
+    int version = 0;
+
+    if (!fgets(line, sizeof(line), fp) || sscanf(line, "mic1map %d", &version) != 1 || version != 1) {
+        fclose(fp);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        size_t length = strcspn(line, "\r\n");
+        if (line[length] == '\0' && !feof(fp)) {
+            /* Longer than the buffer: skip the rest of it */
+            int c;
+            while ((c = fgetc(fp)) != EOF && c != '\n') {}
+            continue;
+        }
+        line[length] = '\0';
+
+        unsigned int address;
+        int source_line, count = 1, n = 0;
+
+        if (strncmp(line, "source ", 7) == 0) {
+            /* A path too long to keep is dropped, never truncated */
+            size_t path = length - 7;
+            if (path < sizeof(map->source)) memcpy(map->source, line + 7, path + 1);
+        } else if (sscanf(line, "line %x %d %d", &address, &source_line, &count) >= 2) {
+            for (int i = 0; i < count && address + i < MEMORY_SIZE; i++) {
+                map->line[address + i] = source_line;
+                words++;
+            }
+        } else if (sscanf(line, "label %x %n", &address, &n) == 1 && n > 0) {
+            if (add_label(&map->labels, &map->label_count, (int)address, line + n) != 0) break;
+        } else if (sscanf(line, "equ %x %n", &address, &n) == 1 && n > 0) {
+            if (add_label(&map->constants, &map->constant_count, (int)address, line + n) != 0) break;
+        }
+    }
+    fclose(fp);
+
+    qsort(map->labels, (size_t)map->label_count, sizeof(source_label), by_address);
+    map->state = SOURCE_MAP_LOADED;
+    return words;
+}
+
+/* Read the map on first use; 1 if there is one */
+static int have_map(source_map* map) {
+    if (map->state == SOURCE_MAP_UNREAD) {
+        load_source_map(map);
+    }
+    return map->state == SOURCE_MAP_LOADED;
+}
+
+int source_map_line(source_map* map, int address) {
+    if (!have_map(map) || address < 0 || address >= MEMORY_SIZE) return 0;
+    return map->line[address];
+}
+
+const char* source_map_label(source_map* map, int address, int* offset) {
+    if (!have_map(map)) return NULL;
+
+    /* Last label at or below the address; the first of several at the same one */
+    int lo = 0, hi = map->label_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (map->labels[mid].address <= address) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) return NULL;
+
+    int found = lo - 1;
+    while (found > 0 && map->labels[found - 1].address == map->labels[found].address) {
+        found--;
+    }
+    if (offset) *offset = address - map->labels[found].address;
+    return map->labels[found].name;
+}
+
+int source_map_symbol(source_map* map, const char* name) {
+    if (!have_map(map)) return -1;
+
+    for (int i = 0; i < map->label_count; i++) {
+        if (strcmp(map->labels[i].name, name) == 0) return map->labels[i].address;
+    }
+    for (int i = 0; i < map->constant_count; i++) {
+        if (strcmp(map->constants[i].name, name) == 0) return map->constants[i].address;
+    }
+    return -1;
+}
+
+/* The source as named in the map, else next to the map under the same file name */
+static FILE* open_source_text(const source_map* map) {
+    FILE* fp = fopen(map->source, "rb");
+    if (fp || map->source[0] == '/') return fp;
+
+    const char* slash = strrchr(map->file, '/');
+    if (!slash) return NULL;
+
+    const char* base = strrchr(map->source, '/');
+    char path[1024];
+    snprintf(path, sizeof(path), "%.*s/%s", (int)(slash - map->file), map->file,
+             base ? base + 1 : map->source);
+    return fopen(path, "rb");
+}
+
+static int load_text(source_map* map) {
+    map->text_state = SOURCE_MAP_MISSING;
+    if (!have_map(map) || !map->source[0]) return -1;
+
+    FILE* fp = open_source_text(map);
+    if (!fp) return -1;
+
+    size_t size = 0, capacity = 4096;
+    char* text = malloc(capacity);
+    size_t n;
+    while (text && (n = fread(text + size, 1, capacity - size - 1, fp)) > 0) {
+        size += n;
+        if (size + 1 == capacity) {
+            char* grown = realloc(text, capacity * 2);
+            if (!grown) {
+                free(text);
+                text = NULL;
+                break;
+            }
+            text = grown;
+            capacity *= 2;
+        }
+    }
+    fclose(fp);
+    if (!text) return -1;
+    text[size] = '\0';
+
+    int count = 1;
+    for (size_t i = 0; i < size; i++) {
+        if (text[i] == '\n') count++;
+    }
+    int* lines = malloc((size_t)count * sizeof(int));
+    if (!lines) {
+        free(text);
+        return -1;
+    }
+
+    count = 0;
+    lines[count++] = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (text[i] == '\n') lines[count++] = (int)i + 1;
+    }
+
+    map->text = text;
+    map->text_lines = lines;
+    map->text_line_count = count;
+    map->text_state = SOURCE_MAP_LOADED;
+    return 0;
+}
+
+const char* source_map_text(source_map* map, int line, int* length) {
+    if (map->text_state == SOURCE_MAP_UNREAD) {
+        load_text(map);
+    }
+    if (map->text_state != SOURCE_MAP_LOADED || line < 1 || line > map->text_line_count) {
+        return NULL;
+    }
+
+    const char* start = map->text + map->text_lines[line - 1];
+    if (length) *length = (int)strcspn(start, "\r\n");
+    return start;
+}
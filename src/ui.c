@@ -193,10 +193,24 @@ void ui_draw_registers(int x, int y, mic1_cpu *cpu) {
     tb_print(x + 9, y + 7, UI_COLOR_MNEMONIC, TB_DEFAULT, buf);
 }
 
-void ui_draw_code(int x, int y, int w, int h, mic1_cpu *cpu, int highlight_pc) {
-    ui_draw_box(x, y, w, h, "Code", UI_COLOR_BORDER);
-
+void ui_draw_code(int x, int y, int w, int h, mic1_cpu *cpu, int highlight_pc, source_map *map) {
     int pc = bits_to_int(cpu->reg_bank.PC.data, 16);
+
+    /* With a source map the title shows the source line at the PC */
+    char title[64] = "Code";
+    int line = map ? source_map_line(map, pc) : 0;
+    if (line) {
+        int length = 0;
+        const char *text = source_map_text(map, line, &length);
+        while (text && length > 0 && (*text == ' ' || *text == '\t')) {
+            text++;
+            length--;
+        }
+        snprintf(title, sizeof(title), "%d: %.*s", line, text ? length : 0, text ? text : "");
+        if (w > 6 && (int)strlen(title) > w - 6) title[w - 6] = '\0';
+    }
+    ui_draw_box(x, y, w, h, title, UI_COLOR_BORDER);
+
     int visible_lines = h - 2;
     int start_addr = pc - visible_lines / 2;
     if (start_addr < 0) start_addr = 0;
@@ -238,6 +252,15 @@ void ui_draw_code(int x, int y, int w, int h, mic1_cpu *cpu, int highlight_pc) {
         int operand = instr & 0x0FFF;
         if (opcode == 6 && operand == addr) {
             tb_print(x + 22, row, TB_RED, bg, "[HALT]");
+            continue;
+        }
+
+        /* Label defined at this address */
+        int offset = 0;
+        const char *label = map ? source_map_label(map, addr, &offset) : NULL;
+        if (label && offset == 0 && w > 24) {
+            snprintf(buf, sizeof(buf), "%.*s", w - 24, label);
+            tb_print(x + 22, row, is_current ? fg : UI_COLOR_LABEL, bg, buf);
         }
     }
 }
@@ -288,14 +311,16 @@ void ui_draw_memory(int x, int y, int w, int h, mic1_cpu *cpu, int start_addr) {
         for (int j = 0; j < 8 && (addr + j) < MEMORY_SIZE; j++) {
             int val = bits_to_int(cpu->main_memory.data[addr + j], 16);
             sprintf(buf, "%04X", val);
-            tb_print(col, row, TB_WHITE, TB_DEFAULT, buf);
+            /* Watched words are shown in red */
+            uint16_t fg = cpu->watch.flags[addr + j] ? (TB_RED | TB_BOLD) : TB_WHITE;
+            tb_print(col, row, fg, TB_DEFAULT, buf);
             col += 5;
         }
     }
 }
 
 void ui_draw_help(int x, int y) {
-    int w = 26, h = 10;
+    int w = 26, h = 11;
     ui_draw_box(x, y, w, h, "Controls", UI_COLOR_BORDER);
 
     tb_print(x + 2, y + 2, UI_COLOR_LABEL, TB_DEFAULT, "s");
@@ -313,8 +338,14 @@ void ui_draw_help(int x, int y) {
     tb_print(x + 2, y + 6, UI_COLOR_LABEL, TB_DEFAULT, "m");
     tb_print(x + 5, y + 6, UI_COLOR_HELP, TB_DEFAULT, "Memory view");
 
-    tb_print(x + 2, y + 7, UI_COLOR_LABEL, TB_DEFAULT, "q/ESC");
-    tb_print(x + 8, y + 7, UI_COLOR_HELP, TB_DEFAULT, "Quit");
+    tb_print(x + 2, y + 7, UI_COLOR_LABEL, TB_DEFAULT, "w");
+    tb_print(x + 5, y + 7, UI_COLOR_HELP, TB_DEFAULT, "Watch mem addr");
+
+    tb_print(x + 2, y + 8, UI_COLOR_LABEL, TB_DEFAULT, "e/u");
+    tb_print(x + 6, y + 8, UI_COLOR_HELP, TB_DEFAULT, "Edit/reload .asm");
+
+    tb_print(x + 2, y + 9, UI_COLOR_LABEL, TB_DEFAULT, "q/ESC");
+    tb_print(x + 8, y + 9, UI_COLOR_HELP, TB_DEFAULT, "Quit");
 }
 
 void ui_draw_status(int y, ui_state_t *state) {
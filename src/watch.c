@@ -0,0 +1,109 @@
+#include "../include/watch.h"
+#include <stdlib.h>
+#include <string.h>
+
+void init_watch_table(watch_table* w) {
+    if (!w) return;
+
+    memset(w->flags, 0, sizeof(w->flags));
+    w->active = 0;
+    memset(&w->hit, 0, sizeof(w->hit));
+}
+
+/**
+ * Add `kind` flags to every word in [start, end].
+ * Returns 0 on success, -1 on a bad range or kind.
+ */
+int set_watchpoint(watch_table* w, int start, int end, int kind) {
+    if (!w) return -1;
+    if (start < 0 || end >= MEMORY_SIZE || start > end) return -1;
+    if ((kind & (WATCH_READ | WATCH_WRITE | WATCH_CHANGE)) == 0) return -1;
+
+    for (int addr = start; addr <= end; addr++) {
+        if (w->flags[addr] == 0) w->active++;
+        w->flags[addr] |= (unsigned char)kind;
+    }
+    return 0;
+}
+
+int clear_watchpoint(watch_table* w, int start, int end) {
+    if (!w) return -1;
+    if (start < 0 || end >= MEMORY_SIZE || start > end) return -1;
+
+    for (int addr = start; addr <= end; addr++) {
+        if (w->flags[addr] != 0) w->active--;
+        w->flags[addr] = 0;
+    }
+    return 0;
+}
+
+/**
+ * Slow path, only reached for a word that has flags set.
+ * `kind` is WATCH_READ or WATCH_WRITE; a write also fires WATCH_CHANGE
+ * when the value differs.
+ */
+void watch_access(watch_table* w, int address, int kind, int old_value, int new_value) {
+    if (!w || address < 0 || address >= MEMORY_SIZE) return;
+
+    int flags = w->flags[address];
+    int fired = flags & kind;
+    if (kind == WATCH_WRITE && (flags & WATCH_CHANGE) && old_value != new_value) {
+        fired |= WATCH_CHANGE;
+    }
+    if (!fired) return;
+
+    w->hit.count++;
+    if (w->hit.pending) return;
+
+    w->hit.pending = 1;
+    w->hit.kind = fired;
+    w->hit.address = address;
+    w->hit.old_value = old_value;
+    w->hit.new_value = new_value;
+}
+
+/**
+ * Parse "ADDR[-END][:rwc]" (default kind: w).
+ * Returns 0 on success, -1 on a malformed spec.
+ */
+int parse_watch_spec(const char* spec, int* start, int* end, int* kind) {
+    if (!spec || !start || !end || !kind) return -1;
+
+    char* p;
+    long lo = strtol(spec, &p, 0);
+    if (p == spec) return -1;
+
+    long hi = lo;
+    if (*p == '-') {
+        const char* q = p + 1;
+        hi = strtol(q, &p, 0);
+        if (p == q) return -1;
+    }
+
+    int k = 0;
+    if (*p == ':') {
+        for (p++; *p; p++) {
+            if (*p == 'r') k |= WATCH_READ;
+            else if (*p == 'w') k |= WATCH_WRITE;
+            else if (*p == 'c') k |= WATCH_CHANGE;
+            else return -1;
+        }
+    } else if (*p != '\0') {
+        return -1;
+    }
+    if (k == 0) k = WATCH_WRITE;
+
+    if (lo < 0 || hi >= MEMORY_SIZE || lo > hi) return -1;
+
+    *start = (int)lo;
+    *end = (int)hi;
+    *kind = k;
+    return 0;
+}
+
+const char* watch_kind_name(int kind) {
+    if (kind & WATCH_CHANGE) return "change";
+    if (kind & WATCH_WRITE) return "write";
+    if (kind & WATCH_READ) return "read";
+    return "none";
+}
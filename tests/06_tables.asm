@@ -0,0 +1,56 @@
+; ============================================================================
+; TEST 06: TABLES - Data Directives, Constants and Macros
+; ============================================================================
+; OBJECTIVE: Walk a lookup table through a pointer and sum its entries
+; STRATEGY: .word lays out the table, .equ names the sizes, a macro does
+;           the indirect load (LODD ptr / PSHI / POP), .org places the halt
+; EXPECTED RESULTS:
+;   - Sum of the squares 0..15 accumulated word by word
+;   - Memory [768] = 1240 (0 + 1 + 4 + ... + 225)
+; ============================================================================
+
+.equ LEN, 16                ; table entries
+.equ RESULT, 0x300          ; where the sum ends up
+
+; AC <- memory[memory[ptr]]
+.macro LOADI ptr
+        LODD ptr
+        PSHI                ; push memory[AC]
+        POP
+.endm
+
+        JUMP main
+
+squares: .word 0, 1, 4, 9, 16, 25, 36, 49
+         .word 64, 81, 100, 121, 144, 169, 196, 225
+ptr:    .word squares       ; next entry to read
+count:  .word LEN
+sum:    .word 0
+one:    .word 1
+
+; Sum loop: one table read per iteration
+main:   LOADI ptr
+        ADDD sum
+        STOD sum
+        LODD ptr            ; advance the pointer
+        ADDD one
+        STOD ptr
+        LODD count
+        SUBD one
+        STOD count
+        JNZE main
+
+        LODD sum
+        STOD RESULT         ; Memory[768] <- 1240
+        JUMP halt
+
+.org 0x80
+halt:   JUMP halt           ; Infinite loop
+
+; ============================================================================
+; EXPECTED FINAL MEMORY STATE:
+;   [768] = 1240      ; Sum of the table
+;   [ptr] = squares + LEN, [count] = 0
+; EXPECTED REGISTER STATE:
+;   AC = 1240
+; ============================================================================
@@ -0,0 +1,203 @@
+/*
+ * bench_assembler.c - Assembler throughput
+ *
+ * Purpose: Assemble synthetic sources of 1K to 1M lines and report lines
+ *          per second and peak memory, both for a source held in memory
+ *          (assembler_run) and for one piped in as it is generated
+ *          (assembler_stream).
+ *
+ * Usage:   bench_assembler [max_lines]
+ *
+ * The source repeats a block of eight lines: a comment, a .equ, a
+ * labelled LODD of the constant, an ADDD back to the label, a JZER to
+ * the next block (the last one to the first), a STOD, a blank line and
+ * a .word of two values. An image holds at most MAX_INSTRUCTIONS words,
+ * so once the address space is full the code lines turn into .equ lines
+ * referring to earlier constants, labels on their own and comments;
+ * symbols keep growing.
+ * Each measurement runs in its own process so peak memory is its own.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "../../include/assembler.h"
+
+#define BLOCK_LINES 8
+#define BLOCK_WORDS 6
+#define CODE_BLOCKS ((MAX_INSTRUCTIONS - 1) / BLOCK_WORDS)
+#define LINE_BYTES 64
+
+/* Line `i` of an n-line synthetic source, into out; returns its length */
+static int synthetic_line(char* out, long i, long n) {
+    long b = i / BLOCK_LINES;
+    long next = (b + 1) * BLOCK_LINES < n ? b + 1 : 0;
+
+    if (b < CODE_BLOCKS) {
+        switch (i % BLOCK_LINES) {
+            case 0: return snprintf(out, LINE_BYTES, "; block %ld\n", b);
+            case 1: return snprintf(out, LINE_BYTES, ".equ K%ld, %ld\n", b, b % 4096);
+            case 2: return snprintf(out, LINE_BYTES, "L%ld:    LODD K%ld\n", b, b);
+            case 3: return snprintf(out, LINE_BYTES, "        ADDD L%ld\n", b);
+            case 4: return snprintf(out, LINE_BYTES, "        JZER L%ld\n", next);
+            case 5: return snprintf(out, LINE_BYTES, "        STOD 0x300  ; result\n");
+            case 6: return snprintf(out, LINE_BYTES, "\n");
+            default: return snprintf(out, LINE_BYTES, "        .word %ld, L%ld\n", b, b);
+        }
+    }
+
+    switch (i % BLOCK_LINES) {
+        case 0: return snprintf(out, LINE_BYTES, "; block %ld\n", b);
+        case 1: return snprintf(out, LINE_BYTES, ".equ K%ld, %ld\n", b, b % 4096);
+        case 2: return snprintf(out, LINE_BYTES, "L%ld:\n", b);
+        case 3: return snprintf(out, LINE_BYTES, ".equ C%ld, K%ld+1\n", b, b - 1);
+        case 4: return snprintf(out, LINE_BYTES, "; JZER L%ld\n", next);
+        case 5: return snprintf(out, LINE_BYTES, ".equ D%ld, C%ld\n", b, b);
+        case 6: return snprintf(out, LINE_BYTES, "\n");
+        default: return snprintf(out, LINE_BYTES, "        ; .word %ld, L%ld\n", b, b);
+    }
+}
+
+/* Lines up to a whole block, so every forward label gets defined */
+static long round_lines(long lines) {
+    return (lines + BLOCK_LINES - 1) / BLOCK_LINES * BLOCK_LINES;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static long peak_kb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+typedef struct {
+    int fd;
+    long lines;
+    long bytes;
+} feeder_t;
+
+/* The generator end of the pipe: one line at a time, never the whole source */
+static void* feed_lines(void* arg) {
+    feeder_t* f = arg;
+    char buf[64 * LINE_BYTES];
+    int used = 0;
+
+    for (long i = 0; i < f->lines; i++) {
+        used += synthetic_line(buf + used, i, f->lines);
+        if (used > (int)sizeof(buf) - LINE_BYTES || i == f->lines - 1) {
+            if (write(f->fd, buf, (size_t)used) != used) break;
+            f->bytes += used;
+            used = 0;
+        }
+    }
+    close(f->fd);
+    return NULL;
+}
+
+static void report(const char* mode, long lines, long bytes, const assembler_t* as, int words,
+                   double seconds) {
+    printf("%-7s %9ld %8.1f %6d %8d %9.1f %12.0f %8.1f %9.1f\n", mode, lines,
+           (double)bytes / (1024.0 * 1024.0), words, as->symbol_count, seconds * 1000.0,
+           (double)lines / seconds, (double)bytes / (1024.0 * 1024.0) / seconds,
+           (double)peak_kb() / 1024.0);
+}
+
+/* Whole source in memory, then assembler_run */
+static int bench_string(long lines) {
+    char* source = malloc((size_t)lines * LINE_BYTES + 1);
+    if (!source) return 1;
+
+    long bytes = 0;
+    for (long i = 0; i < lines; i++) {
+        bytes += synthetic_line(source + bytes, i, lines);
+    }
+    source[bytes] = '\0';
+
+    static assembler_t as;
+    static uint16_t image[MAX_INSTRUCTIONS];
+    int size = 0;
+
+    init_assembler(&as);
+    double start = now();
+    int result = assembler_run(&as, source, image, MAX_INSTRUCTIONS, &size);
+    double seconds = now() - start;
+
+    if (result != 0) {
+        fprintf(stderr, "line %d: %s\n", as.error_line, as.error_msg);
+    } else {
+        report("string", lines, bytes, &as, size, seconds);
+    }
+    free_assembler(&as);
+    free(source);
+    return result != 0;
+}
+
+/* Source generated into a pipe while assembler_stream reads it */
+static int bench_stream(long lines) {
+    int in[2];
+    int out = open("/dev/null", O_WRONLY);
+    if (out < 0 || pipe(in) != 0) return 1;
+
+    feeder_t feeder = { in[1], lines, 0 };
+    pthread_t thread;
+    static assembler_t as;
+    int size = 0;
+
+    init_assembler(&as);
+    double start = now();
+    pthread_create(&thread, NULL, feed_lines, &feeder);
+    int result = assembler_stream(&as, in[0], out, &size);
+    pthread_join(thread, NULL);
+    double seconds = now() - start;
+
+    if (result != 0) {
+        fprintf(stderr, "line %d: %s\n", as.error_line, as.error_msg);
+    } else {
+        report("stream", lines, feeder.bytes, &as, size, seconds);
+    }
+    free_assembler(&as);
+    close(in[0]);
+    close(out);
+    return result != 0;
+}
+
+/* One measurement in a child process, so its peak memory is its own */
+static int measure(int (*bench)(long), long lines) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) return 1;
+    if (pid == 0) {
+        int failed = bench(lines);
+        fflush(stdout);
+        _exit(failed);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) != pid) return 1;
+    return !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+int main(int argc, char* argv[]) {
+    long max_lines = argc > 1 ? atol(argv[1]) : 1000000;
+    int failures = 0;
+
+    printf("%-7s %9s %8s %6s %8s %9s %12s %8s %9s\n", "mode", "lines", "MiB", "words",
+           "symbols", "ms", "lines/s", "MiB/s", "peak MiB");
+    for (long lines = 1000; lines <= max_lines; lines *= 10) {
+        failures += measure(bench_string, round_lines(lines));
+        failures += measure(bench_stream, round_lines(lines));
+    }
+    return failures != 0;
+}
@@ -0,0 +1,336 @@
+/*
+ * fuzz_assembler.c - Random input for the assembler
+ *
+ * Purpose: Feed assemble_string generated and mutated sources, nested
+ *          macro stacks included, to catch crashes, hangs and overruns in
+ *          its buffers. Each input is also run through assembler_update
+ *          on a long-lived context and through assembler_stream over a
+ *          pipe; all three must agree.
+ *
+ * Usage:   fuzz_assembler [iterations] [seed]
+ *
+ * A crash, hang (over HANG_SECONDS on one input) or disagreement leaves
+ * the input in fuzz-crash.asm. Build with -fsanitize=address,undefined
+ * (the default here) so overruns abort instead of passing silently;
+ * with clang, -DFUZZ_LIBFUZZER -fsanitize=fuzzer builds the same check
+ * as a libFuzzer target.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../../include/assembler.h"
+
+#define MAX_INPUT 8192
+#define HANG_SECONDS 10
+#define CRASH_FILE "fuzz-crash.asm"
+
+static const char* TOKENS[] = {
+    "LODD", "STOD", "ADDD", "SUBD", "JPOS", "JZER", "JUMP", "LOCO", "LODL", "STOL",
+    "ADDL", "SUBL", "JNEG", "JNZE", "CALL", "PSHI", "POPI", "PUSH", "POP", "RETN",
+    "SWAP", "INSP", "DESP", "lodd", "Jump",
+    ".org", ".word", ".space", ".fill", ".equ", ".global", ".macro", ".endm", ".bogus",
+    "a", "b", "loop", "end", "N", "M", "table", "x1",
+    "0", "1", "255", "4095", "4096", "65535", "65536", "-1", "-32768", "-32769",
+    "0x", "0xFFF", "0x1000", "0xFFFF", "99999999999",
+    ":", ",", "+", "-", ";", " ", "\t", "\r", "a+1", "table-3", "a+N", "+", "::",
+};
+
+/* M0 emits nothing and M1..M15 call the level below 12 times: 12^15
+ * expansions with no words to hit the image limit */
+#define TWELVE(line) line line line line line line line line line line line line
+#define LEVEL(n, below) ".macro M" #n "\n" TWELVE(" M" #below "\n") ".endm\n"
+#define NESTED_SEED ".macro M0\n .space 0\n.endm\n" \
+    LEVEL(1, 0) LEVEL(2, 1) LEVEL(3, 2) LEVEL(4, 3) LEVEL(5, 4) LEVEL(6, 5) LEVEL(7, 6) \
+    LEVEL(8, 7) LEVEL(9, 8) LEVEL(10, 9) LEVEL(11, 10) LEVEL(12, 11) LEVEL(13, 12) \
+    LEVEL(14, 13) LEVEL(15, 14) " M15\n"
+
+static const char* SEEDS[] = {
+    "        LOCO 3\nloop:   SUBD one\n        JNZE loop\ndone:   JUMP done\none:    LOCO 1\n",
+    ".equ N, 3\n.macro COPY d, s\n LODD s\n STOD d\n.endm\n JUMP main\n"
+    "t: .word 5, -1, t+N\n .space 2\n .fill N, 7\nmain: COPY 0x300, t+1\n.org 0x20\nend: JUMP end\n",
+    ".global f\nf: CALL g\n RETN\ng: INSP 2\n DESP 2\n RETN\n",
+    ".macro M a\n M a\n.endm\n M 1\n",
+    NESTED_SEED,        /* last: only run as written */
+};
+
+static char current[MAX_INPUT + 1];
+static size_t current_size;
+
+/* Leave the input that failed in CRASH_FILE; async-signal-safe */
+static void save_input(void) {
+    int fd = open(CRASH_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        ssize_t n = write(fd, current, current_size);
+        (void)n;
+        close(fd);
+    }
+}
+
+static void on_signal(int sig) {
+    static const char hang[] = "\nfuzz: hang, input saved in " CRASH_FILE "\n";
+    static const char crash[] = "\nfuzz: crash, input saved in " CRASH_FILE "\n";
+    ssize_t n;
+
+    save_input();
+    if (sig == SIGALRM) {
+        n = write(STDOUT_FILENO, hang, sizeof(hang) - 1);
+    } else {
+        n = write(STDOUT_FILENO, crash, sizeof(crash) - 1);
+    }
+    (void)n;
+    _exit(2);
+}
+
+/* assembler_stream over pipes; inputs are small enough for the pipe buffers */
+static int stream_source(assembler_t* as, const char* source, uint16_t* image, int* size) {
+    int in[2], out[2];
+    int result = -1;
+
+    if (pipe(in) != 0) return -2;
+    if (pipe(out) != 0) {
+        close(in[0]);
+        close(in[1]);
+        return -2;
+    }
+
+    ssize_t n = write(in[1], source, strlen(source));
+    close(in[1]);
+    if (n == (ssize_t)strlen(source)) {
+        result = assembler_stream(as, in[0], out[1], size);
+    }
+    close(in[0]);
+    close(out[1]);
+
+    size_t got = 0;
+    while (got < MAX_INSTRUCTIONS * sizeof(uint16_t)) {
+        ssize_t r = read(out[0], (char*)image + got, MAX_INSTRUCTIONS * sizeof(uint16_t) - got);
+        if (r <= 0) break;
+        got += (size_t)r;
+    }
+    close(out[0]);
+    return result == 0 && got != (size_t)*size * sizeof(uint16_t) ? -2 : result;
+}
+
+/* One input through every entry point; 0 if they agree */
+static int check_input(const char* source) {
+    static assembler_t updater;
+    static int updater_ready;
+    static uint16_t image[MAX_INSTRUCTIONS];
+    static int image_size;
+    uint16_t expected[MAX_INSTRUCTIONS];
+    uint16_t streamed[MAX_INSTRUCTIONS];
+    int expected_size = 0;
+    int streamed_size = 0;
+
+    if (!updater_ready) {
+        init_assembler(&updater);
+        updater_ready = 1;
+    }
+
+    int ok = assemble_string(source, expected, &expected_size) == 0;
+
+    /* A failed update leaves the image as it was; the next call starts over */
+    int updated = assembler_update(&updater, source, image, MAX_INSTRUCTIONS, &image_size) == 0;
+    if (updated != ok || (ok && (image_size != expected_size ||
+        memcmp(image, expected, (size_t)expected_size * sizeof(uint16_t)) != 0))) {
+        printf("\nfuzz: assembler_update disagrees with assemble_string\n");
+        return -1;
+    }
+
+    assembler_t as;
+    init_assembler(&as);
+    int streamed_ok = stream_source(&as, source, streamed, &streamed_size);
+    free_assembler(&as);
+
+    if (streamed_ok == -2 || (streamed_ok == 0) != ok) {
+        printf("\nfuzz: assembler_stream disagrees with assemble_string\n");
+        return -1;
+    }
+    if (ok && (streamed_size != expected_size ||
+        memcmp(streamed, expected, (size_t)expected_size * sizeof(uint16_t)) != 0)) {
+        printf("\nfuzz: assembler_stream output differs\n");
+        return -1;
+    }
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size > MAX_INPUT) size = MAX_INPUT;
+
+    /* The source is a C string: stop at the first NUL */
+    memcpy(current, data, size);
+    current[size] = '\0';
+    current_size = strlen(current);
+
+    if (check_input(current) != 0) {
+        save_input();
+        abort();
+    }
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+
+static unsigned long long rng_state;
+
+static unsigned rng(void) {
+    rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned)(rng_state >> 33);
+}
+
+static void append(char* buf, size_t* len, const char* text, size_t n) {
+    if (*len + n > MAX_INPUT) n = MAX_INPUT - *len;
+    memcpy(buf + *len, text, n);
+    *len += n;
+}
+
+/* N1..Nd each call the macro below a few times, then one call of Nd.
+ * Mostly small enough to assemble; one in 32 runs into the expansion
+ * budget, which costs a second or so under the sanitizers */
+static void append_nested(char* buf, size_t* len) {
+    static const char* BODIES[] = {
+        " .space 0\n", " LOCO x\n", " .word x, 1\n", " .fill x, 2\n", " N0 x\n", " JUMP x\n",
+    };
+    int huge = rng() % 32 == 0;
+    int depth = 1 + (int)(rng() % (huge ? 16 : 8));
+    int fanout = huge ? 12 : 4;
+    char line[64];
+
+    append(buf, len, ".macro N0 x\n", 12);
+    for (int i = (int)(rng() % 3); i >= 0; i--) {
+        const char* body = BODIES[rng() % (sizeof(BODIES) / sizeof(BODIES[0]))];
+        append(buf, len, body, strlen(body));
+    }
+    append(buf, len, ".endm\n", 6);
+
+    for (int d = 1; d <= depth; d++) {
+        int n = snprintf(line, sizeof(line), ".macro N%d x\n", d);
+        append(buf, len, line, (size_t)n);
+        for (int i = 1 + (int)(rng() % fanout); i > 0; i--) {
+            n = snprintf(line, sizeof(line), " N%d x\n", d - 1);
+            append(buf, len, line, (size_t)n);
+        }
+        append(buf, len, ".endm\n", 6);
+    }
+
+    int n = snprintf(line, sizeof(line), " N%d %u\n", depth, rng() % 8);
+    append(buf, len, line, (size_t)n);
+}
+
+/* Lines of tokens from the dictionary, now and then a long run or raw
+ * bytes, and sometimes a stack of nested macros */
+static size_t generate(char* buf) {
+    size_t len = 0;
+    int lines = 1 + (int)(rng() % 40);
+
+    if (rng() % 4 == 0) append_nested(buf, &len);
+
+    for (int l = 0; l < lines && len < MAX_INPUT; l++) {
+        int tokens = (int)(rng() % 6);
+        for (int t = 0; t < tokens; t++) {
+            unsigned pick = rng() % 100;
+            if (pick < 85) {
+                const char* tok = TOKENS[rng() % (sizeof(TOKENS) / sizeof(TOKENS[0]))];
+                append(buf, &len, tok, strlen(tok));
+            } else if (pick < 95) {
+                char run[400];
+                size_t n = 200 + rng() % 200;
+                memset(run, "ax9 ;"[rng() % 5], n);
+                append(buf, &len, run, n);
+            } else {
+                char byte = (char)(1 + rng() % 255);
+                append(buf, &len, &byte, 1);
+            }
+            if (rng() % 3) append(buf, &len, " ", 1);
+        }
+        append(buf, &len, "\n", 1);
+    }
+    return len;
+}
+
+/* A seed program with a few bytes or lines changed */
+static size_t mutate(char* buf) {
+    const char* seed = SEEDS[rng() % (sizeof(SEEDS) / sizeof(SEEDS[0]) - 1)];
+    size_t len = strlen(seed);
+    int edits = 1 + (int)(rng() % 4);
+
+    memcpy(buf, seed, len);
+    for (int e = 0; e < edits && len > 0; e++) {
+        size_t at = rng() % len;
+        switch (rng() % 4) {
+            case 0:     /* flip a byte */
+                buf[at] = (char)(1 + rng() % 255);
+                break;
+            case 1:     /* drop a byte */
+                memmove(buf + at, buf + at + 1, len - at - 1);
+                len--;
+                break;
+            case 2: {   /* insert a token */
+                const char* tok = TOKENS[rng() % (sizeof(TOKENS) / sizeof(TOKENS[0]))];
+                size_t n = strlen(tok);
+                if (len + n <= MAX_INPUT) {
+                    memmove(buf + at + n, buf + at, len - at);
+                    memcpy(buf + at, tok, n);
+                    len += n;
+                }
+                break;
+            }
+            default: {  /* duplicate a stretch */
+                size_t n = rng() % 64;
+                if (at + n > len) n = len - at;
+                if (len + n <= MAX_INPUT) {
+                    memmove(buf + at + n, buf + at, len - at);
+                    len += n;
+                }
+                break;
+            }
+        }
+    }
+    return len;
+}
+
+int main(int argc, char* argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 20000;
+    rng_state = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+
+    signal(SIGALRM, on_signal);
+    signal(SIGSEGV, on_signal);
+    signal(SIGBUS, on_signal);
+    signal(SIGFPE, on_signal);
+    signal(SIGABRT, on_signal);
+
+    /* assemble_string reports every error on stderr */
+    if (!freopen("/dev/null", "w", stderr)) return 1;
+
+    printf("Fuzzing the assembler: %ld inputs, seed %llu\n", iterations, rng_state);
+
+    /* Every seed as written first; mutants of the nested one are too
+     * slow to draw often, so mutate() leaves it out */
+    for (size_t i = 0; i < sizeof(SEEDS) / sizeof(SEEDS[0]); i++) {
+        alarm(HANG_SECONDS);
+        LLVMFuzzerTestOneInput((const uint8_t*)SEEDS[i], strlen(SEEDS[i]));
+        alarm(0);
+    }
+    for (long i = 0; i < iterations; i++) {
+        char buf[MAX_INPUT];
+        size_t len = rng() % 2 ? generate(buf) : mutate(buf);
+
+        alarm(HANG_SECONDS);
+        LLVMFuzzerTestOneInput((const uint8_t*)buf, len);
+        alarm(0);
+
+        if ((i + 1) % 25000 == 0) {
+            printf("  %ld inputs\n", i + 1);
+            fflush(stdout);
+        }
+    }
+    printf("No crash, hang or disagreement in %ld inputs\n", iterations);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ * test_active_units.c - Active-unit mask per microinstruction
+ *
+ * Purpose: Verify that each microinstruction activates exactly the
+ *          datapath units whose results are observable, and that the
+ *          microcode engine evaluating only those units stays in
+ *          lockstep with one that evaluates every unit every cycle.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/mic1.h"
+#include "../../include/alu.h"
+#include "../../include/utils/conversions.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+static const char* MICROCODE = "../../data/basic_microcode.txt";
+
+/* Microinstruction word from its fields (layout of decode_microinstruction) */
+#define WORD(a, b, c, alu, cond, bits) \
+    (((uint32_t)(a) << 20) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 12) | \
+     ((uint32_t)(alu) << 3) | ((uint32_t)(cond) << 1) | (uint32_t)(bits))
+
+#define B_ENC   (1u << 11)
+#define B_WR    (1u << 10)
+#define B_RD    (1u << 9)
+#define B_MAR   (1u << 8)
+#define B_MBR   (1u << 7)
+#define B_AMUX  1u
+
+static int units_of(uint32_t word) {
+    micro_op op;
+    decode_micro_op(word, &op);
+    return op.units;
+}
+
+/*
+ * TEST 1: Mask per microinstruction
+ */
+void test_masks(void) {
+    TEST_SECTION("Active units per microinstruction");
+
+    TEST_ASSERT(units_of(WORD(1, 6, 1, ALU_A_PLUS_B, COND_NONE, B_ENC)) == UNIT_ALL,
+                "ac := ac + 1 uses every unit");
+    TEST_ASSERT(units_of(WORD(0, 0, 0, ALU_A, COND_NONE, B_MAR | B_RD)) == UNIT_BUS_B,
+                "mar := pc; rd only drives bus B");
+    TEST_ASSERT(units_of(WORD(1, 0, 0, ALU_A, COND_IF_N, 0)) == (UNIT_BUS_A | UNIT_ALU),
+                "alu := ac; if n needs bus A and the ALU flags");
+    TEST_ASSERT(units_of(WORD(0, 0, 0, ALU_A_AND_B, COND_ALWAYS, 0)) == 0,
+                "goto with no destination activates nothing");
+    TEST_ASSERT(units_of(WORD(1, 0, 0, ALU_A, COND_NONE, B_MBR | B_WR)) ==
+                (UNIT_BUS_A | UNIT_ALU | UNIT_SHIFTER), "mbr := ac; wr skips buses B and C");
+    TEST_ASSERT(units_of(WORD(0, 0, 1, ALU_A, COND_NONE, B_ENC | B_AMUX)) ==
+                (UNIT_ALU | UNIT_SHIFTER | UNIT_BUS_C), "ac := mbr reads MBR, not bus A");
+    TEST_ASSERT(units_of(WORD(2, 3, 2, ALU_NOT_A, COND_NONE, B_ENC)) ==
+                (UNIT_BUS_A | UNIT_ALU | UNIT_SHIFTER | UNIT_BUS_C), "inv(a) does not read bus B");
+
+    mir m;
+    init_mir(&m);
+    TEST_ASSERT(m.units == UNIT_ALL, "A fresh MIR evaluates every unit");
+}
+
+/*
+ * TEST 2: Lockstep against the full datapath
+ */
+
+/* Runs random programs on two CPUs; returns the microcycles where they differ */
+static int lockstep(int trials, int cycles, long* compared) {
+    static mic1_cpu masked, full;
+    int differences = 0;
+
+    srand(37);
+    for (int trial = 0; trial < trials; trial++) {
+        init_mic1(&masked);
+        init_mic1(&full);
+        load_microprogram_file(&masked, MICROCODE);
+        load_microprogram_file(&full, MICROCODE);
+        for (int addr = 0; addr < MICROPROGRAM_SIZE; addr++) {
+            full.ctrl_mem.ops[addr].units = UNIT_ALL;
+        }
+
+        for (int addr = 0; addr < MEMORY_SIZE; addr++) {
+            int value = rand() & 0xFFFF;
+            mem_store_word(&masked.main_memory, addr, value);
+            mem_store_word(&full.main_memory, addr, value);
+        }
+        int sp = rand() & 0xFFF;
+        int_to_bits(sp, masked.reg_bank.SP.data, 16);
+        int_to_bits(sp, full.reg_bank.SP.data, 16);
+
+        for (int cycle = 0; cycle < cycles; cycle++) {
+            run_mic1_cycle(&masked);
+            run_mic1_cycle(&full);
+            (*compared)++;
+
+            if (mic1_state_digest(&masked) != mic1_state_digest(&full) ||
+                memcmp(masked.mpc.address, full.mpc.address, sizeof(full.mpc.address)) != 0 ||
+                memcmp(masked.mar.address, full.mar.address, sizeof(full.mar.address)) != 0 ||
+                memcmp(masked.mbr.data, full.mbr.data, sizeof(full.mbr.data)) != 0 ||
+                masked.fault.count != full.fault.count) {
+                differences++;
+                break;
+            }
+            if (full.fault.count) break;
+        }
+    }
+    return differences;
+}
+
+void test_lockstep(void) {
+    TEST_SECTION("Masked datapath against the full datapath");
+
+    long compared = 0;
+    int differences = lockstep(64, 2000, &compared);
+
+    TEST_ASSERT(compared > 10000, "Random programs run for many microcycles");
+    TEST_ASSERT(differences == 0, "Registers, memory, MAR, MBR and MPC agree every microcycle");
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  ACTIVE-UNIT MASK UNIT TESTS                               ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_masks();
+    test_lockstep();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
@@ -0,0 +1,1052 @@
+/*
+ * test_assembler.c - Assembler contexts
+ *
+ * Purpose: Verify that each assembler_t carries its own symbols, line
+ *          map and errors, that output goes to the caller's buffer with
+ *          its capacity honoured, that several threads assembling
+ *          different programs at once get the serial results, that
+ *          incremental reassembly matches assembling from scratch, that
+ *          data directives, constants and macros assemble right, that
+ *          streamed input gives the same image, written as it goes, that
+ *          the line syntax (mnemonics, operands, comments) holds, that
+ *          the .map sidecar reads back with lines and labels, that the
+ *          peephole pass drops only what no path can tell apart, that
+ *          forward references are backpatched in a single pass, and that
+ *          the symbol table grows past any fixed label count or length.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "../../include/assembler.h"
+#include "../../include/srcmap.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+#define THREADS 4
+#define ROUNDS 50
+#define EDITS 400
+#define PROGRAM_LINES 120
+
+static const char* LOOP_SRC =
+    "; counts down from 3\n"
+    "        LOCO 3\n"
+    "loop:   SUBD one\n"
+    "        JNZE loop\n"
+    "done:   JUMP done\n"
+    "one:    LOCO 1\n";
+
+static const char* CALL_SRC =
+    "start:  CALL sub\n"
+    "\n"
+    "        JUMP start\n"
+    "sub:    RETN\n";
+
+/*
+ * TEST 1: Independent contexts
+ */
+void test_contexts(void) {
+    TEST_SECTION("Independent contexts");
+
+    assembler_t a, b;
+    uint16_t out_a[16], out_b[16];
+    int size_a = 0, size_b = 0;
+
+    init_assembler(&a);
+    init_assembler(&b);
+    TEST_ASSERT(assembler_run(&a, LOOP_SRC, out_a, 16, &size_a) == 0 &&
+                assembler_run(&b, CALL_SRC, out_b, 16, &size_b) == 0,
+                "Two contexts assemble side by side");
+    TEST_ASSERT(size_a == 5 && out_a[1] == 0x3004 && out_a[2] == 0xD001,
+                "Forward and backward references resolved");
+    TEST_ASSERT(size_b == 3 && out_b[0] == 0xE002 && out_b[2] == 0xF800, "Second program intact");
+
+    TEST_ASSERT(assembler_source_line(&a, 1) == 3 && assembler_source_line(&a, 4) == 6,
+                "First context keeps its own line map");
+    TEST_ASSERT(assembler_source_line(&b, 1) == 3 && assembler_source_line(&b, 3) == -1,
+                "Second context keeps its own line map");
+    TEST_ASSERT(lookup_symbol(&a, "one") == 4 && lookup_symbol(&b, "one") == -1 &&
+                lookup_symbol(&b, "sub") == 2, "Symbols stay in their context");
+
+    TEST_ASSERT(assembler_run(&a, "LOCO 1\nJUMP nowhere\n", out_a, 16, &size_a) != 0 &&
+                a.error_line == 2 && strstr(a.error_msg, "nowhere") != NULL,
+                "Undefined label reported with its line, nothing printed");
+    TEST_ASSERT(assembler_run(&a, "LOCO 1\nBOGUS 2\n", out_a, 16, &size_a) != 0 &&
+                a.error_line == 2, "Invalid opcode reported with its line");
+    TEST_ASSERT(assembler_run(&a, LOOP_SRC, out_a, 4, &size_a) != 0,
+                "Output larger than the caller's buffer is rejected");
+    TEST_ASSERT(assembler_run(&a, CALL_SRC, out_a, 16, &size_a) == 0 && size_a == 3 &&
+                lookup_symbol(&a, "loop") == -1, "A context is reset on reuse");
+
+    free_assembler(&a);
+    free_assembler(&b);
+}
+
+/* Program number `n`: a chain of n labels, each jumping to the next */
+static char* chain_source(int n) {
+    char* source = malloc((size_t)n * 32 + 32);
+    char* p = source;
+
+    for (int i = 0; i < n; i++) {
+        p += sprintf(p, "l%d: JUMP l%d\n", i, i + 1);
+    }
+    sprintf(p, "l%d: JUMP l0\n", n);
+    return source;
+}
+
+typedef struct {
+    const char* source;
+    const uint16_t* expected;
+    int expected_size;
+    int mismatches;
+} job_t;
+
+static void* assemble_rounds(void* arg) {
+    job_t* job = arg;
+    assembler_t as;
+    uint16_t out[MAX_INSTRUCTIONS];
+    int size;
+
+    init_assembler(&as);
+    for (int r = 0; r < ROUNDS; r++) {
+        if (assembler_run(&as, job->source, out, MAX_INSTRUCTIONS, &size) != 0 ||
+            size != job->expected_size ||
+            memcmp(out, job->expected, (size_t)size * sizeof(uint16_t)) != 0 ||
+            assembler_source_line(&as, (uint16_t)(size - 1)) != size) {
+            job->mismatches++;
+        }
+    }
+    free_assembler(&as);
+    return NULL;
+}
+
+/*
+ * TEST 2: Concurrent assembly
+ */
+void test_threads(void) {
+    TEST_SECTION("Concurrent assembly");
+
+    static uint16_t expected[THREADS][MAX_INSTRUCTIONS];
+    char* sources[THREADS];
+    job_t jobs[THREADS];
+    pthread_t threads[THREADS];
+    int ok = 1;
+
+    for (int t = 0; t < THREADS; t++) {
+        sources[t] = chain_source(500 + 700 * t);
+        jobs[t].source = sources[t];
+        jobs[t].expected = expected[t];
+        jobs[t].mismatches = 0;
+        ok &= assemble_string(sources[t], expected[t], &jobs[t].expected_size) == 0;
+    }
+    TEST_ASSERT(ok && jobs[3].expected_size == 2601 && expected[3][2600] == 0x6000,
+                "Serial reference programs assemble");
+
+    for (int t = 0; t < THREADS; t++) {
+        pthread_create(&threads[t], NULL, assemble_rounds, &jobs[t]);
+    }
+    int mismatches = 0;
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        mismatches += jobs[t].mismatches;
+        free(sources[t]);
+    }
+    TEST_ASSERT(mismatches == 0, "Every thread matches the serial output and line map");
+}
+
+/*
+ * TEST 3: Incremental reassembly
+ */
+void test_update(void) {
+    TEST_SECTION("Incremental reassembly");
+
+    assembler_t as;
+    uint16_t image[MAX_INSTRUCTIONS];
+    int size = 0;
+
+    init_assembler(&as);
+    TEST_ASSERT(assembler_update(&as, LOOP_SRC, image, MAX_INSTRUCTIONS, &size) == 0 &&
+                as.update.full && size == 5 && as.patch_count == 5, "First update assembles everything");
+
+    const char* edited =
+        "; counts down from 3\n"
+        "        LOCO 7\n"
+        "loop:   SUBD one\n"
+        "        JNZE loop\n"
+        "done:   JUMP done\n"
+        "one:    LOCO 1\n";
+    TEST_ASSERT(assembler_update(&as, edited, image, MAX_INSTRUCTIONS, &size) == 0 &&
+                !as.update.full && as.update.reparsed == 1 && as.update.first_line == 2,
+                "A one-line edit parses one line");
+    TEST_ASSERT(as.patch_count == 1 && as.patched[0] == 0 && image[0] == 0x7007,
+                "Only the edited word is patched");
+
+    const char* inserted =
+        "; counts down from 3\n"
+        "        LOCO 7\n"
+        "        PUSH\n"
+        "loop:   SUBD one\n"
+        "        JNZE loop\n"
+        "done:   JUMP done\n"
+        "one:    LOCO 1\n";
+    TEST_ASSERT(assembler_update(&as, inserted, image, MAX_INSTRUCTIONS, &size) == 0 &&
+                as.update.reparsed == 1 && as.update.moved_from == 1 && as.update.moved_by == 1,
+                "Inserting a line shifts the tail by one word");
+    TEST_ASSERT(size == 6 && image[2] == 0x3005 && image[3] == 0xD002 && image[4] == 0x6004 &&
+                assembler_source_line(&as, 5) == 7 && lookup_symbol(&as, "one") == 5,
+                "Moved labels and their references follow");
+
+    TEST_ASSERT(assembler_update(&as, "LOCO 1\nJUMP nowhere\n", image, MAX_INSTRUCTIONS, &size) != 0 &&
+                size == 6 && image[0] == 0x7007, "A failed update leaves the image alone");
+    TEST_ASSERT(assembler_update(&as, LOOP_SRC, image, MAX_INSTRUCTIONS, &size) == 0 &&
+                as.update.full && size == 5 && image[0] == 0x7003,
+                "The next update starts from scratch");
+
+    /* Random line edits, each checked against a full assembly */
+    static char lines[PROGRAM_LINES * 2][48];
+    static char source[PROGRAM_LINES * 2 * 48];
+    uint16_t expected[MAX_INSTRUCTIONS];
+    uint16_t shadow[MAX_INSTRUCTIONS];
+    int count = PROGRAM_LINES;
+    int failures = 0;
+    int partial = 0;
+    unsigned seed = 12345;
+
+    for (int i = 0; i < count; i++) {
+        sprintf(lines[i], "l%d: ADDD l%d ; start", i, (i * 7) % PROGRAM_LINES);
+    }
+
+    for (int e = 0; e < EDITS; e++) {
+        seed = seed * 1103515245u + 12345u;
+        int at = (int)((seed >> 8) % (unsigned)count);
+        int kind = (int)((seed >> 20) % 4);
+        int target = (int)((seed >> 4) % (unsigned)count);
+
+        if (kind == 0 && count < PROGRAM_LINES * 2 - 1) {           /* insert */
+            memmove(lines[at + 1], lines[at], (size_t)(count - at) * sizeof(lines[0]));
+            sprintf(lines[at], "x%d: LOCO %d", e, e);
+            count++;
+        } else if (kind == 1 && lines[at][0] == 'x') {              /* delete */
+            memmove(lines[at], lines[at + 1], (size_t)(count - at - 1) * sizeof(lines[0]));
+            count--;
+        } else if (kind == 2) {                                     /* new operand */
+            sprintf(strchr(lines[at], ':'), ": JUMP l%d", target % PROGRAM_LINES);
+        } else if (strlen(lines[at]) < 40) {                        /* comment */
+            strcat(lines[at], " ;c");
+        }
+        char* p = source;
+        for (int i = 0; i < count; i++) {
+            p += sprintf(p, "%s\n", lines[i]);
+        }
+
+        int expected_size = 0;
+        int ok_full = assemble_string(source, expected, &expected_size) == 0;
+
+        memcpy(shadow, image, sizeof(shadow));
+        int shadow_size = size;
+        int ok = assembler_update(&as, source, image, MAX_INSTRUCTIONS, &size) == 0;
+
+        /* Replaying the patch list on the old image must give the new one */
+        for (int i = 0; ok && i < as.patch_count; i++) {
+            shadow[as.patched[i]] = image[as.patched[i]];
+        }
+        if (ok != ok_full || (ok && (size != expected_size ||
+            memcmp(image, expected, (size_t)size * sizeof(uint16_t)) != 0 ||
+            memcmp(shadow, image, (size_t)size * sizeof(uint16_t)) != 0))) {
+            failures++;
+        }
+        for (int i = 0; ok && i < size; i++) {
+            if (assembler_source_line(&as, (uint16_t)i) < 1 ||
+                strstr(lines[assembler_source_line(&as, (uint16_t)i) - 1], ":") == NULL) {
+                failures++;
+                break;
+            }
+        }
+        if (ok && !as.update.full && shadow_size > 0) partial++;
+    }
+    TEST_ASSERT(failures == 0, "400 random edits match a full assembly, patch list included");
+    TEST_ASSERT(partial > EDITS / 2, "Most edits are applied incrementally");
+
+    free_assembler(&as);
+}
+
+static const char* TABLE_SRC =
+    ".equ N, 3\n"
+    ".equ OUT, 0x300\n"
+    ".macro COPY dst, src\n"
+    "        LODD src    ; one word at a time\n"
+    "        STOD dst\n"
+    ".endm\n"
+    "        JUMP main\n"
+    "table:  .word 5, -1, table+N\n"
+    "        .space 2\n"
+    "        .fill N, 0x7\n"
+    "main:   COPY OUT, table+1\n"
+    "        LOCO N\n"
+    ".org 0x20\n"
+    "done:   JUMP done\n";
+
+/* Update `as` to `source` and compare with a one-shot assembly */
+static int update_matches(assembler_t* as, const char* source, uint16_t* image, int* size) {
+    uint16_t expected[MAX_INSTRUCTIONS];
+    int expected_size = 0;
+
+    if (assemble_string(source, expected, &expected_size) != 0 ||
+        assembler_update(as, source, image, MAX_INSTRUCTIONS, size) != 0) {
+        return 0;
+    }
+    return *size == expected_size &&
+           memcmp(image, expected, (size_t)expected_size * sizeof(uint16_t)) == 0;
+}
+
+/* Source with the first occurrence of `from` replaced by `to`, in a static buffer */
+static const char* edit_source(const char* source, const char* from, const char* to) {
+    static char edited[1024];
+    char original[1024];
+
+    snprintf(original, sizeof(original), "%s", source);
+    const char* at = strstr(original, from);
+    snprintf(edited, sizeof(edited), "%.*s%s%s", (int)(at - original), original, to, at + strlen(from));
+    return edited;
+}
+
+/*
+ * TEST 4: Directives, constants and macros
+ */
+void test_directives(void) {
+    TEST_SECTION("Directives, constants and macros");
+
+    assembler_t as;
+    uint16_t out[MAX_INSTRUCTIONS];
+    int size = 0;
+
+    init_assembler(&as);
+    TEST_ASSERT(assembler_run(&as, TABLE_SRC, out, MAX_INSTRUCTIONS, &size) == 0 && size == 33,
+                ".org pads the program up to its address");
+    TEST_ASSERT(out[0] == 0x6009 && out[1] == 5 && out[2] == 0xFFFF && out[3] == 4 &&
+                out[4] == 0 && out[5] == 0 && out[6] == 7 && out[8] == 7,
+                ".word, .space and .fill lay out data words");
+    TEST_ASSERT(out[9] == 0x0002 && out[10] == 0x1300 && out[11] == 0x7003 && out[32] == 0x6020,
+                "Macro arguments, constants and NAME+N operands substituted");
+    TEST_ASSERT(lookup_symbol(&as, "N") == 3 && lookup_symbol(&as, "done") == 32 &&
+                assembler_source_line(&as, 2) == 8 && assembler_source_line(&as, 10) == 11 &&
+                assembler_source_line(&as, 20) == 13,
+                "Data, expansion and padding words map to their lines");
+
+    struct {
+        const char* source;
+        int line;
+        const char* message;
+    } errors[] = {
+        { "LOCO 1\n.org 0x10\n.org 4\n", 3, "behind" },
+        { "LOCO 1\n.macro M a\nLODD a\n", 2, "Missing .endm" },
+        { ".macro M\nx: LOCO 1\n.endm\n", 2, "Labels" },
+        { ".macro M a\nLODD a\n.endm\nM 1, 2\n", 4, "arguments" },
+        { ".org SIZE\n.equ SIZE, 4\n", 1, "Not defined yet" },
+        { ".macro M\n.org 4\n.endm\nM\n", 4, "not allowed" },
+        { ".macro M\nM\n.endm\nM\n", 4, "nested too deep" },
+        { ".bogus 1\n", 1, "Invalid directive" },
+        { ".word 70000\n", 1, "out of range" },
+        { ".fill 4097, 1\n", 1, "out of range" },
+    };
+    int reported = 0;
+    for (size_t i = 0; i < sizeof(errors) / sizeof(errors[0]); i++) {
+        if (assembler_run(&as, errors[i].source, out, MAX_INSTRUCTIONS, &size) != 0 &&
+            as.error_line == errors[i].line && strstr(as.error_msg, errors[i].message)) {
+            reported++;
+        }
+    }
+    TEST_ASSERT(reported == (int)(sizeof(errors) / sizeof(errors[0])),
+                "Directive and macro errors reported with their line");
+
+    /* 15 levels of 12 uses each that emit nothing: 12^15 lines without a budget */
+    static char nested[4096];
+    int length = snprintf(nested, sizeof(nested), ".macro M0\n.space 0\n.endm\n");
+    for (int level = 1; level < 16; level++) {
+        length += snprintf(nested + length, sizeof(nested) - (size_t)length, ".macro M%d\n", level);
+        for (int use = 0; use < 12; use++) {
+            length += snprintf(nested + length, sizeof(nested) - (size_t)length, "M%d\n", level - 1);
+        }
+        length += snprintf(nested + length, sizeof(nested) - (size_t)length, ".endm\n");
+    }
+    snprintf(nested + length, sizeof(nested) - (size_t)length, "M15\n");
+    TEST_ASSERT(assembler_run(&as, nested, out, MAX_INSTRUCTIONS, &size) != 0 &&
+                as.error_line == 214 && strstr(as.error_msg, "expansion too large"),
+                "Nested macros stop at the expansion budget");
+
+    mic1_object obj;
+    TEST_ASSERT(assembler_object(&as, TABLE_SRC, &obj) == 0, "Directives assemble into an object");
+    int word_reloc = 0, constant_relocs = 0, abs_symbol = 0;
+    for (int i = 0; i < obj.reloc_count; i++) {
+        if (obj.relocs[i].offset == 3 && obj.relocs[i].bits == 16) word_reloc = 1;
+        if (obj.relocs[i].offset == 10 || obj.relocs[i].offset == 11) constant_relocs++;
+    }
+    for (int i = 0; i < obj.symbol_count; i++) {
+        if (strcmp(obj.symbols[i].name, "OUT") == 0 && (obj.symbols[i].flags & OBJ_SYM_ABS)) {
+            abs_symbol = 1;
+        }
+    }
+    TEST_ASSERT(word_reloc && constant_relocs == 0 && abs_symbol,
+                ".word labels relocate 16 bits, constants never relocate");
+    free_object(&obj);
+
+    /* Edits whose effect reaches past their line go through a full assembly */
+    size = 0;
+    TEST_ASSERT(update_matches(&as, TABLE_SRC, out, &size), "Update assembles directives");
+
+    const char* source = edit_source(TABLE_SRC, ".equ N, 3", ".equ N, 2");
+    TEST_ASSERT(update_matches(&as, source, out, &size) && as.update.full,
+                "Changing a constant reassembles everything");
+    source = edit_source(source, "LODD src", "LODD src\n        ADDD src");
+    TEST_ASSERT(update_matches(&as, source, out, &size) && as.update.full && out[9] == 0x2002,
+                "Editing a macro body reassembles its uses");
+    source = edit_source(source, "        LOCO N\n", "        LOCO N\n        PUSH\n");
+    TEST_ASSERT(update_matches(&as, source, out, &size) && as.update.full && out[32] == 0x6020,
+                "A move absorbed by .org reassembles everything");
+    source = edit_source(source, "done:   JUMP done", "done:   JUMP main");
+    TEST_ASSERT(update_matches(&as, source, out, &size) && !as.update.full &&
+                as.patch_count == 1, "Lines after .org still update in place");
+    source = edit_source(source, "main:   COPY OUT, table+1", "main:   COPY OUT, table");
+    TEST_ASSERT(update_matches(&as, source, out, &size) && !as.update.full,
+                "Macro uses update in place");
+
+    /* NAME+SYM follows SYM when an edit above moves it */
+    const char* offsets =
+        "off:    LOCO 0\n"
+        "h:      JUMP h\n"
+        "start:  LODD tbl+off\n"
+        "tbl:    .word 1, 2, 3, 4, 5\n";
+    TEST_ASSERT(update_matches(&as, offsets, out, &size) && out[2] == 0x0003,
+                "NAME+SYM assembles");
+    source = edit_source(offsets, "off:", "        LOCO 7\noff:");
+    TEST_ASSERT(update_matches(&as, source, out, &size) && out[3] == 0x0005,
+                "Moving SYM updates NAME+SYM");
+
+    free_assembler(&as);
+}
+
+typedef struct {
+    assembler_t as;
+    int in_fd;
+    int out_fd;
+    int size;
+    int result;
+} stream_job_t;
+
+static void* run_stream(void* arg) {
+    stream_job_t* job = arg;
+    job->result = assembler_stream(&job->as, job->in_fd, job->out_fd, &job->size);
+    close(job->out_fd);
+    return NULL;
+}
+
+/* Read `count` words from `fd`, waiting at most a second for each */
+static int read_words(int fd, uint16_t* words, int count) {
+    char* p = (char*)words;
+    size_t left = (size_t)count * sizeof(uint16_t);
+
+    while (left > 0) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 1000) != 1) return -1;
+        ssize_t n = read(fd, p, left);
+        if (n <= 0) return -1;
+        p += n;
+        left -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Feed `text` into the stream, all of it */
+static void feed(int fd, const char* text) {
+    size_t left = strlen(text);
+    while (left > 0) {
+        ssize_t n = write(fd, text, left);
+        if (n <= 0) return;
+        text += n;
+        left -= (size_t)n;
+    }
+}
+
+#define STREAM_LINES 40000
+
+/* Line `i` of a long source: far more text than the stream buffer, a word every 16 lines */
+static int stream_line(char* out, size_t size, int i) {
+    if (i % 16 != 0 || i > 32000) {
+        return snprintf(out, size, "; filler comment line %d\n", i);
+    }
+    return snprintf(out, size, "l%d: JUMP l%d\n", i, i < 32000 ? i + 16 : 0);
+}
+
+static void* feed_source(void* arg) {
+    stream_job_t* job = arg;
+    char line[64];
+
+    for (int i = 0; i < STREAM_LINES; i++) {
+        stream_line(line, sizeof(line), i);
+        feed(job->in_fd, line);
+    }
+    close(job->in_fd);
+    return NULL;
+}
+
+/*
+ * TEST 5: Streaming input and output
+ */
+void test_stream(void) {
+    TEST_SECTION("Streaming input and output");
+
+    stream_job_t job;
+    int in[2], out[2];
+    uint16_t words[8];
+    pthread_t thread;
+
+    TEST_ASSERT(pipe(in) == 0 && pipe(out) == 0, "Pipes for source and image");
+    init_assembler(&job.as);
+    job.in_fd = in[0];
+    job.out_fd = out[1];
+    pthread_create(&thread, NULL, run_stream, &job);
+
+    feed(in[1], "start:  LOCO 1\n        JUMP start\n");
+    TEST_ASSERT(read_words(out[0], words, 2) == 0 && words[0] == 0x7001 && words[1] == 0x6000,
+                "Words are written before the source ends");
+    feed(in[1], "        JUMP end\n        LOCO 2\n");
+    struct pollfd pfd = { out[0], POLLIN, 0 };
+    TEST_ASSERT(poll(&pfd, 1, 200) == 0, "A word waiting for a label holds back the rest");
+    feed(in[1], "end:    JUMP end");
+    close(in[1]);
+    TEST_ASSERT(read_words(out[0], words, 3) == 0 && words[0] == 0x6004 && words[1] == 0x7002 &&
+                words[2] == 0x6004, "The label releases them; a last line without newline counts");
+    pthread_join(thread, NULL);
+    TEST_ASSERT(job.result == 0 && job.size == 5 && read(out[0], words, 2) == 0,
+                "Stream ends with the image");
+    close(in[0]);
+    close(out[0]);
+
+    /* A long source through a pipe, output to a pipe drained as it comes */
+    static uint16_t image[MAX_INSTRUCTIONS];
+    static char source[2 * 1024 * 1024];
+    uint16_t expected[MAX_INSTRUCTIONS];
+    int expected_size = 0;
+    pthread_t writer;
+
+    char* p = source;
+    for (int i = 0; i < STREAM_LINES; i++) {
+        p += stream_line(p, 64, i);
+    }
+    assemble_string(source, expected, &expected_size);
+
+    TEST_ASSERT(pipe(in) == 0 && pipe(out) == 0, "Pipes for a long source");
+    job.in_fd = in[0];
+    job.out_fd = out[1];
+    stream_job_t feeder = job;
+    feeder.in_fd = in[1];
+    pthread_create(&writer, NULL, feed_source, &feeder);
+    pthread_create(&thread, NULL, run_stream, &job);
+    int got = read_words(out[0], image, expected_size);
+    pthread_join(writer, NULL);
+    pthread_join(thread, NULL);
+    TEST_ASSERT(got == 0 && job.result == 0 && job.size == expected_size && expected_size == 2001 &&
+                memcmp(image, expected, (size_t)expected_size * sizeof(uint16_t)) == 0,
+                "A 40000-line piped source matches assemble_string");
+    close(in[0]);
+    close(out[0]);
+
+    /* Overlong lines are errors, terminated or not */
+    static char longline[MAX_LINE_LENGTH + 64];
+    memset(longline, 'x', sizeof(longline) - 1);
+    TEST_ASSERT(pipe(in) == 0 && pipe(out) == 0, "Pipes for an overlong line");
+    feed(in[1], "LOCO 1\n");
+    feed(in[1], longline);
+    close(in[1]);
+    job.in_fd = in[0];
+    job.out_fd = out[1];
+    run_stream(&job);
+    TEST_ASSERT(job.result != 0 && job.as.error_line == 2 && strstr(job.as.error_msg, "too long"),
+                "An overlong line is reported, not truncated");
+    close(in[0]);
+    close(out[0]);
+
+    free_assembler(&job.as);
+}
+
+/*
+ * TEST 6: Line syntax
+ */
+void test_syntax(void) {
+    TEST_SECTION("Line syntax");
+
+    TEST_ASSERT(is_valid_opcode("LODD") && is_valid_opcode("desp") && is_valid_opcode("Retn") &&
+                !is_valid_opcode("LOD") && !is_valid_opcode("LODDX") && !is_valid_opcode(""),
+                "Mnemonics match whole words in any case");
+    TEST_ASSERT(parse_opcode("CALL") == OP_CALL && parse_opcode("swap") == 0xFA &&
+                parse_opcode("nope") == 0xFF, "parse_opcode gives opcode or 0xFF");
+    TEST_ASSERT(parse_operand("0") == 0 && parse_operand(" 4095 ") == 4095 &&
+                parse_operand("0xfff") == 4095 && parse_operand("4096") == -1 &&
+                parse_operand("0x") == -1 && parse_operand("12a") == -1,
+                "parse_operand takes 12-bit decimal or hex");
+
+    assembler_t as;
+    uint16_t out[16];
+    int size = 0;
+
+    init_assembler(&as);
+    TEST_ASSERT(assembler_run(&as,
+                              "; only a comment\n"
+                              "\n"
+                              "a:\n"
+                              "b:  lodd b ; same address as a\n"
+                              "\tINSP 0x7F\r\n"
+                              "    PUSH        ; no operand\n"
+                              "    JUMP a;tight comment\n",
+                              out, 16, &size) == 0 && size == 4,
+                "Comments, blank lines, tabs, CR and bare labels");
+    TEST_ASSERT(out[0] == 0x0000 && out[1] == 0xFC7F && out[2] == 0xF400 && out[3] == 0x6000 &&
+                lookup_symbol(&as, "a") == 0 && lookup_symbol(&as, "b") == 0,
+                "Encoding: 4-bit opcode + 12 bits, 8-bit opcode + 8 bits");
+
+    TEST_ASSERT(assembler_run(&as, "x: LOCO 1\nx: LOCO 2\n", out, 16, &size) != 0 &&
+                as.error_line == 2 && strstr(as.error_msg, "Duplicate label"),
+                "Duplicate label reported");
+    TEST_ASSERT(assembler_run(&as, "LOCO\n", out, 16, &size) != 0 &&
+                strstr(as.error_msg, "Missing operand"), "Missing operand reported");
+    TEST_ASSERT(assembler_run(&as, "LOCO 4096\n", out, 16, &size) != 0 &&
+                strstr(as.error_msg, "out of range"), "Operand over 12 bits reported");
+    TEST_ASSERT(assembler_run(&as, ".global nowhere\n", out, 16, &size) != 0 &&
+                strstr(as.error_msg, "Undefined global"), "Exported label must be defined");
+
+    free_assembler(&as);
+}
+
+static const char* MAP_ASM = "test_assembler_map.asm";
+static const char* MAP_BIN = "test_assembler_map.bin";
+static const char* MAP_FILE = "test_assembler_map.map";
+
+static int write_text(const char* path, const char* text) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) return -1;
+    fputs(text, fp);
+    return fclose(fp);
+}
+
+/*
+ * TEST 7: Source map sidecar
+ */
+void test_source_map(void) {
+    TEST_SECTION("Source map sidecar");
+
+    char name[64];
+    assembler_map_file(name, sizeof(name), "dir.v2/prog.bin");
+    TEST_ASSERT(strcmp(name, "dir.v2/prog.map") == 0, "prog.bin -> prog.map");
+    assembler_map_file(name, sizeof(name), "dir.v2/prog");
+    TEST_ASSERT(strcmp(name, "dir.v2/prog.map") == 0, "A name without extension gets .map");
+    TEST_ASSERT(assembler_map_file(name, 12, "dir/prog.bin") < 0 && name[0] == '\0',
+                "A map name that does not fit is refused, not truncated");
+
+    TEST_ASSERT(write_text(MAP_ASM, TABLE_SRC) == 0 && assemble_file(MAP_ASM, MAP_BIN) == 0,
+                "Table program assembled to a file");
+
+    source_map map;
+    init_source_map(&map, MAP_BIN, 0);
+    TEST_ASSERT(strcmp(map.file, MAP_FILE) == 0 && map.state == SOURCE_MAP_UNREAD,
+                "Nothing is read before the first lookup");
+    TEST_ASSERT(source_map_line(&map, 0) == 7 && map.state == SOURCE_MAP_LOADED,
+                "First lookup reads the map");
+    TEST_ASSERT(source_map_line(&map, 1) == 8 && source_map_line(&map, 3) == 8 &&
+                source_map_line(&map, 8) == 10 && source_map_line(&map, 10) == 11 &&
+                source_map_line(&map, 0x1F) == 13 && source_map_line(&map, 0x20) == 14 &&
+                source_map_line(&map, 0x21) == 0,
+                "Every word maps to the line that emitted it, macros and .org included");
+
+    int offset = -1;
+    const char* label = source_map_label(&map, 10, &offset);
+    TEST_ASSERT(label && strcmp(label, "main") == 0 && offset == 1, "Address 10 is main+1");
+    label = source_map_label(&map, 0x20, &offset);
+    TEST_ASSERT(label && strcmp(label, "done") == 0 && offset == 0, "Address 0x20 is done");
+    TEST_ASSERT(source_map_label(&map, 0, &offset) == NULL, "No label below the first one");
+    TEST_ASSERT(source_map_symbol(&map, "table") == 1 && source_map_symbol(&map, "OUT") == 0x300 &&
+                source_map_symbol(&map, "N") == 3 && source_map_symbol(&map, "nope") == -1,
+                "Labels and constants by name");
+
+    int length = 0;
+    const char* text = source_map_text(&map, 14, &length);
+    TEST_ASSERT(text && length == 17 && strncmp(text, "done:   JUMP done", 17) == 0,
+                "Source text of a line, read from the .asm");
+    free_source_map(&map);
+
+    /* A source path that does not fit is dropped, the lines are kept */
+    char record[700];
+    memset(record, 'a', sizeof(record));
+    memcpy(record, "mic1map 1\nsource ", 17);
+    snprintf(record + 600, sizeof(record) - 600, "\nline 0 5\n");
+    TEST_ASSERT(write_text(MAP_FILE, record) == 0, "Map with an overlong source written");
+    init_source_map(&map, MAP_BIN, 0);
+    TEST_ASSERT(source_map_line(&map, 0) == 5 && map.source[0] == '\0' &&
+                source_map_text(&map, 1, NULL) == NULL,
+                "Overlong source path dropped, not truncated");
+    free_source_map(&map);
+
+    init_source_map(&map, "no_such_program.bin", 0);
+    TEST_ASSERT(source_map_line(&map, 0) == 0 && source_map_label(&map, 0, NULL) == NULL &&
+                map.state == SOURCE_MAP_MISSING, "A program without a map has no lines");
+    free_source_map(&map);
+
+    FILE* fp;
+
+    /* An output path whose map name would be cut short to an existing
+     * file ("././.../victim" at 511 characters) leaves that file alone */
+    const char* victim = "test_assembler_victim";
+    char long_bin[600];
+    int n = 0;
+    while (n + 2 + (int)strlen(victim) <= 511) {
+        memcpy(long_bin + n, "./", 2);
+        n += 2;
+    }
+    if (n + (int)strlen(victim) < 511) long_bin[n++] = '/';
+    snprintf(long_bin + n, sizeof(long_bin) - n, "%sX.bin", victim);
+    TEST_ASSERT(write_text(victim, "keep\n") == 0 && write_text(MAP_ASM, TABLE_SRC) == 0 &&
+                assemble_file(MAP_ASM, long_bin) == 0, "Image with an overlong path assembled");
+    char kept[16] = "";
+    fp = fopen(victim, "r");
+    TEST_ASSERT(fp && fgets(kept, sizeof(kept), fp) && strcmp(kept, "keep\n") == 0,
+                "No map written over, or removed from, a truncated path");
+    if (fp) fclose(fp);
+    remove(victim);
+    remove(long_bin);
+
+    /* A failed build takes the old map with it */
+    TEST_ASSERT(write_text(MAP_ASM, "    JUMP nowhere\n") == 0 &&
+                assemble_file(MAP_ASM, MAP_BIN) != 0, "Broken source fails");
+    fp = fopen(MAP_FILE, "r");
+    TEST_ASSERT(fp == NULL, "Stale map removed on error");
+    if (fp) fclose(fp);
+
+    remove(MAP_ASM);
+    remove(MAP_BIN);
+    remove(MAP_FILE);
+}
+
+static const char* OPT_ASM = "test_assembler_opt.asm";
+static const char* OPT_BIN = "test_assembler_opt.bin";
+static const char* OPT_MAP = "test_assembler_opt.map";
+
+/* Every pattern once, plus a .org that must not move */
+static const char* PEEPHOLE_SRC =
+    "        LOCO 5\n"
+    "        STOD x\n"
+    "        LODD x\n"              /* AC already holds x */
+    "        JUMP a\n"              /* chain a -> b, then next */
+    "a:      JUMP b\n"
+    "b:      INSP 2\n"
+    "        INSP 1\n"
+    "        DESP 1\n"
+    "        DESP 2\n"
+    "        JNZE c\n"              /* chain c -> d */
+    "        CALL f\n"
+    "        JUMP done\n"
+    "c:      JUMP d\n"
+    "d:      ADDD one\n"
+    "done:   JUMP done\n"
+    "f:      RETN\n"
+    "x:      .word 0\n"
+    "one:    .word 1\n"
+    ".org 0x20\n"
+    "tail:   JUMP tail\n";
+
+/* -O on `source` through a file; the image words in `image` */
+static int optimize_text(const char* source, uint16_t* image, optimize_t* stats) {
+    if (write_text(OPT_ASM, source) != 0 || assemble_file_optimized(OPT_ASM, OPT_BIN, stats) != 0) {
+        return -1;
+    }
+    FILE* fp = fopen(OPT_BIN, "rb");
+    if (!fp) return -1;
+    int size = (int)fread(image, sizeof(uint16_t), MAX_INSTRUCTIONS, fp);
+    fclose(fp);
+    return size;
+}
+
+/*
+ * TEST 8: Peephole optimisation
+ */
+void test_optimize(void) {
+    TEST_SECTION("Peephole optimisation");
+
+    static const uint16_t expected[] = {
+        0x7005, 0x1008, 0xD005, 0xE007, 0x6006, 0x2009, 0x6006, 0xF800, 0x0000, 0x0001
+    };
+    uint16_t image[MAX_INSTRUCTIONS];
+    optimize_t stats;
+
+    int size = optimize_text(PEEPHOLE_SRC, image, &stats);
+    TEST_ASSERT(size == 0x21 && memcmp(image, expected, sizeof(expected)) == 0,
+                "Redundant words dropped, references follow the code");
+    TEST_ASSERT(image[0x0A] == 0 && image[0x1F] == 0 && image[0x20] == 0x6020,
+                "Word after .org keeps its address, the gap grows");
+    TEST_ASSERT(stats.store_loads == 1 && stats.jumps_to_next == 3 && stats.stack_pairs == 2 &&
+                stats.jump_chains == 2 && stats.removed == 8 && stats.blocked_line == 0,
+                "Each pattern counted");
+    TEST_ASSERT(stats.skipped[OP_LODD << 4] == 1 && stats.skipped[OP_JUMP << 4] == 3 &&
+                stats.skipped[OP_INSP >> 4] == 2 && stats.skipped[OP_DESP >> 4] == 2,
+                "Skipped instructions by opcode, a bypassed JUMP dropped later counted once");
+
+    source_map map;
+    init_source_map(&map, OPT_MAP, 1);
+    TEST_ASSERT(source_map_symbol(&map, "c") == 5 && source_map_symbol(&map, "d") == 5 &&
+                source_map_symbol(&map, "b") == 2 && source_map_symbol(&map, "tail") == 0x20,
+                "Map has the new addresses; a dropped word's label moves to the next word");
+    TEST_ASSERT(source_map_line(&map, 2) == 10 && source_map_line(&map, 0x0A) == 19,
+                "Map lines follow the words, the grown gap is the .org's");
+    free_source_map(&map);
+
+    /* The second word of a pattern is a label: a path enters there */
+    size = optimize_text("        STOD x\n"
+                         "again:  LODD x\n"
+                         "        INSP 1\n"
+                         "back:   DESP 1\n"
+                         "        JUMP again\n"
+                         "        JUMP back\n"
+                         "x:      .word 0\n", image, &stats);
+    TEST_ASSERT(size == 7 && stats.removed == 0, "Label boundaries respected");
+
+    /* A label on the first word moves on with it */
+    size = optimize_text("        STOD x\n"
+                         "skip:   INSP 1\n"
+                         "        DESP 1\n"
+                         "        LODD x\n"
+                         "        JUMP skip\n"
+                         "x:      .word 0\n", image, &stats);
+    TEST_ASSERT(size == 4 && stats.stack_pairs == 1 && stats.store_loads == 0 &&
+                image[1] == 0x0003 && image[2] == 0x6001,
+                "A dropped label makes the next word an entry");
+
+    size = optimize_text("        STOD x\n"
+                         "        LODD x\n"
+                         "        LODD 3\n"
+                         "x:      .word 7\n", image, &stats);
+    TEST_ASSERT(size == 4 && stats.removed == 0 && stats.blocked_line == 3,
+                "A number addressing the code keeps every word in place");
+
+    size = optimize_text("a:      JUMP b\n"
+                         "b:      JUMP a\n"
+                         "        CALL a\n"
+                         "        JUMP c\n"
+                         "c:      JUMP c\n", image, &stats);
+    TEST_ASSERT(size == 4 && image[0] == 0x6001 && image[1] == 0x6000 && image[2] == 0xE000 &&
+                image[3] == 0x6003, "Loops of JUMPs left alone, halts end a chain");
+
+    size = optimize_text("spin:   INSP 1\n"
+                         "        DESP 1\n"
+                         "        JUMP spin\n", image, &stats);
+    TEST_ASSERT(size == 3 && stats.removed == 0, "No endless loop turns into a halt");
+
+    size = optimize_text("        INSP 1\n"
+                         "        DESP 1\n"
+                         "        LOCO 2\n"
+                         ".org 3\n"
+                         "end:    JUMP end\n", image, &stats);
+    TEST_ASSERT(size == 4 && stats.removed == 0, "Code running into a .org never meets the gap");
+
+    remove(OPT_ASM);
+    remove(OPT_BIN);
+    remove(OPT_MAP);
+}
+
+static const char* FORWARD_SRC =
+    "        lodd count      ; every operand names a later label\n"
+    "        Jzer done\n"
+    "loop:   subd one\n"
+    "        JNZE loop\n"
+    "        call done\n"
+    "        jump table+2\n"
+    "done:   Jump done\n"
+    "count:  loco 3\n"
+    "one:    LOCO 1\n"
+    "table:  loco 0\n"
+    "        loco 0\n"
+    "        loco 0\n";
+
+/*
+ * TEST 9: Single pass with backpatching
+ */
+void test_single_pass(void) {
+    TEST_SECTION("Single pass with backpatching");
+
+    static const uint16_t expected[] = {
+        0x0007, 0x5006, 0x3008, 0xD002, 0xE006, 0x600B,
+        0x6006, 0x7003, 0x7001, 0x7000, 0x7000, 0x7000
+    };
+    int words = (int)(sizeof(expected) / sizeof(expected[0]));
+
+    assembler_t as;
+    uint16_t out[16];
+    int size = 0;
+
+    init_assembler(&as);
+    TEST_ASSERT(assembler_run(&as, FORWARD_SRC, out, 16, &size) == 0 && size == words &&
+                memcmp(out, expected, sizeof(expected)) == 0,
+                "Forward references backpatched, NAME+N included, mnemonics in any case");
+    TEST_ASSERT(as.fixup_count == 0 && lookup_symbol(&as, "done") == 6 &&
+                lookup_symbol(&as, "table") == 9, "No fixup left once the labels are defined");
+
+    /* One label referenced many times before it appears */
+    char source[MAX_INSTRUCTIONS * 16];
+    int length = 0;
+    for (int i = 0; i < 100; i++) {
+        length += snprintf(source + length, sizeof(source) - (size_t)length, "    JUMP end\n");
+    }
+    snprintf(source + length, sizeof(source) - (size_t)length, "end: JUMP end\n");
+    uint16_t image[MAX_INSTRUCTIONS];
+    TEST_ASSERT(assembler_run(&as, source, image, MAX_INSTRUCTIONS, &size) == 0 && size == 101,
+                "100 fixups against one label");
+    int patched = 1;
+    for (int i = 0; i < size; i++) {
+        if (image[i] != 0x6064) patched = 0;
+    }
+    TEST_ASSERT(patched, "Every fixup gets the label's address");
+
+    TEST_ASSERT(assembler_run(&as, "    LOCO 1\n    JUMP later\n    ADDD nowhere\n", out, 16, &size) != 0 &&
+                as.error_line == 2 && strstr(as.error_msg, "Undefined label: later"),
+                "A label never defined is reported on its first reference");
+    TEST_ASSERT(assembler_run(&as, ".global main\nmain: JUMP main\n", out, 16, &size) == 0 &&
+                size == 1 && out[0] == 0x6000, ".global may come before its label");
+
+    /* One word over the limit is an error, not an overflow */
+    length = 0;
+    for (int i = 0; i <= MAX_INSTRUCTIONS; i++) {
+        length += snprintf(source + length, sizeof(source) - (size_t)length, "LOCO 1\n");
+    }
+    TEST_ASSERT(assembler_run(&as, source, image, MAX_INSTRUCTIONS, &size) != 0 &&
+                strstr(as.error_msg, "Program too large"), "Too many words reported");
+
+    free_assembler(&as);
+}
+
+#define LONG_LABELS 1000
+#define BARE_LABELS 20000
+
+/* 94 characters that differ only past the old 64-character limit */
+static void long_label(char* name, size_t size, int i) {
+    snprintf(name, size, "%s_%04d",
+             "a_label_name_well_past_sixty_four_characters_that_only_differs_at_its_very_end_xxxxxxxxxx", i);
+}
+
+/*
+ * TEST 10: Symbol table growth
+ */
+void test_symbol_table(void) {
+    TEST_SECTION("Symbol table growth");
+
+    /* Each line jumps to another label, before or after it */
+    size_t capacity = (size_t)LONG_LABELS * 2 * 128;
+    char* source = malloc(capacity);
+    uint16_t* image = malloc(MAX_INSTRUCTIONS * sizeof(uint16_t));
+    size_t length = 0;
+    char name[128], target[128];
+
+    for (int i = 0; i < LONG_LABELS; i++) {
+        long_label(name, sizeof(name), i);
+        long_label(target, sizeof(target), (i * 7 + 13) % LONG_LABELS);
+        length += (size_t)snprintf(source + length, capacity - length, "%s: JUMP %s\n", name, target);
+    }
+
+    assembler_t as;
+    int size = 0;
+
+    init_assembler(&as);
+    TEST_ASSERT(assembler_run(&as, source, image, MAX_INSTRUCTIONS, &size) == 0 &&
+                size == LONG_LABELS && as.symbol_count == LONG_LABELS,
+                "1000 labels of 94 characters, none confused with another");
+
+    int found = 1, patched = 1;
+    for (int i = 0; i < LONG_LABELS; i++) {
+        long_label(name, sizeof(name), i);
+        if (lookup_symbol(&as, name) != i) found = 0;
+        if (image[i] != (0x6000 | (i * 7 + 13) % LONG_LABELS)) patched = 0;
+    }
+    TEST_ASSERT(found, "Every label found at its address");
+    TEST_ASSERT(patched, "Every reference, forward or backward, resolved");
+    TEST_ASSERT((as.slot_count & (as.slot_count - 1)) == 0 && as.slot_count >= 2 * as.symbol_count,
+                "Hash table grew to a power of two, at most half full");
+    long_label(name, sizeof(name), LONG_LABELS);
+    TEST_ASSERT(lookup_symbol(&as, name) == -1, "A missing label is not found");
+
+    /* Bare labels take no words, so the table can outgrow memory */
+    free(source);
+    capacity = (size_t)BARE_LABELS * 16;
+    source = malloc(capacity);
+    length = 0;
+    for (int i = 0; i < BARE_LABELS; i++) {
+        length += (size_t)snprintf(source + length, capacity - length, "l%d:\n", i);
+    }
+    snprintf(source + length, capacity - length, "last: JUMP l%d\n", BARE_LABELS - 1);
+    TEST_ASSERT(assembler_run(&as, source, image, MAX_INSTRUCTIONS, &size) == 0 && size == 1 &&
+                as.symbol_count == BARE_LABELS + 1 && lookup_symbol(&as, "l0") == 0 &&
+                lookup_symbol(&as, "l19999") == 0 && image[0] == 0x6000,
+                "20000 labels on one address");
+
+    free_assembler(&as);
+    free(source);
+    free(image);
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  ASSEMBLER UNIT TESTS                                      ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_contexts();
+    test_threads();
+    test_update();
+    test_directives();
+    test_stream();
+    test_syntax();
+    test_source_map();
+    test_optimize();
+    test_single_pass();
+    test_symbol_table();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
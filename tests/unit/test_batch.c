@@ -0,0 +1,266 @@
+/*
+ * test_batch.c - Struct-of-arrays batch engine
+ *
+ * Purpose: Verify that every lane of the batch engine matches a scalar
+ *          CPU on the direct engine, whether the lanes agree on the
+ *          instruction or diverge, that one program runs over many
+ *          inputs, and that faults stop or trap only their own lane.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/mic1.h"
+#include "../../include/batch.h"
+#include "../../include/utils/conversions.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+#define LANES 256
+#define STEPS 300
+
+static mic1_cpu cpu;
+static mic1_batch batch;
+
+/* PC, AC, SP and instruction count of every lane after each batch step */
+static int trace_pc[STEPS][LANES];
+static int trace_ac[STEPS][LANES];
+static int trace_sp[STEPS][LANES];
+static int trace_cycles[STEPS][LANES];
+
+/* acc := n * x by repeated addition; halts on JUMP self at 8 */
+static const int program[] = {
+    0x0020, 0x5008, 0x3021, 0x1020, 0x0022, 0x2023, 0x1022, 0x6000, 0x6008
+};
+
+/*
+ * TEST 1: Lane access
+ */
+void test_lanes(void) {
+    TEST_SECTION("Lane access");
+
+    TEST_ASSERT(init_batch(&batch, LANES) == 0, "A batch of 256 lanes is allocated");
+    TEST_ASSERT(batch.sp[0] == 0x0FFF && batch.sp[LANES - 1] == 0x0FFF && batch.pc[7] == 0 &&
+                batch.fault_action == FAULT_ACTION_HALT, "Every lane starts from reset");
+
+    batch_store_word(&batch, BATCH_ALL_LANES, 0x100, 0xBEEF);
+    batch_store_word(&batch, 200, 0x100, 0x1234);
+    TEST_ASSERT(batch_load_word(&batch, 0, 0x100) == 0xBEEF && batch_load_word(&batch, 199, 0x100) == 0xBEEF &&
+                batch_load_word(&batch, 200, 0x100) == 0x1234, "Stores reach only the selected lanes");
+
+    init_mic1(&cpu);
+    mem_store_word(&cpu.main_memory, 0xABC, 0x7777);
+    int_to_bits(0x0123, cpu.reg_bank.AC.data, 16);
+    int_to_bits(0x0456, cpu.reg_bank.PC.data, 16);
+    cpu.cycle_count = 9;
+    batch_load_cpu(&batch, 33, &cpu);
+    TEST_ASSERT(batch_load_word(&batch, 33, 0xABC) == 0x7777 && batch.ac[33] == 0x0123 &&
+                batch.pc[33] == 0x0456 && batch.cycle_count[33] == 9 &&
+                batch_load_word(&batch, 33, 0x100) == 0 && batch_load_word(&batch, 32, 0xABC) == 0,
+                "A scalar CPU loads into one lane");
+
+    uint64_t digest = mic1_state_digest(&cpu);
+    init_mic1(&cpu);
+    batch_store_cpu(&batch, 33, &cpu);
+    TEST_ASSERT(mic1_state_digest(&cpu) == digest && cpu.cycle_count == 9, "The lane stores back unchanged");
+
+    free_batch(&batch);
+    TEST_ASSERT(batch.memory == NULL && batch.lanes == 0, "free_batch releases the arrays");
+    TEST_ASSERT(init_batch(&batch, 0) == -1, "A batch needs at least one lane");
+}
+
+/*
+ * TEST 2: Lockstep against the direct engine
+ */
+
+/* Random memory and SP for one lane, reproducible from its seed */
+static void randomise(mic1_cpu* c, int lane) {
+    srand(2000 + lane);
+    for (int addr = 0; addr < MEMORY_SIZE; addr++) {
+        mem_store_word(&c->main_memory, addr, rand() & 0xFFFF);
+    }
+    int_to_bits(rand() & 0xFFF, c->reg_bank.SP.data, 16);
+}
+
+void test_lockstep(void) {
+    TEST_SECTION("Lanes against the direct engine");
+
+    int diverged = 0, mismatched = 0, final_mismatch = 0;
+
+    init_batch(&batch, LANES);
+    batch.fault_action = FAULT_ACTION_IGNORE;
+    for (int lane = 0; lane < LANES; lane++) {
+        init_mic1(&cpu);
+        randomise(&cpu, lane);
+        batch_load_cpu(&batch, lane, &cpu);
+    }
+
+    for (int step = 0; step < STEPS; step++) {
+        batch_step(&batch);
+        for (int lane = 0; lane < LANES; lane++) {
+            trace_pc[step][lane] = batch.pc[lane];
+            trace_ac[step][lane] = batch.ac[lane];
+            trace_sp[step][lane] = batch.sp[lane];
+            trace_cycles[step][lane] = batch.cycle_count[lane];
+        }
+    }
+
+    static mic1_cpu stored;
+    for (int lane = 0; lane < LANES; lane++) {
+        init_mic1(&cpu);
+        cpu.fault.action = FAULT_ACTION_IGNORE;
+        randomise(&cpu, lane);
+
+        for (int step = 0; step < STEPS; step++) {
+            step_mic1(&cpu);
+            if (bits_to_int(cpu.reg_bank.PC.data, 16) != trace_pc[step][lane] ||
+                bits_to_int(cpu.reg_bank.AC.data, 16) != trace_ac[step][lane] ||
+                bits_to_int(cpu.reg_bank.SP.data, 16) != trace_sp[step][lane] ||
+                cpu.cycle_count != trace_cycles[step][lane]) {
+                mismatched++;
+                break;
+            }
+            if (trace_pc[step][lane] != trace_pc[step][0]) diverged = 1;
+        }
+
+        init_mic1(&stored);
+        batch_store_cpu(&batch, lane, &stored);
+        if (mic1_state_digest(&stored) != mic1_state_digest(&cpu)) final_mismatch++;
+    }
+    free_batch(&batch);
+
+    TEST_ASSERT(diverged, "Random programs send lanes down different paths");
+    TEST_ASSERT(mismatched == 0, "PC, AC, SP and instruction count match after every step");
+    TEST_ASSERT(final_mismatch == 0, "Memory and registers match at the end");
+}
+
+/*
+ * TEST 3: One program, many inputs
+ */
+void test_inputs(void) {
+    TEST_SECTION("One program over 1000 inputs");
+
+    init_batch(&batch, 1000);
+    for (int i = 0; i < 9; i++) {
+        batch_store_word(&batch, BATCH_ALL_LANES, i, program[i]);
+    }
+    batch_store_word(&batch, BATCH_ALL_LANES, 0x21, 1);
+    for (int lane = 0; lane < batch.lanes; lane++) {
+        batch_store_word(&batch, lane, 0x20, lane % 50);
+        batch_store_word(&batch, lane, 0x23, lane);
+    }
+
+    for (int step = 0; step < 8 * 50 + 8; step++) {
+        batch_step(&batch);
+    }
+
+    int wrong = 0, halted = 1;
+    for (int lane = 0; lane < batch.lanes; lane++) {
+        if (batch_load_word(&batch, lane, 0x22) != (lane % 50) * lane) wrong++;
+        if (batch.pc[lane] != 8 || batch.stopped[lane]) halted = 0;
+    }
+    TEST_ASSERT(wrong == 0, "Every lane computes its own product");
+    TEST_ASSERT(halted, "Every lane ends in the halt loop");
+
+    init_mic1(&cpu);
+    for (int i = 0; i < 9; i++) {
+        mem_store_word(&cpu.main_memory, i, program[i]);
+    }
+    mem_store_word(&cpu.main_memory, 0x20, 49);
+    mem_store_word(&cpu.main_memory, 0x21, 1);
+    mem_store_word(&cpu.main_memory, 0x23, 999);
+    for (int step = 0; step < 8 * 50 + 8; step++) {
+        step_mic1(&cpu);
+    }
+    TEST_ASSERT(cpu.cycle_count == batch.cycle_count[999] &&
+                bits_to_int(cpu.reg_bank.AC.data, 16) == batch.ac[999],
+                "A lane matches a scalar CPU on the same input");
+    free_batch(&batch);
+}
+
+/*
+ * TEST 4: Faults
+ */
+void test_faults(void) {
+    TEST_SECTION("Faults per lane");
+
+    /* Lane 1 runs off the end of memory, the others keep counting */
+    init_batch(&batch, 4);
+    batch_store_word(&batch, BATCH_ALL_LANES, 0, 0x7001);      /* LOCO 1 */
+    batch_store_word(&batch, BATCH_ALL_LANES, 1, 0x6000);      /* JUMP 0 */
+    batch_store_word(&batch, 1, 1, 0x6FFF);                    /* JUMP 0xFFF */
+    for (int i = 0; i < 6; i++) batch_step(&batch);
+
+    TEST_ASSERT(batch.stopped[1] && batch.fault[1] == FAULT_PC_BOUNDS && batch.pc[1] == MEMORY_SIZE &&
+                batch.cycle_count[1] == 3, "HALT stops the faulting lane on the bad fetch");
+    TEST_ASSERT(!batch.stopped[0] && !batch.stopped[3] && batch.fault[0] == FAULT_NONE &&
+                batch.cycle_count[0] == 6, "Other lanes are not affected");
+
+    batch.stopped[1] = 0;
+    batch.fault_action = FAULT_ACTION_TRAP;
+    batch.trap_vector = 0x200;
+    batch.pc[1] = MEMORY_SIZE;
+    batch_step(&batch);
+    TEST_ASSERT(!batch.stopped[1] && batch.pc[1] == 0x200 && batch.fault[1] == FAULT_PC_BOUNDS,
+                "TRAP sends only the faulting lane to the trap vector");
+
+    batch.fault_action = FAULT_ACTION_HALT;
+    batch.pc[2] = MEMORY_SIZE;
+    batch_step(&batch);
+    TEST_ASSERT(batch.stopped[2] && batch.fault[2] == FAULT_PC_BOUNDS, "A PC past memory faults");
+    free_batch(&batch);
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  BATCH ENGINE UNIT TESTS                                   ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_lanes();
+    test_lockstep();
+    test_inputs();
+    test_faults();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
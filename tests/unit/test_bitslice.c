@@ -0,0 +1,281 @@
+/*
+ * test_bitslice.c - Bit-sliced 64-lane microcode engine
+ *
+ * Purpose: Verify that every lane of the bit-sliced engine matches a
+ *          scalar CPU on the microcode engine, with lanes diverging on
+ *          random programs and regrouping at the fetch, and that one
+ *          program runs over 64 different inputs at once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/mic1.h"
+#include "../../include/bitslice.h"
+#include "../../include/microasm.h"
+#include "../../include/utils/conversions.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+static const char* MICROCODE = "../../data/basic_microcode.txt";
+static const char* MAL_SOURCE = "../../data/mic1.mal";
+static const char* MAL_STORE = "test_bitslice.txt";
+
+#define STEPS 300
+
+static mic1_cpu cpu, scratch;
+static mic1_slice slice;
+static mal_program prog;
+
+/* PC, AC, SP and cycle count of every lane after each step of the slice */
+static int trace_pc[STEPS][SLICE_LANES];
+static int trace_ac[STEPS][SLICE_LANES];
+static int trace_sp[STEPS][SLICE_LANES];
+static int trace_cycles[STEPS][SLICE_LANES];
+
+/*
+ * TEST 1: Lane access
+ */
+void test_lanes(void) {
+    TEST_SECTION("Lane access");
+
+    init_mic1(&cpu);
+    load_microprogram_file(&cpu, MICROCODE);
+    init_slice(&slice, &cpu.ctrl_mem);
+
+    TEST_ASSERT(slice_register(&slice, 0, 4) == 0x0FFF && slice_register(&slice, 63, 5) == 0x0FFF &&
+                slice_register(&slice, 17, 9) == 0xFFFF && slice_register(&slice, 40, 8) == 1,
+                "Every lane starts with the reset register values");
+
+    slice_store_word(&slice, SLICE_ALL_LANES, 0x100, 0xBEEF);
+    slice_store_word(&slice, (uint64_t)1 << 63, 0x100, 0x1234);
+    slice_set_register(&slice, (uint64_t)1 << 5, 1, 0x8001);
+    TEST_ASSERT(slice_load_word(&slice, 0, 0x100) == 0xBEEF &&
+                slice_load_word(&slice, 62, 0x100) == 0xBEEF &&
+                slice_load_word(&slice, 63, 0x100) == 0x1234, "Stores reach only the selected lanes");
+    TEST_ASSERT(slice_register(&slice, 5, 1) == 0x8001 && slice_register(&slice, 4, 1) == 0 &&
+                slice_register(&slice, 6, 1) == 0, "Register writes reach only the selected lanes");
+
+    /* Round trip through a scalar CPU */
+    init_mic1(&scratch);
+    mem_store_word(&scratch.main_memory, 0xABC, 0x7777);
+    int_to_bits(0x0123, scratch.reg_bank.TIR.data, 16);
+    int_to_bits(0x0ABC, scratch.mar.address, 12);
+    int_to_bits(3, scratch.mpc.address, MICROADDR_BITS);
+    slice_load_cpu(&slice, 33, &scratch);
+    TEST_ASSERT(slice_load_word(&slice, 33, 0xABC) == 0x7777 && slice_register(&slice, 33, 3) == 0x0123 &&
+                slice_mpc(&slice, 33) == 3 && slice_mpc(&slice, 32) == 0 &&
+                slice_load_word(&slice, 33, 0x100) == 0, "A scalar CPU loads into one lane");
+
+    uint64_t digest = mic1_state_digest(&scratch);
+    init_mic1(&scratch);
+    slice_store_cpu(&slice, 33, &scratch);
+    TEST_ASSERT(mic1_state_digest(&scratch) == digest && bits_to_int(scratch.mar.address, 12) == 0xABC &&
+                bits_to_int(scratch.mpc.address, MICROADDR_BITS) == 3, "The lane stores back unchanged");
+}
+
+/*
+ * TEST 2: Lockstep against scalar CPUs
+ */
+
+/* Random memory and SP for one lane, reproducible from its seed */
+static void randomise(mic1_cpu* c, int lane) {
+    srand(1000 + lane);
+    for (int addr = 0; addr < MEMORY_SIZE; addr++) {
+        mem_store_word(&c->main_memory, addr, rand() & 0xFFFF);
+    }
+    int_to_bits(rand() & 0xFFF, c->reg_bank.SP.data, 16);
+}
+
+/* Random programs on the slice, then lane by lane on scalar CPUs */
+static void lockstep(const char* microcode) {
+    int diverged = 0, mismatched = 0, final_mismatch = 0;
+
+    init_mic1(&cpu);
+    load_microprogram_file(&cpu, microcode);
+    init_slice(&slice, &cpu.ctrl_mem);
+
+    for (int lane = 0; lane < SLICE_LANES; lane++) {
+        init_mic1(&scratch);
+        randomise(&scratch, lane);
+        slice_load_cpu(&slice, lane, &scratch);
+    }
+
+    for (int step = 0; step < STEPS; step++) {
+        slice_step(&slice);
+        for (int lane = 0; lane < SLICE_LANES; lane++) {
+            trace_pc[step][lane] = slice_register(&slice, lane, 0);
+            trace_ac[step][lane] = slice_register(&slice, lane, 1);
+            trace_sp[step][lane] = slice_register(&slice, lane, 4);
+            trace_cycles[step][lane] = slice.cycle_count[lane];
+        }
+    }
+    uint64_t active = slice.active, faulted = slice.faulted;
+
+    for (int lane = 0; lane < SLICE_LANES; lane++) {
+        init_mic1(&scratch);
+        load_microprogram_file(&scratch, microcode);
+        scratch.engine = MIC1_ENGINE_MICROCODE;
+        randomise(&scratch, lane);
+
+        for (int step = 0; step < STEPS; step++) {
+            step_mic1(&scratch);
+            if (bits_to_int(scratch.reg_bank.PC.data, 16) != trace_pc[step][lane] ||
+                bits_to_int(scratch.reg_bank.AC.data, 16) != trace_ac[step][lane] ||
+                bits_to_int(scratch.reg_bank.SP.data, 16) != trace_sp[step][lane] ||
+                scratch.cycle_count != trace_cycles[step][lane]) {
+                mismatched++;
+                break;
+            }
+            if (lane > 0 && trace_pc[step][lane] != trace_pc[step][0]) diverged = 1;
+        }
+
+        init_mic1(&cpu);
+        slice_store_cpu(&slice, lane, &cpu);
+        if (mic1_state_digest(&cpu) != mic1_state_digest(&scratch) ||
+            bits_to_int(cpu.mbr.data, 16) != bits_to_int(scratch.mbr.data, 16) ||
+            bits_to_int(cpu.mar.address, 12) != bits_to_int(scratch.mar.address, 12)) {
+            final_mismatch++;
+        }
+    }
+
+    TEST_ASSERT(diverged, "Random programs send lanes down different paths");
+    TEST_ASSERT(mismatched == 0, "PC, AC, SP and cycle count match the scalar CPU after every step");
+    TEST_ASSERT(final_mismatch == 0, "Memory, registers, MAR and MBR match at the end");
+    TEST_ASSERT(active == SLICE_ALL_LANES && faulted == 0, "No lane leaves the control store");
+}
+
+void test_lockstep(void) {
+    TEST_SECTION("Lanes against the scalar microcode engine");
+
+    printf("  data/basic_microcode.txt:\n");
+    lockstep(MICROCODE);
+
+    /* 8-bit dispatch keys, so lanes also split on the sub-opcode */
+    FILE* out = fopen(MAL_STORE, "w");
+    TEST_ASSERT(mal_assemble_file(MAL_SOURCE, &prog) == 0 &&
+                mal_write_control_store(&prog, NULL, MAL_SOURCE, out) == 0, "data/mic1.mal assembles");
+    fclose(out);
+
+    printf("  data/mic1.mal:\n");
+    lockstep(MAL_STORE);
+}
+
+/*
+ * TEST 3: One program, 64 inputs
+ */
+void test_inputs(void) {
+    TEST_SECTION("One program over 64 inputs");
+
+    /* acc := n * x by repeated addition; halts on JUMP self at 8 */
+    static const int program[] = {
+        0x0020, 0x5008, 0x3021, 0x1020, 0x0022, 0x2023, 0x1022, 0x6000, 0x6008
+    };
+
+    /* data/mic1.mal implements the ISA; the basic microcode does not */
+    init_mic1(&cpu);
+    load_microprogram_file(&cpu, MAL_STORE);
+    init_slice(&slice, &cpu.ctrl_mem);
+
+    for (int i = 0; i < 9; i++) {
+        slice_store_word(&slice, SLICE_ALL_LANES, i, program[i]);
+    }
+    slice_store_word(&slice, SLICE_ALL_LANES, 0x21, 1);
+    for (int lane = 0; lane < SLICE_LANES; lane++) {
+        slice_store_word(&slice, (uint64_t)1 << lane, 0x20, lane);
+        slice_store_word(&slice, (uint64_t)1 << lane, 0x23, lane + 5);
+    }
+
+    for (int step = 0; step < 8 * SLICE_LANES + 8; step++) {
+        slice_step(&slice);
+    }
+
+    int wrong = 0, halted = 1;
+    for (int lane = 0; lane < SLICE_LANES; lane++) {
+        if (slice_load_word(&slice, lane, 0x22) != lane * (lane + 5)) wrong++;
+        if (slice_register(&slice, lane, 0) != 8) halted = 0;
+    }
+    TEST_ASSERT(wrong == 0, "Every lane computes its own product");
+    TEST_ASSERT(halted, "Lanes that finish early wait at the halt loop");
+    TEST_ASSERT(slice.cycle_count[63] > slice.cycle_count[1] && slice.cycle_count[1] > slice.cycle_count[0],
+                "Longer inputs take more microcycles");
+
+    /* Same run on one scalar CPU for the longest input */
+    init_mic1(&scratch);
+    load_microprogram_file(&scratch, MAL_STORE);
+    scratch.engine = MIC1_ENGINE_MICROCODE;
+    for (int i = 0; i < 9; i++) {
+        mem_store_word(&scratch.main_memory, i, program[i]);
+    }
+    mem_store_word(&scratch.main_memory, 0x20, 63);
+    mem_store_word(&scratch.main_memory, 0x21, 1);
+    mem_store_word(&scratch.main_memory, 0x23, 68);
+    for (int step = 0; step < 8 * SLICE_LANES + 8; step++) {
+        step_mic1(&scratch);
+    }
+    TEST_ASSERT(scratch.cycle_count == slice.cycle_count[63], "Lane 63 spends as many microcycles as a scalar CPU");
+
+    /* Lanes outside `active` do not move */
+    init_slice(&slice, &cpu.ctrl_mem);
+    slice_store_word(&slice, SLICE_ALL_LANES, 0, 0x7042);
+    slice.active = ~(uint64_t)1;
+    slice_step(&slice);
+    TEST_ASSERT(slice_register(&slice, 1, 1) == 0x42 && slice_register(&slice, 0, 1) == 0 &&
+                slice_register(&slice, 0, 0) == 0 && slice.cycle_count[0] == 0,
+                "Inactive lanes keep their state");
+
+    remove(MAL_STORE);
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  BIT-SLICED ENGINE UNIT TESTS                              ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_lanes();
+    test_lockstep();
+    test_inputs();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
@@ -0,0 +1,275 @@
+/*
+ * test_compiled_engine.c - Cross-check of the compiled microcode engine
+ *
+ * Purpose: Verify that the code generated by mic1mcc from
+ *          data/mic1_microcode.txt has the same architectural effect as
+ *          interpreting the control store, cycle by cycle, from both a
+ *          reset CPU and randomised register/memory states, and that the
+ *          test programs leave the same state on all three engines.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/mic1.h"
+#include "../../include/assembler.h"
+#include "../../include/microcode_compiled.h"
+#include "../../include/utils/conversions.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+static const char* MICROCODE = "../../data/mic1_microcode.txt";
+
+static mic1_cpu interp, compiled;
+
+/* Architectural state both engines must agree on */
+static int same_state(mic1_cpu* x, mic1_cpu* y) {
+    return mic1_state_digest(x) == mic1_state_digest(y) &&
+           bits_to_int(x->mpc.address, MICROADDR_BITS) ==
+               bits_to_int(y->mpc.address, MICROADDR_BITS) &&
+           bits_to_int(x->mar.address, 12) == bits_to_int(y->mar.address, 12) &&
+           bits_to_int(x->mbr.data, 16) == bits_to_int(y->mbr.data, 16) &&
+           x->unified_cache.hits == y->unified_cache.hits &&
+           x->unified_cache.misses == y->unified_cache.misses &&
+           x->cycle_count == y->cycle_count;
+}
+
+/* Run both engines for `cycles`; returns the first diverging cycle or -1 */
+static int lockstep(int cycles) {
+    for (int i = 0; i < cycles; i++) {
+        run_mic1_cycle(&interp);
+        run_compiled_cycle(&compiled);
+        if (!same_state(&interp, &compiled)) return i;
+    }
+    return -1;
+}
+
+static void setup_pair(void) {
+    init_mic1(&interp);
+    init_mic1(&compiled);
+    load_microprogram_file(&interp, MICROCODE);
+}
+
+/*
+ * TEST 1: Engines agree from reset
+ */
+void test_from_reset(void) {
+    TEST_SECTION("Lockstep from reset");
+
+    setup_pair();
+    TEST_ASSERT(strstr(mic1_compiled_source, "mic1_microcode.txt") != NULL,
+                "Compiled engine was generated from the default microprogram");
+
+    /* LOCO 66; STOD 100; ADDD 100; JUMP 0 */
+    int program[] = { 0x7042, 0x1064, 0x2064, 0x6000 };
+    for (int i = 0; i < 4; i++) {
+        mem_store_word(&interp.main_memory, i, program[i]);
+        mem_store_word(&compiled.main_memory, i, program[i]);
+    }
+
+    TEST_ASSERT(lockstep(5000) < 0, "5000 microcycles agree on a small program");
+}
+
+/*
+ * TEST 2: Engines agree from random states
+ */
+void test_random_states(void) {
+    TEST_SECTION("Lockstep from random states");
+
+    srand(42);
+    int diverged = 0;
+
+    for (int trial = 0; trial < 64 && !diverged; trial++) {
+        setup_pair();
+
+        for (int addr = 0; addr < MEMORY_SIZE; addr++) {
+            int v = rand() & 0xFFFF;
+            mem_store_word(&interp.main_memory, addr, v);
+            mem_store_word(&compiled.main_memory, addr, v);
+        }
+        mic1_register* ri = &interp.reg_bank.PC;
+        mic1_register* rc = &compiled.reg_bank.PC;
+        for (int r = 0; r < 16; r++) {
+            int v = rand() & 0xFFFF;
+            int_to_bits(v, ri[r].data, 16);
+            int_to_bits(v, rc[r].data, 16);
+        }
+        int mpc = rand() % interp.ctrl_mem.size;
+        int_to_bits(mpc, interp.mpc.address, MICROADDR_BITS);
+        int_to_bits(mpc, compiled.mpc.address, MICROADDR_BITS);
+
+        if (lockstep(500) >= 0) diverged = 1;
+    }
+
+    TEST_ASSERT(!diverged, "64 random states x 500 microcycles agree");
+}
+
+/*
+ * TEST 3: step_mic1 engine selection
+ */
+void test_engine_step(void) {
+    TEST_SECTION("Engine selection");
+
+    setup_pair();
+    interp.engine = MIC1_ENGINE_MICROCODE;
+    compiled.engine = MIC1_ENGINE_COMPILED;
+
+    mem_store_word(&interp.main_memory, 0, 0x7042);
+    mem_store_word(&compiled.main_memory, 0, 0x7042);
+
+    step_mic1(&interp);
+    step_mic1(&compiled);
+    TEST_ASSERT(bits_to_int(compiled.mpc.address, MICROADDR_BITS) == 0 && compiled.cycle_count > 1,
+                "A step runs microcycles until MPC returns to 0");
+    TEST_ASSERT(same_state(&interp, &compiled), "Microcode and compiled steps agree");
+
+    TEST_ASSERT(mic1_engine_from_name("compiled") == MIC1_ENGINE_COMPILED &&
+                mic1_engine_from_name("bogus") < 0, "Engine names parse");
+
+    reset_mic1(&compiled);
+    TEST_ASSERT(compiled.engine == MIC1_ENGINE_COMPILED, "Engine survives reset");
+}
+
+static const char* PROGRAMS[] = {
+    "../01_registers.asm", "../02_alu_math.asm", "../03_memory_io.asm",
+    "../04_control_flow.asm", "../05_stack_ops.asm", "../06_tables.asm"
+};
+
+/* The word at PC is a JUMP to itself */
+static int at_halt(mic1_cpu* cpu) {
+    int pc = bits_to_int(cpu->reg_bank.PC.data, 16);
+    int instr = mem_load_word(&cpu->main_memory, pc & 0xFFF);
+    return instr == (0x6000 | (pc & 0xFFF));
+}
+
+static void start(mic1_cpu* cpu, int engine, const uint16_t* image, int size) {
+    init_mic1(cpu);
+    if (engine == MIC1_ENGINE_MICROCODE) load_microprogram_file(cpu, MICROCODE);
+    cpu->engine = engine;
+    cpu->running = 1;
+    int_to_bits(0x0FFF, cpu->reg_bank.SP.data, 16);
+    load_program_image(cpu, image, 0, size);
+}
+
+/*
+ * TEST 4: Test programs on every engine
+ */
+void test_programs(void) {
+    TEST_SECTION("tests/*.asm on every engine");
+
+    static mic1_cpu direct;
+    static char source[65536];
+    static uint16_t image[MEMORY_SIZE];
+    char message[96];
+
+    for (size_t p = 0; p < sizeof(PROGRAMS) / sizeof(PROGRAMS[0]); p++) {
+        FILE* fp = fopen(PROGRAMS[p], "r");
+        size_t n = fp ? fread(source, 1, sizeof(source) - 1, fp) : 0;
+        if (fp) fclose(fp);
+        source[n] = '\0';
+
+        int size = 0;
+        if (n == 0 || assemble_string(source, image, &size) != 0) {
+            snprintf(message, sizeof(message), "%s assembles", PROGRAMS[p]);
+            TEST_ASSERT(0, message);
+            continue;
+        }
+
+        start(&direct, MIC1_ENGINE_DIRECT, image, size);
+        start(&interp, MIC1_ENGINE_MICROCODE, image, size);
+        start(&compiled, MIC1_ENGINE_COMPILED, image, size);
+
+        /* Until the halt, or a while into a program that loops */
+        int agree = 1, steps = 0;
+        while (agree && steps < 2000 && !at_halt(&direct)) {
+            step_mic1(&direct);
+            step_mic1(&interp);
+            step_mic1(&compiled);
+            agree = mic1_state_digest(&interp) == mic1_state_digest(&direct) &&
+                    mic1_state_digest(&compiled) == mic1_state_digest(&direct);
+            steps++;
+        }
+        snprintf(message, sizeof(message), "%s: %d instructions, same state on all engines",
+                 PROGRAMS[p] + 3, steps);
+        TEST_ASSERT(agree && steps > 0, message);
+    }
+}
+
+/*
+ * TEST 5: MPC outside the control store
+ */
+void test_mpc_bounds(void) {
+    TEST_SECTION("MPC bounds");
+
+    for (int action = FAULT_ACTION_HALT; action <= FAULT_ACTION_IGNORE; action++) {
+        setup_pair();
+        interp.fault.action = compiled.fault.action = action;
+        interp.running = compiled.running = 1;
+        int_to_bits(interp.ctrl_mem.size, interp.mpc.address, MICROADDR_BITS);
+        int_to_bits(interp.ctrl_mem.size, compiled.mpc.address, MICROADDR_BITS);
+
+        int agree = lockstep(1) < 0 && interp.running == compiled.running &&
+                    compiled.fault.kind == FAULT_MPC_BOUNDS &&
+                    compiled.fault.address == interp.fault.address &&
+                    compiled.fault.count == interp.fault.count;
+        TEST_ASSERT(agree && lockstep(500) < 0, action == FAULT_ACTION_HALT ?
+                    "HALT: both engines raise MPC_BOUNDS and stop" : action == FAULT_ACTION_TRAP ?
+                    "TRAP: both engines raise MPC_BOUNDS and agree afterwards" :
+                    "IGNORE: both engines raise MPC_BOUNDS and agree afterwards");
+    }
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  COMPILED MICROCODE ENGINE UNIT TESTS                      ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_from_reset();
+    test_random_states();
+    test_engine_step();
+    test_programs();
+    test_mpc_bounds();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
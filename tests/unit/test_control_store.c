@@ -0,0 +1,392 @@
+/*
+ * test_control_store.c - Binary control-store format and predecoded table
+ *
+ * Purpose: Verify that the predecoded micro_op table matches
+ *          decode_microinstruction, that .mcs files round-trip and are
+ *          auto-detected by load_microprogram, that damaged files are
+ *          rejected, that a CPU behaves identically with either form, and
+ *          that the dispatch table loads with the microprogram.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/mic1.h"
+#include "../../include/control_store.h"
+#include "../../include/utils/conversions.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+static const char* MICROCODE = "../../data/basic_microcode.txt";
+static const char* BINARY = "test_control_store.mcs";
+static const char* DISPATCH_TEXT = "test_control_store.txt";
+
+static control_memory text_cm, bin_cm;
+
+static int same_mir(const mir* x, const mir* y) {
+    return memcmp(x, y, sizeof(mir)) == 0;
+}
+
+static int same_store(const control_memory* x, const control_memory* y) {
+    return memcmp(x->microinstructions, y->microinstructions, sizeof(x->microinstructions)) == 0 &&
+           memcmp(x->words, y->words, sizeof(x->words)) == 0 &&
+           memcmp(x->ext, y->ext, sizeof(x->ext)) == 0 &&
+           memcmp(x->ops, y->ops, sizeof(x->ops)) == 0 && x->size == y->size;
+}
+
+/*
+ * TEST 1: Predecoded table matches the bitwise decoder
+ */
+void test_predecode(void) {
+    TEST_SECTION("Predecoded table");
+
+    init_control_memory(&text_cm);
+    int count = load_microprogram(&text_cm, MICROCODE);
+    TEST_ASSERT(count > 0, "Text microprogram loads");
+
+    int mismatches = 0;
+    for (int addr = 0; addr < text_cm.size; addr++) {
+        mpc p;
+        mir fetched, decoded;
+        init_mir(&fetched);
+        init_mir(&decoded);
+        int_to_bits(addr, p.address, MICROADDR_BITS);
+
+        fetch_microinstruction(&text_cm, &p, &fetched);
+        memcpy(decoded.data, text_cm.microinstructions[addr], sizeof(decoded.data));
+        decoded.ext = text_cm.ext[addr];
+        decode_microinstruction(&decoded);
+        if (!same_mir(&fetched, &decoded)) mismatches++;
+    }
+    TEST_ASSERT(mismatches == 0, "fetch_microinstruction agrees with decode_microinstruction at all 256 addresses");
+
+    micro_op op;
+    decode_micro_op(0xFF00F807u, &op);
+    TEST_ASSERT(op.addr == 0xFF && op.c == 0xF && op.cond == COND_ALWAYS &&
+                (op.flags & MICRO_ENC) && !(op.flags & MICRO_WR) && (op.flags & MICRO_AMUX),
+                "decode_micro_op extracts ADDR, C, COND and flag bits");
+}
+
+/*
+ * TEST 2: Round trip through the binary format
+ */
+void test_round_trip(void) {
+    TEST_SECTION("Binary round trip");
+
+    int count = load_microprogram(&text_cm, MICROCODE);
+
+    TEST_ASSERT(save_control_store(&text_cm, count, CS_FLAG_PREDECODED, BINARY) == 0,
+                "save_control_store writes the file");
+    TEST_ASSERT(is_control_store_file(BINARY) && !is_control_store_file(MICROCODE),
+                "Binary files are recognised by their magic");
+
+    init_control_memory(&bin_cm);
+    TEST_ASSERT(load_microprogram(&bin_cm, BINARY) == count,
+                "load_microprogram auto-detects the binary file");
+    TEST_ASSERT(same_store(&text_cm, &bin_cm), "Bits, words and predecoded ops match the text load");
+
+    TEST_ASSERT(save_control_store(&text_cm, count, 0, BINARY) == 0, "Saved without predecoded table");
+    init_control_memory(&bin_cm);
+    TEST_ASSERT(load_control_store(&bin_cm, BINARY) == count && same_store(&text_cm, &bin_cm),
+                "Table is rebuilt when it is not stored");
+}
+
+/*
+ * TEST 3: Damaged files are rejected
+ */
+
+/* Saves a fresh file, flips one bit (negative offsets count from the end)
+ * or drops the last byte, and tries to load it */
+static int corrupt_and_load(long offset, int truncate) {
+    int count = load_microprogram(&text_cm, MICROCODE);
+    save_control_store(&text_cm, count, CS_FLAG_PREDECODED, BINARY);
+
+    FILE* fp = fopen(BINARY, "rb");
+    unsigned char buffer[CS_MAX_FILE_SIZE];
+    size_t size = fread(buffer, 1, sizeof(buffer), fp);
+    fclose(fp);
+
+    if (truncate) {
+        size -= 1;
+    } else {
+        buffer[offset < 0 ? (long)size + offset : offset] ^= 0x01;
+    }
+    fp = fopen(BINARY, "wb");
+    fwrite(buffer, 1, size, fp);
+    fclose(fp);
+
+    init_control_memory(&bin_cm);
+    return load_control_store(&bin_cm, BINARY);
+}
+
+/* Same, but writes 0xFF and recomputes the checksum, as a crafted file would */
+static int forge_and_load(uint32_t flags, long offset) {
+    int count = load_microprogram(&text_cm, MICROCODE);
+    save_control_store(&text_cm, count, flags, BINARY);
+
+    FILE* fp = fopen(BINARY, "rb");
+    unsigned char buffer[CS_MAX_FILE_SIZE];
+    size_t size = fread(buffer, 1, sizeof(buffer), fp);
+    fclose(fp);
+
+    buffer[offset < 0 ? (long)size + offset : offset] = 0xFF;
+    uint32_t sum = control_store_checksum(buffer + CS_HEADER_SIZE, size - CS_HEADER_SIZE);
+    for (int i = 0; i < 4; i++) {
+        buffer[12 + i] = (sum >> (8 * i)) & 0xFF;
+    }
+    fp = fopen(BINARY, "wb");
+    fwrite(buffer, 1, size, fp);
+    fclose(fp);
+
+    init_control_memory(&bin_cm);
+    return load_control_store(&bin_cm, BINARY);
+}
+
+void test_damaged(void) {
+    TEST_SECTION("Damaged files");
+
+    TEST_ASSERT(corrupt_and_load(CS_HEADER_SIZE + 10, 0) < 0, "Flipped word bit fails the checksum");
+    TEST_ASSERT(corrupt_and_load(-3, 0) < 0, "Flipped predecoded byte fails the checksum");
+    TEST_ASSERT(corrupt_and_load(4, 0) < 0, "Unknown version is rejected");
+    TEST_ASSERT(corrupt_and_load(0, 1) < 0, "Truncated file is rejected");
+    TEST_ASSERT(forge_and_load(CS_FLAG_PREDECODED, -(CS_OP_SIZE - 2)) < 0,
+                "Predecoded register field that disagrees with its word is rejected");
+    TEST_ASSERT(forge_and_load(CS_FLAG_PREDECODED | CS_FLAG_DISPATCH, -1) < 0,
+                "Dispatch entry outside the store is rejected");
+    TEST_ASSERT(bin_cm.size == CLASSIC_STORE_SIZE && bin_cm.dispatch[15] < bin_cm.size,
+                "Rejected file leaves the store untouched");
+}
+
+/*
+ * TEST 4: A CPU runs identically from either form
+ */
+void test_cpu_equivalence(void) {
+    TEST_SECTION("CPU equivalence");
+
+    static mic1_cpu from_text, from_binary;
+    int count = load_microprogram(&text_cm, MICROCODE);
+    save_control_store(&text_cm, count, CS_FLAG_PREDECODED, BINARY);
+
+    init_mic1(&from_text);
+    init_mic1(&from_binary);
+    TEST_ASSERT(load_microprogram_file(&from_text, MICROCODE) == 0 &&
+                load_microprogram_file(&from_binary, BINARY) == 0,
+                "load_microprogram_file accepts both forms");
+    TEST_ASSERT(from_binary.ctrl_mem.fault == &from_binary.fault,
+                "Fault register stays wired after a binary load");
+
+    /* LOCO 66; STOD 100; ADDD 100; JUMP 0 */
+    int program[] = { 0x7042, 0x1064, 0x2064, 0x6000 };
+    for (int i = 0; i < 4; i++) {
+        mem_store_word(&from_text.main_memory, i, program[i]);
+        mem_store_word(&from_binary.main_memory, i, program[i]);
+    }
+
+    int diverged = 0;
+    for (int i = 0; i < 3000 && !diverged; i++) {
+        run_mic1_cycle(&from_text);
+        run_mic1_cycle(&from_binary);
+        diverged = mic1_state_digest(&from_text) != mic1_state_digest(&from_binary);
+    }
+    TEST_ASSERT(!diverged, "3000 microcycles agree");
+
+    remove(BINARY);
+}
+
+/*
+ * TEST 5: Dispatch table
+ */
+
+/* MPC after a dispatch microinstruction with the given MBR value */
+static int dispatch_from(const control_memory* cm, int mbr_value) {
+    mmux m;
+    mpc p;
+    mir ir;
+    mbr mb;
+
+    init_mmux(&m);
+    init_mpc(&p);
+    init_mir(&ir);
+    m.cm = cm;
+    m.control_cond[0] = m.control_cond[1] = 1;
+    ir.dispatch = 1;
+    int_to_bits(mbr_value, mb.data, 16);
+    run_mmux(&m, &p, &ir, &mb);
+    return bits_to_int(p.address, MICROADDR_BITS);
+}
+
+void test_dispatch(void) {
+    TEST_SECTION("Dispatch table");
+
+    init_control_memory(&text_cm);
+    int layout = text_cm.dispatch_bits == 4;
+    for (int op = 0; op < 16; op++) {
+        if (text_cm.dispatch[op] != dispatch_target(op)) layout = 0;
+    }
+    TEST_ASSERT(layout, "Default table reproduces the built-in layout");
+    TEST_ASSERT(dispatch_from(&text_cm, 0x7) == dispatch_target(7) &&
+                dispatch_from(NULL, 0x7) == dispatch_target(7),
+                "run_mmux dispatches through the table, or the layout without one");
+
+    FILE* out = fopen(DISPATCH_TEXT, "w");
+    fprintf(out, "@dispatch_bits 8\n@dispatch 0x2A 0x30\n@dispatch 0xF4 0x41\n");
+    for (int i = 0; i < 2; i++) {
+        fprintf(out, "00000000000000000000000000000000\n");
+    }
+    fclose(out);
+
+    int count = load_microprogram(&text_cm, DISPATCH_TEXT);
+    TEST_ASSERT(count == 2 && text_cm.dispatch_bits == 8 && text_cm.dispatch[0x2A] == 0x30 &&
+                text_cm.dispatch[0xF4] == 0x41 && text_cm.dispatch[0x02] == 0,
+                "@dispatch lines replace the table");
+    TEST_ASSERT(dispatch_from(&text_cm, 0x12F4) == 0x41, "8-bit keys use MBR[7:0]");
+
+    save_control_store(&text_cm, count, CS_FLAGS, BINARY);
+    init_control_memory(&bin_cm);
+    TEST_ASSERT(load_control_store(&bin_cm, BINARY) == count && bin_cm.dispatch_bits == 8 &&
+                memcmp(bin_cm.dispatch, text_cm.dispatch, sizeof(bin_cm.dispatch)) == 0,
+                "Table round-trips through the binary format");
+
+    save_control_store(&text_cm, count, CS_FLAG_PREDECODED, BINARY);
+    init_control_memory(&bin_cm);
+    TEST_ASSERT(load_control_store(&bin_cm, BINARY) == count && bin_cm.dispatch_bits == 4 &&
+                bin_cm.dispatch[3] == dispatch_target(3),
+                "Files without a table get the default layout");
+
+    remove(DISPATCH_TEXT);
+    remove(BINARY);
+}
+
+/*
+ * TEST 6: Extended control store
+ */
+
+/* Text line: extension byte (if any), then the 32-bit word */
+static void write_word(FILE* out, int ext, uint32_t word) {
+    for (int bit = 7; ext && bit >= 0; bit--) fputc('0' + ((ext >> bit) & 1), out);
+    if (ext) fputc(' ', out);
+    for (int bit = 31; bit >= 0; bit--) fputc('0' + (int)((word >> bit) & 1), out);
+    fputc('\n', out);
+}
+
+/* MPC after one microcycle from `mpc` with MBR = `mbr_value` */
+static int step_from(mic1_cpu* cpu, int mpc, int mbr_value) {
+    int_to_bits(mpc, cpu->mpc.address, MICROADDR_BITS);
+    int_to_bits(mbr_value, cpu->mbr.data, 16);
+    run_mic1_cycle(cpu);
+    return bits_to_int(cpu->mpc.address, MICROADDR_BITS);
+}
+
+void test_extended(void) {
+    TEST_SECTION("Extended control store");
+
+    if (MICROPROGRAM_SIZE < 512) {
+        printf("  [SKIP] MICROADDR_BITS=%d is too narrow\n", MICROADDR_BITS);
+        return;
+    }
+
+    static mic1_cpu cpu;
+    uint32_t jump = (uint32_t)COND_ALWAYS << 1;
+
+    FILE* out = fopen(DISPATCH_TEXT, "w");
+    fprintf(out, "@size 512\n@dispatch 0x7 0x1FF\n");
+    write_word(out, MICRO_EXT_WIDE | 0x1, 0xFFu << 24 | jump);          /* goto 0x1FF */
+    write_word(out, MICRO_EXT_WIDE | MICRO_EXT_DISPATCH, 0);            /* goto dispatch */
+    write_word(out, MICRO_EXT_WIDE, 0xFFu << 24 | jump);                /* goto 0x0FF */
+    write_word(out, 0, 0xFFu << 24 | jump);                             /* classic dispatch */
+    fclose(out);
+
+    init_control_memory(&text_cm);
+    int count = load_microprogram(&text_cm, DISPATCH_TEXT);
+    TEST_ASSERT(count == 4 && text_cm.size == 512 && text_cm.dispatch[7] == 0x1FF &&
+                text_cm.ext[0] == (MICRO_EXT_WIDE | 0x1) && text_cm.ext[3] == 0,
+                "@size and 40-bit words load");
+    TEST_ASSERT(text_cm.ops[0].addr == 0x1FF && !(text_cm.ops[0].flags & MICRO_DISPATCH) &&
+                (text_cm.ops[1].flags & MICRO_DISPATCH) &&
+                text_cm.ops[2].addr == 0xFF && !(text_cm.ops[2].flags & MICRO_DISPATCH) &&
+                (text_cm.ops[3].flags & MICRO_DISPATCH),
+                "Extended words dispatch only through the DISPATCH bit");
+
+    init_mic1(&cpu);
+    load_microprogram_file(&cpu, DISPATCH_TEXT);
+    cpu.engine = MIC1_ENGINE_MICROCODE;
+    TEST_ASSERT(step_from(&cpu, 0, 0) == 0x1FF && step_from(&cpu, 1, 0x7007) == 0x1FF &&
+                step_from(&cpu, 2, 0x7007) == 0xFF && step_from(&cpu, 3, 0x7007) == 0x1FF,
+                "MPC follows wide targets and both dispatch encodings");
+    TEST_ASSERT(step_from(&cpu, 0x1FF, 0) == 0 && !cpu.fault.count,
+                "MPC wraps at the control-store size");
+
+    TEST_ASSERT(save_control_store(&text_cm, count, CS_FLAG_PREDECODED | CS_FLAG_DISPATCH, BINARY) == 0,
+                "Extended store saves");
+    init_control_memory(&bin_cm);
+    TEST_ASSERT(load_control_store(&bin_cm, BINARY) == count && same_store(&text_cm, &bin_cm) &&
+                bin_cm.dispatch[7] == 0x1FF,
+                "Size, extension bytes and wide dispatch entries round-trip");
+
+    out = fopen(DISPATCH_TEXT, "w");
+    fprintf(out, "@size 300\n");
+    write_word(out, 0, jump);
+    fclose(out);
+    init_control_memory(&text_cm);
+    TEST_ASSERT(load_microprogram(&text_cm, DISPATCH_TEXT) == 1 && text_cm.size == CLASSIC_STORE_SIZE,
+                "A size that is not a power of two is ignored");
+
+    remove(DISPATCH_TEXT);
+    remove(BINARY);
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  BINARY CONTROL STORE UNIT TESTS                           ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_predecode();
+    test_round_trip();
+    test_damaged();
+    test_cpu_equivalence();
+    test_dispatch();
+    test_extended();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
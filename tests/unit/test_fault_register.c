@@ -0,0 +1,174 @@
+/*
+ * test_fault_register.c - Unit tests for the CPU fault register
+ *
+ * Purpose: Verify that faults raised by the memory system, decoders and
+ *          engines are recorded in mic1_cpu.fault and that the configured
+ *          action (halt, trap, ignore) is applied without any I/O.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/mic1.h"
+#include "../../include/fault.h"
+#include "../../include/utils/conversions.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+static mic1_cpu cpu;
+
+/* Put the CPU at an out-of-range PC so the next step faults */
+static void setup_bad_pc(int action) {
+    init_mic1(&cpu);
+    cpu.fault.action = action;
+    cpu.fault.trap_vector = 0x010;
+    cpu.running = 1;
+    int_to_bits(0x1234, cpu.reg_bank.PC.data, 16);
+}
+
+/*
+ * TEST 1: raise_fault bookkeeping
+ */
+void test_raise_fault(void) {
+    TEST_SECTION("raise_fault bookkeeping");
+
+    fault_register f;
+    init_fault_register(&f);
+    TEST_ASSERT(f.kind == FAULT_NONE && f.count == 0, "Fresh register has no fault");
+
+    raise_fault(&f, FAULT_MEM_READ, 0x123);
+    raise_fault(&f, FAULT_DECODER, 7);
+    TEST_ASSERT(f.kind == FAULT_MEM_READ && f.address == 0x123,
+                "First fault of a cycle is kept");
+    TEST_ASSERT(f.count == 2 && f.pending == 1, "Every fault is counted");
+
+    raise_fault(NULL, FAULT_MEM_READ, 0);
+    TEST_ASSERT(1, "Unconnected units may raise into NULL");
+
+    int vector = -1;
+    TEST_ASSERT(parse_fault_action("trap:0x20", &vector) == FAULT_ACTION_TRAP && vector == 0x20,
+                "trap:0x20 parses with vector");
+    TEST_ASSERT(parse_fault_action("bogus", &vector) < 0, "Unknown action is rejected");
+}
+
+/*
+ * TEST 2: Components are wired to the CPU fault register
+ */
+void test_wiring(void) {
+    TEST_SECTION("Component wiring");
+
+    init_mic1(&cpu);
+    TEST_ASSERT(cpu.main_memory.fault == &cpu.fault, "Main memory reports to CPU");
+    TEST_ASSERT(cpu.decoder_a.fault == &cpu.fault &&
+                cpu.decoder_b.fault == &cpu.fault &&
+                cpu.decoder_c.fault == &cpu.fault, "Decoders report to CPU");
+    TEST_ASSERT(cpu.ctrl_mem.fault == &cpu.fault, "Control store reports to CPU");
+}
+
+/*
+ * TEST 3: Fault actions on the direct engine
+ */
+void test_actions(void) {
+    TEST_SECTION("Fault actions");
+
+    setup_bad_pc(FAULT_ACTION_HALT);
+    step_mic1(&cpu);
+    TEST_ASSERT(!cpu.running, "HALT stops the CPU");
+    TEST_ASSERT(cpu.fault.kind == FAULT_PC_BOUNDS && cpu.fault.address == 0x1234,
+                "Fault kind and address are recorded");
+    TEST_ASSERT(!cpu.fault.pending, "Fault is no longer pending once taken");
+
+    setup_bad_pc(FAULT_ACTION_TRAP);
+    step_mic1(&cpu);
+    TEST_ASSERT(cpu.running, "TRAP keeps the CPU running");
+    TEST_ASSERT(bits_to_int(cpu.reg_bank.PC.data, 16) == 0x010, "TRAP loads PC with the vector");
+    TEST_ASSERT(cpu.fault.pc == 0x1234, "TRAP saves the faulting PC");
+
+    setup_bad_pc(FAULT_ACTION_IGNORE);
+    cpu.fault.cycle = -1;
+    step_mic1(&cpu);
+    TEST_ASSERT(cpu.running && cpu.fault.count == 1, "IGNORE records and continues");
+    TEST_ASSERT(cpu.fault.cycle == 0, "Fault is stamped with the cycle it was taken");
+
+    reset_mic1(&cpu);
+    TEST_ASSERT(cpu.fault.count == 0 && cpu.fault.action == FAULT_ACTION_IGNORE,
+                "Reset clears the log but keeps the action");
+}
+
+/*
+ * TEST 4: MPC outside the control store
+ */
+void test_mpc_bounds(void) {
+    TEST_SECTION("MPC bounds");
+
+    /* Word 0: ac := ac + 1, as mic1mal encodes it */
+    init_mic1(&cpu);
+    TEST_ASSERT(load_microprogram_text(&cpu.ctrl_mem, "00000000000110000001100000000000\n") == 1,
+                "One-word store loads");
+    cpu.fault.action = FAULT_ACTION_IGNORE;
+    cpu.running = 1;
+    run_mic1_cycle(&cpu);
+    TEST_ASSERT(bits_to_int(cpu.reg_bank.AC.data, 16) == 1, "Word 0 increments AC");
+
+    int_to_bits(0x300, cpu.mpc.address, MICROADDR_BITS);
+    run_mic1_cycle(&cpu);
+    TEST_ASSERT(cpu.fault.kind == FAULT_MPC_BOUNDS && cpu.fault.address == 0x300,
+                "Out-of-range MPC raises MPC_BOUNDS");
+    TEST_ASSERT(bits_to_int(cpu.reg_bank.AC.data, 16) == 1 &&
+                bits_to_int(cpu.mpc.address, MICROADDR_BITS) == 0,
+                "IGNORE does not rerun the previous microinstruction and resumes at 0");
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  FAULT REGISTER UNIT TESTS                                 ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_raise_fault();
+    test_wiring();
+    test_actions();
+    test_mpc_bounds();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
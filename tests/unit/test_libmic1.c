@@ -0,0 +1,277 @@
+/*
+ * test_libmic1.c - Embedding interface
+ *
+ * Purpose: Verify that libmic1.h alone is enough to assemble a source
+ *          held in memory, load the image into a heap CPU and run it with
+ *          a cycle budget; that a control store passed as text runs as
+ *          the compiled engine does; that budgets, halts and faults are
+ *          told apart; and that several CPUs run side by side without
+ *          sharing state.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/libmic1.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+#define SIMS 16
+
+static const char* MICROCODE = "../../data/mic1_microcode.txt";
+
+/* sum := n + (n-1) + ... + 1, with n in the word at `n` (address 15) */
+static const char* SUM_SRC =
+    "        LODD n\n"
+    "loop:   STOD n\n"
+    "        LODD sum\n"
+    "        ADDD n\n"
+    "        STOD sum\n"
+    "        LODD n\n"
+    "        SUBD one\n"
+    "        JNZE loop\n"
+    "        LODD sum\n"
+    "done:   JUMP done\n"
+    "        .space 5\n"
+    "n:      .word 10\n"
+    "sum:    .word 0\n"
+    "one:    .word 1\n";
+
+#define SUM_N   15
+#define SUM_SUM 16
+
+static uint16_t image[MIC1_SIM_WORDS];
+static int image_size;
+
+static char* read_text(const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return NULL;
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char* text = malloc((size_t)size + 1);
+    if (text && fread(text, 1, (size_t)size, fp) != (size_t)size) {
+        free(text);
+        text = NULL;
+    }
+    if (text) text[size] = '\0';
+    fclose(fp);
+    return text;
+}
+
+/* A new CPU of `engine` with the sum program loaded */
+static mic1_sim* sum_sim(const char* engine, const char* microcode) {
+    mic1_sim* sim = mic1_sim_create(engine);
+    if (!sim) return NULL;
+    if ((microcode && mic1_sim_load_microcode(sim, microcode) != 0) ||
+        mic1_sim_load(sim, image, 0, image_size) != 0) {
+        mic1_sim_destroy(sim);
+        return NULL;
+    }
+    return sim;
+}
+
+/*
+ * TEST 1: Assemble from a string
+ */
+void test_assemble(void) {
+    TEST_SECTION("Assemble from a string");
+
+    char error[128] = "";
+    TEST_ASSERT(mic1_sim_assemble(SUM_SRC, image, MIC1_SIM_WORDS, &image_size,
+                                  error, sizeof(error)) == 0 && image_size == 18,
+                "Source in memory assembles into the caller's buffer");
+    TEST_ASSERT(image[SUM_N] == 10 && image[9] == 0x6009, "Data and halt words in place");
+
+    uint16_t small[4];
+    int size = 0;
+    TEST_ASSERT(mic1_sim_assemble("  LOCO 1\n  BOGUS 2\n", small, 4, &size, error,
+                                  sizeof(error)) != 0 && strncmp(error, "line 2: ", 8) == 0,
+                "Error comes back as 'line N: message'");
+    TEST_ASSERT(mic1_sim_assemble(SUM_SRC, small, 4, &size, NULL, 0) != 0,
+                "Capacity of the buffer honoured");
+}
+
+/*
+ * TEST 2: Run with a cycle budget
+ */
+void test_run(void) {
+    TEST_SECTION("Run with a cycle budget");
+
+    TEST_ASSERT(mic1_sim_create("warp") == NULL, "Unknown engine refused");
+
+    mic1_sim* sim = sum_sim(NULL, NULL);
+    TEST_ASSERT(sim != NULL, "Direct CPU created and loaded");
+    if (!sim) return;
+
+    TEST_ASSERT(mic1_sim_register(sim, MIC1_SIM_PC) == 0 &&
+                mic1_sim_register(sim, MIC1_SIM_SP) == 0x0FFF,
+                "Starts at PC 0 with SP 0x0FFF, as mic1_simulator does");
+    TEST_ASSERT(mic1_sim_run(sim, 5) == MIC1_SIM_BUDGET && mic1_sim_cycles(sim) == 5,
+                "Budget of 5 instructions stops after 5");
+    TEST_ASSERT(mic1_sim_run(sim, 100000) == MIC1_SIM_HALT &&
+                mic1_sim_register(sim, MIC1_SIM_AC) == 55 && mic1_sim_read(sim, SUM_SUM) == 55,
+                "Next run goes on to the halt: sum 1..10 = 55");
+    TEST_ASSERT(mic1_sim_register(sim, MIC1_SIM_PC) == 9, "Stopped at the JUMP to itself");
+    long cycles = mic1_sim_cycles(sim);
+    TEST_ASSERT(mic1_sim_run(sim, 100) == MIC1_SIM_HALT && mic1_sim_cycles(sim) == cycles,
+                "Running a halted program costs nothing");
+
+    /* Same program, other input: reset keeps memory */
+    TEST_ASSERT(mic1_sim_write(sim, SUM_N, 4) == 0 && mic1_sim_write(sim, SUM_SUM, 0) == 0 &&
+                mic1_sim_read(sim, SUM_N) == 4, "Words written and read back");
+    mic1_sim_reset(sim);
+    TEST_ASSERT(mic1_sim_cycles(sim) == 0 && mic1_sim_register(sim, MIC1_SIM_PC) == 0,
+                "Reset clears registers and the cycle count");
+    TEST_ASSERT(mic1_sim_run(sim, 100000) == MIC1_SIM_HALT &&
+                mic1_sim_register(sim, MIC1_SIM_AC) == 10, "Rerun with n = 4 gives 10");
+
+    TEST_ASSERT(mic1_sim_load(sim, image, MIC1_SIM_WORDS - 2, image_size) != 0 &&
+                mic1_sim_write(sim, MIC1_SIM_WORDS, 1) != 0 && mic1_sim_read(sim, -1) == -1,
+                "Out-of-memory addresses refused");
+    mic1_sim_destroy(sim);
+
+    /* Jump to the last word and run past the end of memory */
+    uint16_t jump = 0x6FFF, last = 0x7001;
+    sim = mic1_sim_create(NULL);
+    TEST_ASSERT(sim && mic1_sim_load(sim, &jump, 0, 1) == 0 &&
+                mic1_sim_load(sim, &last, MIC1_SIM_WORDS - 1, 1) == 0 &&
+                mic1_sim_run(sim, 100) == MIC1_SIM_FAULT, "Running off memory ends in a fault");
+    mic1_sim_destroy(sim);
+}
+
+/*
+ * TEST 3: Every engine, microcode from memory
+ */
+void test_engines(void) {
+    TEST_SECTION("Every engine, microcode from memory");
+
+    char* microcode = read_text(MICROCODE);
+    TEST_ASSERT(microcode != NULL, "Control store text read");
+    if (!microcode) return;
+
+    mic1_sim* direct = sum_sim("direct", NULL);
+    mic1_sim* micro = sum_sim("microcode", microcode);
+    mic1_sim* compiled = sum_sim("compiled", NULL);
+    TEST_ASSERT(direct && micro && compiled, "One CPU per engine");
+
+    if (direct && micro && compiled) {
+        int d = mic1_sim_run(direct, 100000);
+        int m = mic1_sim_run(micro, 1000000);
+        int c = mic1_sim_run(compiled, 1000000);
+        TEST_ASSERT(d == MIC1_SIM_HALT && m == MIC1_SIM_HALT && c == MIC1_SIM_HALT,
+                    "All three reach the halt");
+        TEST_ASSERT(mic1_sim_digest(micro) == mic1_sim_digest(direct) &&
+                    mic1_sim_digest(compiled) == mic1_sim_digest(direct) &&
+                    mic1_sim_register(micro, MIC1_SIM_AC) == mic1_sim_register(direct, MIC1_SIM_AC),
+                    "Control store from text and the compiled one end as the direct engine");
+        TEST_ASSERT(mic1_sim_cycles(micro) == mic1_sim_cycles(compiled) &&
+                    mic1_sim_cycles(micro) > mic1_sim_cycles(direct),
+                    "Microcode engines count microcycles, the same number");
+    }
+    mic1_sim_destroy(direct);
+    mic1_sim_destroy(micro);
+    mic1_sim_destroy(compiled);
+
+    mic1_sim* sim = mic1_sim_create("microcode");
+    TEST_ASSERT(sim && mic1_sim_load_microcode(sim, "; nothing here\n") != 0,
+                "Text without microinstructions refused");
+    mic1_sim_destroy(sim);
+    free(microcode);
+}
+
+/*
+ * TEST 4: CPUs side by side
+ */
+void test_many(void) {
+    TEST_SECTION("CPUs side by side");
+
+    mic1_sim* sims[SIMS];
+    int created = 0;
+    for (int i = 0; i < SIMS; i++) {
+        sims[i] = sum_sim(NULL, NULL);
+        if (sims[i]) {
+            created++;
+            mic1_sim_write(sims[i], SUM_N, i + 1);
+        }
+    }
+    TEST_ASSERT(created == SIMS, "16 CPUs on the heap at once");
+    if (created != SIMS) return;
+
+    /* Interleaved in small slices, as a scheduler would */
+    int halted = 0;
+    for (int round = 0; round < 10000 && halted < SIMS; round++) {
+        halted = 0;
+        for (int i = 0; i < SIMS; i++) {
+            halted += mic1_sim_run(sims[i], 7) == MIC1_SIM_HALT;
+        }
+    }
+
+    int right = 0;
+    for (int i = 0; i < SIMS; i++) {
+        int n = i + 1;
+        right += mic1_sim_register(sims[i], MIC1_SIM_AC) == n * (n + 1) / 2;
+    }
+    TEST_ASSERT(halted == SIMS && right == SIMS, "Each CPU sums its own n");
+    TEST_ASSERT(mic1_sim_digest(sims[0]) != mic1_sim_digest(sims[1]), "States differ per CPU");
+
+    for (int i = 0; i < SIMS; i++) {
+        mic1_sim_destroy(sims[i]);
+    }
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  LIBMIC1 UNIT TESTS                                        ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_assemble();
+    test_run();
+    test_engines();
+    test_many();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
@@ -0,0 +1,256 @@
+/*
+ * test_microanalysis.c - Static microcode analyzer
+ *
+ * Purpose: Verify path enumeration and cycle costs on small MAL
+ *          programs, the dead-code, no-write and fall-through findings,
+ *          and that the static cost of every instruction brackets the
+ *          microcycles the microcode engine actually spends on it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/mic1.h"
+#include "../../include/microasm.h"
+#include "../../include/microanalysis.h"
+#include "../../include/utils/conversions.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+static const char* MICROCODE = "../../data/basic_microcode.txt";
+static const char* MAL_SOURCE = "../../data/mic1.mal";
+static const char* MAL_STORE = "test_microanalysis.txt";
+
+static mal_program prog;
+static control_memory cm;
+static mca_report report;
+
+/* Assembles `source` straight into cm and analyzes it */
+static int analyze_mal(const char* source) {
+    if (mal_assemble(source, &prog) < 0) return -1;
+
+    init_control_memory(&cm);
+    for (int i = 0; i < MICROPROGRAM_SIZE; i++) {
+        cm.words[i] = prog.words[i];
+        decode_micro_op(prog.words[i], &cm.ops[i]);
+    }
+    cm.dispatch_bits = prog.dispatch_bits;
+    for (int key = 0; key < (1 << prog.dispatch_bits); key++) {
+        cm.dispatch[key] = (uint8_t)(prog.dispatch[key] < 0 ? 0 : prog.dispatch[key]);
+    }
+    return mca_analyze(&cm, &report);
+}
+
+/*
+ * TEST 1: Paths and costs
+ */
+void test_paths(void) {
+    TEST_SECTION("Paths and cycle costs");
+
+    const char* source =
+        "fetch: mar := pc; rd; pc := pc + 1\n"
+        "       ir := mbr\n"
+        "       mbr := ir; goto dispatch\n"
+        "one:   ac := ac + 1; goto fetch\n"
+        "two:   alu := ac; if n goto neg\n"
+        "       alu := ac; if z goto fetch\n"
+        "       ac := 0; goto fetch\n"
+        "neg:   ac := inv(ac)\n"
+        "       ac := ac + 1; goto fetch\n"
+        "spin:  alu := ac; if z goto spin\n"
+        "       goto fetch\n"
+        "hang:  goto hang\n"
+        ".dispatch 0 one\n"
+        ".dispatch 1 two\n"
+        ".dispatch 2 spin\n"
+        ".dispatch 3 fetch\n"
+        ".dispatch 4 hang\n";
+
+    TEST_ASSERT(analyze_mal(source) == 0, "Sample control store analyzes");
+    TEST_ASSERT(report.fetch.min_cycles == 3 && report.fetch.max_cycles == 3 &&
+                report.fetch.path_count == 1 && report.fetch.paths[0].end == MCA_END_DISPATCH,
+                "Fetch runs straight to the dispatch");
+
+    const mca_routine* r = mca_routine_for(&report, 0x1000);
+    TEST_ASSERT(r->path_count == 3 && r->min_cycles == 2 && r->max_cycles == 3,
+                "Branching routine has three N/Z paths");
+    TEST_ASSERT(strcmp(r->paths[0].trace, "N") == 0 && r->paths[0].cycles == 3 &&
+                strcmp(r->paths[1].trace, "nZ") == 0 && r->paths[1].cycles == 2 &&
+                strcmp(r->paths[2].trace, "nz") == 0, "Paths record taken and not-taken branches");
+
+    TEST_ASSERT(mca_instruction_cycles(&report, 0x0123) == 4 &&
+                mca_instruction_min_cycles(&report, 0x1000) == 5 &&
+                mca_instruction_cycles(&report, 0x1FFF) == 6,
+                "Instruction cost adds fetch and routine");
+    TEST_ASSERT(mca_instruction_cycles(&report, 0x2000) == -1 &&
+                mca_routine_for(&report, 0x2000)->min_cycles == 2,
+                "A routine that can spin forever has no worst case; its best case exits");
+    TEST_ASSERT(mca_instruction_min_cycles(&report, 0x4000) == -1 &&
+                mca_instruction_cycles(&report, 0x4000) == -1,
+                "A routine that never finishes has no best case either");
+    TEST_ASSERT(mca_instruction_cycles(&report, 0x3000) == 3,
+                "Dispatch back to 0 costs the fetch alone");
+
+    char table[256];
+    FILE* fp = tmpfile();
+    mca_write_cost_table(&report, fp);
+    rewind(fp);
+    TEST_ASSERT(fgets(table, sizeof(table), fp) && strcmp(table, "fetch 3 3\n") == 0 &&
+                fgets(table, sizeof(table), fp) && strcmp(table, "key 0x00 0x03 4 4 1\n") == 0,
+                "Cost table lists fetch and each dispatch key");
+    fclose(fp);
+}
+
+/*
+ * TEST 2: Findings
+ */
+void test_findings(void) {
+    TEST_SECTION("Dead code, no-write and fall-through");
+
+    const char* source =
+        "fetch: mar := pc; rd; pc := pc + 1\n"
+        "       ir := mbr; goto dispatch\n"
+        "a:     goto b\n"                           /* 0x02 jump only */
+        "b:     ac := ac + 1\n"                     /* 0x03 falls into c */
+        "c:     ac := ac + 1\n"                     /* 0x04 falls into an empty word */
+        ".org 0x10\n"
+        "d:     rd\n"                               /* 0x10 */
+        "       alu := ac; if n goto fetch\n"       /* 0x11 N/Z test: no finding */
+        "       goto fetch\n"
+        ".org 0x30\n"
+        "dead:  ac := 0; goto fetch\n"              /* 0x30 unreachable */
+        ".org 0xFF\n"
+        "e:     ac := sp\n"                         /* 0xFF wraps to 0 */
+        ".dispatch 0 a\n"
+        ".dispatch 1 c\n"
+        ".dispatch 2 d\n"
+        ".dispatch 3 e\n";
+
+    TEST_ASSERT(analyze_mal(source) == 0, "Sample control store analyzes");
+    TEST_ASSERT(report.flags[0x30] & MCA_UNREACHABLE && report.unreachable_count == 1,
+                "Unreachable microinstruction is dead code");
+    TEST_ASSERT(!(report.flags[0x20] & MCA_UNREACHABLE), "Empty words are not dead code");
+    TEST_ASSERT((report.flags[0x02] & MCA_NO_WRITE) && (report.flags[0x12] & MCA_NO_WRITE) &&
+                !(report.flags[0x10] & MCA_NO_WRITE) && !(report.flags[0x11] & MCA_NO_WRITE) &&
+                report.no_write_count == 2, "Jump-only microinstructions write nothing");
+    TEST_ASSERT((report.flags[0x03] & MCA_FALL_ENTRY) && (report.flags[0x04] & MCA_FALL_EMPTY) &&
+                (report.flags[0xFF] & MCA_FALL_WRAP) && report.hazard_count == 3,
+                "Fall-through hazards are classified");
+}
+
+/*
+ * TEST 3: Static costs bracket the microcode engine
+ */
+
+/* Runs random instructions; returns how many fell outside [min, max] */
+static int check_costs(const char* microcode, int trials) {
+    static mic1_cpu cpu;
+    int outside = 0;
+
+    init_control_memory(&cm);
+    load_microprogram(&cm, microcode);
+    mca_analyze(&cm, &report);
+
+    srand(11);
+    for (int trial = 0; trial < trials; trial++) {
+        init_mic1(&cpu);
+        load_microprogram_file(&cpu, microcode);
+        cpu.engine = MIC1_ENGINE_MICROCODE;
+        for (int addr = 0; addr < MEMORY_SIZE; addr++) {
+            mem_store_word(&cpu.main_memory, addr, rand() & 0xFFFF);
+        }
+        int_to_bits(rand() & 0xFFFF, cpu.reg_bank.AC.data, 16);
+        int_to_bits(rand() & 0xFFF, cpu.reg_bank.SP.data, 16);
+
+        for (int step = 0; step < 100 && !cpu.fault.count; step++) {
+            int pc = bits_to_int(cpu.reg_bank.PC.data, 16);
+            if (pc >= MEMORY_SIZE) break;
+            int instruction = mem_load_word(&cpu.main_memory, pc);
+            int before = cpu.cycle_count;
+
+            step_mic1(&cpu);
+            if (cpu.fault.count) break;
+
+            int spent = cpu.cycle_count - before;
+            int max = mca_instruction_cycles(&report, instruction);
+            if (spent < mca_instruction_min_cycles(&report, instruction) ||
+                (max >= 0 && spent > max)) {
+                outside++;
+            }
+        }
+    }
+    return outside;
+}
+
+void test_dynamic_costs(void) {
+    TEST_SECTION("Static costs against the microcode engine");
+
+    TEST_ASSERT(check_costs(MICROCODE, 32) == 0,
+                "basic_microcode.txt: every instruction within its static bounds");
+
+    FILE* out = fopen(MAL_STORE, "w");
+    TEST_ASSERT(mal_assemble_file(MAL_SOURCE, &prog) == 0 &&
+                mal_write_control_store(&prog, NULL, MAL_SOURCE, out) == 0,
+                "data/mic1.mal assembles");
+    fclose(out);
+
+    TEST_ASSERT(check_costs(MAL_STORE, 32) == 0,
+                "mic1.mal: every instruction within its static bounds");
+    TEST_ASSERT(report.unreachable_count == 0 && report.hazard_count == 0,
+                "mic1.mal has no dead code and no fall-through hazards");
+
+    remove(MAL_STORE);
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  MICROCODE ANALYZER UNIT TESTS                             ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_paths();
+    test_findings();
+    test_dynamic_costs();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
@@ -0,0 +1,371 @@
+/*
+ * test_microasm.c - Symbolic micro-assembler (MAL)
+ *
+ * Purpose: Verify field encoding of MAL statements, error reporting,
+ *          the generated dispatch table, and that data/mic1.mal run on
+ *          the microcode engine matches the direct engine instruction by
+ *          instruction.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/mic1.h"
+#include "../../include/microasm.h"
+#include "../../include/utils/conversions.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+static const char* MAL_SOURCE = "../../data/mic1.mal";
+static const char* CONTROL_STORE = "test_microasm.txt";
+
+static mal_program prog;
+
+/* Field accessors (layout per control_unit.c) */
+#define F_ADDR(w)   (((w) >> 24) & 0xFF)
+#define F_A(w)      (((w) >> 20) & 0xF)
+#define F_B(w)      (((w) >> 16) & 0xF)
+#define F_C(w)      (((w) >> 12) & 0xF)
+#define F_ENC(w)    (((w) >> 11) & 1)
+#define F_WR(w)     (((w) >> 10) & 1)
+#define F_RD(w)     (((w) >> 9) & 1)
+#define F_MAR(w)    (((w) >> 8) & 1)
+#define F_MBR(w)    (((w) >> 7) & 1)
+#define F_SH(w)     (((w) >> 5) & 3)
+#define F_ALU(w)    (((w) >> 3) & 3)
+#define F_COND(w)   (((w) >> 1) & 3)
+#define F_AMUX(w)   ((w) & 1)
+
+/*
+ * TEST 1: Statement encoding
+ */
+void test_encoding(void) {
+    TEST_SECTION("Statement encoding");
+
+    const char* source =
+        "start: mar := pc; rd; pc := pc + 1\n"
+        "       ac := lshift(ac + mbr); if n goto start\n"
+        "       mar := sp; mbr := ac; wr\n"
+        "       tir := band(ir, amask); alu := band(ir, amask); if z then goto 0x10\n"
+        ".org 0x10\n"
+        "here:  sp := sp + (-1); goto dispatch\n"
+        ".dispatch 0x3 here\n";
+
+    TEST_ASSERT(mal_assemble(source, &prog) == 0, "Sample program assembles");
+
+    uint32_t w = prog.words[0];
+    TEST_ASSERT(F_MAR(w) && F_RD(w) && F_B(w) == 0 && F_A(w) == 8 && F_C(w) == 0 && F_ENC(w) &&
+                F_ALU(w) == 0, "mar := pc; pc := pc + 1 swaps the addends onto A=r1, B=pc");
+
+    w = prog.words[1];
+    TEST_ASSERT(F_AMUX(w) && F_B(w) == 1 && F_ALU(w) == 0 && F_SH(w) == 2 &&
+                F_COND(w) == COND_IF_N && F_ADDR(w) == 0,
+                "lshift(ac + mbr) puts mbr on the A-mux and branches on n");
+
+    w = prog.words[2];
+    TEST_ASSERT(F_MAR(w) && F_B(w) == 4 && F_MBR(w) && F_WR(w) && F_A(w) == 1 && F_ALU(w) == 2 &&
+                !F_ENC(w), "mar := sp; mbr := ac; wr");
+
+    w = prog.words[3];
+    TEST_ASSERT(F_ALU(w) == 1 && F_A(w) == 2 && F_B(w) == 5 && F_C(w) == 3 &&
+                F_COND(w) == COND_IF_Z && F_ADDR(w) == 0x10,
+                "Shared ALU operation, 'then' and numeric targets");
+
+    w = prog.words[0x10];
+    TEST_ASSERT(F_COND(w) == COND_ALWAYS && F_ADDR(w) == 0xFF && F_B(w) == 9,
+                "goto dispatch and the -1 constant");
+
+    TEST_ASSERT(prog.dispatch[3] == 0x10 && prog.dispatch[0] == -1 && prog.size == 0x11 &&
+                prog.dispatch_bits == 4, "Dispatch table and size");
+    TEST_ASSERT(prog.line[1] == 2 && prog.line[0x10] == 6 && prog.line[5] == 0,
+                "Addresses map to source lines");
+
+    TEST_ASSERT(mal_assemble("a: goto dispatch\nb: rd\n"
+                             ".dispatch 0x2 a\n.dispatch 0x2 0x5 b\n", &prog) == 0 &&
+                prog.dispatch_bits == 8 && prog.dispatch[0x20] == 0 && prog.dispatch[0x2F] == 0 &&
+                prog.dispatch[0x25] == 1 && prog.dispatch[0x30] == -1,
+                "Sub-opcode entries switch to 8-bit keys; opcode entries fill the rest");
+}
+
+/*
+ * TEST 2: Errors
+ */
+static int fails(const char* source) {
+    return mal_assemble(source, &prog) < 0 && prog.error_count > 0;
+}
+
+void test_errors(void) {
+    TEST_SECTION("Errors");
+
+    TEST_ASSERT(fails("goto nowhere\n"), "Undefined label");
+    TEST_ASSERT(fails("mar := ir; ac := ac + mbr\n"), "MAR and the ALU need different B operands");
+    TEST_ASSERT(fails("ac := pc; sp := pc\n"), "Two register destinations");
+    TEST_ASSERT(fails("ac := pc; mbr := sp\n"), "Two ALU operations");
+    TEST_ASSERT(fails("x: rd\nx: wr\n"), "Duplicate label");
+    TEST_ASSERT(fails("if n goto 0\n"), "Condition without an ALU operation");
+    TEST_ASSERT(fails("ac := mbr + mbr\n"), "mbr on both ALU inputs");
+    TEST_ASSERT(fails("jump 3\n"), "Unknown statement");
+    TEST_ASSERT(fails(".org 3\nrd\n.org 3\nwr\n"), "Overlapping .org");
+    TEST_ASSERT(fails(".dispatch 16 x\nx: rd\n"), "Dispatch opcode out of range");
+    TEST_ASSERT(fails(".dispatch 1 16 x\nx: rd\n"), "Dispatch sub-opcode out of range");
+    TEST_ASSERT(fails(".dispatch 1 2 x\n.dispatch 1 2 x\nx: rd\n"), "Duplicate sub-opcode entry");
+
+    fails("rd\n\nac := bogus\n");
+    TEST_ASSERT(strncmp(prog.error_msg, "line 3:", 7) == 0, "Error message carries the line number");
+}
+
+/*
+ * TEST 3: data/mic1.mal against the direct engine
+ */
+static mic1_cpu micro, direct;
+
+static int same_isa_state(void) {
+    return mem_digest(&micro.main_memory) == mem_digest(&direct.main_memory) &&
+           bits_to_int(micro.reg_bank.PC.data, 16) == bits_to_int(direct.reg_bank.PC.data, 16) &&
+           bits_to_int(micro.reg_bank.AC.data, 16) == bits_to_int(direct.reg_bank.AC.data, 16) &&
+           bits_to_int(micro.reg_bank.SP.data, 16) == bits_to_int(direct.reg_bank.SP.data, 16);
+}
+
+/* PCs the two engines are not expected to agree on */
+static int comparable(void) {
+    return bits_to_int(direct.reg_bank.PC.data, 16) < MEMORY_SIZE - 1;
+}
+
+static int random_lockstep(int trials, int steps);
+
+static void setup_pair(void) {
+    init_mic1(&micro);
+    init_mic1(&direct);
+    load_microprogram_file(&micro, CONTROL_STORE);
+    micro.engine = MIC1_ENGINE_MICROCODE;
+    direct.engine = MIC1_ENGINE_DIRECT;
+}
+
+/* Steps both CPUs; returns the number of instructions that agreed */
+static int lockstep(int steps) {
+    for (int i = 0; i < steps; i++) {
+        if (!comparable()) return steps;
+        step_mic1(&micro);
+        step_mic1(&direct);
+        if (!same_isa_state()) return i;
+    }
+    return steps;
+}
+
+void test_microprogram(void) {
+    TEST_SECTION("mic1.mal on the microcode engine");
+
+    TEST_ASSERT(mal_assemble_file(MAL_SOURCE, &prog) == 0, "data/mic1.mal assembles");
+
+    int complete = prog.dispatch_bits == 8;
+    for (int key = 0; key < DISPATCH_TABLE_SIZE; key++) {
+        if (prog.dispatch[key] < 0) complete = 0;
+        if (key < 0xF0 && prog.dispatch[key] != prog.dispatch[key & 0xF0]) complete = 0;
+    }
+    TEST_ASSERT(complete, "Every opcode/sub-opcode key is dispatched");
+    TEST_ASSERT(prog.dispatch[0xF4] != prog.dispatch[0xF6] &&
+                prog.dispatch[0xF1] == prog.dispatch[0xF3],
+                "0xF sub-opcodes have their own routines; odd ones share one");
+
+    FILE* out = fopen(CONTROL_STORE, "w");
+    mal_write_control_store(&prog, NULL, MAL_SOURCE, out);
+    fclose(out);
+
+    setup_pair();
+    TEST_ASSERT(micro.ctrl_mem.words[0] == prog.words[0] &&
+                micro.ctrl_mem.words[prog.size - 1] == prog.words[prog.size - 1],
+                "Generated control store loads with load_microprogram_file");
+    TEST_ASSERT(micro.ctrl_mem.dispatch_bits == 8 &&
+                micro.ctrl_mem.dispatch[0xFC] == prog.dispatch[0xFC] &&
+                micro.ctrl_mem.dispatch[0x70] == prog.dispatch[0x70],
+                "Dispatch table loads with the control store");
+
+    /* One of each instruction, then loop */
+    int program[] = {
+        0x7005,     /* LOCO 5       */
+        0x1100,     /* STOD 0x100   */
+        0x2100,     /* ADDD 0x100   */
+        0x3101,     /* SUBD 0x101   */
+        0xF400,     /* PUSH         */
+        0xF400,     /* PUSH         */
+        0x8001,     /* LODL 1       */
+        0x9002,     /* STOL 2       */
+        0xA000,     /* ADDL 0       */
+        0xB002,     /* SUBL 2       */
+        0xFA00,     /* SWAP         */
+        0xFA00,     /* SWAP         */
+        0xFC03,     /* INSP 3       */
+        0xFE05,     /* DESP 5       */
+        0xF600,     /* POP          */
+        0xF000,     /* PSHI         */
+        0xF200,     /* POPI         */
+        0xE014,     /* CALL 0x14    */
+        0x4016,     /* JPOS 0x16    */
+        0x6000,     /* JUMP 0       */
+        0x0000,
+        0x0000,
+        0xC000,     /* JNEG 0       */
+        0x5000,     /* JZER 0       */
+        0xD018,     /* JNZE 0x18    */
+        0xF800,     /* RETN         */
+    };
+    int count = (int)(sizeof(program) / sizeof(program[0]));
+
+    setup_pair();
+    for (int i = 0; i < count; i++) {
+        mem_store_word(&micro.main_memory, i, program[i]);
+        mem_store_word(&direct.main_memory, i, program[i]);
+    }
+    mem_store_word(&micro.main_memory, 0x101, 0x0003);
+    mem_store_word(&direct.main_memory, 0x101, 0x0003);
+    int_to_bits(0x800, micro.reg_bank.SP.data, 16);
+    int_to_bits(0x800, direct.reg_bank.SP.data, 16);
+
+    TEST_ASSERT(lockstep(500) == 500, "Every instruction matches the direct engine");
+    TEST_ASSERT(random_lockstep(64, 300), "64 random memory images x 300 instructions agree");
+
+    /* Odd 0xF sub-opcodes are NOPs on both engines */
+    int odd[] = { 0xF100, 0xF3FF, 0xF942, 0xFF01, 0x6000 };
+    setup_pair();
+    for (int i = 0; i < 5; i++) {
+        mem_store_word(&micro.main_memory, i, odd[i]);
+        mem_store_word(&direct.main_memory, i, odd[i]);
+    }
+    int_to_bits(0x1234, micro.reg_bank.AC.data, 16);
+    int_to_bits(0x1234, direct.reg_bank.AC.data, 16);
+    int_to_bits(0x800, micro.reg_bank.SP.data, 16);
+    int_to_bits(0x800, direct.reg_bank.SP.data, 16);
+    TEST_ASSERT(lockstep(4) == 4 && direct.fault.kind == FAULT_NONE &&
+                bits_to_int(direct.reg_bank.PC.data, 16) == 4 &&
+                bits_to_int(direct.reg_bank.AC.data, 16) == 0x1234 &&
+                bits_to_int(direct.reg_bank.SP.data, 16) == 0x800,
+                "Odd sub-opcodes run as a NOP on both engines");
+    TEST_ASSERT(lockstep(50) == 50, "Odd sub-opcodes stay in lockstep");
+
+    remove(CONTROL_STORE);
+}
+
+/*
+ * TEST 4: Extended control store
+ */
+void test_extended(void) {
+    TEST_SECTION("Extended control store");
+
+    TEST_ASSERT(mal_assemble(".size 384\n", &prog) < 0 &&
+                mal_assemble("goto 0\n.size 512\n", &prog) < 0 &&
+                mal_assemble(".org 0x100\ngoto 0\n", &prog) < 0,
+                "Bad .size and addresses past 0xFF in a classic program are rejected");
+
+    if (MICROPROGRAM_SIZE < 1024) {
+        printf("  [SKIP] MICROADDR_BITS=%d is too narrow\n", MICROADDR_BITS);
+        return;
+    }
+
+    /* mic1.mal with everything from jzer on moved to 0x300 */
+    static char text[16384], source[16384 + 64];
+    FILE* in = fopen(MAL_SOURCE, "r");
+    size_t n = in ? fread(text, 1, sizeof(text) - 1, in) : 0;
+    text[n] = '\0';
+    if (in) fclose(in);
+    const char* jzer = strstr(text, "\njzer:");
+    snprintf(source, sizeof(source), ".size 1024\n%.*s\n.org 0x300%s",
+             jzer ? (int)(jzer - text) : 0, text, jzer ? jzer : "");
+
+    TEST_ASSERT(mal_assemble(source, &prog) == 0 && prog.extended && prog.store_size == 1024 &&
+                prog.dispatch[0x50] == 0x300 && prog.size > 0x300,
+                "Relocated mic1.mal assembles past 0xFF");
+
+    int marker = 0, dispatches = 0;
+    for (int addr = 0; addr < prog.size; addr++) {
+        if (prog.ext[addr] & MICRO_EXT_DISPATCH) dispatches++;
+        if (F_ADDR(prog.words[addr]) == DISPATCH_ADDR && F_COND(prog.words[addr]) == COND_ALWAYS) marker++;
+    }
+    TEST_ASSERT(dispatches == 1 && marker == 0, "goto dispatch uses the DISPATCH bit, not ADDR 0xFF");
+
+    FILE* out = fopen(CONTROL_STORE, "w");
+    mal_write_control_store(&prog, NULL, MAL_SOURCE, out);
+    fclose(out);
+
+    setup_pair();
+    TEST_ASSERT(micro.ctrl_mem.size == 1024 && micro.ctrl_mem.dispatch[0x50] == 0x300 &&
+                micro.ctrl_mem.ops[0x300].addr == 0x302 && micro.ctrl_mem.ops[0x300].cond == COND_IF_Z,
+                "Extended control store loads with its size and wide addresses");
+    TEST_ASSERT(random_lockstep(64, 300), "Relocated microprogram matches the direct engine");
+
+    remove(CONTROL_STORE);
+}
+
+/* Random memory images; 1 when every instruction agreed */
+static int random_lockstep(int trials, int steps) {
+    srand(7);
+    for (int trial = 0; trial < trials; trial++) {
+        setup_pair();
+        for (int addr = 0; addr < MEMORY_SIZE; addr++) {
+            int v = rand() & 0xFFFF;
+            mem_store_word(&micro.main_memory, addr, v);
+            mem_store_word(&direct.main_memory, addr, v);
+        }
+        int ac = rand() & 0xFFFF, sp = rand() & 0xFFFF;
+        int_to_bits(ac, micro.reg_bank.AC.data, 16);
+        int_to_bits(ac, direct.reg_bank.AC.data, 16);
+        int_to_bits(sp, micro.reg_bank.SP.data, 16);
+        int_to_bits(sp, direct.reg_bank.SP.data, 16);
+
+        if (lockstep(steps) != steps) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  MICRO-ASSEMBLER (MAL) UNIT TESTS                          ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_encoding();
+    test_errors();
+    test_microprogram();
+    test_extended();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
@@ -0,0 +1,190 @@
+/*
+ * test_object_linker.c - Unit tests for relocatable objects and mic1ld
+ *
+ * Purpose: Verify that the assembler emits symbols and relocations,
+ *          that objects survive a write/read round trip, that the linker
+ *          resolves cross-object references, and that the loader places
+ *          and relocates an object at its load address.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/mic1.h"
+#include "../../include/assembler.h"
+#include "../../include/object.h"
+#include "../../include/utils/conversions.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+static const char* MAIN_SRC =
+    "start: LOCO 5\n"
+    "       CALL double\n"
+    "       STOD result\n"
+    "done:  JUMP done\n"
+    "result: LOCO 0\n";
+
+static const char* LIB_SRC =
+    ".global double\n"
+    "double: ADDD scratch\n"
+    "        RETN\n"
+    "scratch: LOCO 0\n";
+
+static const char* OBJ_PATH = "test_object_linker.o";
+
+static mic1_cpu cpu;
+
+/*
+ * TEST 1: Assembler output
+ */
+void test_assemble_object(void) {
+    TEST_SECTION("Assembler object output");
+
+    mic1_object obj;
+    TEST_ASSERT(assemble_object(MAIN_SRC, &obj) == 0, "Main module assembles");
+    TEST_ASSERT(object_size(&obj) == 5, "Code section holds 5 words");
+
+    int sym = object_find_symbol(&obj, "double");
+    TEST_ASSERT(sym >= 0 && (obj.symbols[sym].flags & OBJ_SYM_UNDEF),
+                "External reference becomes an undefined symbol");
+    TEST_ASSERT(obj.reloc_count == 3, "Every label reference gets a relocation");
+    TEST_ASSERT(obj.line_count == 5 && obj.lines[1].line == 2, "Line table maps words to source");
+    free_object(&obj);
+
+    TEST_ASSERT(assemble_object(LIB_SRC, &obj) == 0, "Library module assembles");
+    sym = object_find_symbol(&obj, "double");
+    TEST_ASSERT(sym >= 0 && obj.symbols[sym].flags == OBJ_SYM_GLOBAL &&
+                obj.symbols[sym].value == 0, ".global exports the label");
+    free_object(&obj);
+
+    TEST_ASSERT(assemble_object(".global missing\n", &obj) != 0,
+                ".global of an unknown label is rejected");
+}
+
+/*
+ * TEST 2: Linking two objects
+ */
+void test_link(void) {
+    TEST_SECTION("Linking");
+
+    mic1_object in[2], out;
+    char error[128];
+    assemble_object(MAIN_SRC, &in[0]);
+    assemble_object(LIB_SRC, &in[1]);
+
+    TEST_ASSERT(link_objects(&out, in, 2, error, sizeof(error)) == 0, "Objects link");
+    TEST_ASSERT(object_size(&out) == 8, "Library is placed after main");
+
+    uint16_t image[MEMORY_SIZE];
+    TEST_ASSERT(object_image(&out, 0, image, MEMORY_SIZE, error, sizeof(error)) == 8,
+                "Image at base 0");
+    TEST_ASSERT(image[1] == 0xE005, "CALL resolved to the library entry");
+    TEST_ASSERT(image[5] == 0x2007, "Library-local reference shifted by its offset");
+
+    TEST_ASSERT(object_image(&out, 0x100, image, MEMORY_SIZE, error, sizeof(error)) == 0x108,
+                "Image at base 0x100");
+    TEST_ASSERT(image[0x101] == 0xE105 && image[0x102] == 0x1104,
+                "Every reference follows the base address");
+    free_object(&out);
+
+    TEST_ASSERT(link_objects(&out, in, 1, error, sizeof(error)) != 0 &&
+                strstr(error, "double") != NULL, "Unresolved symbol is reported");
+
+    mic1_object dup[2];
+    assemble_object(LIB_SRC, &dup[0]);
+    assemble_object(LIB_SRC, &dup[1]);
+    TEST_ASSERT(link_objects(&out, dup, 2, error, sizeof(error)) != 0,
+                "Duplicate global is rejected");
+
+    free_object(&dup[0]);
+    free_object(&dup[1]);
+    free_object(&in[0]);
+    free_object(&in[1]);
+}
+
+/*
+ * TEST 3: File round trip and loader
+ */
+void test_load(void) {
+    TEST_SECTION("Object file and loader");
+
+    mic1_object in[2], out, back;
+    char error[128];
+    assemble_object(MAIN_SRC, &in[0]);
+    assemble_object(LIB_SRC, &in[1]);
+    link_objects(&out, in, 2, error, sizeof(error));
+    out.load_address = 0x200;
+
+    TEST_ASSERT(write_object_file(&out, OBJ_PATH) == 0, "Object is written");
+    TEST_ASSERT(is_object_file(OBJ_PATH), "Magic is recognised");
+    TEST_ASSERT(read_object_file(&back, OBJ_PATH) == 0 &&
+                back.symbol_count == out.symbol_count &&
+                back.reloc_count == out.reloc_count &&
+                back.sections[0].words[1] == out.sections[0].words[1],
+                "Object survives a round trip");
+
+    init_mic1(&cpu);
+    TEST_ASSERT(load_program_file(&cpu, OBJ_PATH) == 0, "Loader accepts the object");
+    TEST_ASSERT(bits_to_int(cpu.reg_bank.PC.data, 16) == 0x200, "PC starts at the load address");
+    TEST_ASSERT(bits_to_int(cpu.main_memory.data[0x201], 16) == 0xE205,
+                "Loaded code is relocated");
+
+    remove(OBJ_PATH);
+    free_object(&back);
+    free_object(&out);
+    free_object(&in[0]);
+    free_object(&in[1]);
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  OBJECT FORMAT AND LINKER UNIT TESTS                       ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_assemble_object();
+    test_link();
+    test_load();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
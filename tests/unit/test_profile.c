@@ -0,0 +1,215 @@
+/*
+ * test_profile.c - Per-microinstruction execution profiler
+ *
+ * Purpose: Verify that the profiler counts every microcycle once, splits
+ *          N/Z branches into taken and not taken, attributes cycles to
+ *          the macro instruction in flight, agrees between the microcode
+ *          and compiled engines, and maps addresses to source lines.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/mic1.h"
+#include "../../include/microasm.h"
+#include "../../include/profile.h"
+#include "../../include/utils/conversions.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+static const char* MICROCODE = "../../data/basic_microcode.txt";
+static const char* MAL_SOURCE = "../../data/mic1.mal";
+static const char* MAL_STORE = "test_profile.txt";
+
+static mic1_cpu cpu;
+static micro_profile profile;
+static mal_program prog;
+static char mal_text[16384];
+
+/* LOCO 3; loop: SUBD one; JPOS loop; STOD 0x100; JUMP self */
+static const int program[] = { 0x7003, 0x3010, 0x4001, 0x1100, 0x6004 };
+
+static void setup(const char* microcode, int engine) {
+    init_mic1(&cpu);
+    load_microprogram_file(&cpu, microcode);
+    cpu.engine = engine;
+    for (int i = 0; i < 5; i++) {
+        mem_store_word(&cpu.main_memory, i, program[i]);
+    }
+    mem_store_word(&cpu.main_memory, 0x10, 1);
+
+    init_profile(&profile);
+    cpu.profile = &profile;
+}
+
+/*
+ * TEST 1: Counting
+ */
+void test_counts(void) {
+    TEST_SECTION("Execution counts");
+
+    FILE* in = fopen(MAL_SOURCE, "r");
+    size_t n = in ? fread(mal_text, 1, sizeof(mal_text) - 1, in) : 0;
+    mal_text[n] = '\0';
+    if (in) fclose(in);
+
+    FILE* out = fopen(MAL_STORE, "w");
+    TEST_ASSERT(mal_assemble(mal_text, &prog) == 0 &&
+                mal_write_control_store(&prog, mal_text, MAL_SOURCE, out) == 0, "data/mic1.mal assembles");
+    fclose(out);
+
+    setup(MAL_STORE, MIC1_ENGINE_MICROCODE);
+    for (int i = 0; i < 9; i++) step_mic1(&cpu);
+
+    uint64_t sum = 0;
+    for (int addr = 0; addr < MICROPROGRAM_SIZE; addr++) sum += profile.exec[addr];
+
+    TEST_ASSERT(profile.cycles == (uint64_t)cpu.cycle_count && sum == profile.cycles,
+                "Every microcycle is counted once");
+    TEST_ASSERT(profile.instructions == 9 && profile.exec[0] == 9,
+                "Each instruction starts at MPC 0");
+    TEST_ASSERT(profile.class_instructions[0x7] == 1 && profile.class_instructions[0x3] == 3 &&
+                profile.class_instructions[0x4] == 3 && profile.class_instructions[0x1] == 1 &&
+                profile.class_instructions[0x6] == 1, "Instructions are attributed to their opcode");
+
+    uint64_t class_sum = 0;
+    for (int cls = 0; cls < PROFILE_CLASSES; cls++) class_sum += profile.class_cycles[cls];
+    TEST_ASSERT(class_sum == profile.cycles &&
+                profile.by_class[0x7][prog.dispatch[0x70]] == 1 &&
+                profile.by_class[0x3][0] == 3, "Microcycles are attributed to the instruction in flight");
+
+    TEST_ASSERT(profile_class(0xF400) == 16 + 4 && strcmp(profile_class_name(16 + 4), "PUSH") == 0 &&
+                profile_class(0x2123) == 2, "0xF instructions are split by sub-opcode");
+
+    cpu.profile = NULL;
+    step_mic1(&cpu);
+    TEST_ASSERT(profile.instructions == 9, "Detached profile stops counting");
+}
+
+/*
+ * TEST 2: Branches
+ */
+void test_branches(void) {
+    TEST_SECTION("Branch outcomes");
+
+    setup(MAL_STORE, MIC1_ENGINE_MICROCODE);
+    for (int i = 0; i < 8; i++) step_mic1(&cpu);
+
+    /* jpos: "alu := ac; if n goto fetch" then "alu := ac; if z goto fetch" */
+    int jpos = prog.dispatch[0x40];
+    TEST_ASSERT(profile.exec[jpos] == 3 && profile.taken[jpos] == 0 && profile.not_taken[jpos] == 3,
+                "AC >= 0 on every JPOS: the N branch is never taken");
+    TEST_ASSERT(profile.taken[jpos + 1] == 1 && profile.not_taken[jpos + 1] == 2,
+                "The Z branch is taken once, when AC reaches 0");
+    TEST_ASSERT(profile.taken[0] == 0 && profile.not_taken[0] == 0,
+                "Unconditional microinstructions have no outcome");
+}
+
+/*
+ * TEST 3: Engines agree
+ */
+void test_engines(void) {
+    TEST_SECTION("Microcode and compiled engines");
+
+    static micro_profile microcoded;
+
+    /* The compiled engine is built from data/mic1.mal too */
+    setup(MAL_STORE, MIC1_ENGINE_MICROCODE);
+    for (int i = 0; i < 9; i++) step_mic1(&cpu);
+    microcoded = profile;
+
+    setup(MAL_STORE, MIC1_ENGINE_COMPILED);
+    for (int i = 0; i < 9; i++) step_mic1(&cpu);
+
+    TEST_ASSERT(memcmp(&microcoded, &profile, sizeof(profile)) == 0,
+                "Compiled engine produces the same profile");
+}
+
+/*
+ * TEST 4: Source lines and report
+ */
+void test_source(void) {
+    TEST_SECTION("Source lines and report");
+
+    static profile_source source;
+
+    TEST_ASSERT(load_profile_source(&source, MAL_STORE) == prog.size &&
+                source.mal_line[0] == prog.line[0] &&
+                strncmp(source.text[0], "fetch:", 6) == 0,
+                "mic1mal comments map addresses to MAL lines");
+    TEST_ASSERT(load_profile_source(&source, MICROCODE) == CLASSIC_STORE_SIZE &&
+                source.line[0] > 0 && source.line[1] > source.line[0] && source.mal_line[0] == 0,
+                "Plain control stores map to their own lines");
+
+    setup(MAL_STORE, MIC1_ENGINE_MICROCODE);
+    for (int i = 0; i < 8; i++) step_mic1(&cpu);
+    load_profile_source(&source, MAL_STORE);
+
+    char report[8192];
+    FILE* fp = tmpfile();
+    write_profile_report(&profile, &source, fp);
+    rewind(fp);
+    size_t n = fread(report, 1, sizeof(report) - 1, fp);
+    report[n] = '\0';
+    fclose(fp);
+
+    TEST_ASSERT(strstr(report, "8 instructions") && strstr(report, "fetch:  mar := pc") &&
+                strstr(report, "SUBD") && strstr(report, "JPOS"),
+                "Report shows source lines and instruction classes");
+
+    remove(MAL_STORE);
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  MICROCODE PROFILER UNIT TESTS                             ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_counts();
+    test_branches();
+    test_engines();
+    test_source();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
@@ -0,0 +1,166 @@
+/*
+ * test_stack_ops.c - Unit tests for the 0xF (stack) group in the direct engine
+ *
+ * Purpose: Verify PSHI, POPI, PUSH, POP, RETN, SWAP, INSP and DESP
+ *          against the MAC-1 definitions, that odd sub-opcodes fault,
+ *          and that tests/05_stack_ops.asm leaves the documented memory
+ *          state behind.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/mic1.h"
+#include "../../include/assembler.h"
+#include "../../include/utils/conversions.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+#define REG(r)  bits_to_int(cpu.reg_bank.r.data, 16)
+#define MEM(a)  bits_to_int(cpu.main_memory.data[a], 16)
+
+static mic1_cpu cpu;
+
+/* Fresh CPU with AC, SP preset and one instruction at address 0 */
+static void setup(int instr, int ac, int sp) {
+    init_mic1(&cpu);
+    cpu.running = 1;
+    mem_store_word(&cpu.main_memory, 0, instr);
+    int_to_bits(ac, cpu.reg_bank.AC.data, 16);
+    int_to_bits(sp, cpu.reg_bank.SP.data, 16);
+}
+
+/*
+ * TEST 1: Individual sub-opcodes
+ */
+void test_sub_opcodes(void) {
+    TEST_SECTION("Sub-opcodes");
+
+    setup(0xF400, 0x1234, 0x100);    /* PUSH */
+    step_mic1(&cpu);
+    TEST_ASSERT(REG(SP) == 0x0FF && MEM(0x0FF) == 0x1234, "PUSH: SP-1, M[SP] <- AC");
+
+    setup(0xF600, 0, 0x100);         /* POP */
+    mem_store_word(&cpu.main_memory, 0x100, 0x4321);
+    step_mic1(&cpu);
+    TEST_ASSERT(REG(SP) == 0x101 && REG(AC) == 0x4321, "POP: AC <- M[SP], SP+1");
+
+    setup(0xF000, 0x050, 0x100);     /* PSHI */
+    mem_store_word(&cpu.main_memory, 0x050, 0x0BAD);
+    step_mic1(&cpu);
+    TEST_ASSERT(REG(SP) == 0x0FF && MEM(0x0FF) == 0x0BAD, "PSHI: SP-1, M[SP] <- M[AC]");
+
+    setup(0xF200, 0x050, 0x100);     /* POPI */
+    mem_store_word(&cpu.main_memory, 0x100, 0x0ABC);
+    step_mic1(&cpu);
+    TEST_ASSERT(REG(SP) == 0x101 && MEM(0x050) == 0x0ABC, "POPI: M[AC] <- M[SP], SP+1");
+
+    setup(0xF800, 0, 0x200);         /* RETN */
+    mem_store_word(&cpu.main_memory, 0x200, 0x0123);
+    step_mic1(&cpu);
+    TEST_ASSERT(REG(PC) == 0x123 && REG(SP) == 0x201, "RETN: PC <- M[SP], SP+1");
+
+    setup(0xFA00, 0x0777, 0x0FFF);   /* SWAP */
+    step_mic1(&cpu);
+    TEST_ASSERT(REG(AC) == 0x0FFF && REG(SP) == 0x0777, "SWAP exchanges AC and SP");
+
+    setup(0xFC10, 0, 0x100);         /* INSP 16 */
+    step_mic1(&cpu);
+    TEST_ASSERT(REG(SP) == 0x110, "INSP adds the 8-bit operand");
+
+    setup(0xFE10, 0, 0x100);         /* DESP 16 */
+    step_mic1(&cpu);
+    TEST_ASSERT(REG(SP) == 0x0F0 && REG(PC) == 1, "DESP subtracts the 8-bit operand");
+
+    setup(0xF100, 0x55, 0x100);      /* odd sub-opcode */
+    step_mic1(&cpu);
+    TEST_ASSERT(cpu.fault.kind == FAULT_NONE && REG(PC) == 1,
+                "Odd sub-opcode runs as a NOP, as in data/mic1.mal");
+    TEST_ASSERT(REG(SP) == 0x100 && REG(AC) == 0x55, "Odd sub-opcode has no effect");
+}
+
+/*
+ * TEST 2: tests/05_stack_ops.asm end to end
+ */
+void test_stack_program(void) {
+    TEST_SECTION("05_stack_ops.asm");
+
+    FILE* fp = fopen("../05_stack_ops.asm", "r");
+    static char source[16384];
+    size_t n = fp ? fread(source, 1, sizeof(source) - 1, fp) : 0;
+    if (fp) fclose(fp);
+    source[n] = '\0';
+
+    static uint16_t image[MAX_INSTRUCTIONS];
+    int size = 0;
+    TEST_ASSERT(n > 0 && assemble_string(source, image, &size) == 0, "Program assembles");
+
+    init_mic1(&cpu);
+    int_to_bits(0x0FFF, cpu.reg_bank.SP.data, 16);
+    for (int i = 0; i < size; i++) {
+        mem_store_word(&cpu.main_memory, i, image[i]);
+    }
+    cpu.running = 1;
+    for (int i = 0; i < 200 && cpu.running; i++) {
+        step_mic1(&cpu);
+    }
+
+    TEST_ASSERT(MEM(500) == 819 && MEM(501) == 546 && MEM(502) == 273, "LIFO order");
+    TEST_ASSERT(MEM(512) == 0, "Popped value matches");
+    TEST_ASSERT(MEM(521) == 3050 && MEM(522) == 3051, "CALL/RETN round trip");
+    TEST_ASSERT(MEM(525) == 2457 && MEM(599) == 1549, "Program reached the success marker");
+    TEST_ASSERT(REG(SP) == 0x0FFF, "Stack is balanced at the end");
+    TEST_ASSERT(cpu.fault.count == 0, "No faults");
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  STACK OPERATION UNIT TESTS                                ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_sub_opcodes();
+    test_stack_program();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
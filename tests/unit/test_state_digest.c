@@ -0,0 +1,221 @@
+/*
+ * test_state_digest.c - Unit tests for the incremental state digest
+ *
+ * Purpose: Verify that the per-page memory digests and their root are
+ *          kept current by every write path, that they always agree with
+ *          a full recomputation, that the CPU state digest tells
+ *          equal and different states apart, and that the direct and
+ *          microcode engines in the same state digest alike.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/mic1.h"
+#include "../../include/cache.h"
+#include "../../include/microasm.h"
+#include "../../include/utils/conversions.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+static memory mem;
+static mic1_cpu cpu_a, cpu_b;
+static mal_program prog;
+
+static const char* MAL_SOURCE = "../../data/mic1.mal";
+static const char* CONTROL_STORE = "test_state_digest.txt";
+
+/* Digest and page digests as a full walk would compute them */
+static int matches_rehash(memory* m) {
+    uint64_t digest = m->digest;
+    uint64_t pages[DIGEST_PAGES];
+    memcpy(pages, m->page_digest, sizeof(pages));
+
+    mem_rehash(m);
+    return digest == m->digest && memcmp(pages, m->page_digest, sizeof(pages)) == 0;
+}
+
+/* Write through MAR/MBR, the path the microcode engine takes */
+static void bus_write(memory* m, cache* c, int addr, int value) {
+    mar a;
+    mbr b;
+    init_mar(&a);
+    init_mbr(&b);
+    int_to_address(addr, a.address);
+    int_to_bits(value, b.data, 16);
+    m_write(&a, &b, m, c);
+}
+
+/*
+ * TEST 1: Memory digest bookkeeping
+ */
+void test_memory_digest(void) {
+    TEST_SECTION("Memory digest");
+
+    init_memory(&mem);
+    TEST_ASSERT(mem_digest(&mem) == 0, "Zeroed memory digests to 0");
+
+    mem_store_word(&mem, 0x123, 0xBEEF);
+    uint64_t one = mem_digest(&mem);
+    TEST_ASSERT(one != 0, "A store changes the digest");
+    TEST_ASSERT(mem_page_digest(&mem, 0x123 / DIGEST_PAGE_WORDS) == one &&
+                mem_page_digest(&mem, 0) == 0, "Only the written page changes");
+
+    mem_store_word(&mem, 0x123, 0);
+    TEST_ASSERT(mem_digest(&mem) == 0, "Restoring the old value restores the digest");
+
+    mem_store_word(&mem, 0x124, 0xBEEF);
+    TEST_ASSERT(mem_digest(&mem) != one, "Same value at another address differs");
+
+    srand(1234);
+    for (int i = 0; i < 2000; i++) {
+        mem_store_word(&mem, rand() % MEMORY_SIZE, rand() & 0xFFFF);
+    }
+    TEST_ASSERT(matches_rehash(&mem), "Direct-engine stores agree with a full rehash");
+
+    cache c;
+    init_cache(&c);
+    for (int i = 0; i < 2000; i++) {
+        bus_write(&mem, (i & 1) ? &c : NULL, rand() % MEMORY_SIZE, rand() & 0xFFFF);
+    }
+    TEST_ASSERT(matches_rehash(&mem), "MAR/MBR writes (with and without cache) agree");
+}
+
+/*
+ * TEST 2: CPU state digest
+ */
+void test_state_digest(void) {
+    TEST_SECTION("CPU state digest");
+
+    init_mic1(&cpu_a);
+    init_mic1(&cpu_b);
+    TEST_ASSERT(mic1_state_digest(&cpu_a) == mic1_state_digest(&cpu_b),
+                "Fresh CPUs digest equal");
+
+    /* LOCO 7; STOD 0x40; JUMP 2 */
+    int program[] = { 0x7007, 0x1040, 0x6002 };
+    for (int i = 0; i < 3; i++) {
+        mem_store_word(&cpu_a.main_memory, i, program[i]);
+        mem_store_word(&cpu_b.main_memory, i, program[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        step_mic1(&cpu_a);
+        step_mic1(&cpu_b);
+    }
+    TEST_ASSERT(mem_load_word(&cpu_a.main_memory, 0x40) == 7, "Program ran");
+    TEST_ASSERT(mic1_state_digest(&cpu_a) == mic1_state_digest(&cpu_b),
+                "Same program, same steps, same digest");
+    TEST_ASSERT(matches_rehash(&cpu_a.main_memory), "Running digest stayed exact");
+
+    int_to_bits(8, cpu_b.reg_bank.AC.data, 16);
+    TEST_ASSERT(mic1_state_digest(&cpu_a) != mic1_state_digest(&cpu_b),
+                "A register difference changes the state digest");
+    TEST_ASSERT(mem_digest(&cpu_a.main_memory) == mem_digest(&cpu_b.main_memory),
+                "Memory digest ignores registers");
+
+    /* Loaders rehash only the pages they wrote */
+    static uint16_t image[MEMORY_SIZE];
+    for (int i = 0; i < MEMORY_SIZE; i++) image[i] = (uint16_t)(rand() & 0xFFFF);
+    uint16_t patched[] = { 0x003, 0x7C0, 0x7FF, 0x800, 0xFFF };
+    patch_program(&cpu_a, image, patched, 5);
+    TEST_ASSERT(matches_rehash(&cpu_a.main_memory), "patch_program keeps the digest exact");
+    load_program_image(&cpu_a, image + 0x3F0, 0x3F0, 40);
+    TEST_ASSERT(matches_rehash(&cpu_a.main_memory), "load_program_image across a page boundary");
+    int_to_bits(0x1234, cpu_a.main_memory.data[0x500], 16);
+    mem_rehash_page(&cpu_a.main_memory, 0x500 / DIGEST_PAGE_WORDS);
+    TEST_ASSERT(matches_rehash(&cpu_a.main_memory), "mem_rehash_page fixes up one page");
+}
+
+/*
+ * TEST 3: Engines agree
+ */
+void test_engines(void) {
+    TEST_SECTION("Direct and microcode engines");
+
+    FILE* out = fopen(CONTROL_STORE, "w");
+    int written = out && mal_assemble_file(MAL_SOURCE, &prog) == 0 &&
+                  mal_write_control_store(&prog, NULL, MAL_SOURCE, out) == 0;
+    if (out) fclose(out);
+    TEST_ASSERT(written, "data/mic1.mal assembled to a control store");
+
+    init_mic1(&cpu_a);
+    init_mic1(&cpu_b);
+    cpu_a.engine = MIC1_ENGINE_DIRECT;
+    cpu_b.engine = MIC1_ENGINE_MICROCODE;
+    TEST_ASSERT(load_microprogram_file(&cpu_b, CONTROL_STORE) == 0, "Control store loaded");
+    remove(CONTROL_STORE);
+
+    /* LOCO 7; STOD 0x40; PUSH; ADDD 0x40; CALL 7; JUMP 6; JUMP 6; INSP 1; DESP 1; RETN */
+    int program[] = { 0x7007, 0x1040, 0xF400, 0x2040, 0xE007, 0x6006, 0x6006,
+                      0xFC01, 0xFE01, 0xF800 };
+    for (int i = 0; i < 10; i++) {
+        mem_store_word(&cpu_a.main_memory, i, program[i]);
+        mem_store_word(&cpu_b.main_memory, i, program[i]);
+    }
+    int_to_bits(0x800, cpu_a.reg_bank.SP.data, 16);
+    int_to_bits(0x800, cpu_b.reg_bank.SP.data, 16);
+
+    int agreed = 0;
+    for (int i = 0; i < 9; i++) {
+        step_mic1(&cpu_a);
+        step_mic1(&cpu_b);
+        agreed += mic1_state_digest(&cpu_a) == mic1_state_digest(&cpu_b);
+    }
+    TEST_ASSERT(bits_to_int(cpu_a.reg_bank.PC.data, 16) == 6 &&
+                bits_to_int(cpu_b.reg_bank.PC.data, 16) == 6 &&
+                mem_load_word(&cpu_b.main_memory, 0x40) == 7, "Both ran the program to the halt");
+    TEST_ASSERT(agreed == 9, "Same state digest after every instruction");
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  STATE DIGEST UNIT TESTS                                   ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_memory_digest();
+    test_state_digest();
+    test_engines();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}
@@ -0,0 +1,153 @@
+/*
+ * test_watchpoints.c - Unit tests for memory watchpoints
+ *
+ * Purpose: Verify the per-word watch bitmap used by m_read/m_write and the
+ *          direct engine: range arming, read/write/change detection and
+ *          stopping the CPU with MIC1_STOP_WATCH.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/mic1.h"
+#include "../../include/watch.h"
+#include "../../include/utils/conversions.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        tests_run++; \
+        if (condition) { \
+            tests_passed++; \
+            printf("  [PASS] %s\n", message); \
+        } else { \
+            tests_failed++; \
+            printf("  [FAIL] %s\n", message); \
+        } \
+    } while (0)
+
+#define TEST_SECTION(name) \
+    printf("\n=== TEST SECTION: %s ===\n", name)
+
+static mic1_cpu cpu;
+
+/* LOCO value; STOD addr; JUMP self */
+static void load_store_program(int value, int addr) {
+    init_mic1(&cpu);
+    cpu.running = 1;
+    int_to_bits(0x7000 | value, cpu.main_memory.data[0], 16);
+    int_to_bits(0x1000 | addr, cpu.main_memory.data[1], 16);
+    int_to_bits(0x6002, cpu.main_memory.data[2], 16);
+}
+
+/*
+ * TEST 1: Arming and disarming
+ */
+void test_table(void) {
+    TEST_SECTION("Watch table");
+
+    watch_table w;
+    init_watch_table(&w);
+    TEST_ASSERT(w.active == 0, "Fresh table has nothing armed");
+
+    TEST_ASSERT(set_watchpoint(&w, 0x100, 0x10F, WATCH_WRITE) == 0, "Range is accepted");
+    set_watchpoint(&w, 0x108, 0x108, WATCH_READ);
+    TEST_ASSERT(w.active == 16, "Overlapping watch does not double count");
+    TEST_ASSERT(w.flags[0x108] == (WATCH_WRITE | WATCH_READ), "Flags accumulate per word");
+
+    clear_watchpoint(&w, 0x100, 0x107);
+    TEST_ASSERT(w.active == 8 && w.flags[0x100] == 0, "Clearing a range disarms it");
+    TEST_ASSERT(set_watchpoint(&w, 0x10, MEMORY_SIZE, WATCH_READ) != 0, "Out of range is rejected");
+
+    int start, end, kind;
+    TEST_ASSERT(parse_watch_spec("0x64-0x67:rc", &start, &end, &kind) == 0 &&
+                start == 0x64 && end == 0x67 && kind == (WATCH_READ | WATCH_CHANGE),
+                "Spec with range and kinds parses");
+    TEST_ASSERT(parse_watch_spec("100", &start, &end, &kind) == 0 &&
+                start == 100 && end == 100 && kind == WATCH_WRITE,
+                "Bare address defaults to write");
+    TEST_ASSERT(parse_watch_spec("0x64:x", &start, &end, &kind) != 0, "Unknown kind is rejected");
+}
+
+/*
+ * TEST 2: Direct engine stops on the watched store
+ */
+void test_direct_engine(void) {
+    TEST_SECTION("Direct engine");
+
+    load_store_program(0x42, 0x64);
+    set_watchpoint(&cpu.watch, 0x64, 0x64, WATCH_WRITE);
+    step_mic1(&cpu);
+    TEST_ASSERT(cpu.running, "LOCO does not touch the watched word");
+    step_mic1(&cpu);
+    TEST_ASSERT(!cpu.running && cpu.stop_reason == MIC1_STOP_WATCH, "STOD stops the CPU");
+    TEST_ASSERT(cpu.watch.hit.address == 0x64 && cpu.watch.hit.new_value == 0x42 &&
+                cpu.watch.hit.cycle == 1, "Hit records address, value and cycle");
+
+    load_store_program(0, 0x64);
+    set_watchpoint(&cpu.watch, 0x64, 0x64, WATCH_CHANGE);
+    step_mic1(&cpu);
+    step_mic1(&cpu);
+    TEST_ASSERT(cpu.running && cpu.watch.hit.count == 0, "Change watch ignores same-value store");
+}
+
+/*
+ * TEST 3: MAR/MBR path used by the microcode engine
+ */
+void test_mar_mbr_path(void) {
+    TEST_SECTION("m_read / m_write");
+
+    init_mic1(&cpu);
+    set_watchpoint(&cpu.watch, 0x200, 0x200, WATCH_READ | WATCH_CHANGE);
+    int_to_address(0x200, cpu.mar.address);
+
+    int_to_bits(0x1234, cpu.mbr.data, 16);
+    m_write(&cpu.mar, &cpu.mbr, &cpu.main_memory, &cpu.unified_cache);
+    TEST_ASSERT(cpu.watch.hit.pending && cpu.watch.hit.kind == WATCH_CHANGE &&
+                cpu.watch.hit.old_value == 0 && cpu.watch.hit.new_value == 0x1234,
+                "m_write fires the change watch");
+
+    cpu.watch.hit.pending = 0;
+    m_read(&cpu.mar, &cpu.mbr, &cpu.main_memory, &cpu.unified_cache);
+    TEST_ASSERT(cpu.watch.hit.pending && cpu.watch.hit.kind == WATCH_READ,
+                "m_read fires the read watch");
+}
+
+/*
+ * Main test runner
+ */
+int main(void) {
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  WATCHPOINT UNIT TESTS                                     ║\n");
+    printf("╚════════════════════════════════════════════════════════════╝\n");
+
+    test_table();
+    test_direct_engine();
+    test_mar_mbr_path();
+
+    /* Summary */
+    printf("\n");
+    printf("╔════════════════════════════════════════════════════════════╗\n");
+    printf("║  TEST SUMMARY                                              ║\n");
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+    printf("║  Total:  %3d                                               ║\n", tests_run);
+    printf("║  Passed: %3d                                               ║\n", tests_passed);
+    printf("║  Failed: %3d                                               ║\n", tests_failed);
+    printf("╠════════════════════════════════════════════════════════════╣\n");
+
+    if (tests_failed == 0) {
+        printf("║  STATUS: ✓ ALL TESTS PASSED                               ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 0;
+    } else {
+        printf("║  STATUS: ✗ SOME TESTS FAILED - DEBUG REQUIRED            ║\n");
+        printf("╚════════════════════════════════════════════════════════════╝\n");
+        return 1;
+    }
+}